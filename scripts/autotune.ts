@@ -0,0 +1,216 @@
+/**
+ * Tuning-parameter autotuner over the integration graphs.
+ *
+ * For each graph, searches its autotunable tuning params (`autotune: true`,
+ * numeric, with ui.min/ui.max) for the lowest median frame time measured by
+ * src/metal/scene-bench.mm, using coordinate descent: starting from the
+ * defaults, each param in turn is swept over its grid (ui.step, or --levels
+ * evenly spaced values; whole numbers for int params) with the others held,
+ * and the best value kept when it beats the current time by --min-gain.
+ * Passes repeat until one makes no change or --passes is reached.
+ *
+ * Frames are timed on the CPU backend (scene-bench built as plain C++, see
+ * bench-scenes.ts --cpu), so scenes that draw are skipped; --metal times the
+ * Metal build instead.
+ *
+ * The winning values are written to the tuning cache (tuning-cache.h),
+ * replacing any earlier entry for the same graph hash and machine. Hosts
+ * load it at startup: the harness and scene-bench with -T <path>, the FFGL
+ * plugin from NANO_TUNING_CACHE. Prints a JSON report of the search.
+ *
+ * Usage: npx ts-node scripts/autotune.ts [--scenes blur,noise,...]
+ *          [--resolution 1080p] [--frames 30] [--warmup 3] [--threads 0]
+ *          [--levels 5] [--passes 3] [--min-gain 0.02] [--metal]
+ *          [--cache ~/.nano-ffglify/tuning-cache.tsv]
+ */
+import { buildScene, cpuUnsupported, inputArgs, resourceSpecs, RESOLUTIONS, SCENES } from './scene-build';
+import { getMetalBuildDir } from '../src/metal/metal-compile';
+import { InputDef, IRDocument } from '../src/ir/types';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { execSync } from 'child_process';
+
+interface Measurement {
+  frameMs: number;
+  graphHash: string;
+  machine: string;
+}
+
+function parseArgs(argv: string[]) {
+  const opts = {
+    scenes: Object.keys(SCENES),
+    resolution: '1080p',
+    frames: 30,
+    warmup: 3,
+    threads: 0,
+    levels: 5,
+    passes: 3,
+    minGain: 0.02,
+    metal: false,
+    cache: path.join(os.homedir(), '.nano-ffglify', 'tuning-cache.tsv'),
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const value = argv[i + 1];
+    switch (argv[i]) {
+      case '--scenes': opts.scenes = value.split(','); i++; break;
+      case '--resolution': opts.resolution = value; i++; break;
+      case '--frames': opts.frames = parseInt(value); i++; break;
+      case '--warmup': opts.warmup = parseInt(value); i++; break;
+      case '--threads': opts.threads = parseInt(value); i++; break;
+      case '--levels': opts.levels = Math.max(2, parseInt(value)); i++; break;
+      case '--passes': opts.passes = Math.max(1, parseInt(value)); i++; break;
+      case '--min-gain': opts.minGain = parseFloat(value); i++; break;
+      case '--metal': opts.metal = true; break;
+      case '--cache': opts.cache = value; i++; break;
+      default: throw new Error(`Unknown argument '${argv[i]}'`);
+    }
+  }
+  if (!RESOLUTIONS[opts.resolution]) {
+    throw new Error(`Unknown resolution '${opts.resolution}' (${Object.keys(RESOLUTIONS).join(', ')})`);
+  }
+  for (const s of opts.scenes) {
+    if (!SCENES[s]) throw new Error(`Unknown scene '${s}' (${Object.keys(SCENES).join(', ')})`);
+  }
+  return opts;
+}
+
+// Params the autotuner may change, and the values it tries for each.
+function searchSpace(ir: IRDocument, levels: number): { param: InputDef; values: number[] }[] {
+  const space: { param: InputDef; values: number[] }[] = [];
+  for (const param of ir.tuningParams || []) {
+    const min = param.ui?.min;
+    const max = param.ui?.max;
+    if (!param.autotune || (param.type !== 'float' && param.type !== 'int')) continue;
+    if (min === undefined || max === undefined || max <= min) continue;
+    const values = new Set<number>();
+    const step = param.ui?.step ?? (param.type === 'int' && max - min < levels ? 1 : (max - min) / (levels - 1));
+    for (let v = min; v <= max + step * 1e-6; v += step) {
+      values.add(param.type === 'int' ? Math.round(v) : Number(v.toPrecision(6)));
+    }
+    if (typeof param.default === 'number') values.add(param.default);
+    space.push({ param, values: [...values].sort((a, b) => a - b) });
+  }
+  return space;
+}
+
+function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const buildDir = getMetalBuildDir();
+  const [width, height] = RESOLUTIONS[opts.resolution];
+
+  const results: any[] = [];
+  const entries: { graphHash: string; machine: string; frameMs: number; values: Record<string, number> }[] = [];
+  for (const name of opts.scenes) {
+    const ir = SCENES[name];
+    const space = searchSpace(ir, opts.levels);
+    if (space.length === 0) {
+      console.error(`${name}: no autotunable tuning params, skipped`);
+      results.push({ scene: name, skipped: 'no autotunable tuning params' });
+      continue;
+    }
+    const unsupported = opts.metal ? '' : cpuUnsupported(ir);
+    if (unsupported) {
+      console.error(`${name}: ${unsupported}, skipped`);
+      results.push({ scene: name, skipped: unsupported });
+      continue;
+    }
+    console.error(`Building ${name}...`);
+    const { driverPath, metallibPath, resourceIds } = buildScene(name, ir, buildDir, !opts.metal);
+    const baseArgs = [
+      metallibPath ? `"${metallibPath}"` : '',
+      ...inputArgs(ir),
+      '-n', String(opts.frames), '-w', String(opts.warmup), '-j', String(opts.threads),
+    ].filter(Boolean);
+    const specs = resourceSpecs(ir, resourceIds, width, height);
+
+    // Median frame time with `values` overriding the defaults (the later -i wins).
+    const measured = new Map<string, number>();
+    let evaluations = 0;
+    const measure = (values: Record<string, number>): Measurement => {
+      const overrides = Object.entries(values).flatMap(([id, v]) => ['-i', `${id}:${v}`]);
+      const out = JSON.parse(execSync(`"${driverPath}" ${[...baseArgs, ...overrides, ...specs].join(' ')}`, {
+        encoding: 'utf-8',
+        stdio: ['pipe', 'pipe', 'inherit'],
+      }).trim());
+      evaluations++;
+      return { frameMs: out.frameMs.p50, graphHash: out.graphHash, machine: out.machine };
+    };
+    const cost = (values: Record<string, number>): number => {
+      const key = JSON.stringify(values);
+      if (!measured.has(key)) measured.set(key, measure(values).frameMs);
+      return measured.get(key)!;
+    };
+
+    const current: Record<string, number> = {};
+    for (const { param, values } of space) {
+      current[param.id] = typeof param.default === 'number' ? param.default : values[0];
+    }
+    const baseline = measure(current);
+    measured.set(JSON.stringify(current), baseline.frameMs);
+    let best = baseline.frameMs;
+    let passes = 0;
+    for (let pass = 0; pass < opts.passes; pass++) {
+      passes++;
+      let changed = false;
+      for (const { param, values } of space) {
+        for (const v of values) {
+          if (v === current[param.id]) continue;
+          const t = cost({ ...current, [param.id]: v });
+          if (t < best * (1 - opts.minGain)) {
+            best = t;
+            current[param.id] = v;
+            changed = true;
+          }
+        }
+        console.error(`  ${name} ${param.id} = ${current[param.id]} (${best.toFixed(3)} ms)`);
+      }
+      if (!changed) break;
+    }
+
+    entries.push({ graphHash: baseline.graphHash, machine: baseline.machine, frameMs: best, values: { ...current } });
+    results.push({
+      scene: name,
+      graphHash: baseline.graphHash,
+      machine: baseline.machine,
+      baselineMs: baseline.frameMs,
+      bestMs: best,
+      speedup: baseline.frameMs / best,
+      evaluations,
+      passes,
+      values: current,
+    });
+  }
+
+  // Rewrite the cache, dropping entries superseded by this run.
+  const replaced = new Set(entries.map(e => `${e.graphHash}\t${e.machine}`));
+  const kept = fs.existsSync(opts.cache)
+    ? fs.readFileSync(opts.cache, 'utf-8').split('\n').filter(line => {
+      if (!line || line.startsWith('#')) return false;
+      const [graph, machine] = line.split('\t');
+      return !replaced.has(`${graph}\t${machine}`);
+    })
+    : [];
+  const lines = [
+    '# nano-ffglify tuning cache: graph hash, machine, frame ms, name=value ...',
+    ...kept,
+    ...entries.map(e => [e.graphHash, e.machine, e.frameMs.toFixed(4),
+      Object.entries(e.values).map(([id, v]) => `${id}=${v}`).join(' ')].join('\t')),
+  ];
+  if (entries.length > 0) {
+    fs.mkdirSync(path.dirname(opts.cache), { recursive: true });
+    fs.writeFileSync(opts.cache, lines.join('\n') + '\n');
+    console.error(`Wrote ${opts.cache}`);
+  }
+
+  console.log(JSON.stringify({
+    date: new Date().toISOString(),
+    resolution: opts.resolution,
+    backend: opts.metal ? 'metal' : 'cpu',
+    frames: opts.frames,
+    cache: opts.cache,
+    results,
+  }, null, 2));
+}
+
+main();
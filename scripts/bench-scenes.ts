@@ -0,0 +1,144 @@
+/**
+ * Scene-level throughput benchmark over the integration graphs.
+ *
+ * Compiles each graph with CppGenerator (plus its shaders with MslGenerator),
+ * builds src/metal/scene-bench.mm against it and runs N frames per
+ * resolution and worker-thread count. Prints one JSON report (or writes it to
+ * --out) with frame-time percentiles, scaling efficiency relative to the
+ * single-thread run, memory high-water marks and heap allocations per frame,
+ * tagged with the commit so runs can be tracked over time.
+ *
+ * Shaders run on Metal by default, where the thread count only affects
+ * CPU-side work. With --cpu the driver is built without Metal and shaders run
+ * as CPU kernels on the worker pool, so the thread sweep measures kernel
+ * scaling; scenes that draw are skipped.
+ *
+ * Usage: npx ts-node scripts/bench-scenes.ts [--frames 120] [--warmup 5]
+ *          [--resolutions 720p,1080p,4k] [--threads 1,2,4,8]
+ *          [--scenes blur,noise,...] [--cpu] [--out report.json]
+ */
+import { buildScene, cpuUnsupported, inputArgs, resourceSpecs, RESOLUTIONS, SCENES } from './scene-build';
+import { getMetalBuildDir } from '../src/metal/metal-compile';
+import * as fs from 'fs';
+import * as os from 'os';
+import * as path from 'path';
+import { execSync } from 'child_process';
+
+interface SceneRun {
+  threads: number;
+  frameMs: { mean: number; min: number; p50: number; p90: number; p99: number; max: number };
+  fps: number;
+  scalingEfficiency: number;
+  peakResourceBytes: number;
+  reallocations: number;
+  allocationsPerFrame: { mean: number; max: number };
+  peakRssBytes: number;
+}
+
+function parseArgs(argv: string[]) {
+  const opts = {
+    frames: 120,
+    warmup: 5,
+    resolutions: Object.keys(RESOLUTIONS),
+    threads: [1, 2, 4, 8],
+    scenes: Object.keys(SCENES),
+    cpu: false,
+    out: '',
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const value = argv[i + 1];
+    switch (argv[i]) {
+      case '--frames': opts.frames = parseInt(value); i++; break;
+      case '--warmup': opts.warmup = parseInt(value); i++; break;
+      case '--resolutions': opts.resolutions = value.split(','); i++; break;
+      case '--threads': opts.threads = value.split(',').map(t => parseInt(t)); i++; break;
+      case '--scenes': opts.scenes = value.split(','); i++; break;
+      case '--cpu': opts.cpu = true; break;
+      case '--out': opts.out = value; i++; break;
+      default: throw new Error(`Unknown argument '${argv[i]}'`);
+    }
+  }
+  for (const r of opts.resolutions) {
+    if (!RESOLUTIONS[r]) throw new Error(`Unknown resolution '${r}' (${Object.keys(RESOLUTIONS).join(', ')})`);
+  }
+  for (const s of opts.scenes) {
+    if (!SCENES[s]) throw new Error(`Unknown scene '${s}' (${Object.keys(SCENES).join(', ')})`);
+  }
+  return opts;
+}
+
+function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const buildDir = getMetalBuildDir();
+  const repoRoot = path.resolve(__dirname, '..');
+  let commit = '';
+  try {
+    commit = execSync('git rev-parse HEAD', { cwd: repoRoot, encoding: 'utf-8' }).trim();
+  } catch {
+    // Not a checkout
+  }
+
+  const results: any[] = [];
+  for (const name of opts.scenes) {
+    const ir = SCENES[name];
+    const unsupported = opts.cpu ? cpuUnsupported(ir) : '';
+    if (unsupported) {
+      console.error(`${name}: ${unsupported}, skipped`);
+      results.push({ scene: name, skipped: unsupported });
+      continue;
+    }
+    console.error(`Building ${name}...`);
+    const { driverPath, metallibPath, resourceIds } = buildScene(name, ir, buildDir, opts.cpu);
+    for (const resolution of opts.resolutions) {
+      const [width, height] = RESOLUTIONS[resolution];
+      const runs: SceneRun[] = [];
+      for (const threads of opts.threads) {
+        const args = [
+          metallibPath ? `"${metallibPath}"` : '',
+          ...inputArgs(ir),
+          '-n', String(opts.frames), '-w', String(opts.warmup), '-j', String(threads),
+          ...resourceSpecs(ir, resourceIds, width, height),
+        ].filter(Boolean);
+        console.error(`  ${name} ${resolution} x${threads}`);
+        const out = JSON.parse(execSync(`"${driverPath}" ${args.join(' ')}`, {
+          encoding: 'utf-8',
+          stdio: ['pipe', 'pipe', 'inherit'],
+        }).trim());
+        runs.push({
+          threads: out.threads,
+          frameMs: out.frameMs,
+          fps: 1000 / out.frameMs.mean,
+          scalingEfficiency: 1,
+          peakResourceBytes: out.peakResourceBytes,
+          reallocations: out.reallocations,
+          allocationsPerFrame: out.allocationsPerFrame,
+          peakRssBytes: out.peakRssBytes,
+        });
+      }
+      // Speedup over the fewest-thread run, divided by the thread ratio.
+      const base = runs.reduce((a, b) => (b.threads < a.threads ? b : a), runs[0]);
+      for (const run of runs) {
+        run.scalingEfficiency = (base.frameMs.mean / run.frameMs.mean) / (run.threads / base.threads);
+      }
+      results.push({ scene: name, resolution, width, height, runs });
+    }
+  }
+
+  const report = {
+    commit,
+    date: new Date().toISOString(),
+    machine: { platform: process.platform, arch: process.arch, cpu: os.cpus()[0]?.model || '', cores: os.cpus().length },
+    backend: opts.cpu ? 'cpu' : 'metal',
+    frames: opts.frames,
+    results,
+  };
+  const json = JSON.stringify(report, null, 2);
+  if (opts.out) {
+    fs.writeFileSync(opts.out, json + '\n');
+    console.error(`Wrote ${opts.out}`);
+  } else {
+    console.log(json);
+  }
+}
+
+main();
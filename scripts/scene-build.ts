@@ -0,0 +1,119 @@
+/**
+ * Shared pieces of the scene scripts (bench-scenes.ts, autotune.ts): the
+ * integration graphs, benchmark resolutions, and building and driving
+ * src/metal/scene-bench.mm for one graph, on Metal or (with `cpu`) as plain
+ * C++ on the CPU backend.
+ */
+import { CppGenerator } from '../src/metal/cpp-generator';
+import { MslGenerator } from '../src/metal/msl-generator';
+import {
+  BLUR_SHADER,
+  FEEDBACK_SHADER,
+  HISTOGRAM_SHADER,
+  NOISE_SHADER,
+  PARTICLE_SHADER,
+  RAYMARCH_SHADER,
+  UV_WARP_SHADER,
+} from '../src/domain/example-ir';
+import { IRDocument, ResourceDef } from '../src/ir/types';
+import { compileCppHost, compileMetalShader } from '../src/metal/metal-compile';
+import * as fs from 'fs';
+import * as path from 'path';
+
+export const SCENES: Record<string, IRDocument> = {
+  blur: BLUR_SHADER,
+  particle: PARTICLE_SHADER,
+  raymarch: RAYMARCH_SHADER,
+  histogram: HISTOGRAM_SHADER,
+  noise: NOISE_SHADER,
+  feedback: FEEDBACK_SHADER,
+  'uv-warp': UV_WARP_SHADER,
+};
+
+export const RESOLUTIONS: Record<string, [number, number]> = {
+  '720p': [1280, 720],
+  '1080p': [1920, 1080],
+  '4k': [3840, 2160],
+};
+
+// Why a scene cannot run on the CPU backend, or '' if it can: draws need
+// Metal, and skipping them would time a different scene.
+export function cpuUnsupported(ir: IRDocument): string {
+  const draws = ir.functions.some(f => f.nodes.some(n => n.op === 'cmd_draw'));
+  return draws ? 'cmd_draw requires the Metal backend' : '';
+}
+
+// Compile one scene; returns the driver and metallib paths, its resource ids
+// and its autotune cache key. With `cpu` the driver is built as plain C++ and
+// there is no metallib, so shaders run as CPU kernels.
+export function buildScene(name: string, ir: IRDocument, buildDir: string, cpu = false) {
+  const metalDir = path.resolve(__dirname, '../src/metal');
+  const sceneDir = path.join(buildDir, `scene-bench-${name}`);
+  fs.mkdirSync(sceneDir, { recursive: true });
+
+  const { code, resourceIds, shaderFunctions, graphHash } = new CppGenerator().compile(ir, ir.entryPoint);
+  fs.writeFileSync(path.join(sceneDir, 'generated_code.cpp'), code);
+
+  let metallibPath = '';
+  if (!cpu && shaderFunctions.length > 0) {
+    const stages = new Map<string, 'compute' | 'vertex' | 'fragment'>();
+    shaderFunctions.forEach(f => { if (f.stage) stages.set(f.id, f.stage); });
+    const resourceBindings = new Map<string, number>();
+    resourceIds.forEach((id, idx) => resourceBindings.set(id, idx + 1));
+    const { code: mslCode } = new MslGenerator().compileLibrary(
+      ir, shaderFunctions.map(s => s.id), { stages, resourceBindings });
+    const mslPath = path.join(sceneDir, 'shaders.metal');
+    fs.writeFileSync(mslPath, mslCode);
+    metallibPath = compileMetalShader(mslPath, sceneDir, [metalDir]).metallibPath;
+  }
+
+  const driverPath = path.join(sceneDir, cpu ? 'scene-bench-cpu' : 'scene-bench');
+  compileCppHost({
+    sourcePaths: [path.join(metalDir, 'scene-bench.mm')],
+    outputPath: driverPath,
+    objc: !cpu,
+    extraFlags: [...(cpu ? ['-x c++'] : []), `-I"${sceneDir}"`, '-pthread'],
+  });
+  return { driverPath, metallibPath, resourceIds, graphHash };
+}
+
+// Resource specs for scene-bench (same order and format as cpp-harness):
+// viewport-sized and input textures take the benchmark resolution.
+export function resourceSpecs(ir: IRDocument, resourceIds: string[], width: number, height: number): string[] {
+  return resourceIds.map(id => {
+    const r = (ir.resources.find(res => res.id === id) || ir.inputs.find(inp => inp.id === id)) as ResourceDef | undefined;
+    if (!r) return '0';
+    const fixed = r.size && r.size.mode === 'fixed' ? r.size.value : undefined;
+    if (r.type === 'texture2d') {
+      const scale = r.size && r.size.mode === 'viewport' ? r.size.scale ?? 1 : 1;
+      const [sx, sy] = Array.isArray(scale) ? scale : [scale, scale];
+      const [w, h] = Array.isArray(fixed) ? fixed : typeof fixed === 'number' ? [fixed, 1]
+        : [Math.max(1, Math.round(width * sx)), Math.max(1, Math.round(height * sy))];
+      return `T:${w}:${h}:${r.sampler?.wrap === 'clamp' ? 1 : 0}`;
+    }
+    const size = typeof fixed === 'number' ? fixed : 100;
+    if (r.type === 'atomic_counter') return `B:${size}:1`;
+    const dt = r.dataType;
+    const struct = ir.structs?.find(s => s.id === dt);
+    const floatsOf = (t?: string) => t === 'float4' || t === 'int4' ? 4 : t === 'float3' || t === 'int3' ? 3
+      : t === 'float2' || t === 'int2' ? 2 : t === 'float3x3' ? 9 : t === 'float4x4' ? 16 : 1;
+    const stride = struct ? struct.members.reduce((sum, m) => sum + floatsOf(m.type), 0) : floatsOf(dt);
+    return `B:${size}:${stride}`;
+  });
+}
+
+// -i arguments for the graph's input defaults (vectors as name_0, name_1, ...).
+export function inputArgs(ir: IRDocument): string[] {
+  const args: string[] = [];
+  for (const input of [...(ir.inputs || []), ...(ir.tuningParams || [])]) {
+    const value = input.default;
+    if (Array.isArray(value)) {
+      value.forEach((v, i) => args.push('-i', `${input.id}_${i}:${v}`));
+    } else if (typeof value === 'number') {
+      args.push('-i', `${input.id}:${value}`);
+    } else if (typeof value === 'boolean') {
+      args.push('-i', `${input.id}:${value ? 1 : 0}`);
+    }
+  }
+  return args;
+}
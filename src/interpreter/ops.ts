@@ -1,6 +1,7 @@
 import { IRDocument, BuiltinOp, TextureFormat, TextureFormatValues, TextureFormatFromId } from '../ir/types';
-import { AtomicLoadArgs, AtomicStoreArgs, AtomicRmwArgs, CmdSyncToCpuArgs, CmdWaitCpuSyncArgs, CmdCopyBufferArgs, CmdCopyTextureArgs, PrngMakeArgs, PrngNextArgs, OpArgs } from '../ir/builtin-schemas';
+import { AtomicLoadArgs, AtomicStoreArgs, AtomicRmwArgs, CmdSyncToCpuArgs, CmdWaitCpuSyncArgs, CmdCopyBufferArgs, CmdCopyTextureArgs, CmdBlurTextureArgs, CmdScanBufferArgs, CmdCompactBufferArgs, CmdSortBufferArgs, CmdReduceBufferArgs, CmdConvolveTextureArgs, PrngMakeArgs, PrngNextArgs, OpArgs } from '../ir/builtin-schemas';
 import { EvaluationContext, RuntimeValue, VectorValue } from './context';
+import { blurTexture, compactBuffer, convolveTexture, reduceBuffer, scanBuffer, sortBuffer } from '../runtime/resource-ops';
 
 export type OpHandler<K extends BuiltinOp> = (ctx: EvaluationContext, args: OpArgs[K]) => RuntimeValue | void;
 
@@ -1021,6 +1022,31 @@ export const OpRegistry: { [K in BuiltinOp]: OpHandler<K> } = {
     throw new Error('cmd_copy_texture not implemented in interpreter');
   },
 
+  // Whole-resource ops on the CPU copies (runtime/resource-ops.ts)
+  'cmd_blur_texture': function (ctx: EvaluationContext, args: CmdBlurTextureArgs): RuntimeValue | void {
+    blurTexture(ctx.resources, args.src, args.dst, Number(args.radius), Number(args.sigma ?? 0), args.mode ?? 'gaussian');
+  },
+  'cmd_scan_buffer': function (ctx: EvaluationContext, args: CmdScanBufferArgs): RuntimeValue | void {
+    const count = args.count !== undefined ? Number(args.count) : Infinity;
+    scanBuffer(ctx.resources, args.src, args.dst, args.inclusive === true, count, args.total ?? null);
+  },
+  'cmd_compact_buffer': function (ctx: EvaluationContext, args: CmdCompactBufferArgs): RuntimeValue | void {
+    compactBuffer(ctx.resources, args.src, args.dst, args.flags ?? null, args.counter ?? null);
+  },
+  'cmd_sort_buffer': function (ctx: EvaluationContext, args: CmdSortBufferArgs): RuntimeValue | void {
+    const count = args.count !== undefined ? Number(args.count) : Infinity;
+    sortBuffer(ctx.resources, args.src, args.dst, Number(args.key_component ?? 0), args.keys ?? null, args.descending === true, count);
+  },
+  'cmd_reduce_buffer': function (ctx: EvaluationContext, args: CmdReduceBufferArgs): RuntimeValue | void {
+    const count = args.count !== undefined ? Number(args.count) : Infinity;
+    reduceBuffer(ctx.resources, args.src, args.dst, args.mode ?? 'sum', Number(args.component ?? -1), count,
+      Number(args.bins ?? -1), Number(args.range_min ?? 0), Number(args.range_max ?? 1));
+  },
+  'cmd_convolve_texture': function (ctx: EvaluationContext, args: CmdConvolveTextureArgs): RuntimeValue | void {
+    convolveTexture(ctx.resources, args.src, args.dst, args.kernel ?? null, Number(args.radius ?? 0),
+      Number(args.sigma ?? 0), args.normalize !== false);
+  },
+
   // PRNG ops — interpreter is disabled but stubs needed for type completeness
   'prng_make': function (ctx: EvaluationContext, args: PrngMakeArgs): RuntimeValue | void {
     throw new Error('prng_make not implemented in interpreter');
@@ -225,6 +225,12 @@ export interface AtomicRmwArgs { counter: string; index: any; value: any; [key:
 
 export interface CmdCopyBufferArgs { src: string; dst: string; src_offset?: any; dst_offset?: any; count?: any; [key: string]: any; }
 export interface CmdCopyTextureArgs { src: string; dst: string; src_rect?: any; dst_rect?: any; sample?: string; alpha?: any; normalized?: boolean; [key: string]: any; }
+export interface CmdBlurTextureArgs { src: string; dst: string; radius: any; sigma?: any; mode?: string; [key: string]: any; }
+export interface CmdScanBufferArgs { src: string; dst: string; inclusive?: boolean; count?: any; total?: string; [key: string]: any; }
+export interface CmdCompactBufferArgs { src: string; dst: string; flags?: string; counter?: string; [key: string]: any; }
+export interface CmdSortBufferArgs { src: string; dst: string; key_component?: number; keys?: string; descending?: boolean; count?: any; [key: string]: any; }
+export interface CmdReduceBufferArgs { src: string; dst: string; mode?: string; component?: number; count?: any; bins?: number; range_min?: any; range_max?: any; [key: string]: any; }
+export interface CmdConvolveTextureArgs { src: string; dst: string; kernel?: string; radius?: any; sigma?: any; normalize?: boolean; [key: string]: any; }
 
 export interface ArrayConstructArgs {
   values?: any[];
@@ -919,6 +925,82 @@ export const OpDefs: Record<BuiltinOp, OpDef<any>> = {
       normalized: { type: BoolSchema, doc: "If true, rect coords are 0..1 relative to texture dims", optional: true }
     }
   }),
+  'cmd_blur_texture': defineOp<CmdBlurTextureArgs>({
+    doc: "Blur a whole texture into another of the same size (or in place) with a separable Gaussian or box filter. Edges follow the source's wrap mode. Much faster than blurring with texture_sample loops on the CPU backend.",
+    isExecutable: true,
+    cpuOnly: true,
+    args: {
+      src: { type: z.string(), doc: "Source texture resource ID", requiredRef: true, refType: 'resource', isIdentifier: true },
+      dst: { type: z.string(), doc: "Destination texture resource ID (may equal src)", requiredRef: true, refType: 'resource', isIdentifier: true, isPrimaryResource: true },
+      radius: { type: FloatSchema, doc: "Kernel radius in pixels", refable: true },
+      sigma: { type: FloatSchema, doc: "Gaussian standard deviation in pixels (default radius / 3)", refable: true, optional: true },
+      mode: { type: z.string(), doc: "'gaussian' (default) or 'box'", optional: true, literalTypes: ['string'] }
+    }
+  }),
+  'cmd_scan_buffer': defineOp<CmdScanBufferArgs>({
+    doc: "Prefix sum of a buffer's elements (component-wise for vector types) into another buffer, or in place: exclusive by default, so dst[i] is the sum of src[0..i). Use for allocating output indices from per-element counts. Runs in parallel on the CPU backend.",
+    isExecutable: true,
+    cpuOnly: true,
+    args: {
+      src: { type: z.string(), doc: "Source buffer resource ID", requiredRef: true, refType: 'resource', isIdentifier: true },
+      dst: { type: z.string(), doc: "Destination buffer resource ID (may equal src)", requiredRef: true, refType: 'resource', isIdentifier: true, isPrimaryResource: true },
+      inclusive: { type: BoolSchema, doc: "If true, dst[i] also includes src[i]", optional: true },
+      count: { type: IntSchema, doc: "Number of typed elements to scan (default: all)", refable: true, optional: true },
+      total: { type: z.string(), doc: "Buffer or atomic counter receiving the total at index 0", optional: true, refType: 'resource', isIdentifier: true }
+    }
+  }),
+  'cmd_compact_buffer': defineOp<CmdCompactBufferArgs>({
+    doc: "Stream compaction: copy, in order, the elements of src whose flag is positive to the front of dst (which may equal src), e.g. to drop dead particles. Flags come from a separate buffer, or each element's first component. Elements of dst past the kept ones are left unchanged. Runs in parallel on the CPU backend.",
+    isExecutable: true,
+    cpuOnly: true,
+    args: {
+      src: { type: z.string(), doc: "Source buffer resource ID", requiredRef: true, refType: 'resource', isIdentifier: true },
+      dst: { type: z.string(), doc: "Destination buffer resource ID (may equal src)", requiredRef: true, refType: 'resource', isIdentifier: true, isPrimaryResource: true },
+      flags: { type: z.string(), doc: "Buffer of per-element flags (default: each element's first component)", optional: true, refType: 'resource', isIdentifier: true },
+      counter: { type: z.string(), doc: "Buffer or atomic counter receiving the number of kept elements at index 0", optional: true, refType: 'resource', isIdentifier: true }
+    }
+  }),
+  'cmd_sort_buffer': defineOp<CmdSortBufferArgs>({
+    doc: "Stable sort of a buffer's elements into another buffer, or in place, by a float key: one component of each element (so struct payloads move with their key), or a separate keys buffer, which is sorted along with them. Ascending by default; sort descending for back-to-front drawing of depth-sorted particles. Integer keys sort exactly up to 2^24. Runs as a parallel radix sort on the CPU backend.",
+    isExecutable: true,
+    cpuOnly: true,
+    args: {
+      src: { type: z.string(), doc: "Source buffer resource ID", requiredRef: true, refType: 'resource', isIdentifier: true },
+      dst: { type: z.string(), doc: "Destination buffer resource ID (may equal src)", requiredRef: true, refType: 'resource', isIdentifier: true, isPrimaryResource: true },
+      key_component: { type: IntSchema, doc: "Component of each element used as its key (default 0); ignored with keys", optional: true },
+      keys: { type: z.string(), doc: "Buffer of per-element float keys, sorted along with the elements (default: key_component of each element)", optional: true, refType: 'resource', isIdentifier: true },
+      descending: { type: BoolSchema, doc: "If true, sort from the largest key to the smallest", optional: true },
+      count: { type: IntSchema, doc: "Number of leading elements to sort (default: all)", refable: true, optional: true }
+    }
+  }),
+  'cmd_reduce_buffer': defineOp<CmdReduceBufferArgs>({
+    doc: "Reduce a buffer or texture into a result buffer: 'sum', 'min', 'max' or 'mean' (one value per component, or of component), 'argmin'/'argmax' (first index of the extreme value of component) or 'histogram' (bins counts of component over [range_min, range_max), e.g. luminance for auto-exposure). Runs in parallel on the CPU backend with results that are identical run to run.",
+    isExecutable: true,
+    cpuOnly: true,
+    args: {
+      src: { type: z.string(), doc: "Source buffer or texture resource ID", requiredRef: true, refType: 'resource', isIdentifier: true },
+      dst: { type: z.string(), doc: "Buffer or atomic counter receiving the results from index 0", requiredRef: true, refType: 'resource', isIdentifier: true, isPrimaryResource: true },
+      mode: { type: z.string(), doc: "'sum' (default), 'min', 'max', 'mean', 'argmin', 'argmax' or 'histogram'", optional: true, literalTypes: ['string'] },
+      component: { type: IntSchema, doc: "Component (texture channel) to reduce (default: every component; the first for argmin, argmax and histogram)", optional: true },
+      count: { type: IntSchema, doc: "Number of leading elements to reduce (default: all)", refable: true, optional: true },
+      bins: { type: IntSchema, doc: "Histogram bin count (default: the size of dst)", optional: true },
+      range_min: { type: FloatSchema, doc: "Lower edge of the first histogram bin (default 0); lower values count in it", refable: true, optional: true },
+      range_max: { type: FloatSchema, doc: "Upper edge of the last histogram bin (default 1); higher values count in it", refable: true, optional: true }
+    }
+  }),
+  'cmd_convolve_texture': defineOp<CmdConvolveTextureArgs>({
+    doc: "Convolve a whole texture into another of the same size (or in place) with a large kernel, through FFTs: a Gaussian of the given radius, or the first channel of a kernel texture centred on its middle texel. For bloom and glow with radii of tens to hundreds of pixels, where cmd_blur_texture gets expensive; the cost depends on the image size padded by the radius, not on the kernel. Edges follow the source's wrap mode. Kernel spectra are cached between frames.",
+    isExecutable: true,
+    cpuOnly: true,
+    args: {
+      src: { type: z.string(), doc: "Source texture resource ID", requiredRef: true, refType: 'resource', isIdentifier: true },
+      dst: { type: z.string(), doc: "Destination texture resource ID (may equal src)", requiredRef: true, refType: 'resource', isIdentifier: true, isPrimaryResource: true },
+      kernel: { type: z.string(), doc: "Kernel texture resource ID (default: a Gaussian of radius)", optional: true, refType: 'resource', isIdentifier: true },
+      radius: { type: FloatSchema, doc: "Gaussian radius in pixels, when there is no kernel texture", refable: true, optional: true },
+      sigma: { type: FloatSchema, doc: "Gaussian standard deviation in pixels (default radius / 3)", refable: true, optional: true },
+      normalize: { type: BoolSchema, doc: "Scale the kernel to sum to 1, keeping the image's brightness (default true)", optional: true }
+    }
+  }),
 
   // Logic / Control
   'var_set': VarSetDef,
@@ -1046,6 +1128,12 @@ export type OpArgs = {
   'cmd_wait_cpu_sync': CmdWaitCpuSyncArgs;
   'cmd_copy_buffer': CmdCopyBufferArgs;
   'cmd_copy_texture': CmdCopyTextureArgs;
+  'cmd_blur_texture': CmdBlurTextureArgs;
+  'cmd_scan_buffer': CmdScanBufferArgs;
+  'cmd_compact_buffer': CmdCompactBufferArgs;
+  'cmd_sort_buffer': CmdSortBufferArgs;
+  'cmd_reduce_buffer': CmdReduceBufferArgs;
+  'cmd_convolve_texture': CmdConvolveTextureArgs;
   'var_set': VarSetArgs;
   'var_get': VarGetArgs;
   'builtin_get': BuiltinGetArgs;
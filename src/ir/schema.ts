@@ -49,9 +49,11 @@ const InputDefSchema = z.object({
   comment: z.string().optional(),
   default: z.any().optional(),
   sidechannel: z.boolean().optional(),
+  autotune: z.boolean().optional(),
   ui: z.object({
     min: z.number().optional(),
     max: z.number().optional(),
+    step: z.number().optional(),
     widget: z.enum(['slider', 'color_picker', 'text', 'toggle', 'file']).optional(),
   }).optional(),
 });
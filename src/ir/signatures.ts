@@ -435,6 +435,37 @@ export const OpSignatures: Partial<Record<BuiltinOp, OpSignature[]>> = {
     { inputs: { src: 'string', dst: 'string', src_rect: 'float4', dst_rect: 'float4', sample: 'string', alpha: 'float', normalized: 'boolean' }, output: 'any' },
     { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
   ],
+  'cmd_blur_texture': [
+    { inputs: { src: 'string', dst: 'string', radius: 'float' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', radius: 'float', sigma: 'float', mode: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
+  ],
+  'cmd_scan_buffer': [
+    { inputs: { src: 'string', dst: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', inclusive: 'boolean', count: 'int', total: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
+  ],
+  'cmd_compact_buffer': [
+    { inputs: { src: 'string', dst: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', flags: 'string', counter: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
+  ],
+  'cmd_sort_buffer': [
+    { inputs: { src: 'string', dst: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', key_component: 'int', keys: 'string', descending: 'boolean', count: 'int' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
+  ],
+  'cmd_reduce_buffer': [
+    { inputs: { src: 'string', dst: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', mode: 'string', component: 'int', count: 'int', bins: 'int', range_min: 'float', range_max: 'float' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
+  ],
+  'cmd_convolve_texture': [
+    { inputs: { src: 'string', dst: 'string', radius: 'float' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', kernel: 'string' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', kernel: 'string', radius: 'float', sigma: 'float', normalize: 'boolean' }, output: 'any' },
+    { inputs: { src: 'string', dst: 'string', '*': 'any' }, output: 'any' }
+  ],
 
   // Atomics
   'atomic_load':     [{ inputs: { counter: 'string', index: 'int' }, output: 'int' }],
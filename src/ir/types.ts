@@ -78,9 +78,11 @@ export interface InputDef {
   format?: string;   // For textures: 'rgba8', 'rgba32f', etc. hints for UI/Validation
   default?: any;     // Default value if not provided by host
   sidechannel?: boolean; // Texture passed via back-channel, not counted as FFGL input
+  autotune?: boolean; // Tuning param the autotuner may search over ui.min..ui.max (performance knobs only)
   ui?: {
     min?: number;
     max?: number;
+    step?: number;   // Autotune grid spacing (default: a few evenly spaced values; 1 for int)
     widget?: 'slider' | 'color_picker' | 'text' | 'toggle' | 'file';
   };
 }
@@ -383,7 +385,9 @@ export type BuiltinOp =
   // Commands
   | 'cmd_dispatch' | 'cmd_resize_resource' | 'cmd_draw'
   | 'cmd_sync_to_cpu' | 'cmd_wait_cpu_sync'
-  | 'cmd_copy_buffer' | 'cmd_copy_texture';
+  | 'cmd_copy_buffer' | 'cmd_copy_texture' | 'cmd_blur_texture'
+  | 'cmd_scan_buffer' | 'cmd_compact_buffer' | 'cmd_sort_buffer' | 'cmd_reduce_buffer'
+  | 'cmd_convolve_texture';
 
 
 // ------------------------------------------------------------------
@@ -0,0 +1,115 @@
+#pragma once
+
+// Structured log of host-visible actions (currently resource resizes).
+//
+// EvalContext appends one POD record per action: the op, the resource index,
+// its new dimensions and a steady-clock timestamp. Records go into a ring
+// preallocated at construction, so logging never allocates; once the ring is
+// full the oldest records are overwritten and counted as dropped, unless a
+// drain callback is set, in which case the full ring is handed to it first.
+// Actions are logged from the thread that issues host commands.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+enum class ActionOp : uint8_t {
+  Resize,
+};
+
+inline const char *actionOpName(ActionOp op) {
+  switch (op) {
+  case ActionOp::Resize:
+    return "resize";
+  }
+  return "unknown";
+}
+
+struct ActionRecord {
+  ActionOp op = ActionOp::Resize;
+  int32_t resource = -1;
+  int32_t width = 0;
+  int32_t height = 0;
+  uint64_t timeNs = 0; // steady clock
+};
+
+class ActionLog {
+public:
+  // Receives `count` records, oldest first. The pointer is only valid during
+  // the call.
+  using Drain = std::function<void(const ActionRecord *records, size_t count)>;
+
+  // `capacity` is rounded up to a power of two.
+  explicit ActionLog(size_t capacity = 256) {
+    size_t n = 1;
+    while (n < capacity)
+      n <<= 1;
+    records.reset(new ActionRecord[n]);
+    scratch.reset(new ActionRecord[n]);
+    mask = n - 1;
+  }
+
+  ActionLog(const ActionLog &) = delete;
+  ActionLog &operator=(const ActionLog &) = delete;
+
+  void push(ActionOp op, int resource, int width, int height) {
+    if (size() == capacity()) {
+      if (drain)
+        flush();
+      else
+        ++droppedCount;
+    }
+    ActionRecord &r = records[head & mask];
+    r.op = op;
+    r.resource = resource;
+    r.width = width;
+    r.height = height;
+    r.timeNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    ++head;
+  }
+
+  // Called with the ring's contents when it fills and on flush().
+  void setDrain(Drain callback) { drain = std::move(callback); }
+
+  // Hand the records to the drain callback, if any, and empty the log.
+  void flush() {
+    size_t n = drain ? size() : 0;
+    for (size_t i = 0; i < n; ++i)
+      scratch[i] = (*this)[i];
+    tail = head;
+    if (n > 0)
+      drain(scratch.get(), n);
+  }
+
+  void clear() {
+    head = tail = 0;
+    droppedCount = 0;
+  }
+
+  size_t capacity() const { return mask + 1; }
+  size_t size() const {
+    uint64_t n = head - tail;
+    return n < capacity() ? static_cast<size_t>(n) : capacity();
+  }
+  bool empty() const { return head == tail; }
+  // Records overwritten because the ring was full and nothing drained it
+  uint64_t dropped() const { return droppedCount; }
+
+  // Record `i` of those held, oldest first.
+  const ActionRecord &operator[](size_t i) const {
+    return records[(head - size() + i) & mask];
+  }
+
+private:
+  std::unique_ptr<ActionRecord[]> records;
+  std::unique_ptr<ActionRecord[]> scratch; // contiguous copy for the drain
+  size_t mask = 0;
+  uint64_t head = 0; // records ever pushed
+  uint64_t tail = 0; // first record not yet flushed
+  uint64_t droppedCount = 0;
+  Drain drain;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+// Heap allocation counting for hosts and test drivers.
+//
+// AllocCounter reads process-wide counters of global operator new calls and
+// bytes. They count only in a program where exactly one translation unit
+// expands NANO_DEFINE_ALLOC_COUNTER() at namespace scope, which replaces
+// every replaceable global new and delete (plain, array, aligned and nothrow
+// forms) with versions that count and go through malloc and free (the
+// harness, the scene benchmark and the CPU runtime tests do; the FFGL plugin
+// does not). Hosts take a snapshot before and after a frame to get its
+// allocations and drive steady-state frames to zero.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+class AllocCounter {
+public:
+  struct Snapshot {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+  };
+
+  static Snapshot now() {
+    return {allocations().load(std::memory_order_relaxed),
+            bytes().load(std::memory_order_relaxed)};
+  }
+
+  // Allocations and bytes since `start`.
+  static Snapshot since(const Snapshot &start) {
+    Snapshot n = now();
+    return {n.allocations - start.allocations, n.bytes - start.bytes};
+  }
+
+  // True in programs that expanded NANO_DEFINE_ALLOC_COUNTER().
+  static std::atomic<bool> &installed() {
+    static std::atomic<bool> flag{false};
+    return flag;
+  }
+
+  static void count(size_t size) {
+    allocations().fetch_add(1, std::memory_order_relaxed);
+    bytes().fetch_add(size, std::memory_order_relaxed);
+  }
+
+  // The nothrow forms return null on failure; the others throw. Every form
+  // allocates with malloc / aligned_alloc so that any delete can free it.
+  static void *tryAllocate(size_t size) noexcept {
+    count(size);
+    return std::malloc(size ? size : 1);
+  }
+
+  static void *tryAllocateAligned(size_t size, size_t align) noexcept {
+    count(size);
+    size_t rounded = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded ? rounded : align);
+  }
+
+  static void *allocate(size_t size) {
+    if (void *p = tryAllocate(size))
+      return p;
+    throw std::bad_alloc();
+  }
+
+  static void *allocateAligned(size_t size, size_t align) {
+    if (void *p = tryAllocateAligned(size, align))
+      return p;
+    throw std::bad_alloc();
+  }
+
+private:
+  static std::atomic<uint64_t> &allocations() {
+    static std::atomic<uint64_t> n{0};
+    return n;
+  }
+  static std::atomic<uint64_t> &bytes() {
+    static std::atomic<uint64_t> n{0};
+    return n;
+  }
+};
+
+#define NANO_DEFINE_ALLOC_COUNTER()                                            \
+  [[maybe_unused]] static const bool nanoAllocCounterInstalled =             \
+      (AllocCounter::installed().store(true), true);                           \
+  void *operator new(std::size_t size) { return AllocCounter::allocate(size); } \
+  void *operator new[](std::size_t size) {                                     \
+    return AllocCounter::allocate(size);                                       \
+  }                                                                            \
+  void *operator new(std::size_t size, std::align_val_t align) {               \
+    return AllocCounter::allocateAligned(size, static_cast<size_t>(align));    \
+  }                                                                            \
+  void *operator new[](std::size_t size, std::align_val_t align) {             \
+    return AllocCounter::allocateAligned(size, static_cast<size_t>(align));    \
+  }                                                                            \
+  void *operator new(std::size_t size, const std::nothrow_t &) noexcept {      \
+    return AllocCounter::tryAllocate(size);                                    \
+  }                                                                            \
+  void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {    \
+    return AllocCounter::tryAllocate(size);                                    \
+  }                                                                            \
+  void *operator new(std::size_t size, std::align_val_t align,                 \
+                     const std::nothrow_t &) noexcept {                        \
+    return AllocCounter::tryAllocateAligned(size, static_cast<size_t>(align)); \
+  }                                                                            \
+  void *operator new[](std::size_t size, std::align_val_t align,               \
+                       const std::nothrow_t &) noexcept {                      \
+    return AllocCounter::tryAllocateAligned(size, static_cast<size_t>(align)); \
+  }                                                                            \
+  void operator delete(void *p) noexcept { std::free(p); }                     \
+  void operator delete[](void *p) noexcept { std::free(p); }                   \
+  void operator delete(void *p, std::size_t) noexcept { std::free(p); }        \
+  void operator delete[](void *p, std::size_t) noexcept { std::free(p); }      \
+  void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }   \
+  void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); } \
+  void operator delete(void *p, std::size_t, std::align_val_t) noexcept {      \
+    std::free(p);                                                              \
+  }                                                                            \
+  void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {    \
+    std::free(p);                                                              \
+  }                                                                            \
+  void operator delete(void *p, const std::nothrow_t &) noexcept {             \
+    std::free(p);                                                              \
+  }                                                                            \
+  void operator delete[](void *p, const std::nothrow_t &) noexcept {           \
+    std::free(p);                                                              \
+  }                                                                            \
+  void operator delete(void *p, std::align_val_t,                              \
+                       const std::nothrow_t &) noexcept {                      \
+    std::free(p);                                                              \
+  }                                                                            \
+  void operator delete[](void *p, std::align_val_t,                            \
+                         const std::nothrow_t &) noexcept {                    \
+    std::free(p);                                                              \
+  }
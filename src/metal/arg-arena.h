@@ -0,0 +1,173 @@
+#pragma once
+
+// Per-frame argument arena for EvalContext.
+//
+// Dispatch and draw arguments (the flattened `inputs` uniform data) are
+// small, short-lived and produced every frame. ArgArena sub-allocates them
+// linearly from large blocks instead of creating a buffer per command. A
+// block is retired when it fills up or the frame ends, and reused once the
+// fences of the commands that read it have signalled, so a steady-state
+// frame allocates nothing.
+//
+// ArenaStorage is the only contact with the backend (host memory for the CPU
+// backend, shared MTLBuffers for Metal), mirroring TransferDevice in
+// residency.h.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "hazard-tracker.h"
+
+// Backing memory for arena blocks, addressed by block index.
+class ArenaStorage {
+public:
+  virtual ~ArenaStorage() = default;
+
+  // Create block `index` of `bytes` bytes and return its host address.
+  virtual void *createBlock(size_t index, size_t bytes) = 0;
+};
+
+// Host memory blocks (CPU backend, tests).
+class HostArenaStorage : public ArenaStorage {
+public:
+  void *createBlock(size_t index, size_t bytes) override {
+    if (index >= blocks.size())
+      blocks.resize(index + 1);
+    // Zero-initialized so padding never reads uninitialized memory.
+    blocks[index].reset(new uint8_t[bytes]());
+    return blocks[index].get();
+  }
+
+private:
+  std::vector<std::unique_ptr<uint8_t[]>> blocks;
+};
+
+class ArgArena {
+public:
+  struct Allocation {
+    void *data = nullptr;
+    size_t block = 0;
+    size_t offset = 0;
+  };
+
+  // `alignment` must be a power of two.
+  explicit ArgArena(ArenaStorage &storage, size_t blockBytes = 64 * 1024,
+                    size_t alignment = 256)
+      : storage(storage), blockBytes(blockBytes), alignment(alignment) {}
+
+  ArgArena(const ArgArena &) = delete;
+  ArgArena &operator=(const ArgArena &) = delete;
+
+  // Reserve `bytes` bytes (at least one alignment unit). When the current
+  // block is full it is retired and a recycled or new block takes over.
+  Allocation allocate(size_t bytes) {
+    bytes = alignUp(bytes > 0 ? bytes : 1);
+    if (current < 0 || cursor + bytes > blocks[current].capacity) {
+      retireCurrent();
+      current = static_cast<long>(acquireBlock(bytes));
+      cursor = 0;
+    }
+    Block &b = blocks[current];
+    Allocation a{b.data + cursor, static_cast<size_t>(current), cursor};
+    cursor += bytes;
+    frameBytes += bytes;
+    return a;
+  }
+
+  // Allocate and copy `bytes` bytes from `src`.
+  Allocation push(const void *src, size_t bytes) {
+    Allocation a = allocate(bytes);
+    if (bytes > 0)
+      std::memcpy(a.data, src, bytes);
+    return a;
+  }
+
+  // The most recent allocation is in use until `fence` has signalled; its
+  // block is not reused before then.
+  void retireAfter(FencePtr fence) {
+    if (current >= 0 && fence && !fence->isDone())
+      blocks[current].fences.push_back(std::move(fence));
+  }
+
+  // Close the frame: the partly filled block is retired so the next frame
+  // starts on a block whose previous users have finished.
+  void endFrame() {
+    retireCurrent();
+    lastFrameBytes = frameBytes;
+    frameBytes = 0;
+  }
+
+  size_t blockCount() const { return blocks.size(); }
+
+  // Statistics
+  size_t blocksCreated = 0;
+  size_t blocksRecycled = 0;
+  size_t frameBytes = 0;     // allocated in the current frame
+  size_t lastFrameBytes = 0; // allocated in the last closed frame
+
+private:
+  struct Block {
+    uint8_t *data = nullptr;
+    size_t capacity = 0;
+    std::vector<FencePtr> fences; // users of the block's current contents
+  };
+
+  size_t alignUp(size_t n) const { return (n + alignment - 1) & ~(alignment - 1); }
+
+  void retireCurrent() {
+    if (current < 0)
+      return;
+    retiring.push_back(static_cast<size_t>(current));
+    current = -1;
+    cursor = 0;
+  }
+
+  // Move retired blocks whose users have all finished (oldest first) to the
+  // free list.
+  void recycle() {
+    while (!retiring.empty()) {
+      Block &b = blocks[retiring.front()];
+      for (const auto &fence : b.fences)
+        if (!fence->isDone())
+          return;
+      b.fences.clear();
+      freeBlocks.push_back(retiring.front());
+      retiring.pop_front();
+      ++blocksRecycled;
+    }
+  }
+
+  size_t acquireBlock(size_t bytes) {
+    recycle();
+    for (size_t i = 0; i < freeBlocks.size(); ++i) {
+      if (blocks[freeBlocks[i]].capacity >= bytes) {
+        size_t idx = freeBlocks[i];
+        freeBlocks.erase(freeBlocks.begin() + static_cast<long>(i));
+        return idx;
+      }
+    }
+    size_t idx = blocks.size();
+    size_t capacity = std::max(blockBytes, bytes);
+    Block b;
+    b.data = static_cast<uint8_t *>(storage.createBlock(idx, capacity));
+    b.capacity = capacity;
+    blocks.push_back(std::move(b));
+    ++blocksCreated;
+    return idx;
+  }
+
+  ArenaStorage &storage;
+  size_t blockBytes;
+  size_t alignment;
+
+  std::vector<Block> blocks;
+  std::vector<size_t> freeBlocks; // ready for reuse
+  std::deque<size_t> retiring;    // full or closed, maybe still in use
+  long current = -1;              // block being filled
+  size_t cursor = 0;
+};
@@ -0,0 +1,322 @@
+#pragma once
+
+// Reductions of float buffers and texture channels for
+// EvalContext::reduceBuffer: sum, min, max, mean, argmin/argmax and
+// histograms.
+//
+// Elements are split into blocks whose size depends only on the element
+// count, never on the thread count. Each block is reduced on the WorkerPool
+// into a partial with kReduceLanes independent accumulators per component,
+// which the compiler vectorizes. Block partials are then merged pairwise in a
+// fixed tree on the calling thread. The same input therefore gives
+// bit-identical results whatever the pool size or scheduling. Sums
+// accumulate in double.
+//
+// Histograms count integers, which merge exactly in any grouping, so their
+// blocks follow the pool size. Per-block counts come from a scratch pool.
+//
+// NaNs are skipped by min/max, argmin/argmax and histograms.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "frame-graph.h"
+
+enum class ReduceMode {
+  Sum = 0,
+  Min = 1,
+  Max = 2,
+  Mean = 3,
+  ArgMin = 4,
+  ArgMax = 5,
+  Histogram = 6
+};
+
+namespace buffer_reduce {
+
+constexpr int kReduceLanes = 8;
+constexpr int kReduceBlock = 1 << 13; // elements
+constexpr int kMaxReduceBlocks = 256;
+constexpr int kMaxReduceStride = 4;
+
+// Blocks of whole lane groups, at most kMaxReduceBlocks; depends on n only.
+inline int blockSize(int n) {
+  int size = std::max(kReduceBlock, (n + kMaxReduceBlocks - 1) /
+                                        kMaxReduceBlocks);
+  return (size + kReduceLanes - 1) / kReduceLanes * kReduceLanes;
+}
+
+// One block's (or, after merging, one range's) result per component.
+struct Partial {
+  double sum[kMaxReduceStride];
+  float lo[kMaxReduceStride], hi[kMaxReduceStride];
+};
+
+// Lane i % kReduceLanes of component s lives at acc[lane * S + s], which is
+// also the layout of the elements, so the inner loop is a straight run of
+// kReduceLanes * S floats.
+template <int S>
+inline void reduceBlock(const float *x, int n, Partial &out) {
+  constexpr int W = kReduceLanes * S;
+  double sum[W] = {};
+  float lo[W], hi[W];
+  std::fill_n(lo, W, std::numeric_limits<float>::infinity());
+  std::fill_n(hi, W, -std::numeric_limits<float>::infinity());
+  int i = 0;
+  for (; i + kReduceLanes <= n; i += kReduceLanes) {
+    const float *p = x + static_cast<size_t>(i) * S;
+    for (int k = 0; k < W; ++k) {
+      float v = p[k];
+      sum[k] += v;
+      lo[k] = v < lo[k] ? v : lo[k];
+      hi[k] = v > hi[k] ? v : hi[k];
+    }
+  }
+  // Fold the lanes pairwise, then the tail.
+  for (int width = kReduceLanes / 2; width >= 1; width /= 2)
+    for (int k = 0; k < width * S; ++k) {
+      sum[k] += sum[k + width * S];
+      lo[k] = std::min(lo[k], lo[k + width * S]);
+      hi[k] = std::max(hi[k], hi[k + width * S]);
+    }
+  for (; i < n; ++i)
+    for (int s = 0; s < S; ++s) {
+      float v = x[static_cast<size_t>(i) * S + s];
+      sum[s] += v;
+      lo[s] = v < lo[s] ? v : lo[s];
+      hi[s] = v > hi[s] ? v : hi[s];
+    }
+  for (int s = 0; s < S; ++s) {
+    out.sum[s] = sum[s];
+    out.lo[s] = lo[s];
+    out.hi[s] = hi[s];
+  }
+}
+
+template <int S> struct ReduceJob {
+  const float *src;
+  int n, block;
+  Partial partials[kMaxReduceBlocks];
+
+  int blockCount() const { return (n + block - 1) / block; }
+
+  Partial run(WorkerPool &pool) {
+    const int blocks = blockCount();
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b)
+        reduceBlock<S>(job->src + static_cast<size_t>(b) * job->block * S,
+                       std::min(job->block, job->n - b * job->block),
+                       job->partials[b]);
+    });
+    for (int width = 1; width < blocks; width *= 2)
+      for (int b = 0; b + width < blocks; b += 2 * width) {
+        Partial &a = partials[b];
+        const Partial &c = partials[b + width];
+        for (int s = 0; s < S; ++s) {
+          a.sum[s] += c.sum[s];
+          a.lo[s] = std::min(a.lo[s], c.lo[s]);
+          a.hi[s] = std::max(a.hi[s], c.hi[s]);
+        }
+      }
+    return partials[0];
+  }
+};
+
+// First index of the smallest (or, with Max, largest) value; -1 if all NaN.
+struct ArgJob {
+  const float *src;
+  int n, stride, block;
+  bool max;
+  float value[kMaxReduceBlocks];
+  int index[kMaxReduceBlocks];
+
+  void reduce(int b) {
+    if (stride == 1)
+      reduceStride<1>(b);
+    else
+      reduceStride<0>(b);
+  }
+
+  // S = 0: the runtime stride.
+  template <int S> void reduceStride(int b) {
+    const int st = S ? S : stride;
+    const int begin = b * block, end = std::min(n, begin + block);
+    const float sign = max ? -1.0f : 1.0f;
+    float best[kReduceLanes];
+    int at[kReduceLanes];
+    std::fill_n(best, kReduceLanes, std::numeric_limits<float>::infinity());
+    std::fill_n(at, kReduceLanes, -1);
+    int i = begin;
+    for (; i + kReduceLanes <= end; i += kReduceLanes)
+      for (int k = 0; k < kReduceLanes; ++k) {
+        float v = sign * src[static_cast<size_t>(i + k) * st];
+        bool better = v < best[k] || (at[k] < 0 && v == v);
+        best[k] = better ? v : best[k];
+        at[k] = better ? i + k : at[k];
+      }
+    for (; i < end; ++i) {
+      float v = sign * src[static_cast<size_t>(i) * st];
+      int k = i % kReduceLanes;
+      if (v < best[k] || (at[k] < 0 && v == v)) {
+        best[k] = v;
+        at[k] = i;
+      }
+    }
+    float v = std::numeric_limits<float>::infinity();
+    int idx = -1;
+    for (int k = 0; k < kReduceLanes; ++k)
+      if (at[k] >= 0 && (idx < 0 || best[k] < v ||
+                         (best[k] == v && at[k] < idx))) {
+        v = best[k];
+        idx = at[k];
+      }
+    value[b] = v;
+    index[b] = idx;
+  }
+
+  int run(WorkerPool &pool) {
+    const int blocks = (n + block - 1) / block;
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b)
+        job->reduce(b);
+    });
+    // Left blocks hold lower indices, so ties keep the left one.
+    for (int width = 1; width < blocks; width *= 2)
+      for (int b = 0; b + width < blocks; b += 2 * width) {
+        int c = b + width;
+        if (index[c] >= 0 && (index[b] < 0 || value[c] < value[b])) {
+          value[b] = value[c];
+          index[b] = index[c];
+        }
+      }
+    return index[0];
+  }
+};
+
+struct HistogramJob {
+  const float *src;
+  int n, stride, bins, block;
+  float lo, scale; // bin = (v - lo) * scale, clamped to [0, bins)
+  uint32_t *counts; // bins per block
+
+  void count(int b) {
+    uint32_t *c = counts + static_cast<size_t>(b) * bins;
+    std::fill_n(c, bins, 0u);
+    const int begin = b * block, end = std::min(n, begin + block);
+    const float last = static_cast<float>(bins - 1);
+    for (int i = begin; i < end; ++i) {
+      float v = src[static_cast<size_t>(i) * stride];
+      if (v != v)
+        continue;
+      float t = std::min(std::max((v - lo) * scale, 0.0f), last);
+      ++c[static_cast<int>(t)];
+    }
+  }
+
+  // Totals end up in the first block's counts.
+  void run(WorkerPool &pool) {
+    const int blocks = (n + block - 1) / block;
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b)
+        job->count(b);
+    });
+    for (int b = 1; b < blocks; ++b) {
+      const uint32_t *c = counts + static_cast<size_t>(b) * bins;
+      for (int k = 0; k < bins; ++k)
+        counts[k] += c[k];
+    }
+  }
+};
+
+template <int S>
+inline Partial reduceStride(const float *src, int n, WorkerPool &pool) {
+  ReduceJob<S> job;
+  job.src = src;
+  job.n = n;
+  job.block = blockSize(n);
+  return job.run(pool);
+}
+
+} // namespace buffer_reduce
+
+// Sum, Min, Max or Mean of n elements of `stride` floats (1-4; textures are
+// 4), component-wise. Writes one value per component to out, or just that of
+// `component` when it is >= 0, and returns how many were written. ArgMin and
+// ArgMax write the first index of the extreme value of `component` (or the
+// first component), or -1 if there is none. Results do not depend on the
+// pool size.
+inline int reduceFloats(const float *src, int n, int stride, ReduceMode mode,
+                        int component, double *out, WorkerPool &pool) {
+  using namespace buffer_reduce;
+  n = std::max(n, 0);
+  stride = std::max(1, std::min(stride, kMaxReduceStride));
+  if (component >= stride)
+    component = stride - 1;
+  if (mode == ReduceMode::ArgMin || mode == ReduceMode::ArgMax) {
+    ArgJob job;
+    job.src = src + std::max(component, 0);
+    job.n = n;
+    job.stride = stride;
+    job.block = blockSize(n);
+    job.max = mode == ReduceMode::ArgMax;
+    out[0] = n > 0 ? job.run(pool) : -1;
+    return 1;
+  }
+  Partial p{};
+  if (n > 0) {
+    switch (stride) {
+    case 1: p = reduceStride<1>(src, n, pool); break;
+    case 2: p = reduceStride<2>(src, n, pool); break;
+    case 3: p = reduceStride<3>(src, n, pool); break;
+    default: p = reduceStride<4>(src, n, pool); break;
+    }
+  }
+  const int first = component >= 0 ? component : 0;
+  const int last = component >= 0 ? component + 1 : stride;
+  for (int s = first; s < last; ++s) {
+    double v = 0.0;
+    switch (mode) {
+    case ReduceMode::Min: v = n > 0 ? p.lo[s] : 0.0; break;
+    case ReduceMode::Max: v = n > 0 ? p.hi[s] : 0.0; break;
+    case ReduceMode::Mean: v = n > 0 ? p.sum[s] / n : 0.0; break;
+    default: v = p.sum[s]; break;
+    }
+    out[s - first] = v;
+  }
+  return last - first;
+}
+
+// Histogram of component `component` of n elements of `stride` floats into
+// `bins` counts over [lo, hi); values outside land in the first or last bin.
+// `counts` is per-block scratch; returns the bins totals, which it holds.
+inline const uint32_t *histogramFloats(const float *src, int n, int stride,
+                                       int component, int bins, float lo,
+                                       float hi, std::vector<uint32_t> &counts,
+                                       WorkerPool &pool) {
+  using namespace buffer_reduce;
+  bins = std::max(bins, 1);
+  n = std::max(n, 0);
+  int blocks = std::min((n + kReduceBlock - 1) / kReduceBlock,
+                        static_cast<int>(pool.threadCount()) * 2);
+  blocks = std::max(blocks, 1);
+  if (counts.size() < static_cast<size_t>(blocks) * bins)
+    counts.resize(static_cast<size_t>(blocks) * bins);
+  HistogramJob job;
+  job.src = src + std::max(0, std::min(component, stride - 1));
+  job.n = n;
+  job.stride = stride;
+  job.bins = bins;
+  job.block = std::max(1, (n + blocks - 1) / blocks);
+  job.lo = lo;
+  job.scale = hi > lo ? static_cast<float>(bins) / (hi - lo) : 0.0f;
+  job.counts = counts.data();
+  if (n > 0)
+    job.run(pool);
+  else
+    std::fill_n(job.counts, bins, 0u);
+  return job.counts;
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+// Prefix sums and stream compaction of float buffers for
+// EvalContext::scanBuffer and EvalContext::compactBuffer.
+//
+// Both are work-efficient three-phase passes over at most kMaxScanBlocks
+// blocks of elements: reduce each block on the WorkerPool, scan the block
+// totals on the calling thread, then run each block again from its offset.
+// Inside a block, the scan walks chunks of kScanChunk elements: the local
+// prefix of a chunk does not depend on the running carry, so consecutive
+// chunks overlap in the pipeline instead of forming one serial chain of
+// adds, and the reductions keep independent partial sums the compiler
+// vectorizes. Compaction writes every element to the next output slot and
+// advances only past kept ones, so random flags cost no mispredictions.
+//
+// Elements are `stride` floats (1-4), scanned component-wise. Buffers below
+// kScanParallelMin elements are processed on the calling thread.
+
+#include <algorithm>
+#include <cstddef>
+
+#include "frame-graph.h"
+
+namespace buffer_scan {
+
+constexpr int kScanChunk = 8;
+constexpr int kMaxScanBlocks = 256;
+constexpr int kScanParallelMin = 1 << 15;
+constexpr int kMaxScanStride = 4;
+
+// out[s] = sum of component s over the n elements at x.
+template <int S> inline void blockSum(const float *x, int n, float *out) {
+  float acc[kScanChunk * S] = {};
+  int i = 0;
+  for (; i + kScanChunk <= n; i += kScanChunk) {
+    const float *p = x + static_cast<size_t>(i) * S;
+    for (int k = 0; k < kScanChunk * S; ++k)
+      acc[k] += p[k];
+  }
+  for (int s = 0; s < S; ++s) {
+    float sum = 0.0f;
+    for (int e = 0; e < kScanChunk; ++e)
+      sum += acc[e * S + s];
+    for (int e = i; e < n; ++e)
+      sum += x[static_cast<size_t>(e) * S + s];
+    out[s] = sum;
+  }
+}
+
+// Scan n elements from `carry` (S floats, updated to the running total).
+// dst may equal src: each chunk is read before it is written.
+template <int S, bool Inclusive>
+inline void scanBlock(const float *src, float *dst, int n, float *carry) {
+  float c[S];
+  std::copy_n(carry, S, c);
+  int i = 0;
+  for (; i + kScanChunk <= n; i += kScanChunk) {
+    const float *x = src + static_cast<size_t>(i) * S;
+    float *o = dst + static_cast<size_t>(i) * S;
+    float acc[S] = {};
+    for (int e = 0; e < kScanChunk; ++e)
+      for (int s = 0; s < S; ++s) {
+        float v = x[e * S + s];
+        if (Inclusive)
+          acc[s] += v;
+        o[e * S + s] = c[s] + acc[s];
+        if (!Inclusive)
+          acc[s] += v;
+      }
+    for (int s = 0; s < S; ++s)
+      c[s] += acc[s];
+  }
+  for (; i < n; ++i) {
+    for (int s = 0; s < S; ++s) {
+      float v = src[static_cast<size_t>(i) * S + s];
+      float before = c[s];
+      c[s] += v;
+      dst[static_cast<size_t>(i) * S + s] = Inclusive ? c[s] : before;
+    }
+  }
+  std::copy_n(c, S, carry);
+}
+
+// Split n elements into blocks of whole chunks, a few per worker.
+inline int blockSize(int n, WorkerPool &pool) {
+  int blocks = std::min(kMaxScanBlocks,
+                        static_cast<int>(pool.threadCount()) * 4);
+  int size = (n + blocks - 1) / blocks;
+  size = (size + kScanChunk - 1) / kScanChunk * kScanChunk;
+  return std::max(size, kScanParallelMin / 4);
+}
+
+template <int S, bool Inclusive> struct ScanJob {
+  const float *src;
+  float *dst;
+  int n, block;
+  float *sums; // S per block: totals, then offsets
+
+  int blockCount() const { return (n + block - 1) / block; }
+  int blockLength(int b) const { return std::min(block, n - b * block); }
+
+  void run(float *total, WorkerPool &pool) {
+    float carry[S] = {};
+    if (n < kScanParallelMin || pool.threadCount() <= 1) {
+      scanBlock<S, Inclusive>(src, dst, n, carry);
+      std::copy_n(carry, S, total);
+      return;
+    }
+    const int blocks = blockCount();
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b)
+        blockSum<S>(job->src + static_cast<size_t>(b) * job->block * S,
+                    job->blockLength(b), job->sums + b * S);
+    });
+    for (int b = 0; b < blocks; ++b)
+      for (int s = 0; s < S; ++s) {
+        float v = sums[b * S + s];
+        sums[b * S + s] = carry[s];
+        carry[s] += v;
+      }
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b) {
+        size_t at = static_cast<size_t>(b) * job->block * S;
+        scanBlock<S, Inclusive>(job->src + at, job->dst + at,
+                                job->blockLength(b), job->sums + b * S);
+      }
+    });
+    std::copy_n(carry, S, total);
+  }
+};
+
+template <int S>
+inline void scanStride(const float *src, float *dst, int n, bool inclusive,
+                       float *total, WorkerPool &pool) {
+  float sums[kMaxScanBlocks * S];
+  if (inclusive)
+    ScanJob<S, true>{src, dst, n, blockSize(n, pool), sums}.run(total, pool);
+  else
+    ScanJob<S, false>{src, dst, n, blockSize(n, pool), sums}.run(total, pool);
+}
+
+struct CompactJob {
+  const float *src;
+  const float *flags;
+  float *dst;
+  int n, stride, flagStride, capacity, block;
+  int offsets[kMaxScanBlocks + 1];
+
+  int blockLength(int b) const { return std::min(block, n - b * block); }
+
+  int countKept(int begin, int end) const {
+    int kept = 0;
+    for (int i = begin; i < end; ++i)
+      kept += flags[static_cast<size_t>(i) * flagStride] > 0.0f;
+    return kept;
+  }
+
+  // Copy the kept elements of [begin, end) to dst elements [out, limit);
+  // `limit` (where the next block's output starts) stops the write after
+  // the last kept element from running over.
+  void scatter(int begin, int end, int out, int limit) const {
+    switch (stride) {
+    case 1: scatterStride<1>(begin, end, out, limit); break;
+    case 2: scatterStride<2>(begin, end, out, limit); break;
+    case 3: scatterStride<3>(begin, end, out, limit); break;
+    case 4: scatterStride<4>(begin, end, out, limit); break;
+    default:
+      for (int i = begin; i < end && out < limit; ++i) {
+        std::copy_n(src + static_cast<size_t>(i) * stride, stride,
+                    dst + static_cast<size_t>(out) * stride);
+        out += flags[static_cast<size_t>(i) * flagStride] > 0.0f;
+      }
+    }
+  }
+
+  template <int S>
+  void scatterStride(int begin, int end, int out, int limit) const {
+    for (int i = begin; i < end && out < limit; ++i) {
+      const float *x = src + static_cast<size_t>(i) * S;
+      float *o = dst + static_cast<size_t>(out) * S;
+      for (int s = 0; s < S; ++s)
+        o[s] = x[s];
+      out += flags[static_cast<size_t>(i) * flagStride] > 0.0f;
+    }
+  }
+
+  int run(WorkerPool &pool) {
+    // In place, blocks would overwrite elements other blocks have yet to
+    // read; a single forward sweep is safe.
+    if (dst == src || n < kScanParallelMin || pool.threadCount() <= 1) {
+      int kept = std::min(countKept(0, n), capacity);
+      scatter(0, n, 0, kept);
+      return kept;
+    }
+    const int blocks = (n + block - 1) / block;
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b)
+        job->offsets[b] = job->countKept(b * job->block,
+                                         b * job->block + job->blockLength(b));
+    });
+    int kept = 0;
+    for (int b = 0; b < blocks; ++b) {
+      int v = offsets[b];
+      offsets[b] = std::min(kept, capacity);
+      kept += v;
+    }
+    offsets[blocks] = std::min(kept, capacity);
+    pool.parallelFor(blocks, 1, [job = this](int b0, int b1) {
+      for (int b = b0; b < b1; ++b)
+        job->scatter(b * job->block, b * job->block + job->blockLength(b),
+                     job->offsets[b], job->offsets[b + 1]);
+    });
+    return offsets[blocks];
+  }
+};
+
+} // namespace buffer_scan
+
+// Prefix sum of n elements of `stride` floats (1-4), component-wise:
+// exclusive (dst[i] = sum of src[0..i)) or inclusive (sum of src[0..i]).
+// dst may equal src. `total` receives the `stride` component sums.
+inline void scanFloats(const float *src, float *dst, int n, int stride,
+                       bool inclusive, float *total, WorkerPool &pool) {
+  using namespace buffer_scan;
+  switch (stride) {
+  case 1: scanStride<1>(src, dst, n, inclusive, total, pool); break;
+  case 2: scanStride<2>(src, dst, n, inclusive, total, pool); break;
+  case 3: scanStride<3>(src, dst, n, inclusive, total, pool); break;
+  default: scanStride<4>(src, dst, n, inclusive, total, pool); break;
+  }
+}
+
+// Stream compaction: copy, in order, the elements (`stride` floats) of src
+// whose flag is positive to the front of dst, at most `capacity` of them.
+// flags[i * flagStride] is element i's flag; pass flags = src and
+// flagStride = stride to test each element's first component. dst may equal
+// src, but not flags (unless flags is src). Elements of dst past the kept
+// ones are left as they were. Returns the number written.
+inline int compactFloats(const float *src, const float *flags, float *dst,
+                         int n, int stride, int flagStride, int capacity,
+                         WorkerPool &pool) {
+  buffer_scan::CompactJob job{src, flags, dst, n, stride, flagStride,
+                              capacity, buffer_scan::blockSize(n, pool), {}};
+  return job.run(pool);
+}
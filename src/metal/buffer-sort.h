@@ -0,0 +1,331 @@
+#pragma once
+
+// Radix sort of buffer elements by a float key, for EvalContext::sortBuffer.
+//
+// Keys are mapped to unsigned integers that order like the floats (negative
+// values have every bit flipped, the rest only the sign bit) and packed with
+// their element index into 64-bit pairs. Large ranges are split on their top
+// varying 8-bit digit (MSD): blocks on the WorkerPool count their digits, the
+// counts become per-block bucket offsets, and every block scatters its pairs
+// stably into the buckets. Buckets small enough to stay in cache are then
+// sorted on the WorkerPool by the remaining digits, least significant first
+// (LSD), with one histogram pass for all digits; larger buckets are split
+// again. Digits that are the same across a range (e.g. the exponent byte of
+// keys in a narrow range) are skipped. The elements, `stride` floats each so
+// struct payloads move with their key, are then gathered in sorted order.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "frame-graph.h"
+
+// Working storage for one sort.
+struct SortScratch {
+  std::vector<uint64_t> pairs[2]; // key << 32 | element index
+  std::vector<uint32_t> counts;   // per block, per digit
+  std::vector<float> payload;     // source copy for in-place sorts
+};
+
+namespace buffer_sort {
+
+constexpr int kRadixBits = 8;
+constexpr int kBuckets = 1 << kRadixBits;
+constexpr int kMaxSortBlocks = 64;
+constexpr int kSortParallelMin = 1 << 16;
+constexpr int kLocalSortMax = 1 << 14; // pairs sorted in cache
+
+// Unsigned key that orders like the float (-0 just before +0; NaNs with
+// the sign bit clear after +inf).
+inline uint32_t sortableKey(float f) {
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  uint32_t mask = static_cast<uint32_t>(-static_cast<int32_t>(u >> 31));
+  return u ^ (mask | 0x80000000u);
+}
+
+inline float keyValue(uint32_t key) {
+  uint32_t u = key ^ (((key >> 31) - 1) | 0x80000000u);
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+struct SortJob {
+  const float *src = nullptr;  // elements (the payload copy when in place)
+  const float *keys = nullptr; // keys[i * keyStride]
+  float *dst = nullptr;
+  float *sortedKeys = nullptr; // receives the keys in order, or null
+  int n = 0, stride = 1, keyStride = 1, maxBlocks = 1;
+  bool descending = false;
+  uint64_t *pairs[2] = {nullptr, nullptr};
+  uint32_t *counts = nullptr; // per block, per digit
+  uint32_t orBits[kMaxSortBlocks], andBits[kMaxSortBlocks];
+  WorkerPool *pool = nullptr;
+  // What the current step works on: blocks of pairs[from][lo, lo + len)
+  // split by the digit at `shift`, or the buckets at `starts`.
+  int lo = 0, len = 0, blocks = 1, block = 0, shift = 0, from = 0;
+  const uint32_t *starts = nullptr;
+  void (SortJob::*step)(int) = nullptr;
+
+  int begin(int b) const { return lo + b * block; }
+  int end(int b) const { return std::min(lo + len, lo + (b + 1) * block); }
+
+  void makePairs(int b) {
+    uint32_t orAll = 0, andAll = ~0u;
+    uint64_t *out = pairs[0];
+    for (int i = begin(b); i < end(b); ++i) {
+      uint32_t k = sortableKey(keys[static_cast<size_t>(i) * keyStride]);
+      if (descending)
+        k = ~k;
+      orAll |= k;
+      andAll &= k;
+      out[i] = static_cast<uint64_t>(k) << 32 | static_cast<uint32_t>(i);
+    }
+    orBits[b] = orAll;
+    andBits[b] = andAll;
+  }
+
+  void countDigits(int b) {
+    uint32_t *c = counts + b * kBuckets;
+    std::fill_n(c, kBuckets, 0u);
+    const uint64_t *in = pairs[from];
+    const int s = 32 + shift;
+    for (int i = begin(b); i < end(b); ++i)
+      ++c[(in[i] >> s) & (kBuckets - 1)];
+  }
+
+  // Counts (block-major) to offsets: bucket by bucket, block by block, so
+  // each block's pairs land after those of earlier blocks (stable).
+  void offsets() {
+    uint32_t sum = static_cast<uint32_t>(lo);
+    for (int d = 0; d < kBuckets; ++d)
+      for (int b = 0; b < blocks; ++b) {
+        uint32_t c = counts[b * kBuckets + d];
+        counts[b * kBuckets + d] = sum;
+        sum += c;
+      }
+  }
+
+  void scatter(int b) {
+    uint32_t *off = counts + b * kBuckets;
+    const uint64_t *in = pairs[from];
+    uint64_t *out = pairs[1 - from];
+    const int s = 32 + shift;
+    for (int i = begin(b); i < end(b); ++i) {
+      uint64_t p = in[i];
+      out[off[(p >> s) & (kBuckets - 1)]++] = p;
+    }
+  }
+
+  void copyBack(int b) {
+    std::copy(pairs[1] + begin(b), pairs[1] + end(b), pairs[0] + begin(b));
+  }
+
+  // Sorts pairs[cur][at, at + count) by the digits below bit `top` of the
+  // key and leaves them in pairs[0].
+  void sortLocal(int at, int count, int top, int cur) {
+    if (count == 0)
+      return;
+    const int digits = top / kRadixBits;
+    uint32_t hist[32 / kRadixBits][kBuckets] = {};
+    const uint64_t *in = pairs[cur] + at;
+    for (int i = 0; i < count; ++i) {
+      uint64_t p = in[i];
+      for (int d = 0; d < digits; ++d)
+        ++hist[d][(p >> (32 + d * kRadixBits)) & (kBuckets - 1)];
+    }
+    for (int d = 0; d < digits; ++d) {
+      const int s = 32 + d * kRadixBits;
+      uint32_t *off = hist[d];
+      if (off[(pairs[cur][at] >> s) & (kBuckets - 1)] ==
+          static_cast<uint32_t>(count))
+        continue;
+      uint32_t sum = 0;
+      for (int k = 0; k < kBuckets; ++k) {
+        uint32_t c = off[k];
+        off[k] = sum;
+        sum += c;
+      }
+      in = pairs[cur] + at;
+      uint64_t *out = pairs[1 - cur] + at;
+      for (int i = 0; i < count; ++i) {
+        uint64_t p = in[i];
+        out[off[(p >> s) & (kBuckets - 1)]++] = p;
+      }
+      cur = 1 - cur;
+    }
+    if (cur != 0)
+      std::copy_n(pairs[cur] + at, count, pairs[0] + at);
+  }
+
+  void sortBucket(int d) {
+    int count = static_cast<int>(starts[d + 1] - starts[d]);
+    if (count <= kLocalSortMax)
+      sortLocal(static_cast<int>(starts[d]), count, shift, from);
+  }
+
+  void gather(int b) {
+    switch (stride) {
+    case 1: gatherStride<1>(b); break;
+    case 2: gatherStride<2>(b); break;
+    case 3: gatherStride<3>(b); break;
+    case 4: gatherStride<4>(b); break;
+    default: gatherStride<0>(b); break;
+    }
+  }
+
+  // S = 0: the runtime stride.
+  template <int S> void gatherStride(int b) {
+    const int st = S ? S : stride;
+    const uint64_t *sorted = pairs[0];
+    for (int j = begin(b); j < end(b); ++j) {
+      const float *x = src + static_cast<size_t>(
+                                 static_cast<uint32_t>(sorted[j])) * st;
+      float *o = dst + static_cast<size_t>(j) * st;
+      for (int c = 0; c < st; ++c)
+        o[c] = x[c];
+    }
+    if (!sortedKeys)
+      return;
+    for (int j = begin(b); j < end(b); ++j) {
+      uint32_t k = static_cast<uint32_t>(sorted[j] >> 32);
+      sortedKeys[static_cast<size_t>(j) * keyStride] =
+          keyValue(descending ? ~k : k);
+    }
+  }
+
+  // Runs `step` over `count` items; the chunk callback captures only the
+  // job, so wrapping it in a std::function does not allocate.
+  void each(void (SortJob::*stepFn)(int), int count) {
+    step = stepFn;
+    pool->parallelFor(count, 1, [job = this](int i0, int i1) {
+      for (int i = i0; i < i1; ++i)
+        (job->*(job->step))(i);
+    });
+  }
+
+  void setRange(int at, int count) {
+    lo = at;
+    len = count;
+    blocks = count >= kSortParallelMin ? maxBlocks : 1;
+    block = (count + blocks - 1) / blocks;
+    blocks = (count + block - 1) / block;
+  }
+
+  // Sorts pairs[cur][at, at + count) by the digits below bit `top` of the
+  // key and leaves them in pairs[0].
+  void sortRange(int at, int count, int top, int cur) {
+    if (count <= kLocalSortMax) {
+      sortLocal(at, count, top, cur);
+      return;
+    }
+    setRange(at, count);
+    from = cur;
+    for (;;) {
+      if (top == 0) {
+        if (cur != 0)
+          each(&SortJob::copyBack, blocks);
+        return;
+      }
+      shift = top - kRadixBits;
+      each(&SortJob::countDigits, blocks);
+      int d = static_cast<int>((pairs[cur][at] >> (32 + shift)) &
+                               (kBuckets - 1));
+      uint32_t same = 0;
+      for (int b = 0; b < blocks; ++b)
+        same += counts[b * kBuckets + d];
+      if (same != static_cast<uint32_t>(count))
+        break;
+      top = shift;
+    }
+    offsets();
+    uint32_t bucketStarts[kBuckets + 1];
+    for (int k = 0; k < kBuckets; ++k)
+      bucketStarts[k] = counts[k];
+    bucketStarts[kBuckets] = static_cast<uint32_t>(at + count);
+    each(&SortJob::scatter, blocks);
+
+    // Cache-sized buckets in parallel, then the larger ones split again.
+    top = shift;
+    from = cur = 1 - cur;
+    starts = bucketStarts;
+    each(&SortJob::sortBucket, kBuckets);
+    for (int k = 0; k < kBuckets; ++k) {
+      int size = static_cast<int>(bucketStarts[k + 1] - bucketStarts[k]);
+      if (size > kLocalSortMax)
+        sortRange(static_cast<int>(bucketStarts[k]), size, top, cur);
+    }
+  }
+
+  void run() {
+    setRange(0, n);
+    each(&SortJob::makePairs, blocks);
+    uint32_t orAll = 0, andAll = ~0u;
+    for (int b = 0; b < blocks; ++b) {
+      orAll |= orBits[b];
+      andAll &= andBits[b];
+    }
+    const uint32_t varying = orAll ^ andAll;
+    int top = 32;
+    while (top > 0 && (varying >> (top - kRadixBits)) == 0)
+      top -= kRadixBits;
+    sortRange(0, n, top, 0);
+    setRange(0, n);
+    each(&SortJob::gather, blocks);
+  }
+};
+
+} // namespace buffer_sort
+
+// Stable sort of the first n elements (`stride` floats each) of src into dst
+// by ascending (or descending) float key. keys[i * keyStride] is element i's
+// key; pass keys = src + c and keyStride = stride to sort by component c.
+// dst may equal src; otherwise keys must not overlap dst. If sortedKeys is
+// set it receives the keys in sorted order (it may equal keys).
+// Integer-valued keys sort exactly as floats up to 2^24.
+inline void sortFloats(const float *src, const float *keys, float *dst,
+                       float *sortedKeys, int n, int stride, int keyStride,
+                       bool descending, SortScratch &scratch,
+                       WorkerPool &pool) {
+  using namespace buffer_sort;
+  if (n <= 0)
+    return;
+  int maxBlocks = 1;
+  if (pool.threadCount() > 1)
+    maxBlocks = std::min(kMaxSortBlocks,
+                         static_cast<int>(pool.threadCount()) * 2);
+
+  for (auto &p : scratch.pairs)
+    if (p.size() < static_cast<size_t>(n))
+      p.resize(n);
+  if (scratch.counts.size() < static_cast<size_t>(maxBlocks) * kBuckets)
+    scratch.counts.resize(static_cast<size_t>(maxBlocks) * kBuckets);
+  if (dst == src) {
+    size_t floats = static_cast<size_t>(n) * stride;
+    if (scratch.payload.size() < floats)
+      scratch.payload.resize(floats);
+    std::copy_n(src, floats, scratch.payload.data());
+    if (keys >= src && keys < src + floats)
+      keys = scratch.payload.data() + (keys - src);
+    src = scratch.payload.data();
+  }
+
+  SortJob job;
+  job.src = src;
+  job.keys = keys;
+  job.dst = dst;
+  job.sortedKeys = sortedKeys;
+  job.n = n;
+  job.stride = stride;
+  job.keyStride = keyStride;
+  job.maxBlocks = maxBlocks;
+  job.descending = descending;
+  job.pairs[0] = scratch.pairs[0].data();
+  job.pairs[1] = scratch.pairs[1].data();
+  job.counts = scratch.counts.data();
+  job.pool = &pool;
+  job.run();
+}
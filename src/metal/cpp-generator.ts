@@ -3,7 +3,7 @@
  * Generates standalone C++ code from IR, modeled after cpu-jit.ts
  */
 
-import { IRDocument, FunctionDef, Node, Edge } from '../ir/types';
+import { IRDocument, FunctionDef, Node, Edge, ResourceDef } from '../ir/types';
 import { reconstructEdges } from '../ir/utils';
 import { inferFunctionTypes, InferredTypes, analyzeFunction, FunctionAnalysis } from '../ir/validator';
 import { BUILTIN_CPU_ALLOWED } from '../ir/builtin-schemas';
@@ -16,6 +16,31 @@ const isCppDebugEnabled = () => {
   }
 };
 
+/**
+ * Resource access per op, keyed by the arg that names the resource.
+ * Used to declare shader read/write sets for the runtime frame graph.
+ */
+const RESOURCE_ACCESS: Record<string, { key: string; read: boolean; write: boolean }> = {
+  buffer_load: { key: 'buffer', read: true, write: false },
+  buffer_store: { key: 'buffer', read: false, write: true },
+  texture_sample: { key: 'tex', read: true, write: false },
+  texture_load: { key: 'tex', read: true, write: false },
+  texture_store: { key: 'tex', read: false, write: true },
+  atomic_load: { key: 'counter', read: true, write: false },
+  atomic_store: { key: 'counter', read: false, write: true },
+  atomic_add: { key: 'counter', read: true, write: true },
+  atomic_sub: { key: 'counter', read: true, write: true },
+  atomic_min: { key: 'counter', read: true, write: true },
+  atomic_max: { key: 'counter', read: true, write: true },
+  atomic_exchange: { key: 'counter', read: true, write: true },
+};
+
+/**
+ * Commands that may be recorded into a frame-graph batch. Resizes are left out
+ * (they change resource shapes seen by later host code) and so are draws.
+ */
+const BATCHABLE_OPS = new Set(['cmd_dispatch', 'cmd_copy_buffer', 'cmd_copy_texture', 'cmd_blur_texture', 'cmd_scan_buffer', 'cmd_compact_buffer', 'cmd_sort_buffer', 'cmd_reduce_buffer', 'cmd_convolve_texture']);
+
 export interface ShaderFunctionInfo {
   id: string;
   inputs: { id: string; type: string }[];
@@ -26,6 +51,40 @@ export interface CppCompileResult {
   code: string;
   resourceIds: string[];
   shaderFunctions: ShaderFunctionInfo[];
+  /** Identity of the graph in the autotune cache (see graphHash) */
+  graphHash: string;
+  /** Warnings about the graph, e.g. dispatched shaders with no CPU kernel */
+  diagnostics: string[];
+}
+
+/**
+ * Stable 64-bit FNV-1a hash (16 hex digits) of everything in the graph that
+ * affects its cost: the IR minus metadata and tuning-param defaults, which
+ * the autotuner overrides anyway. Keys the autotune cache (tuning-cache.h).
+ */
+export function graphHash(ir: IRDocument): string {
+  const json = JSON.stringify({
+    ...ir,
+    meta: undefined,
+    tuningParams: (ir.tuningParams || []).map(p => ({ id: p.id, type: p.type })),
+  });
+  let h = 0xcbf29ce484222325n;
+  for (let i = 0; i < json.length; i++) {
+    h ^= BigInt(json.charCodeAt(i));
+    h = (h * 0x100000001b3n) & 0xffffffffffffffffn;
+  }
+  return h.toString(16).padStart(16, '0');
+}
+
+export interface CppOptions {
+  /**
+   * Instrument every emitted function and executable node with NodeProfiler
+   * counters (see node-profiler.h); declare_profile_sites() registers the
+   * site table mapping them back to IR function and node ids.
+   */
+  profile?: boolean;
+  /** With `profile`, also instrument pure expression nodes (higher overhead) */
+  profilePure?: boolean;
 }
 
 /**
@@ -35,12 +94,21 @@ export interface CppCompileResult {
 export class CppGenerator {
   private ir?: IRDocument;
   private functionAnalysis = new Map<string, FunctionAnalysis>();
+  private options: CppOptions = {};
+  private profileSites: { func: string, node: string, op: string }[] = [];
+  /** Set while emitting a CPU kernel (see emitCpuKernel) */
+  private kernel?: {
+    globals: Map<string, string>;  // IR global input id -> unpacked local
+    texBound: Map<string, string>; // texture input id -> bound flag local
+  };
 
   /**
    * Compile an IR document to C++ source code
    */
-  compile(ir: IRDocument, entryPointId: string): CppCompileResult {
+  compile(ir: IRDocument, entryPointId: string, options: CppOptions = {}): CppCompileResult {
     this.ir = ir;
+    this.options = options;
+    this.profileSites = [];
     this.functionAnalysis.clear();
     const allFunctions = ir.functions;
     const entryFunc = allFunctions.find((f: FunctionDef) => f.id === entryPointId);
@@ -50,6 +118,7 @@ export class CppGenerator {
     const requiredFuncs = new Set<string>();
     const callStack: string[] = [];
     const shaderFuncs = new Map<string, { func: FunctionDef, stage: 'compute' | 'vertex' | 'fragment' }>();
+    const dispatchedShaders = new Set<string>();
     if (entryFunc.type === 'shader') {
       shaderFuncs.set(entryPointId, { func: entryFunc, stage: 'compute' });
     }
@@ -82,6 +151,7 @@ export class CppGenerator {
             const shaderFunc = allFunctions.find((f: FunctionDef) => f.id === targetFunc);
             if (shaderFunc && shaderFunc.type === 'shader') {
               shaderFuncs.set(targetFunc, { func: shaderFunc, stage: 'compute' });
+              dispatchedShaders.add(targetFunc);
             }
           }
         } else if (node.op === 'cmd_draw') {
@@ -169,7 +239,7 @@ export class CppGenerator {
     if (entryFunc.type === 'shader') {
       lines.push('// Entry point wrapper for shader harness');
       lines.push('void func_main(EvalContext& ctx) {');
-      lines.push('    std::vector<float> _shader_args;');
+      lines.push('    std::vector<float> &_shader_args = ctx.shaderArgs();');
       for (const input of (this.ir!.inputs || [])) {
         const irType = input.type || 'float';
         const argExpr = `ctx.getInput("${input.id}")`;
@@ -191,6 +261,108 @@ export class CppGenerator {
       lines.push('');
     }
 
+    // CPU kernels: dispatched compute shaders compiled for the CPU backend,
+    // which runs them when no Metal device is attached. A shader using
+    // something a kernel cannot do on the CPU gets no kernel and a
+    // diagnostic; dispatching it there fails the run.
+    const diagnostics: string[] = [];
+    const cpuKernels: string[] = [];
+    for (const id of dispatchedShaders) {
+      const kernelLines: string[] = [];
+      try {
+        this.emitCpuKernel(shaderFuncs.get(id)!.func, kernelLines, allFunctions);
+      } catch (e) {
+        diagnostics.push(`No CPU kernel for ${id}: ${(e as Error).message.replace(/\s+/g, ' ')}`);
+        continue;
+      }
+      lines.push(...kernelLines, '');
+      cpuKernels.push(id);
+    }
+    lines.push('void register_cpu_kernels(EvalContext& ctx) {');
+    for (const id of cpuKernels) {
+      lines.push(`    ctx.registerCpuKernel("${id}", ${this.cpuKernelName(id)});`);
+    }
+    if (cpuKernels.length === 0) lines.push('    (void)ctx;');
+    lines.push('}');
+    lines.push('');
+
+    // Frame graph declarations: resources each compute shader reads and writes,
+    // so batched passes that touch disjoint resources can run concurrently.
+    lines.push('void declare_frame_graph(EvalContext& ctx) {');
+    const accessRes = this.getAllResources();
+    const toIndices = (ids: Set<string>) => [...ids]
+      .map(id => accessRes.findIndex(r => r.id === id))
+      .sort((a, b) => a - b)
+      .join(', ');
+    let declaredAny = false;
+    for (const [id, info] of shaderFuncs) {
+      if (info.stage !== 'compute') continue;
+      const access = this.collectShaderAccess(id);
+      // Shaders with unresolved resource references stay undeclared (the
+      // runtime then treats them as touching everything).
+      if (!access) continue;
+      lines.push(`    ctx.declareShaderAccess("${id}", {${toIndices(access.reads)}}, {${toIndices(access.writes)}});`);
+      declaredAny = true;
+    }
+    // Scratch resources that need not survive between frames are transient:
+    // the runtime may alias their storage with other transients whose
+    // lifetimes within the frame don't overlap.
+    const hostAccessed = this.collectHostAccessedResources(requiredFuncs);
+    for (const res of this.ir!.resources) {
+      if (!this.isTransientResource(res, hostAccessed)) continue;
+      const idx = accessRes.findIndex(r => r.id === res.id);
+      const clear = res.persistence?.clearEveryFrame === true;
+      const clearValue = typeof res.persistence?.clearValue === 'number' ? res.persistence.clearValue : 0;
+      lines.push(`    ctx.declareTransient(${idx}, ${clear}, ${this.formatFloat(clearValue)});`);
+      declaredAny = true;
+    }
+    // Retained resources carry state between frames; pipelined CPU
+    // execution double-buffers them.
+    for (const res of this.ir!.resources) {
+      if (!res.persistence?.retain) continue;
+      const idx = accessRes.findIndex(r => r.id === res.id);
+      lines.push(`    ctx.declarePersistent(${idx});`);
+      declaredAny = true;
+    }
+    if (!declaredAny) lines.push('    (void)ctx;');
+    lines.push('}');
+    lines.push('');
+
+    // Profiling site table: index -> (function id, node id, op)
+    lines.push('void declare_profile_sites(EvalContext& ctx) {');
+    if (this.profileSites.length > 0) {
+      lines.push('    static const ProfileSite sites[] = {');
+      for (const site of this.profileSites) {
+        lines.push(`        {${JSON.stringify(site.func)}, ${JSON.stringify(site.node)}, ${JSON.stringify(site.op)}},`);
+      }
+      lines.push('    };');
+      lines.push(`    ctx.profiler.declareSites(sites, ${this.profileSites.length});`);
+    } else {
+      lines.push('    (void)ctx;');
+    }
+    lines.push('}');
+    lines.push('');
+
+    // Tuning params: defaults, then the autotuned values for this graph on
+    // this machine when the host passes a cache file (tuning-cache.h).
+    const hash = graphHash(ir);
+    lines.push(`const char* graph_hash() { return "${hash}"; }`);
+    lines.push('');
+    lines.push('int declare_tuning_params(EvalContext& ctx, const char* cachePath) {');
+    for (const p of ir.tuningParams || []) {
+      const value = p.default;
+      if (Array.isArray(value)) {
+        value.forEach((v, i) => {
+          if (typeof v === 'number') lines.push(`    ctx.inputs["${p.id}_${i}"] = ${this.formatFloat(v)};`);
+        });
+      } else if (typeof value === 'number' || typeof value === 'boolean') {
+        lines.push(`    ctx.inputs["${p.id}"] = ${this.formatFloat(value)};`);
+      }
+    }
+    lines.push('    return applyTuningCache(ctx.inputs, cachePath, graph_hash());');
+    lines.push('}');
+    lines.push('');
+
     // FFGL Plugin Helpers (guarded - only compiled when PLUGIN_CLASS is defined)
     lines.push('#ifdef PLUGIN_CLASS');
     lines.push('void PLUGIN_CLASS::init_plugin() {');
@@ -214,10 +386,12 @@ export class CppGenerator {
     lines.push('');
 
     lines.push('void PLUGIN_CLASS::map_params(EvalContext& ctx) {');
-    params.forEach((p, idx) => {
-      // Map back to inputs. Scale can be handled here or in IR math.
-      // For now, standard 0..1 mapping.
-      lines.push(`    ctx.inputs["${p.id}"] = GetFloatParameter(${idx});`);
+    // The plugin keeps one context across frames, so the input slots are
+    // looked up once and written through every frame.
+    lines.push('    if (!_paramsMapped) {');
+    lines.push('        _paramSlots.clear();');
+    params.forEach(p => {
+      lines.push(`        _paramSlots.push_back(&ctx.inputs["${p.id}"]);`);
     });
     // Automatically-managed resource bound flags in the uniform buffer for the
     // resource_is_bound op. Non-sidechannel textures are always bound in FFGL;
@@ -225,8 +399,14 @@ export class CppGenerator {
     const textureInputs = ir.inputs.filter(i => i.type === 'texture2d');
     for (const tex of textureInputs) {
       const bound = tex.sidechannel ? '0.0f' : '1.0f';
-      lines.push(`    ctx.inputs["tex_bound_${tex.id}"] = ${bound};`);
+      lines.push(`        ctx.inputs["tex_bound_${tex.id}"] = ${bound};`);
     }
+    lines.push('        _paramsMapped = true;');
+    lines.push('    }');
+    params.forEach((p, idx) => {
+      // Standard 0..1 mapping; scaling is handled in IR math.
+      lines.push(`    *_paramSlots[${idx}] = GetFloatParameter(${idx});`);
+    });
     lines.push('}');
     lines.push('');
 
@@ -308,6 +488,8 @@ export class CppGenerator {
       code: lines.join('\n'),
       resourceIds,
       shaderFunctions,
+      graphHash: hash,
+      diagnostics,
     };
   }
 
@@ -363,6 +545,83 @@ export class CppGenerator {
       .sort((a, b) => allRes.findIndex(r => r.id === a) - allRes.findIndex(r => r.id === b));
   }
 
+  /**
+   * Collect the resources a shader function reads and writes, including the
+   * helpers it calls. Returns undefined if a resource reference can't be
+   * resolved statically.
+   */
+  private collectShaderAccess(funcId: string, seen = new Set<string>(),
+    access = { reads: new Set<string>(), writes: new Set<string>() }): { reads: Set<string>, writes: Set<string> } | undefined {
+    if (seen.has(funcId)) return access;
+    seen.add(funcId);
+    const func = this.ir?.functions.find(f => f.id === funcId);
+    if (!func) return undefined;
+    const allRes = this.getAllResources();
+    for (const node of func.nodes) {
+      const rule = RESOURCE_ACCESS[node.op];
+      if (rule) {
+        const resId = node[rule.key];
+        if (typeof resId !== 'string' || !allRes.some(r => r.id === resId)) return undefined;
+        if (rule.read) access.reads.add(resId);
+        if (rule.write) access.writes.add(resId);
+      } else if (node.op === 'call_func' && typeof node['func'] === 'string') {
+        if (!this.collectShaderAccess(node['func'], seen, access)) return undefined;
+      }
+    }
+    return access;
+  }
+
+  /**
+   * Resources whose contents are accessed directly by CPU (host) functions.
+   */
+  private collectHostAccessedResources(cpuFuncIds: Iterable<string>): Set<string> {
+    const accessed = new Set<string>();
+    for (const funcId of cpuFuncIds) {
+      const func = this.ir?.functions.find(f => f.id === funcId);
+      for (const node of func?.nodes || []) {
+        const rule = RESOURCE_ACCESS[node.op];
+        if (rule && typeof node[rule.key] === 'string') accessed.add(node[rule.key]);
+      }
+    }
+    return accessed;
+  }
+
+  /**
+   * A resource is transient if its contents only matter within a frame:
+   * internal, not retained, never read back or touched by host code, and not
+   * a fixed-size buffer (those are initialised once by setup_resources).
+   */
+  private isTransientResource(res: ResourceDef, hostAccessed: Set<string>): boolean {
+    if (res.isOutput || res.persistence?.retain || res.persistence?.cpuAccess) return false;
+    if (hostAccessed.has(res.id)) return false;
+    const size: any = res.size;
+    if (typeof size === 'number' || (size && size.mode === 'fixed')) return false;
+    return true;
+  }
+
+  /**
+   * True if evaluating the node's data inputs reads resource contents, which
+   * would observe stale data while commands are still recorded in a batch.
+   */
+  private readsResourceData(nodeId: string, func: FunctionDef, edges: Edge[], seen = new Set<string>()): boolean {
+    if (seen.has(nodeId)) return false;
+    seen.add(nodeId);
+    const node = func.nodes.find(n => n.id === nodeId);
+    if (!node) return false;
+    const deps = edges.filter(e => e.to === nodeId && e.type === 'data').map(e => e.from);
+    for (const k in node) {
+      if (['id', 'op', 'metadata'].includes(k)) continue;
+      const val = (node as any)[k];
+      if (typeof val === 'string' && func.nodes.some(n => n.id === val)) deps.push(val);
+    }
+    return deps.some(dep => {
+      const depNode = func.nodes.find(n => n.id === dep);
+      if (!depNode) return false;
+      if (RESOURCE_ACCESS[depNode.op]?.read || depNode.op === 'call_func') return true;
+      return this.readsResourceData(dep, func, edges, seen);
+    });
+  }
+
   /**
    * Build function parameter list string
    */
@@ -449,7 +708,23 @@ export class CppGenerator {
     const returnType = hasReturn ? this.irTypeToCpp(f.outputs![0].type || 'float') : 'void';
     const params = this.buildFuncParams(f);
     lines.push(`${returnType} ${this.sanitizeId(f.id, 'func')}(EvalContext& ctx${params}) {`);
+    if (this.options.profile) {
+      // Also closes node sites left open by an early return
+      lines.push(`    NodeProfiler::Scope _profile_scope(ctx.profiler, ${this.profileSite(f.id, '', 'func')});`);
+    }
+
+    this.emitBody(f, '    ', lines, allFunctions, inferredTypes.get(f.id));
+    lines.push('}');
+  }
 
+  /** Local variables and statements of `f`, at `indent`. */
+  private emitBody(
+    f: FunctionDef,
+    indent: string,
+    lines: string[],
+    allFunctions: FunctionDef[],
+    funcInferred?: InferredTypes
+  ) {
     // Declare local variables
     for (const v of f.localVars) {
       const cppType = this.irTypeToCpp(v.type || 'float');
@@ -464,12 +739,10 @@ export class CppGenerator {
       } else {
         init = '{}';
       }
-      lines.push(`    ${cppType} ${this.sanitizeId(v.id, 'var')} = ${init};`);
+      lines.push(`${indent}${cppType} ${this.sanitizeId(v.id, 'var')} = ${init};`);
     }
 
     const edges = reconstructEdges(f);
-    const funcInferred = inferredTypes.get(f.id);
-
 
     // Track which pure nodes have been emitted (for auto declarations)
     const emittedPure = new Set<string>();
@@ -491,7 +764,10 @@ export class CppGenerator {
 
       // Use auto with inline initialization
       const expr = this.compileExpression(node, f, allFunctions, true, emitPure, edges, funcInferred);
-      lines.push(`    auto ${this.nodeResId(node.id)} = ${expr};`);
+      const profiled = !!this.options.profilePure;
+      if (profiled) this.emitProfileEnter(indent, f, node, lines);
+      lines.push(`${indent}auto ${this.nodeResId(node.id)} = ${expr};`);
+      if (profiled) this.emitProfileExit(indent, lines);
     };
 
     // Find entry nodes (executable nodes with no incoming execution edges)
@@ -501,10 +777,177 @@ export class CppGenerator {
     });
 
     for (const entry of entryNodes) {
-      this.emitChain('    ', entry, f, lines, new Set(), allFunctions, emitPure, edges, funcInferred);
+      this.emitChain(indent, entry, f, lines, new Set(), allFunctions, emitPure, edges, funcInferred);
+    }
+  }
+
+  /** Whether optional argument `key` is given, as a property or a data edge. */
+  private hasArg(node: Node, key: string, edges: Edge[]): boolean {
+    return node[key] !== undefined || edges.some(e => e.to === node.id && e.portIn === key && e.type === 'data');
+  }
+
+  private cpuKernelName(shaderId: string): string {
+    return `${this.sanitizeId(shaderId, 'func')}_cpu`;
+  }
+
+  /**
+   * Emit compute shader `func` as a CpuKernel: unpack the dispatch args (in
+   * the order cmd_dispatch packs them), then run the body once per
+   * invocation in the tile. Throws if the shader needs something a kernel
+   * cannot do on the CPU: calls, dynamic array inputs, GPU builtins other
+   * than the invocation id and output size, or global inputs the dispatch
+   * does not pack.
+   */
+  private emitCpuKernel(func: FunctionDef, lines: string[], allFunctions: FunctionDef[]) {
+    const kernel = { globals: new Map<string, string>(), texBound: new Map<string, string>() };
+    const unpack: string[] = [];
+    let offset = 0;
+    const declare = (name: string, irType: string, global: boolean) => {
+      const { expr, size } = this.unpackArg(irType, offset, global);
+      unpack.push(`    [[maybe_unused]] auto ${name} = ${expr};`);
+      offset += size;
+    };
+    const globals = [...(this.ir!.inputs || []), ...(this.ir!.tuningParams || [])];
+    if (func.inputs.length > 0) {
+      for (const input of func.inputs) declare(this.sanitizeId(input.id, 'input'), input.type || 'float', false);
+    } else {
+      for (const input of globals) {
+        if (input.type === 'texture2d') {
+          offset += 1;
+          continue;
+        }
+        const name = this.sanitizeId(input.id, 'input');
+        kernel.globals.set(input.id, name);
+        declare(name, input.type || 'float', true);
+      }
+    }
+    for (const b of this.dispatchBuiltins(func.id)) declare(`_b_${b}`, 'float', false);
+    if (this.functionAnalysis.get(func.id)?.usedBuiltins.has('output_size')) offset += 3;
+    offset += 2 * this.collectBufferSizeResources(func.id).length;
+    for (const tex of globals.filter(i => i.type === 'texture2d')) {
+      const name = `_tb_${tex.id.replace(/[^a-zA-Z0-9_]/g, '_')}`;
+      kernel.texBound.set(tex.id, name);
+      declare(name, 'float', false);
     }
 
-    lines.push('}');
+    this.kernel = kernel;
+    try {
+      lines.push(`void ${this.cpuKernelName(func.id)}([[maybe_unused]] EvalContext& ctx, [[maybe_unused]] const CpuDispatch& _d, const CpuTile& _t) {`);
+      if (offset > 0) {
+        // A dispatch packing fewer args than the shader expects runs nothing
+        lines.push(`    if (_d.argCount < ${offset}) return;`);
+        lines.push('    const float* _args = _d.args;');
+      }
+      lines.push(...unpack);
+      lines.push('    for (int _z = _t.z0; _z < _t.z1; ++_z)');
+      lines.push('    for (int _y = _t.y0; _y < _t.y1; ++_y)');
+      lines.push('    for (int _x = _t.x0; _x < _t.x1; ++_x) {');
+      lines.push('        [[maybe_unused]] const std::array<int, 3> _gid = {_x, _y, _z};');
+      // One call per invocation, so func_return can end it with `return`
+      lines.push('        [&]() {');
+      this.emitBody(func, '            ', lines, allFunctions, this.functionAnalysis.get(func.id)?.inferredTypes);
+      lines.push('        }();');
+      lines.push('    }');
+      lines.push('}');
+    } finally {
+      this.kernel = undefined;
+    }
+  }
+
+  /**
+   * Expression rebuilding a value of `irType` from `_args[offset...]`, the
+   * inverse of emitArgFlattening (or of emitGlobalInputFlattening when
+   * `global`), and the number of floats it takes.
+   */
+  private unpackArg(irType: string, offset: number, global: boolean): { expr: string, size: number } {
+    const at = (i: number) => `_args[${offset + i}]`;
+    const floats = (n: number) => `std::array<float, ${n}>{${Array.from({ length: n }, (_, i) => at(i)).join(', ')}}`;
+    const arrayMatch = irType.match(/^array<([^,]+),\s*(\d+)>$/);
+    if (arrayMatch) {
+      const items: string[] = [];
+      let size = 0;
+      for (let i = 0; i < parseInt(arrayMatch[2]); i++) {
+        const item = this.unpackArg(arrayMatch[1].trim(), offset + size, global);
+        items.push(item.expr);
+        size += item.size;
+      }
+      return { expr: `${this.irTypeToCpp(irType)}{${items.join(', ')}}`, size };
+    }
+    const vecSizes: Record<string, number> = { float2: 2, float3: 3, float4: 4, float3x3: 9, float4x4: 16 };
+    if (vecSizes[irType]) return { expr: floats(vecSizes[irType]), size: vecSizes[irType] };
+    // Other global inputs are packed as one float
+    if (global) return { expr: at(0), size: 1 };
+
+    const structDef = this.ir?.structs?.find(s => s.id === irType);
+    if (structDef) {
+      const members: string[] = [];
+      let size = 0;
+      for (const member of structDef.members) {
+        const item = this.unpackArg(member.type, offset + size, false);
+        members.push(item.expr);
+        size += item.size;
+      }
+      return { expr: `${this.sanitizeId(irType, 'struct')}{${members.join(', ')}}`, size };
+    }
+    if (/\[\]$/.test(irType) || /^array<[^,]+>$/.test(irType)) {
+      throw new Error(`dynamic array input (${irType})`);
+    }
+    const intSizes: Record<string, number> = { int2: 2, int3: 3, int4: 4 };
+    if (intSizes[irType]) {
+      const items = Array.from({ length: intSizes[irType] }, (_, i) => `static_cast<int>(${at(i)})`);
+      return { expr: `std::array<int, ${intSizes[irType]}>{${items.join(', ')}}`, size: intSizes[irType] };
+    }
+    if (irType === 'int' || irType === 'prng') return { expr: `static_cast<int>(${at(0)})`, size: 1 };
+    return { expr: at(0), size: 1 };
+  }
+
+  /**
+   * CPU-allowed builtins a dispatch of `shaderId` packs after its inputs, in
+   * packing order (prng_seed is added for auto-seeded prng_make).
+   */
+  private dispatchBuiltins(shaderId: string): string[] {
+    const analysis = this.functionAnalysis.get(shaderId);
+    const used = analysis ? [...analysis.usedBuiltins].filter(b => BUILTIN_CPU_ALLOWED.includes(b)) : [];
+    const shader = this.ir?.functions.find(f => f.id === shaderId);
+    if (!used.includes('prng_seed') && shader?.nodes.some(n => n.op === 'prng_make')) {
+      used.push('prng_seed');
+    }
+    return used;
+  }
+
+  /** Local holding IR global input `varId` inside a kernel. */
+  private kernelGlobal(varId: string): string {
+    const name = this.kernel!.globals.get(varId);
+    if (!name) throw new Error(`reads global input ${varId}, which the dispatch does not pack`);
+    return name;
+  }
+
+  private kernelBuiltin(name: string): string {
+    switch (name) {
+      case 'global_invocation_id': return '_gid';
+      case 'normalized_global_invocation_id':
+        return 'std::array<float, 3>{(_gid[0] + 0.5f) / _d.dimX, (_gid[1] + 0.5f) / _d.dimY, (_gid[2] + 0.5f) / _d.dimZ}';
+      case 'output_size': return 'std::array<int, 3>{_d.dimX, _d.dimY, _d.dimZ}';
+    }
+    if (BUILTIN_CPU_ALLOWED.includes(name)) return `_b_${name}`;
+    throw new Error(`uses builtin ${name}`);
+  }
+
+  /** ResourceState* of resource `id` inside a kernel. */
+  private kernelResource(id: string): string {
+    const idx = this.getAllResources().findIndex(r => r.id === id);
+    if (idx < 0) throw new Error(`uses unknown resource ${id}`);
+    return `ctx.resources[${idx}]`;
+  }
+
+  /** Floats per texel of texture `id` in host data. */
+  private texelStride(id: string): number {
+    const fmt = this.ir?.resources.find(r => r.id === id)?.format;
+    return fmt === 'r32f' || fmt === 'r16f' || fmt === 'r8' ? 1 : 4;
+  }
+
+  private isVectorType(irType: string): boolean {
+    return irType === 'float2' || irType === 'float3' || irType === 'float4';
   }
 
   private hasResult(op: string): boolean {
@@ -578,11 +1021,22 @@ export class CppGenerator {
     inferredTypes?: InferredTypes
   ) {
     let curr: Node | undefined = startNode;
+    let batching = false;
 
     while (curr) {
       if (visited.has(curr.id)) break;
       visited.add(curr.id);
 
+      // Record runs of consecutive commands into one frame-graph batch
+      const outEdge = edges.find(e => e.from === curr!.id && e.portOut === 'exec_out' && e.type === 'execution');
+      const next = outEdge ? func.nodes.find(n => n.id === outEdge.to) : undefined;
+      const continuesBatch = BATCHABLE_OPS.has(curr.op) && !!next && BATCHABLE_OPS.has(next.op) &&
+        !visited.has(next.id) && !this.readsResourceData(next.id, func, edges);
+      if (continuesBatch && !batching) {
+        lines.push(`${indent}ctx.beginBatch();`);
+        batching = true;
+      }
+
       // Emit data dependencies
       edges.filter(e => e.to === curr!.id && e.type === 'data').forEach(e => emitPure(e.from));
       for (const k in curr) {
@@ -597,6 +1051,10 @@ export class CppGenerator {
       } else if (curr.op === 'flow_loop') {
         this.emitLoop(indent, curr, func, lines, visited, allFunctions, emitPure, edges, inferredTypes);
         return;
+      } else if (curr.op === 'func_return' && this.kernel) {
+        // Ends this invocation
+        lines.push(`${indent}return;`);
+        return;
       } else if (curr.op === 'func_return') {
         // Store return value in context for readback
         const retVal = this.resolveArg(curr, 'val', func, allFunctions, emitPure, edges, inferredTypes);
@@ -619,11 +1077,16 @@ export class CppGenerator {
         }
         return;
       } else {
+        this.emitProfileEnter(indent, func, curr, lines);
         this.emitNode(indent, curr, func, lines, allFunctions, emitPure, edges, inferredTypes);
+        this.emitProfileExit(indent, lines);
       }
 
-      const outEdge = edges.find(e => e.from === curr!.id && e.portOut === 'exec_out' && e.type === 'execution');
-      curr = outEdge ? func.nodes.find(n => n.id === outEdge.to) : undefined;
+      if (batching && !continuesBatch) {
+        lines.push(`${indent}ctx.submitBatch();`);
+        batching = false;
+      }
+      curr = next;
     }
   }
 
@@ -639,6 +1102,7 @@ export class CppGenerator {
     inferredTypes?: InferredTypes
   ) {
     const cond = this.resolveArg(node, 'cond', func, allFunctions, emitPure, edges, inferredTypes);
+    this.emitProfileEnter(indent, func, node, lines);
     lines.push(`${indent}if (${cond}) {`);
     const trueEdge = edges.find(e => e.from === node.id && e.portOut === 'exec_true' && e.type === 'execution');
     const trueNode = trueEdge ? func.nodes.find(n => n.id === trueEdge.to) : undefined;
@@ -648,6 +1112,7 @@ export class CppGenerator {
     const falseNode = falseEdge ? func.nodes.find(n => n.id === falseEdge.to) : undefined;
     if (falseNode) this.emitChain(indent + '    ', falseNode, func, lines, new Set(visited), allFunctions, emitPure, edges, inferredTypes);
     lines.push(`${indent}}`);
+    this.emitProfileExit(indent, lines);
   }
 
   private emitLoop(
@@ -662,12 +1127,14 @@ export class CppGenerator {
     inferredTypes?: InferredTypes
   ) {
     const loopVar = `loop_${node.id.replace(/[^a-zA-Z0-9_]/g, '_')}`;
-    if (node['count'] !== undefined) {
+    if (this.hasArg(node, 'count', edges)) {
       const count = this.resolveArg(node, 'count', func, allFunctions, emitPure, edges, inferredTypes);
+      this.emitProfileEnter(indent, func, node, lines);
       lines.push(`${indent}for (int ${loopVar} = 0; ${loopVar} < ${count}; ${loopVar}++) {`);
     } else {
       const start = this.resolveArg(node, 'start', func, allFunctions, emitPure, edges, inferredTypes);
       const end = this.resolveArg(node, 'end', func, allFunctions, emitPure, edges, inferredTypes);
+      this.emitProfileEnter(indent, func, node, lines);
       lines.push(`${indent}for (int ${loopVar} = ${start}; ${loopVar} < ${end}; ${loopVar}++) {`);
     }
 
@@ -675,12 +1142,30 @@ export class CppGenerator {
     const bodyNode = bodyEdge ? func.nodes.find(n => n.id === bodyEdge.to) : undefined;
     if (bodyNode) this.emitChain(indent + '    ', bodyNode, func, lines, new Set(visited), allFunctions, emitPure, edges, inferredTypes);
     lines.push(`${indent}}`);
+    this.emitProfileExit(indent, lines);
 
     const compEdge = edges.find(e => e.from === node.id && e.portOut === 'exec_completed' && e.type === 'execution');
     const nextNode = compEdge ? func.nodes.find(n => n.id === compEdge.to) : undefined;
     if (nextNode) this.emitChain(indent, nextNode, func, lines, visited, allFunctions, emitPure, edges, inferredTypes);
   }
 
+  /** Register a profiling site and return its index in the site table. */
+  private profileSite(funcId: string, nodeId: string, op: string): number {
+    this.profileSites.push({ func: funcId, node: nodeId, op });
+    return this.profileSites.length - 1;
+  }
+
+  private emitProfileEnter(indent: string, func: FunctionDef, node: Node, lines: string[]) {
+    // Kernels run on worker threads; the profiler is per context
+    if (!this.options.profile || this.kernel) return;
+    lines.push(`${indent}ctx.profiler.enter(${this.profileSite(func.id, node.id, node.op)});`);
+  }
+
+  private emitProfileExit(indent: string, lines: string[]) {
+    if (!this.options.profile || this.kernel) return;
+    lines.push(`${indent}ctx.profiler.exit();`);
+  }
+
   private emitNode(
     indent: string,
     node: Node,
@@ -691,6 +1176,9 @@ export class CppGenerator {
     edges: Edge[],
     inferredTypes?: InferredTypes
   ) {
+    if (this.kernel && node.op.startsWith('cmd_')) {
+      throw new Error(`${node.op} inside a shader`);
+    }
     if (node.op === 'var_set') {
       const val = this.resolveArg(node, 'val', func, allFunctions, emitPure, edges, inferredTypes);
       const varId = node['var'];
@@ -705,19 +1193,27 @@ export class CppGenerator {
       const bufferDef = this.ir?.resources.find(r => r.id === bufferId);
       const dataType = bufferDef?.dataType || 'float';
 
+      if (this.kernel) {
+        lines.push(`${indent}${this.kernelResource(bufferId)}->${this.isVectorType(dataType) ? 'kernelStoreVec' : 'kernelStore'}(static_cast<int>(${idx}), ${val});`);
+        return;
+      }
       // For vector buffers, store the complete vector at the index
       if (dataType === 'float4' || dataType === 'float3' || dataType === 'float2') {
-        lines.push(`${indent}ctx.resources[${bufferIdx}]->storeVec(${idx}, ${val});`);
+        lines.push(`${indent}ctx.hostStoreVec(${bufferIdx}, ${idx}, ${val});`);
       } else {
-        lines.push(`${indent}ctx.resources[${bufferIdx}]->data[static_cast<size_t>(${idx})] = ${val};`);
+        lines.push(`${indent}ctx.hostElementForWrite(${bufferIdx}, static_cast<size_t>(${idx})) = ${val};`);
       }
     } else if (node.op === 'atomic_store') {
       const counterId = node['counter'];
       const idx = this.resolveArg(node, 'index', func, allFunctions, emitPure, edges, inferredTypes);
       const val = this.resolveArg(node, 'value', func, allFunctions, emitPure, edges, inferredTypes);
+      if (this.kernel) {
+        lines.push(`${indent}${this.kernelResource(counterId)}->kernelAtomicStore(static_cast<int>(${idx}), static_cast<int>(${val}));`);
+        return;
+      }
       const allRes = this.getAllResources();
       const bufferIdx = allRes.findIndex(r => r.id === counterId);
-      lines.push(`${indent}ctx.resources[${bufferIdx}]->data[static_cast<size_t>(${idx})] = int_bits_to_float(static_cast<int>(${val}));`);
+      lines.push(`${indent}ctx.hostElementForWrite(${bufferIdx}, static_cast<size_t>(${idx})) = int_bits_to_float(static_cast<int>(${val}));`);
     } else if (node.op === 'array_set') {
       // (unchanged logic omitted for brevity, but arguments updated)
       // array_set modifies a variable in-place, need to find the actual variable name
@@ -772,7 +1268,7 @@ export class CppGenerator {
       const dataType = srcDef?.dataType;
       const stride = dataType === 'float4' ? 4 : dataType === 'float3' ? 3 : dataType === 'float2' ? 2 : 1;
       const resolveOpt = (key: string, defaultExpr: string) => {
-        if (node[key] !== undefined) return this.resolveArg(node, key, func, allFunctions, emitPure, edges, inferredTypes);
+        if (this.hasArg(node, key, edges)) return this.resolveArg(node, key, func, allFunctions, emitPure, edges, inferredTypes);
         return defaultExpr;
       };
       const srcOffset = resolveOpt('src_offset', '0');
@@ -797,9 +1293,66 @@ export class CppGenerator {
       const srcRect = resolveRect('src_rect');
       const dstRect = resolveRect('dst_rect');
       const sampleMode = node['sample'] === 'bilinear' ? 2 : node['sample'] === 'nearest' ? 1 : 0;
-      const alphaVal = node['alpha'] !== undefined ? this.resolveArg(node, 'alpha', func, allFunctions, emitPure, edges, inferredTypes) : '1.0f';
+      const alphaVal = this.hasArg(node, 'alpha', edges) ? this.resolveArg(node, 'alpha', func, allFunctions, emitPure, edges, inferredTypes) : '1.0f';
       const normalized = node['normalized'] === true ? 'true' : 'false';
       lines.push(`${indent}ctx.copyTexture(${srcIdx}, ${dstIdx}, ${srcRect}, ${dstRect}, ${sampleMode}, ${alphaVal}, ${normalized});`);
+    } else if (node.op === 'cmd_blur_texture') {
+      const allRes = this.getAllResources();
+      const srcIdx = allRes.findIndex(r => r.id === node['src']);
+      const dstIdx = allRes.findIndex(r => r.id === node['dst']);
+      const radius = this.resolveArg(node, 'radius', func, allFunctions, emitPure, edges, inferredTypes);
+      const sigma = this.hasArg(node, 'sigma', edges) ? this.resolveArg(node, 'sigma', func, allFunctions, emitPure, edges, inferredTypes) : '0.0f';
+      const mode = node['mode'] === 'box' ? 1 : 0;
+      lines.push(`${indent}ctx.blurTexture(${srcIdx}, ${dstIdx}, ${radius}, ${sigma}, ${mode});`);
+    } else if (node.op === 'cmd_convolve_texture') {
+      const allRes = this.getAllResources();
+      const indexOf = (id: string | undefined) => id === undefined ? -1 : allRes.findIndex(r => r.id === id);
+      const arg = (name: string, fallback: string) => this.hasArg(node, name, edges) ? this.resolveArg(node, name, func, allFunctions, emitPure, edges, inferredTypes) : fallback;
+      const normalize = node['normalize'] === false ? 'false' : 'true';
+      lines.push(`${indent}ctx.convolveTexture(${indexOf(node['src'])}, ${indexOf(node['dst'])}, ${indexOf(node['kernel'])}, ${arg('radius', '0.0f')}, ${arg('sigma', '0.0f')}, ${normalize});`);
+    } else if (node.op === 'cmd_scan_buffer' || node.op === 'cmd_compact_buffer' || node.op === 'cmd_sort_buffer' || node.op === 'cmd_reduce_buffer') {
+      const allRes = this.getAllResources();
+      const indexOf = (id: string | undefined) => id === undefined ? -1 : allRes.findIndex(r => r.id === id);
+      const strideOf = (id: string | undefined) => {
+        // Texture pixels are RGBA floats
+        if (allRes.find(r => r.id === id)?.type === 'texture2d') return 4;
+        const dataType = this.ir?.resources.find(r => r.id === id)?.dataType;
+        return dataType === 'float4' ? 4 : dataType === 'float3' ? 3 : dataType === 'float2' ? 2 : 1;
+      };
+      // Counts and totals land in atomic counters as int bits
+      const isCounter = (id: string | undefined) => allRes.find(r => r.id === id)?.type === 'atomic_counter' ? 'true' : 'false';
+      const srcIdx = indexOf(node['src']);
+      const dstIdx = indexOf(node['dst']);
+      const stride = strideOf(node['src']);
+      if (node.op === 'cmd_scan_buffer') {
+        const count = this.hasArg(node, 'count', edges) ? this.resolveArg(node, 'count', func, allFunctions, emitPure, edges, inferredTypes) : '-1';
+        const inclusive = node['inclusive'] === true ? 'true' : 'false';
+        lines.push(`${indent}ctx.scanBuffer(${srcIdx}, ${dstIdx}, ${stride}, ${inclusive}, static_cast<int>(${count}), ${indexOf(node['total'])}, ${isCounter(node['total'])});`);
+      } else if (node.op === 'cmd_reduce_buffer') {
+        const arg = (name: string, fallback: string) => this.hasArg(node, name, edges) ? this.resolveArg(node, name, func, allFunctions, emitPure, edges, inferredTypes) : fallback;
+        const modes = ['sum', 'min', 'max', 'mean', 'argmin', 'argmax', 'histogram'];
+        const mode = Math.max(0, modes.indexOf(node['mode'] ?? 'sum'));
+        const component = node['component'] !== undefined ? Number(node['component']) : -1;
+        const bins = node['bins'] !== undefined ? Number(node['bins']) : -1;
+        lines.push(`${indent}ctx.reduceBuffer(${srcIdx}, ${dstIdx}, ${stride}, ${mode}, ${component}, static_cast<int>(${arg('count', '-1')}), ${bins}, ${arg('range_min', '0.0f')}, ${arg('range_max', '1.0f')}, ${isCounter(node['dst'])});`);
+      } else if (node.op === 'cmd_sort_buffer') {
+        const count = this.hasArg(node, 'count', edges) ? this.resolveArg(node, 'count', func, allFunctions, emitPure, edges, inferredTypes) : '-1';
+        const keys = node['keys'];
+        const keyComponent = Number(node['key_component'] ?? 0);
+        const descending = node['descending'] === true ? 'true' : 'false';
+        lines.push(`${indent}ctx.sortBuffer(${srcIdx}, ${dstIdx}, ${stride}, ${keyComponent}, ${indexOf(keys)}, ${keys !== undefined ? strideOf(keys) : 1}, ${descending}, static_cast<int>(${count}));`);
+      } else {
+        const flags = node['flags'];
+        lines.push(`${indent}ctx.compactBuffer(${srcIdx}, ${indexOf(flags)}, ${dstIdx}, ${stride}, ${flags !== undefined ? strideOf(flags) : stride}, ${indexOf(node['counter'])}, ${isCounter(node['counter'])});`);
+      }
+    } else if (node.op === 'texture_store' && this.kernel) {
+      const texId = node['tex'] as string;
+      const coords = this.resolveArg(node, 'coords', func, allFunctions, emitPure, edges, inferredTypes);
+      const val = this.resolveArg(node, 'value', func, allFunctions, emitPure, edges, inferredTypes);
+      // Unorm formats (the default) clamp stored values to 0..1
+      const fmt = this.ir?.resources.find(r => r.id === texId)?.format;
+      const unorm = !fmt || fmt === 'rgba8' || fmt === 'r8';
+      lines.push(`${indent}${this.kernelResource(texId)}->kernelStoreTexel(static_cast<int>(${coords}[0]), static_cast<int>(${coords}[1]), ${val}, ${this.texelStride(texId)}, ${unorm});`);
     } else if (node.op === 'texture_store') {
       // Texture store is handled by Metal on GPU. CPU fallback is no-op.
     } else if (node.op === 'cmd_dispatch') {
@@ -832,16 +1385,12 @@ export class CppGenerator {
 
       // Collect CPU-allowed builtins used by the target shader
       const shaderAnalysis = this.functionAnalysis.get(targetFunc);
-      const usedBuiltins = shaderAnalysis ? [...shaderAnalysis.usedBuiltins].filter(b => BUILTIN_CPU_ALLOWED.includes(b)) : [];
-      // Auto-inject prng_seed if shader has prng_make nodes (auto-seed needs it)
-      if (!usedBuiltins.includes('prng_seed') && targetFuncDef?.nodes.some(n => n.op === 'prng_make')) {
-        usedBuiltins.push('prng_seed');
-      }
+      const usedBuiltins = this.dispatchBuiltins(targetFunc);
       const needsOutputSize = shaderAnalysis ? shaderAnalysis.usedBuiltins.has('output_size') : false;
 
       if (hasExplicitInputs || hasGlobalInputs || usedBuiltins.length > 0 || needsOutputSize) {
         lines.push(`${indent}{`);
-        lines.push(`${indent}    std::vector<float> _shader_args;`);
+        lines.push(`${indent}    std::vector<float> &_shader_args = ctx.shaderArgs();`);
 
         if (hasExplicitInputs) {
           for (const input of targetFuncDef!.inputs!) {
@@ -849,7 +1398,7 @@ export class CppGenerator {
             if (node['args'] && node['args'][input.id]) {
               const argId = node['args'][input.id];
               argExpr = this.resolveArg({ ...node, [input.id]: argId } as Node, input.id, func, allFunctions, emitPure, edges, inferredTypes);
-            } else if (node[input.id] !== undefined) {
+            } else if (this.hasArg(node, input.id, edges)) {
               argExpr = this.resolveArg(node, input.id, func, allFunctions, emitPure, edges, inferredTypes);
             } else {
               argExpr = '0.0f';
@@ -908,7 +1457,7 @@ export class CppGenerator {
         if (bufferSizeResourcesNoArgs.length > 0 || texInputsNoArgs.length > 0) {
           const dispAllRes2 = this.getAllResources();
           lines.push(`${indent}{`);
-          lines.push(`${indent}    std::vector<float> _shader_args;`);
+          lines.push(`${indent}    std::vector<float> &_shader_args = ctx.shaderArgs();`);
           for (const resId of bufferSizeResourcesNoArgs) {
             const resIdx = dispAllRes2.findIndex(r => r.id === resId);
             lines.push(`${indent}    _shader_args.push_back(static_cast<float>(ctx.resources[${resIdx}]->width));`);
@@ -945,7 +1494,7 @@ export class CppGenerator {
       const hasGlobalInputs = allGlobalInputs.filter(i => i.type !== 'texture2d').length > 0;
       if (hasGlobalInputs || drawNeedsOutputSize || drawBufferSizeResources.length > 0) {
         lines.push(`${indent}{`);
-        lines.push(`${indent}    std::vector<float> _shader_args;`);
+        lines.push(`${indent}    std::vector<float> &_shader_args = ctx.shaderArgs();`);
         if (hasGlobalInputs) {
           for (const input of allGlobalInputs) {
             if (input.type === 'texture2d') continue;
@@ -995,8 +1544,8 @@ export class CppGenerator {
         lines.push(`${indent}float ${this.nodeResId(node.id)} = _prng_hash_to_float(${varExpr});`);
       } else if (count === 1 && isInt) {
         lines.push(`${indent}${varExpr} = ${varExpr} + 1;`);
-        const hasMin = node['min'] !== undefined || edges.some(e => e.to === node.id && e.portIn === 'min' && e.type === 'data');
-        const hasMax = node['max'] !== undefined || edges.some(e => e.to === node.id && e.portIn === 'max' && e.type === 'data');
+        const hasMin = this.hasArg(node, 'min', edges);
+        const hasMax = this.hasArg(node, 'max', edges);
         if (hasMin && hasMax) {
           const minExpr = this.resolveArg(node, 'min', func, allFunctions, emitPure, edges, inferredTypes);
           const maxExpr = this.resolveArg(node, 'max', func, allFunctions, emitPure, edges, inferredTypes);
@@ -1085,6 +1634,7 @@ export class CppGenerator {
         if (func.inputs.some(i => i.id === baseVal)) return applySwizzle(this.sanitizeId(baseVal, 'input'), getElemType(baseVal));
         // Check IR global inputs (input inheritance)
         if (this.ir?.inputs?.some(i => i.id === baseVal) || this.ir?.tuningParams?.some(i => i.id === baseVal)) {
+          if (this.kernel) return applySwizzle(this.kernelGlobal(baseVal), 'float');
           const varId = baseVal;
           const inputDef = (this.ir.inputs.find(i => i.id === varId) ?? this.ir.tuningParams?.find(i => i.id === varId))!;
           let baseExpr: string;
@@ -1244,6 +1794,7 @@ export class CppGenerator {
         if (func.localVars.some(v => v.id === varId)) return this.sanitizeId(varId, 'var');
         if (func.inputs.some(i => i.id === varId)) return this.sanitizeId(varId, 'input');
         if (this.ir?.inputs?.some(i => i.id === varId) || this.ir?.tuningParams?.some(i => i.id === varId)) {
+          if (this.kernel) return this.kernelGlobal(varId);
           const inputDef = (this.ir.inputs.find(i => i.id === varId) ?? this.ir.tuningParams?.find(i => i.id === varId))!;
           if (inputDef.type === 'float2') {
             return `std::array<float, 2>{ctx.getInput("${varId}_0"), ctx.getInput("${varId}_1")}`;
@@ -1287,26 +1838,38 @@ export class CppGenerator {
       case 'buffer_load': {
         const bufferId = node['buffer'];
         const idx = a('index');
+        if (this.kernel) {
+          const dataType = this.ir?.resources.find(r => r.id === bufferId)?.dataType || 'float';
+          if (this.isVectorType(dataType)) {
+            return `${this.kernelResource(bufferId)}->kernelLoadVec<${dataType.slice(-1)}>(static_cast<int>(${idx}))`;
+          }
+          return `${this.kernelResource(bufferId)}->kernelLoad(static_cast<int>(${idx}))`;
+        }
         const allRes = this.getAllResources();
         const bufferIdx = allRes.findIndex(r => r.id === bufferId);
-        return `ctx.resources[${bufferIdx}]->data[static_cast<size_t>(${idx})]`;
+        return `ctx.hostData(${bufferIdx})[static_cast<size_t>(${idx})]`;
       }
 
       case 'atomic_load': {
         const counterId = node['counter'];
         const idx = a('index');
+        if (this.kernel) return `${this.kernelResource(counterId)}->kernelAtomicLoad(static_cast<int>(${idx}))`;
         const allRes = this.getAllResources();
         const bufferIdx = allRes.findIndex(r => r.id === counterId);
-        return `float_bits_to_int(ctx.resources[${bufferIdx}]->data[static_cast<size_t>(${idx})])`;
+        return `float_bits_to_int(ctx.hostData(${bufferIdx})[static_cast<size_t>(${idx})])`;
       }
 
       case 'atomic_add': case 'atomic_sub': case 'atomic_min': case 'atomic_max': case 'atomic_exchange': {
         const counterId = node['counter'];
         const idx = a('index');
         const val = a('value');
+        if (this.kernel) {
+          const atomicOps: Record<string, string> = { atomic_add: 'Add', atomic_sub: 'Sub', atomic_min: 'Min', atomic_max: 'Max', atomic_exchange: 'Exchange' };
+          return `${this.kernelResource(counterId)}->kernelAtomic(static_cast<int>(${idx}), ResourceState::AtomicOp::${atomicOps[node.op]}, static_cast<int>(${val}))`;
+        }
         const allRes = this.getAllResources();
         const bufferIdx = allRes.findIndex(r => r.id === counterId);
-        const accessor = `ctx.resources[${bufferIdx}]->data[static_cast<size_t>(${idx})]`;
+        const accessor = `ctx.hostElementForWrite(${bufferIdx}, static_cast<size_t>(${idx}))`;
         const cppOps: Record<string, string> = {
           'atomic_add': `old + static_cast<int>(${val})`,
           'atomic_sub': `old - static_cast<int>(${val})`,
@@ -1602,11 +2165,22 @@ export class CppGenerator {
         const fmt = resDef?.format;
         const elemStride = (fmt === 'r32f' || fmt === 'r16f' || fmt === 'r8') ? 1 : 4;
         const coordsExpr = this.resolveArg(node, 'coords', func, allFunctions, emitPure, edges);
+        if (this.kernel) {
+          return `sampleResource(*${this.kernelResource(texId)}, ${coordsExpr}[0], ${coordsExpr}[1], ${wrapMode}, ${filterMode}, ${elemStride})`;
+        }
         return `ctx.sampleTexture(${resIdx}, ${coordsExpr}[0], ${coordsExpr}[1], ${wrapMode}, ${filterMode}, ${elemStride})`;
       }
 
+      case 'texture_load': {
+        if (!this.kernel) throw new Error(`C++ Generator: Unsupported op '${node.op}'`);
+        const texId = node['tex'] as string;
+        const coordsExpr = this.resolveArg(node, 'coords', func, allFunctions, emitPure, edges);
+        return `${this.kernelResource(texId)}->kernelTexel(static_cast<int>(${coordsExpr}[0]), static_cast<int>(${coordsExpr}[1]), ${this.texelStride(texId)})`;
+      }
+
       case 'call_func': {
         const targetFunc = node['func'];
+        if (this.kernel) throw new Error(`calls ${targetFunc}`);
         const targetFuncDef = allFunctions.find((f: FunctionDef) => f.id === targetFunc);
         if (!targetFuncDef) throw new Error(`C++ Generator: Function '${targetFunc}' not found`);
 
@@ -1796,11 +2370,13 @@ export class CppGenerator {
 
       case 'resource_is_bound': {
         const resId = node['resource'];
+        if (this.kernel) return `(${this.kernel.texBound.get(resId) ?? '0.0f'} > 0.5f)`;
         return `(ctx.getInput("tex_bound_${resId}") > 0.5f)`;
       }
 
       case 'builtin_get': {
         const name = node['name'] as string;
+        if (this.kernel) return this.kernelBuiltin(name);
         if (BUILTIN_CPU_ALLOWED.includes(name)) {
           return `ctx.getInput("${name}")`;
         }
@@ -1808,13 +2384,15 @@ export class CppGenerator {
       }
 
       case 'prng_make': {
-        const hasSeed = node['seed'] !== undefined || edges.some(e => e.to === node.id && e.portIn === 'seed' && e.type === 'data');
+        const hasSeed = this.hasArg(node, 'seed', edges);
         if (hasSeed) {
           const seed = a('seed');
           return `_prng_hash(static_cast<int>(${seed}))`;
         }
         // Auto-seed: hash of prng_seed + compile-time function name hash
+        // (+ the invocation in kernels, as in the MSL generator)
         const funcHash = this.hashString(func.id);
+        if (this.kernel) return `_prng_hash(static_cast<int>(_b_prng_seed * 2147483647.0f) + ${funcHash} + _gid[0] + _gid[1] * 65536)`;
         return `_prng_hash(static_cast<int>(ctx.getInput("prng_seed") * 2147483647.0f) + ${funcHash})`;
       }
 
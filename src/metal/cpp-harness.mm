@@ -3,19 +3,25 @@
 
 #import <Foundation/Foundation.h>
 #import <Metal/Metal.h>
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "alloc-counter.h"
 #include "intrinsics.incl.h"
 
+NANO_DEFINE_ALLOC_COUNTER()
+
 // Load a .metallib file
 id<MTLLibrary> loadMetalLib(id<MTLDevice> device, const char *path) {
   NSError *error = nil;
@@ -31,6 +37,47 @@ id<MTLLibrary> loadMetalLib(id<MTLDevice> device, const char *path) {
   return library;
 }
 
+// Per-dispatch times from a trace: the host call of each dispatch and the
+// execution it issued (CPU "exec" or Metal "gpu" event), paired per kernel in
+// issue order.
+void writeDispatchTimings(const TraceRecorder &trace, std::ostream &out) {
+  std::vector<TraceEvent> events = trace.snapshot();
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent &a, const TraceEvent &b) {
+                     return a.beginNs < b.beginNs;
+                   });
+  auto ms = [](const TraceEvent &e) {
+    return static_cast<double>(e.endNs - e.beginNs) / 1e6;
+  };
+  std::vector<const TraceEvent *> issued;
+  std::unordered_map<std::string, std::vector<const TraceEvent *>> executed;
+  for (const TraceEvent &e : events) {
+    if (std::strcmp(e.name, "dispatch") != 0)
+      continue;
+    if (std::strcmp(e.category, "host") == 0)
+      issued.push_back(&e);
+    else
+      executed[e.target].push_back(&e);
+  }
+  std::unordered_map<std::string, size_t> next;
+  out << "[";
+  for (size_t i = 0; i < issued.size(); ++i) {
+    const TraceEvent &host = *issued[i];
+    out << (i > 0 ? "," : "") << "{\"name\":\"" << host.target
+        << "\",\"hostMs\":" << ms(host);
+    auto &runs = executed[host.target];
+    size_t &k = next[host.target];
+    if (k < runs.size()) {
+      const TraceEvent &run = *runs[k++];
+      out << (std::strcmp(run.category, "gpu") == 0 ? ",\"gpuMs\":"
+                                                   : ",\"execMs\":")
+          << ms(run);
+    }
+    out << "}";
+  }
+  out << "]";
+}
+
 // =====================
 // Generated code will be included here
 // =====================
@@ -42,11 +89,29 @@ id<MTLLibrary> loadMetalLib(id<MTLDevice> device, const char *path) {
 
 int main(int argc, const char *argv[]) {
   @autoreleasepool {
+    // Phase timings (ms), reported as "timings"
+    using Clock = std::chrono::steady_clock;
+    auto phaseStart = Clock::now();
+    auto lap = [&phaseStart]() {
+      auto now = Clock::now();
+      double ms = std::chrono::duration<double, std::milli>(now - phaseStart)
+                      .count();
+      phaseStart = now;
+      return ms;
+    };
+
     // Parse arguments: [metallib_path] [-i name:value ...] <resource_specs...>
     // If first arg ends with .metallib, it's the shader library path
     // -i name:value sets an input variable
     // Resource specs: <size> for buffers, T:<width>:<height> for textures
 
+    // CPU backend options (-P, -m, -q, -b); declared before the contexts
+    // that use them so they outlive them
+    std::unique_ptr<FramePipeline> pipeline;
+    std::unique_ptr<MemoryPlanner> memoryPlanner;
+    std::unique_ptr<CpuQueue> cpuQueue;
+    std::unique_ptr<DispatchBudget> budget;
+
     EvalContext ctx;
     std::vector<ResourceState> resourceStorage;
 
@@ -65,9 +130,25 @@ int main(int argc, const char *argv[]) {
       }
     }
 
-    // Parse -i input args, -d data file, then resource specs
+    double initMs = lap();
+
+    // Parse -i input args, -d data file, -p folded-stack profile output,
+    // -t Chrome trace output, -c hardware counters, then resource specs.
+    // CPU backend options: -f <frames> to run, -P <n> pipelined frames in
+    // flight, -m transient aliasing, -q <threads> async queue, -b <us>
+    // dispatch budget per frame
     std::vector<std::string> resourceArgs;
     std::string dataFilePath;
+    std::string foldedPath;
+    std::string tracePath;
+    std::string tuningPath;
+    std::vector<std::pair<std::string, float>> inputArgs;
+    bool sampleCounters = false;
+    int frames = 1;
+    unsigned framesInFlight = 1;
+    bool planMemory = false;
+    unsigned queueThreads = 0;
+    long budgetUs = 0;
     for (int i = argStart; i < argc; ++i) {
       std::string arg = argv[i];
       if (arg == "-i" && i + 1 < argc) {
@@ -77,15 +158,40 @@ int main(int argc, const char *argv[]) {
         if (colonPos != std::string::npos) {
           std::string name = input.substr(0, colonPos);
           float value = std::stof(input.substr(colonPos + 1));
-          ctx.inputs[name] = value;
+          inputArgs.emplace_back(name, value);
         }
+      } else if (arg == "-T" && i + 1 < argc) {
+        tuningPath = argv[++i];
       } else if (arg == "-d" && i + 1 < argc) {
         dataFilePath = argv[++i];
+      } else if (arg == "-p" && i + 1 < argc) {
+        foldedPath = argv[++i];
+      } else if (arg == "-t" && i + 1 < argc) {
+        tracePath = argv[++i];
+      } else if (arg == "-c") {
+        sampleCounters = true;
+      } else if (arg == "-f" && i + 1 < argc) {
+        frames = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "-P" && i + 1 < argc) {
+        framesInFlight = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+      } else if (arg == "-m") {
+        planMemory = true;
+      } else if (arg == "-q" && i + 1 < argc) {
+        queueThreads = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+      } else if (arg == "-b" && i + 1 < argc) {
+        budgetUs = std::stol(argv[++i]);
       } else {
         resourceArgs.push_back(arg);
       }
     }
 
+    // Tuning defaults (and -T cache values) first; -i overrides both.
+    declare_tuning_params(ctx, tuningPath.c_str());
+    for (const auto &kv : inputArgs)
+      ctx.inputs[kv.first] = kv.second;
+
+    double parseMs = lap();
+
     // Parse resource specs
     for (const auto &arg : resourceArgs) {
       if (arg.size() > 2 && arg[0] == 'T' && arg[1] == ':') {
@@ -139,6 +245,8 @@ int main(int argc, const char *argv[]) {
       ctx.resources.push_back(&res);
     }
 
+    double allocateMs = lap();
+
     // Load pre-populated resource data from JSON file if provided
     if (!dataFilePath.empty()) {
       std::ifstream dataFile(dataFilePath);
@@ -179,11 +287,92 @@ int main(int argc, const char *argv[]) {
       }
     }
 
-    // Call generated entry point
-    func_main(ctx);
+    double loadDataMs = lap();
+
+    // Always traced: per-dispatch times come from the trace events (a
+    // smaller ring unless -t asked for the full timeline)
+    auto trace = std::make_unique<TraceRecorder>(tracePath.empty() ? 4096
+                                                                   : 1 << 16);
+    ctx.trace = trace.get();
+    std::unique_ptr<PerfCounters> counters;
+    if (sampleCounters) {
+      counters = std::make_unique<PerfCounters>();
+      ctx.perf = counters.get();
+    }
+
+    // Declare shader resource access and CPU kernels, then call generated
+    // entry point
+    declare_frame_graph(ctx);
+    register_cpu_kernels(ctx);
+    declare_profile_sites(ctx);
+
+    // Attach the CPU backend options (they have no effect on Metal)
+    if (planMemory) {
+      memoryPlanner = std::make_unique<MemoryPlanner>();
+      ctx.memoryPlanner = memoryPlanner.get();
+    }
+    if (queueThreads > 0) {
+      cpuQueue = std::make_unique<CpuQueue>(queueThreads);
+      ctx.cpuQueue = cpuQueue.get();
+    }
+    if (budgetUs > 0) {
+      budget = std::make_unique<DispatchBudget>(
+          std::chrono::microseconds(budgetUs));
+      ctx.dispatchBudget = budget.get();
+    }
+    // Pipelined frames run on a ring of contexts sharing the resources;
+    // persistent resources get a copy per context.
+    std::vector<std::unique_ptr<EvalContext>> extraContexts;
+    std::vector<EvalContext *> ring = {&ctx};
+    if (framesInFlight > 1 && ctx.usesCpuBackend()) {
+      pipeline = std::make_unique<FramePipeline>(framesInFlight);
+      ctx.framePipeline = pipeline.get();
+      for (unsigned k = 1; k < framesInFlight; ++k) {
+        auto c = std::make_unique<EvalContext>();
+        c->resources = ctx.resources;
+        c->isTextureResource = ctx.isTextureResource;
+        c->texWidths = ctx.texWidths;
+        c->texHeights = ctx.texHeights;
+        c->texWrapModes = ctx.texWrapModes;
+        c->inputs = ctx.inputs;
+        c->trace = ctx.trace;
+        c->perf = ctx.perf;
+        c->framePipeline = pipeline.get();
+        c->dispatchBudget = ctx.dispatchBudget;
+        declare_frame_graph(*c);
+        register_cpu_kernels(*c);
+        declare_profile_sites(*c);
+        ring.push_back(c.get());
+        extraContexts.push_back(std::move(c));
+      }
+    }
+
+    auto allocStart = AllocCounter::now();
+    lap();
+    for (int f = 0; f < frames; ++f) {
+      EvalContext &c = *ring[f % ring.size()];
+      c.beginHostFrame();
+      c.beginFrame();
+      func_main(c);
+      if (frames > 1 || ring.size() > 1 || memoryPlanner)
+        c.endFrame();
+    }
+    double funcMainMs = lap();
 
     // Ensure GPU work is done and results synced back
-    ctx.waitForPendingCommands();
+    EvalContext &result = *ring[(frames - 1) % ring.size()];
+    result.waitForPendingCommands();
+    double waitMs = lap();
+    // A dispatch without a CPU kernel did not run; its outputs are not a
+    // result.
+    for (EvalContext *c : ring)
+      if (!c->missingCpuKernels.empty())
+        return 1;
+    auto frameAllocs = AllocCounter::since(allocStart);
+    if (!tracePath.empty()) {
+      std::ofstream traceFile(tracePath);
+      trace->writeJson(traceFile);
+    }
 
     // Helper to output JSON-safe float (NaN → null, ±Inf → ±1e999)
     auto emitFloat = [](float v) {
@@ -197,11 +386,11 @@ int main(int argc, const char *argv[]) {
 
     // Output resources as JSON
     std::cout << "{\"resources\":[";
-    for (size_t r = 0; r < ctx.resources.size(); ++r) {
+    for (size_t r = 0; r < result.resources.size(); ++r) {
       if (r > 0)
         std::cout << ",";
-      auto *res = ctx.resources[r];
-      bool isTex = r < ctx.isTextureResource.size() && ctx.isTextureResource[r];
+      auto *res = result.resources[r];
+      bool isTex = r < result.isTextureResource.size() && result.isTextureResource[r];
       std::cout << "{\"type\":\"" << (isTex ? "texture" : "buffer")
                 << "\",\"width\":" << res->width
                 << ",\"height\":" << res->height << ",\"data\":[";
@@ -215,32 +404,81 @@ int main(int argc, const char *argv[]) {
     std::cout << "]";
 
     // Output return value if set
-    if (!ctx.returnValue.empty()) {
+    if (!result.returnValue.empty()) {
       std::cout << ",\"returnValue\":[";
-      for (size_t i = 0; i < ctx.returnValue.size(); ++i) {
+      for (size_t i = 0; i < result.returnValue.size(); ++i) {
         if (i > 0)
           std::cout << ",";
-        emitFloat(ctx.returnValue[i]);
+        emitFloat(result.returnValue[i]);
       }
       std::cout << "]";
     }
 
     // Output action log
-    if (!ctx.actionLog.empty()) {
+    if (!result.actionLog.empty()) {
       std::cout << ",\"log\":[";
-      for (size_t i = 0; i < ctx.actionLog.size(); ++i) {
+      for (size_t i = 0; i < result.actionLog.size(); ++i) {
         if (i > 0)
           std::cout << ",";
-        auto &a = ctx.actionLog[i];
-        std::cout << "{\"type\":\"" << a.type << "\"";
-        if (!a.target.empty())
-          std::cout << ",\"target\":\"" << a.target << "\"";
-        std::cout << ",\"width\":" << a.width << ",\"height\":" << a.height;
-        std::cout << "}";
+        const ActionRecord &a = result.actionLog[i];
+        std::cout << "{\"type\":\"" << actionOpName(a.op) << "\""
+                  << ",\"resource\":" << a.resource
+                  << ",\"width\":" << a.width << ",\"height\":" << a.height
+                  << ",\"timeNs\":" << a.timeNs << "}";
       }
       std::cout << "]";
+      if (result.actionLog.dropped() > 0)
+        std::cout << ",\"logDropped\":" << result.actionLog.dropped();
     }
 
+    // Per-node profile (generated with CppOptions.profile)
+    if (result.profiler.enabled()) {
+      std::cout << ",\"profile\":";
+      result.profiler.writeReport(std::cout);
+      if (!foldedPath.empty()) {
+        std::ofstream folded(foldedPath);
+        result.profiler.writeFolded(folded);
+      }
+    }
+
+    // Hardware counters per shader function and copy kind
+    if (counters) {
+      std::cout << ",\"perfCounters\":";
+      counters->writeJson(std::cout);
+    }
+
+    // Resource memory and heap allocations of the frame
+    auto memory = result.memoryStats();
+    std::cout << ",\"memory\":{\"currentBytes\":" << memory.currentBytes
+              << ",\"peakBytes\":" << memory.peakBytes
+              << ",\"reallocations\":" << memory.reallocations
+              << ",\"allocations\":" << frameAllocs.allocations << "}";
+
+    // CPU backend options
+    if (budget) {
+      std::cout << ",\"budget\":{\"tilesRun\":" << budget->tilesRun
+                << ",\"tilesSkipped\":" << budget->tilesSkipped
+                << ",\"deadlineMisses\":" << budget->deadlineMisses << "}";
+    }
+    if (pipeline) {
+      std::cout << ",\"pipeline\":{\"framesSubmitted\":"
+                << pipeline->framesSubmitted
+                << ",\"maxInFlight\":" << pipeline->maxObservedInFlight << "}";
+    }
+
+    // Phase timings; output covers everything written above
+    double outputMs = lap();
+    std::cout << ",\"timings\":{\"initMs\":" << initMs
+              << ",\"parseArgsMs\":" << parseMs
+              << ",\"allocateMs\":" << allocateMs
+              << ",\"loadDataMs\":" << loadDataMs
+              << ",\"funcMainMs\":" << funcMainMs << ",\"waitMs\":" << waitMs
+              << ",\"outputMs\":" << outputMs << ",\"dispatches\":";
+    writeDispatchTimings(*trace, std::cout);
+    if (trace->dropped() > 0)
+      std::cout << ",\"eventsDropped\":" << trace->dropped();
+    std::cout << "}";
+
     std::cout << "}" << std::endl;
 
     return 0;
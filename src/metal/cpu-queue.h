@@ -0,0 +1,118 @@
+#pragma once
+
+// Asynchronous command queue for the CPU backend.
+//
+// Without a queue, CPU commands issued outside a batch run synchronously
+// inside func_main. With a CpuQueue attached, EvalContext enqueues
+// dispatches and copies and returns at once, like committing a Metal command
+// buffer: each command gets a Fence, and host access to a resource waits
+// only for the commands it conflicts with (see HazardTracker).
+//
+// Jobs carry the fences of the earlier jobs they depend on. Worker threads
+// take the oldest job whose dependencies have all signalled, so independent
+// commands run concurrently and dependent ones keep their submission order.
+// Dependencies must be fences of earlier jobs on the same queue.
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hazard-tracker.h"
+
+class CpuQueue {
+public:
+  explicit CpuQueue(unsigned threadCount = 2) {
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+      threads.emplace_back([this] { run(); });
+  }
+
+  ~CpuQueue() {
+    drain();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
+
+  CpuQueue(const CpuQueue &) = delete;
+  CpuQueue &operator=(const CpuQueue &) = delete;
+
+  // Run `work` once every fence in `after` has signalled. Returns at once.
+  void submit(std::vector<FencePtr> after, std::function<void()> work) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push_back({std::move(after), std::move(work)});
+      ++pending;
+      ++submitted;
+      maxPending = std::max(maxPending, pending);
+    }
+    wake.notify_one();
+  }
+
+  // Wait until every submitted job has finished.
+  void drain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+  }
+
+  // Statistics
+  size_t submitted = 0;
+  size_t maxPending = 0; // most jobs queued or running at once
+
+private:
+  struct Job {
+    std::vector<FencePtr> after;
+    std::function<void()> work;
+  };
+
+  static bool ready(const Job &job) {
+    for (const auto &f : job.after)
+      if (!f->isDone())
+        return false;
+    return true;
+  }
+
+  void run() {
+    for (;;) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::list<Job>::iterator it;
+        wake.wait(lock, [&] {
+          if (stopping && jobs.empty())
+            return true;
+          it = std::find_if(jobs.begin(), jobs.end(), ready);
+          return it != jobs.end();
+        });
+        if (jobs.empty())
+          return;
+        job = std::move(*it);
+        jobs.erase(it);
+      }
+      job.work();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        --pending;
+      }
+      // A finished job may make others ready.
+      wake.notify_all();
+      done.notify_all();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::list<Job> jobs;
+  size_t pending = 0; // queued or running
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping = false;
+};
@@ -0,0 +1,2026 @@
+// CPU runtime test driver
+// Exercises the backend-neutral parts of intrinsics.incl.h (CPU kernels,
+// frame graph batching, transient aliasing, hazard tracking, residency,
+// pipelined frames, argument arena, pipeline cache, async CPU queue,
+// dispatch budget, node profiler, command trace, memory accounting, action
+// log, hardware counters, tuning cache, texture blur, buffer scan,
+// compaction, sort, reductions and FFT convolution) without Metal.
+// Usage: cpu-runtime-runner <case>
+// Prints a JSON object with the case results.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "alloc-counter.h"
+#include "intrinsics.incl.h"
+
+NANO_DEFINE_ALLOC_COUNTER()
+
+namespace {
+
+// Resources owned by a test context
+struct TestResources {
+  std::vector<ResourceState> states;
+
+  explicit TestResources(size_t count, size_t floatsEach) : states(count) {
+    for (auto &s : states) {
+      s.width = floatsEach;
+      s.height = 1;
+      s.data.assign(floatsEach, 0.0f);
+    }
+  }
+
+  void attach(EvalContext &ctx) {
+    ctx.resources.clear();
+    for (auto &s : states)
+      ctx.resources.push_back(&s);
+  }
+};
+
+// Kernel writing `dst[i] = src[i] * args[0] + args[1]` over a 1D grid.
+CpuKernel scaleKernel(size_t src, size_t dst) {
+  return [src, dst](EvalContext &ctx, const CpuDispatch &d, const CpuTile &t) {
+    auto &in = ctx.resources[src]->data;
+    auto &out = ctx.resources[dst]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      out[x] = in[x] * d.args[0] + d.args[1];
+  };
+}
+
+std::string floats(const std::vector<float> &v, size_t n) {
+  std::ostringstream ss;
+  ss << "[";
+  for (size_t i = 0; i < n && i < v.size(); ++i)
+    ss << (i ? "," : "") << v[i];
+  ss << "]";
+  return ss.str();
+}
+
+// Two independent passes followed by one that combines them. The schedule
+// should have two levels, be cached across frames, and produce the same
+// results as running the passes one by one.
+int runFrameGraph() {
+  const size_t n = 1024;
+  TestResources res(4, n);
+  for (size_t i = 0; i < n; ++i)
+    res.states[0].data[i] = static_cast<float>(i);
+
+  WorkerPool pool(4);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_a", scaleKernel(0, 1));
+  ctx.registerCpuKernel("fn_b", scaleKernel(0, 2));
+  ctx.registerCpuKernel("fn_sum", [](EvalContext &c, const CpuDispatch &,
+                                     const CpuTile &t) {
+    auto &a = c.resources[1]->data;
+    auto &b = c.resources[2]->data;
+    auto &out = c.resources[3]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      out[x] = a[x] + b[x];
+  });
+  ctx.declareShaderAccess("fn_a", {0}, {1});
+  ctx.declareShaderAccess("fn_b", {0}, {2});
+  ctx.declareShaderAccess("fn_sum", {1, 2}, {3});
+
+  size_t levels = 0;
+  for (int frame = 0; frame < 3; ++frame) {
+    ctx.beginBatch();
+    ctx.dispatchShader("fn_a", static_cast<int>(n), 1, 1, {2.0f, 0.0f});
+    ctx.dispatchShader("fn_b", static_cast<int>(n), 1, 1, {1.0f, 1.0f});
+    ctx.dispatchShader("fn_sum", static_cast<int>(n), 1, 1);
+    ctx.submitBatch();
+    levels = ctx.frameGraph.lastLevelCount;
+  }
+
+  bool correct = true;
+  for (size_t i = 0; i < n; ++i)
+    correct = correct && res.states[3].data[i] == 3.0f * i + 1.0f;
+
+  // A stream of distinct batch structures evicts the least recently used
+  // schedules instead of growing the cache.
+  FrameGraph graph;
+  auto submit = [&](uint64_t key) {
+    graph.add(FrameOp::Dispatch, key, {0}, {1}, [] {});
+    graph.execute(pool);
+  };
+  for (uint64_t key = 0; key < 32; ++key)
+    submit(key);
+  size_t misses = graph.cacheMisses;
+  submit(31); // recent: kept
+  submit(0);  // oldest: evicted
+  bool evicted = graph.cacheHits == 1 && graph.cacheMisses == misses + 1;
+
+  std::cout << "{\"levels\":" << levels
+            << ",\"cacheHits\":" << ctx.frameGraph.cacheHits
+            << ",\"cacheMisses\":" << ctx.frameGraph.cacheMisses
+            << ",\"evicted\":" << (evicted ? "true" : "false")
+            << ",\"correct\":" << (correct ? "true" : "false")
+            << ",\"head\":" << floats(res.states[3].data, 4) << "}"
+            << std::endl;
+  return 0;
+}
+
+// Undeclared shaders are assumed to touch every resource, and copies are
+// ordered after the dispatch that produces their source.
+int runHazards() {
+  const size_t n = 64;
+  TestResources res(3, n);
+  EvalContext ctx;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_fill", [](EvalContext &c, const CpuDispatch &d,
+                                      const CpuTile &t) {
+    for (int x = t.x0; x < t.x1; ++x)
+      c.resources[0]->data[x] = d.args[0];
+  });
+
+  ctx.beginBatch();
+  ctx.dispatchShader("fn_fill", static_cast<int>(n), 1, 1, {7.0f});
+  ctx.copyBuffer(0, 1, 1, 0, 0, -1);
+  ctx.copyBuffer(1, 2, 1, 0, 0, -1);
+  ctx.submitBatch();
+
+  std::cout << "{\"levels\":" << ctx.frameGraph.lastLevelCount
+            << ",\"result\":" << floats(res.states[2].data, 4) << "}"
+            << std::endl;
+  return 0;
+}
+
+// Every cell of a 3D grid is visited exactly once, including grids with too
+// few rows to fill the pool.
+int runTiles() {
+  WorkerPool pool(8);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  std::vector<int> dims = {37, 3, 2, 5, 1, 1, 64, 64, 1};
+  bool correct = true;
+  for (size_t i = 0; i + 2 < dims.size(); i += 3) {
+    int w = dims[i], h = dims[i + 1], d = dims[i + 2];
+    std::vector<std::atomic<int>> visits(static_cast<size_t>(w * h * d));
+    ctx.registerCpuKernel("fn_count", [&](EvalContext &, const CpuDispatch &,
+                                          const CpuTile &t) {
+      for (int z = t.z0; z < t.z1; ++z)
+        for (int y = t.y0; y < t.y1; ++y)
+          for (int x = t.x0; x < t.x1; ++x)
+            visits[(z * h + y) * w + x].fetch_add(1);
+    });
+    ctx.dispatchShader("fn_count", w, h, d);
+    for (auto &v : visits)
+      correct = correct && v.load() == 1;
+  }
+  std::cout << "{\"correct\":" << (correct ? "true" : "false") << "}"
+            << std::endl;
+  return 0;
+}
+
+// A chain of scratch buffers (1 -> 2 -> 3) between an input and an output.
+// Scratch buffers 1 and 3 have disjoint lifetimes and should share a slot
+// once the plan is built after the first frame.
+int runTransient() {
+  const size_t n = 256;
+  TestResources res(5, n);
+  for (size_t i = 0; i < n; ++i)
+    res.states[0].data[i] = static_cast<float>(i);
+
+  MemoryPlanner planner;
+  bool correct = true;
+  bool releasedBetweenFrames = true;
+  for (int frame = 0; frame < 3; ++frame) {
+    // A fresh context per frame, like the plugin; the planner persists.
+    EvalContext ctx;
+    ctx.memoryPlanner = &planner;
+    res.attach(ctx);
+    for (int i = 1; i <= 4; ++i) {
+      std::string name = "fn_" + std::to_string(i);
+      ctx.registerCpuKernel(name, scaleKernel(i - 1, i));
+      ctx.declareShaderAccess(name, {i - 1}, {i});
+    }
+    for (int i = 1; i <= 3; ++i)
+      ctx.declareTransient(i);
+
+    for (int i = 1; i <= 3; ++i)
+      ctx.resizeResource(i, static_cast<int>(n), 1, true);
+    ctx.beginBatch();
+    for (int i = 1; i <= 4; ++i)
+      ctx.dispatchShader(("fn_" + std::to_string(i)).c_str(),
+                         static_cast<int>(n), 1, 1, {2.0f, 0.0f});
+    ctx.submitBatch();
+    ctx.endFrame();
+
+    for (size_t i = 0; i < n; ++i)
+      correct = correct && res.states[4].data[i] == 16.0f * i;
+    for (int i = 1; i <= 3; ++i)
+      releasedBetweenFrames =
+          releasedBetweenFrames && res.states[i].data.capacity() == 0;
+  }
+
+  std::cout << "{\"correct\":" << (correct ? "true" : "false")
+            << ",\"released\":" << (releasedBetweenFrames ? "true" : "false")
+            << ",\"slots\":" << planner.slotCount()
+            << ",\"pooledFloats\":" << planner.pooledFloats()
+            << ",\"unaliasedFloats\":" << planner.unaliasedFloats() << "}"
+            << std::endl;
+  return 0;
+}
+
+// Two independent writers in one batch. A host read of A runs only A's
+// writer; B's stays recorded until the batch is submitted.
+int runPerResource() {
+  const size_t n = 128;
+  TestResources res(3, n);
+  for (size_t i = 0; i < n; ++i)
+    res.states[0].data[i] = static_cast<float>(i);
+
+  EvalContext ctx;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_a", scaleKernel(0, 1));
+  ctx.registerCpuKernel("fn_b", scaleKernel(0, 2));
+  ctx.declareShaderAccess("fn_a", {0}, {1});
+  ctx.declareShaderAccess("fn_b", {0}, {2});
+
+  ctx.beginBatch();
+  ctx.dispatchShader("fn_a", static_cast<int>(n), 1, 1, {2.0f, 0.0f});
+  ctx.dispatchShader("fn_b", static_cast<int>(n), 1, 1, {3.0f, 0.0f});
+  float a = ctx.hostData(1)[5];
+  float bBefore = res.states[2].data[5];
+  size_t pendingAfterRead = ctx.frameGraph.size();
+  float aAgain = ctx.hostData(1)[5];
+  ctx.submitBatch();
+  float bAfter = ctx.hostData(2)[5];
+  std::vector<size_t> stale;
+  ctx.hazards.staleResources(stale);
+
+  std::cout << "{\"a\":" << a << ",\"aAgain\":" << aAgain
+            << ",\"bBefore\":" << bBefore << ",\"bAfter\":" << bAfter
+            << ",\"pendingAfterRead\":" << pendingAfterRead
+            << ",\"waits\":" << ctx.hazards.waits
+            << ",\"stale\":" << stale.size() << "}"
+            << std::endl;
+  return 0;
+}
+
+// Host and device dirty ranges against a simulated device: only changed
+// bytes move, and a size change reallocates.
+int runResidency() {
+  const size_t n = 1024;
+  std::vector<float> host(n);
+  for (size_t i = 0; i < n; ++i)
+    host[i] = static_cast<float>(i);
+
+  SimulatedDevice device;
+  ResidencyTracker tracker;
+  auto sync = [&] {
+    tracker.makeDeviceCurrent(0, device, host.data(), host.size() * 4);
+  };
+
+  sync(); // first use: full upload
+  size_t initial = tracker.frame.uploadedBytes;
+  tracker.endFrame();
+
+  // Host writes two neighbouring elements and one far away.
+  host[10] = -1.0f;
+  host[11] = -2.0f;
+  host[500] = -3.0f;
+  tracker.markHostDirty(0, 40, 44);
+  tracker.markHostDirty(0, 44, 48);
+  tracker.markHostDirty(0, 2000, 2004);
+  sync();
+  size_t partialUpload = tracker.frame.uploadedBytes;
+
+  // Device writes floats [100, 200).
+  float *dev = reinterpret_cast<float *>(device.contents(0));
+  for (size_t i = 100; i < 200; ++i)
+    dev[i] = 7.0f;
+  tracker.markDeviceDirty(0, 400, 800);
+  tracker.makeHostCurrent(0, device, host.data(), host.size() * 4);
+  size_t download = tracker.frame.downloadedBytes;
+  tracker.makeHostCurrent(0, device, host.data(), host.size() * 4);
+  size_t repeatDownload = tracker.frame.downloadedBytes - download;
+  sync();
+  tracker.endFrame();
+
+  bool correct = host[10] == -1.0f && host[500] == -3.0f && host[150] == 7.0f &&
+                 host[99] == 99.0f && dev[11] == -2.0f;
+
+  host.resize(2 * n, 0.0f);
+  tracker.markHostDirty(0);
+  sync();
+  size_t resized = tracker.frame.uploadedBytes;
+  tracker.endFrame();
+
+  std::cout << "{\"initial\":" << initial
+            << ",\"partialUpload\":" << partialUpload
+            << ",\"download\":" << download
+            << ",\"repeatDownload\":" << repeatDownload
+            << ",\"resized\":" << resized
+            << ",\"allocations\":" << tracker.total.allocations
+            << ",\"correct\":" << (correct ? "true" : "false") << "}"
+            << std::endl;
+  return 0;
+}
+
+// Host logic writes a persistent input each frame; kernels accumulate it
+// into a persistent buffer and derive an output. Pipelined, the host starts
+// frame N+1 while frame N's (slow) output kernel still runs.
+int runPipelined(bool pipelined) {
+  const size_t n = 64;
+  const int frames = 6;
+  TestResources res(3, n);
+  std::atomic<int> hostFrame{0};
+  std::atomic<int> overlapped{0};
+
+  FramePipeline pipeline(2);
+  EvalContext ring[2];
+  for (auto &ctx : ring) {
+    res.attach(ctx);
+    if (pipelined)
+      ctx.framePipeline = &pipeline;
+    ctx.registerCpuKernel("fn_acc", [](EvalContext &c, const CpuDispatch &,
+                                       const CpuTile &t) {
+      auto &in = c.resources[0]->data;
+      auto &acc = c.resources[1]->data;
+      for (int x = t.x0; x < t.x1; ++x)
+        acc[x] += in[x];
+    });
+    ctx.registerCpuKernel("fn_out", [&](EvalContext &c, const CpuDispatch &d,
+                                        const CpuTile &t) {
+      if (t.x0 == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (hostFrame.load() > static_cast<int>(d.args[0]))
+          overlapped.fetch_add(1);
+      }
+      auto &acc = c.resources[1]->data;
+      auto &out = c.resources[2]->data;
+      for (int x = t.x0; x < t.x1; ++x)
+        out[x] = acc[x] * 2.0f;
+    });
+    ctx.declareShaderAccess("fn_acc", {0, 1}, {1});
+    ctx.declareShaderAccess("fn_out", {1}, {2});
+    ctx.declarePersistent(0);
+    ctx.declarePersistent(1);
+  }
+
+  for (int f = 0; f < frames; ++f) {
+    EvalContext &ctx = ring[f % 2];
+    ctx.beginFrame();
+    hostFrame.store(f);
+    ctx.beginBatch();
+    for (size_t k = 0; k < n; ++k)
+      ctx.hostElementForWrite(0, k) = static_cast<float>(f + 1);
+    ctx.dispatchShader("fn_acc", static_cast<int>(n), 1, 1);
+    ctx.dispatchShader("fn_out", static_cast<int>(n), 1, 1,
+                       {static_cast<float>(f)});
+    ctx.submitBatch();
+    ctx.endFrame();
+  }
+  hostFrame.store(frames);
+  EvalContext &last = ring[(frames - 1) % 2];
+  last.waitForPendingCommands();
+
+  bool correct = true;
+  for (size_t i = 0; i < n; ++i)
+    correct = correct && last.hostData(1)[i] == 21.0f &&
+              last.hostData(2)[i] == 42.0f;
+
+  std::cout << "{\"correct\":" << (correct ? "true" : "false")
+            << ",\"overlapped\":" << overlapped.load()
+            << ",\"framesSubmitted\":" << pipeline.framesSubmitted
+            << ",\"maxInFlight\":" << pipeline.maxObservedInFlight << "}"
+            << std::endl;
+  return 0;
+}
+
+// Arguments are sub-allocated from aligned arena blocks. A block still read
+// by unfinished work is not reused; once its fence signals it is, so a
+// steady stream of batched dispatches settles on a fixed set of blocks.
+int runArgArena() {
+  HostArenaStorage storage;
+  ArgArena arena(storage, 1024, 256);
+  bool aligned = true;
+
+  FencePtr pending = std::make_shared<Fence>();
+  for (int i = 0; i < 3; ++i) {
+    ArgArena::Allocation a = arena.allocate(100);
+    aligned = aligned && a.offset == static_cast<size_t>(i) * 256;
+    arena.retireAfter(pending);
+  }
+  arena.endFrame();
+  arena.allocate(100);
+  arena.endFrame();
+  size_t createdWhilePending = arena.blocksCreated;
+  pending->signal();
+  arena.allocate(100);
+  arena.endFrame();
+  size_t createdAfterRetire = arena.blocksCreated;
+
+  // Batched dispatches over many frames
+  const size_t n = 256;
+  TestResources res(1, n);
+  WorkerPool pool(4);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_args", [](EvalContext &c, const CpuDispatch &d,
+                                      const CpuTile &t) {
+    auto &out = c.resources[0]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      out[x] += d.args[0] * d.args[1];
+  });
+  ctx.declareShaderAccess("fn_args", {0}, {0});
+  float expected = 0.0f;
+  for (int f = 0; f < 50; ++f) {
+    ctx.beginBatch();
+    for (int k = 0; k < 8; ++k) {
+      ctx.dispatchShader("fn_args", static_cast<int>(n), 1, 1,
+                         {static_cast<float>(f), static_cast<float>(k)});
+      expected += static_cast<float>(f * k);
+    }
+    ctx.submitBatch();
+    ctx.endFrame();
+  }
+  bool correct = true;
+  for (size_t i = 0; i < n; ++i)
+    correct = correct && ctx.hostData(0)[i] == expected;
+
+  std::cout << "{\"aligned\":" << (aligned ? "true" : "false")
+            << ",\"createdWhilePending\":" << createdWhilePending
+            << ",\"createdAfterRetire\":" << createdAfterRetire
+            << ",\"correct\":" << (correct ? "true" : "false")
+            << ",\"contextBlocks\":" << ctx.hostArgs.blocksCreated
+            << ",\"lastFrameBytes\":" << ctx.hostArgs.lastFrameBytes << "}"
+            << std::endl;
+  return 0;
+}
+
+// A mock device compiles render pipelines through PipelineCache. Only the
+// first frame compiles; steady-state frames hit the cache. A different
+// target format or load state is a different pipeline.
+int runPipelineCache() {
+  struct MockPipeline {
+    PipelineKey key;
+  };
+  struct MockDevice {
+    size_t created = 0;
+    std::shared_ptr<MockPipeline> compile(const PipelineKey &key) {
+      ++created;
+      if (key.fragmentFunction == "missing")
+        return nullptr;
+      return std::make_shared<MockPipeline>(MockPipeline{key});
+    }
+  };
+
+  MockDevice device;
+  PipelineCache<std::shared_ptr<MockPipeline>> cache;
+  auto draw = [&](const char *vs, const char *fs, uint64_t format, bool load) {
+    PipelineKey key;
+    key.vertexFunction = vs;
+    key.fragmentFunction = fs;
+    key.targetFormat = format;
+    key.loadExisting = load;
+    return cache.get(key, [&] { return device.compile(key); });
+  };
+
+  bool correct = true;
+  size_t firstFrame = 0;
+  for (int frame = 0; frame < 5; ++frame) {
+    auto a = draw("vs_quad", "fs_color", 70, false);
+    auto b = draw("vs_quad", "fs_color", 70, true);
+    auto c = draw("vs_quad", "fs_color", 80, false);
+    auto d = draw("vs_quad", "fs_blur", 70, false);
+    correct = correct && a && b && c && d && a != b && a != c && a != d &&
+              a->key.fragmentFunction == "fs_color" &&
+              d->key.fragmentFunction == "fs_blur";
+    if (frame == 0)
+      firstFrame = device.created;
+  }
+  size_t steadyState = device.created - firstFrame;
+
+  // Failed compilations are not cached
+  bool failed = !draw("vs_quad", "missing", 70, false) &&
+                !draw("vs_quad", "missing", 70, false);
+  bool failedRetried = failed && device.created == firstFrame + 2;
+
+  std::cout << "{\"firstFrame\":" << firstFrame
+            << ",\"steadyState\":" << steadyState
+            << ",\"hits\":" << cache.hits << ",\"misses\":" << cache.misses
+            << ",\"cached\":" << cache.size()
+            << ",\"failedRetried\":" << (failedRetried ? "true" : "false")
+            << ",\"correct\":" << (correct ? "true" : "false") << "}"
+            << std::endl;
+  return 0;
+}
+
+// With an async queue, dispatches and copies return at once. A slow
+// dispatch and an independent one run concurrently; a dependent dispatch
+// and copy wait for it, and host reads wait only for what they need.
+int runAsyncQueue() {
+  const size_t n = 256;
+  TestResources res(5, n);
+  for (size_t i = 0; i < n; ++i)
+    res.states[0].data[i] = static_cast<float>(i);
+
+  WorkerPool pool(4);
+  CpuQueue queue(2);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  ctx.cpuQueue = &queue;
+  res.attach(ctx);
+
+  ctx.registerCpuKernel("fn_slow", [](EvalContext &c, const CpuDispatch &,
+                                      const CpuTile &t) {
+    if (t.x0 == 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    auto &in = c.resources[0]->data;
+    auto &out = c.resources[1]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      out[x] = in[x] + 1.0f;
+  });
+  ctx.registerCpuKernel("fn_fast", [](EvalContext &c, const CpuDispatch &,
+                                      const CpuTile &t) {
+    auto &out = c.resources[3]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      out[x] = 5.0f;
+  });
+  ctx.registerCpuKernel("fn_double", scaleKernel(1, 2));
+  ctx.declareShaderAccess("fn_slow", {0}, {1});
+  ctx.declareShaderAccess("fn_fast", {}, {3});
+  ctx.declareShaderAccess("fn_double", {1}, {2});
+
+  auto start = std::chrono::steady_clock::now();
+  ctx.dispatchShader("fn_slow", static_cast<int>(n), 1, 1);
+  ctx.dispatchShader("fn_fast", static_cast<int>(n), 1, 1);
+  ctx.dispatchShader("fn_double", static_cast<int>(n), 1, 1, {2.0f, 0.0f});
+  ctx.copyBuffer(2, 4, 1, 0, 0, -1);
+  auto issued = std::chrono::steady_clock::now() - start;
+  bool returnedEarly = issued < std::chrono::milliseconds(20);
+
+  // The independent dispatch finishes while the slow one still runs.
+  float fast = ctx.hostData(3)[7];
+  bool slowPendingAfterFast = !ctx.hazards.lastWriter(1)->isDone();
+
+  bool correct = fast == 5.0f;
+  for (size_t i = 0; i < n; ++i)
+    correct = correct &&
+              ctx.hostData(4)[i] == (static_cast<float>(i) + 1.0f) * 2.0f;
+
+  // Host write to a resource a queued dispatch reads waits for it.
+  ctx.dispatchShader("fn_slow", static_cast<int>(n), 1, 1);
+  ctx.hostElementForWrite(0, 0) = 100.0f;
+  correct = correct && ctx.hostData(1)[0] == 1.0f;
+  ctx.waitForPendingCommands();
+
+  std::cout << "{\"returnedEarly\":" << (returnedEarly ? "true" : "false")
+            << ",\"overlapped\":" << (slowPendingAfterFast ? "true" : "false")
+            << ",\"correct\":" << (correct ? "true" : "false")
+            << ",\"submitted\":" << queue.submitted << "}" << std::endl;
+  return 0;
+}
+
+// A dispatch of slow rows under a frame budget. With KeepPrevious it stops
+// between tile batches once the deadline passes, and rows it did not reach
+// keep the previous frame's values; RunToCompletion only reports the miss.
+// Cancelling from another thread stops the dispatch the same way.
+int runBudget() {
+  const int w = 16;
+  const int h = 64;
+  TestResources res(1, w * h);
+  WorkerPool pool(4);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_rows", [](EvalContext &c, const CpuDispatch &d,
+                                      const CpuTile &t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto &out = c.resources[0]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      out[t.y0 * d.dimX + x] = d.args[0];
+  });
+
+  // Frame values increase, so every row must hold a single value no newer
+  // than this frame's (skipped rows keep whatever they had before).
+  auto rowsWith = [&](float value, bool &consistent) {
+    int count = 0;
+    for (int y = 0; y < h; ++y) {
+      float first = res.states[0].data[y * w];
+      for (int x = 0; x < w; ++x)
+        consistent = consistent && res.states[0].data[y * w + x] == first &&
+                     first >= 1.0f && first <= value;
+      count += first == value;
+    }
+    return count;
+  };
+  using ms = std::chrono::milliseconds;
+  auto elapsedMs = [](std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<ms>(std::chrono::steady_clock::now() -
+                                          start)
+        .count();
+  };
+
+  DispatchBudget budget(std::chrono::microseconds(6000));
+  ctx.dispatchBudget = &budget;
+  bool consistent = true;
+
+  // Frame 1: unlimited, fills every row with 1
+  budget.budget = std::chrono::microseconds(0);
+  ctx.beginHostFrame();
+  ctx.dispatchShader("fn_rows", w, h, 1, {1.0f});
+  int fullRows = rowsWith(1.0f, consistent);
+
+  // Frame 2: 6 ms budget, keep previous
+  budget.budget = std::chrono::microseconds(6000);
+  ctx.beginHostFrame();
+  auto start = std::chrono::steady_clock::now();
+  ctx.dispatchShader("fn_rows", w, h, 1, {2.0f});
+  long long limitedMs = elapsedMs(start);
+  int limitedRows = rowsWith(2.0f, consistent);
+  bool limitedComplete = budget.frameComplete();
+
+  // Frame 3: cancelled from another thread
+  budget.budget = std::chrono::microseconds(0);
+  ctx.beginHostFrame();
+  std::thread canceller([&] {
+    std::this_thread::sleep_for(ms(4));
+    budget.cancel();
+  });
+  ctx.dispatchShader("fn_rows", w, h, 1, {3.0f});
+  canceller.join();
+  int cancelledRows = rowsWith(3.0f, consistent);
+  bool cancelledFlag = budget.isCancelled();
+
+  // Frame 4: same budget, run to completion
+  size_t missesBefore = budget.deadlineMisses.load();
+  budget.budget = std::chrono::microseconds(6000);
+  budget.policy = DispatchBudget::Policy::RunToCompletion;
+  ctx.beginHostFrame();
+  ctx.dispatchShader("fn_rows", w, h, 1, {4.0f});
+  int completedRows = rowsWith(4.0f, consistent);
+  size_t missed = budget.deadlineMisses.load() - missesBefore;
+
+  // Frame 5: keep previous, but the output is an aliased transient, which
+  // does not hold the previous frame, so every tile still runs.
+  MemoryPlanner planner;
+  ctx.memoryPlanner = &planner;
+  ctx.declareTransient(0);
+  size_t skippedBefore = budget.tilesSkipped.load();
+  missesBefore = budget.deadlineMisses.load();
+  budget.policy = DispatchBudget::Policy::KeepPrevious;
+  ctx.beginHostFrame();
+  ctx.dispatchShader("fn_rows", w, h, 1, {5.0f});
+  size_t transientSkipped = budget.tilesSkipped.load() - skippedBefore;
+  size_t transientMissed = budget.deadlineMisses.load() - missesBefore;
+  ctx.memoryPlanner = nullptr;
+
+  std::cout << "{\"fullRows\":" << fullRows
+            << ",\"limitedRows\":" << limitedRows
+            << ",\"limitedMs\":" << limitedMs
+            << ",\"limitedComplete\":" << (limitedComplete ? "true" : "false")
+            << ",\"cancelledRows\":" << cancelledRows
+            << ",\"cancelled\":" << (cancelledFlag ? "true" : "false")
+            << ",\"completedRows\":" << completedRows
+            << ",\"missed\":" << missed
+            << ",\"transientSkipped\":" << transientSkipped
+            << ",\"transientMissed\":" << transientMissed
+            << ",\"consistent\":" << (consistent ? "true" : "false") << "}"
+            << std::endl;
+  return 0;
+}
+
+// Instrumented host code shaped like CppGenerator's profiling output: a loop
+// calling a helper whose last call returns early from inside a branch. The
+// function guard closes the open sites, self times nest inside totals, and
+// the folded stacks follow the call path.
+void spinFor(std::chrono::microseconds d) {
+  auto end = std::chrono::steady_clock::now() + d;
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+void profiledHelper(EvalContext &ctx, int i) {
+  NodeProfiler::Scope _profile_scope(ctx.profiler, 3);
+  ctx.profiler.enter(4);
+  spinFor(std::chrono::microseconds(300));
+  ctx.profiler.exit();
+  ctx.profiler.enter(5);
+  if (i == 2) {
+    return;
+  } else {
+  }
+  ctx.profiler.exit();
+}
+
+void profiledMain(EvalContext &ctx) {
+  NodeProfiler::Scope _profile_scope(ctx.profiler, 0);
+  ctx.profiler.enter(1);
+  for (int i = 0; i < 3; i++) {
+    ctx.profiler.enter(2);
+    profiledHelper(ctx, i);
+    ctx.profiler.exit();
+  }
+  ctx.profiler.exit();
+}
+
+int runNodeProfiler() {
+  static const ProfileSite sites[] = {
+      {"main", "", "func"},
+      {"main", "loop", "flow_loop"},
+      {"main", "call", "call_func"},
+      {"helper", "", "func"},
+      {"helper", "work", "var_set"},
+      {"helper", "check", "flow_branch"},
+  };
+  EvalContext ctx;
+  bool disabledIdle = !ctx.profiler.enabled();
+  profiledMain(ctx); // before declareSites: records nothing
+  ctx.profiler.declareSites(sites, 6);
+  profiledMain(ctx);
+
+  const NodeProfiler &p = ctx.profiler;
+  bool balanced = p.depth() == 0;
+  bool counts = p.siteStats(0).count == 1 && p.siteStats(1).count == 1 &&
+                p.siteStats(2).count == 3 && p.siteStats(3).count == 3 &&
+                p.siteStats(4).count == 3 && p.siteStats(5).count == 3;
+  bool nested = true;
+  for (size_t i = 0; i < 6; ++i)
+    nested = nested && p.siteStats(i).selfTicks <= p.siteStats(i).totalTicks;
+  // The loop's time is almost all in the calls below it
+  nested = nested && p.siteStats(1).totalTicks >= p.siteStats(4).totalTicks &&
+           p.siteStats(1).selfTicks < p.siteStats(1).totalTicks / 2;
+
+  std::ostringstream folded;
+  p.writeFolded(folded);
+  std::string f = folded.str();
+  bool foldedPath =
+      f.find("main;loop (flow_loop);call (call_func);helper;work (var_set) ") !=
+      std::string::npos;
+  std::ostringstream report;
+  p.writeReport(report);
+  bool reportHasNode =
+      report.str().find("\"node\":\"work\",\"op\":\"var_set\",\"count\":3") !=
+      std::string::npos;
+
+  std::cout << "{\"disabledIdle\":" << (disabledIdle ? "true" : "false")
+            << ",\"balanced\":" << (balanced ? "true" : "false")
+            << ",\"counts\":" << (counts ? "true" : "false")
+            << ",\"nested\":" << (nested ? "true" : "false")
+            << ",\"foldedPath\":" << (foldedPath ? "true" : "false")
+            << ",\"reportHasNode\":" << (reportHasNode ? "true" : "false")
+            << "}" << std::endl;
+  return 0;
+}
+
+// Commands on the async queue with a trace recorder attached: host calls and
+// the CPU work they issue are recorded on their own threads with resource
+// ids and byte counts. A full ring keeps the newest events.
+int runTrace() {
+  const size_t n = 1024;
+  TestResources res(3, n);
+  for (size_t i = 0; i < n; ++i)
+    res.states[0].data[i] = static_cast<float>(i);
+  WorkerPool pool(2);
+  CpuQueue queue(2);
+  TraceRecorder recorder(256);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  ctx.cpuQueue = &queue;
+  ctx.trace = &recorder;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_scale", scaleKernel(0, 1));
+  ctx.declareShaderAccess("fn_scale", {0}, {1});
+
+  ctx.dispatchShader("fn_scale", static_cast<int>(n), 1, 1, {2.0f, 1.0f});
+  ctx.copyBuffer(1, 2, 1, 0, 0, -1);
+  ctx.resizeResource(0, 512, 1, false);
+  float v = ctx.hostData(2)[3];
+  ctx.waitForPendingCommands();
+
+  uint32_t host = TraceRecorder::threadId();
+  auto events = recorder.snapshot();
+  auto find = [&](const char *name, const char *category) -> const TraceEvent * {
+    for (const auto &e : events)
+      if (std::strcmp(e.name, name) == 0 && std::strcmp(e.category, category) == 0)
+        return &e;
+    return nullptr;
+  };
+  const TraceEvent *dispatchHost = find("dispatch", "host");
+  const TraceEvent *dispatchExec = find("dispatch", "exec");
+  const TraceEvent *copyExec = find("copyBuffer", "exec");
+  const TraceEvent *resize = find("resize", "host");
+  const TraceEvent *sync = find("sync", "host");
+  const TraceEvent *wait = find("wait", "host");
+  bool recorded = dispatchHost && dispatchExec && copyExec && resize && sync &&
+                  wait && find("copyBuffer", "host");
+  bool details =
+      recorded && std::strcmp(dispatchHost->target, "fn_scale") == 0 &&
+      std::strcmp(dispatchExec->target, "fn_scale") == 0 &&
+      dispatchHost->bytes == 2 * sizeof(float) &&
+      copyExec->resource == 2 && copyExec->bytes == n * sizeof(float) &&
+      resize->resource == 0 && resize->bytes == 512 * sizeof(float) &&
+      sync->resource == 2 && dispatchHost->endNs >= dispatchHost->beginNs;
+  bool threads = recorded && dispatchHost->thread == host &&
+                 dispatchExec->thread != host && copyExec->thread != host;
+
+  std::ostringstream json;
+  recorder.writeJson(json);
+  bool chromeJson = json.str().rfind("{\"traceEvents\":[{", 0) == 0 &&
+                    json.str().find("\"ph\":\"X\"") != std::string::npos;
+
+  // Ring overflow
+  TraceRecorder small(8);
+  for (int i = 0; i < 20; ++i)
+    small.record("wait", "host", "", static_cast<uint64_t>(i),
+                 static_cast<uint64_t>(i + 1), i, 0);
+  auto kept = small.snapshot();
+  bool ring = kept.size() == 8 && small.dropped() == 12 &&
+              kept.front().resource == 12 && kept.back().resource == 19;
+
+  // Cost of one recorded span
+  const int spans = 20000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < spans; ++i) {
+    TraceRecorder::Span span(&recorder, "dispatch", "host", "fn_scale", i, 8);
+  }
+  long long nsPerSpan =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count() /
+      spans;
+
+  std::cout << "{\"recorded\":" << (recorded ? "true" : "false")
+            << ",\"details\":" << (details ? "true" : "false")
+            << ",\"threads\":" << (threads ? "true" : "false")
+            << ",\"chromeJson\":" << (chromeJson ? "true" : "false")
+            << ",\"ring\":" << (ring ? "true" : "false")
+            << ",\"correct\":" << (v == 7.0f ? "true" : "false")
+            << ",\"nsPerSpan\":" << nsPerSpan << "}" << std::endl;
+  return 0;
+}
+
+// Resource byte accounting through resizes and storeVec growth, and heap
+// allocations of steady-state frames (same sizes every frame).
+int runMemory() {
+  const size_t n = 1024;
+  TestResources res(3, 16);
+  WorkerPool pool(2);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_scale", scaleKernel(0, 1));
+
+  auto before = ctx.memoryStats();
+  ctx.resizeResource(0, n, 1, false);
+  ctx.resizeResource(1, n, 1, true);
+  size_t grownReallocs = res.states[0].reallocations;
+  ctx.resizeResource(0, 16, 1, false); // shrinking keeps the storage
+  size_t shrunkReallocs = res.states[0].reallocations;
+  ctx.resizeResource(0, 4 * n, 1, false);
+  auto grown = ctx.memoryStats();
+  ctx.resources[0]->data.shrink_to_fit();
+  ctx.resources[0]->data.clear();
+  ctx.resources[0]->data.shrink_to_fit();
+  auto released = ctx.memoryStats();
+
+  for (size_t i = 0; i < 100; ++i)
+    ctx.hostStoreVec(2, i, std::array<float, 4>{1.0f, 2.0f, 3.0f, 4.0f});
+  bool storeVecCounted = res.states[2].reallocations > 0 &&
+                         res.states[2].peakBytes >= 400 * sizeof(float);
+
+  // Steady state: the first frame sizes everything, later frames reuse it.
+  uint64_t steadyAllocations = 0;
+  for (int frame = 0; frame < 8; ++frame) {
+    auto start = AllocCounter::now();
+    ctx.beginHostFrame();
+    ctx.resizeResource(0, n, 1, false);
+    {
+      // As generated code marshals args.
+      std::vector<float> &args = ctx.shaderArgs();
+      args.push_back(2.0f);
+      args.push_back(1.0f);
+      ctx.dispatchShader("fn_scale", static_cast<int>(n), 1, 1, args);
+    }
+    ctx.copyBuffer(1, 2, 1, 0, 0, -1);
+    ctx.waitForPendingCommands();
+    if (frame > 0)
+      steadyAllocations += AllocCounter::since(start).allocations;
+  }
+
+  // Batched frames also reuse the frame graph's schedule, recorded commands
+  // and fences.
+  ctx.declareShaderAccess("fn_scale", {0}, {1});
+  uint64_t batchedAllocations = 0;
+  for (int frame = 0; frame < 8; ++frame) {
+    auto start = AllocCounter::now();
+    ctx.beginHostFrame();
+    ctx.beginBatch();
+    {
+      std::vector<float> &args = ctx.shaderArgs();
+      args.push_back(2.0f);
+      args.push_back(1.0f);
+      ctx.dispatchShader("fn_scale", static_cast<int>(n), 1, 1, args);
+    }
+    ctx.copyBuffer(1, 2, 1, 0, 0, -1);
+    ctx.scanBuffer(2, 2, 1, false, -1, -1, false);
+    ctx.submitBatch();
+    ctx.waitForPendingCommands();
+    if (frame > 1)
+      batchedAllocations += AllocCounter::since(start).allocations;
+  }
+
+  auto probe = AllocCounter::now();
+  std::vector<int> *v = new std::vector<int>(10);
+  auto counted = AllocCounter::since(probe);
+  delete v;
+
+  std::cout << "{\"initialBytes\":" << before.currentBytes
+            << ",\"grownReallocs\":" << grownReallocs
+            << ",\"shrunkReallocs\":" << shrunkReallocs
+            << ",\"grownBytes\":" << grown.currentBytes
+            << ",\"grownPeak\":" << grown.peakBytes
+            << ",\"releasedBytes\":" << released.currentBytes
+            << ",\"releasedPeak\":" << released.peakBytes
+            << ",\"storeVecCounted\":" << (storeVecCounted ? "true" : "false")
+            << ",\"counterInstalled\":"
+            << (AllocCounter::installed() ? "true" : "false")
+            << ",\"probeAllocations\":" << counted.allocations
+            << ",\"steadyAllocations\":" << steadyAllocations
+            << ",\"batchedAllocations\":" << batchedAllocations << "}"
+            << std::endl;
+  return 0;
+}
+
+// Resize records in the action log: ring overflow, the drain callback and
+// the flush at beginHostFrame(), without heap allocations.
+int runActionLog() {
+  TestResources res(2, 16);
+  EvalContext ctx;
+  res.attach(ctx);
+
+  ctx.resizeResource(0, 32, 1, false);
+  ctx.resizeResource2D(1, 4, 3, true);
+  const ActionRecord &first = ctx.actionLog[0];
+  const ActionRecord &second = ctx.actionLog[1];
+  bool recorded = ctx.actionLog.size() == 2 && first.op == ActionOp::Resize &&
+                  first.resource == 0 && first.width == 32 &&
+                  first.height == 1 && second.resource == 1 &&
+                  second.width == 4 && second.height == 3 &&
+                  second.timeNs >= first.timeNs;
+  ctx.beginHostFrame();
+  bool flushed = ctx.actionLog.empty();
+
+  // Without a drain the oldest records are overwritten.
+  size_t capacity = ctx.actionLog.capacity();
+  auto start = AllocCounter::now();
+  for (size_t i = 0; i < capacity + 10; ++i)
+    ctx.resizeResource(0, static_cast<int>(i % 16 + 1), 1, false);
+  uint64_t allocations = AllocCounter::since(start).allocations;
+  bool overwrote = ctx.actionLog.size() == capacity &&
+                   ctx.actionLog.dropped() == 10 &&
+                   ctx.actionLog[0].width == static_cast<int>(10 % 16 + 1);
+  ctx.actionLog.clear();
+
+  // With a drain every record is delivered once, in order.
+  std::vector<int> drained;
+  drained.reserve(4 * capacity);
+  ctx.actionLog.setDrain([&](const ActionRecord *records, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+      drained.push_back(records[i].width);
+  });
+  size_t pushed = 2 * capacity + 5;
+  for (size_t i = 0; i < pushed; ++i)
+    ctx.resizeResource(1, static_cast<int>(i + 1), 1, false);
+  size_t beforeFlush = drained.size();
+  ctx.beginHostFrame();
+  bool inOrder = drained.size() == pushed;
+  for (size_t i = 0; inOrder && i < pushed; ++i)
+    inOrder = drained[i] == static_cast<int>(i + 1);
+
+  std::cout << "{\"recorded\":" << (recorded ? "true" : "false")
+            << ",\"flushed\":" << (flushed ? "true" : "false")
+            << ",\"overwrote\":" << (overwrote ? "true" : "false")
+            << ",\"allocations\":" << allocations
+            << ",\"drainedBeforeFlush\":" << beforeFlush
+            << ",\"capacity\":" << capacity
+            << ",\"drained\":" << drained.size()
+            << ",\"inOrder\":" << (inOrder ? "true" : "false")
+            << ",\"dropped\":" << ctx.actionLog.dropped() << "}" << std::endl;
+  return 0;
+}
+
+// Hardware counters per shader function and copy, and in their trace
+// events. Where perf_event_open is not permitted the counters report why and
+// commands run unsampled.
+int runPerfCounters() {
+  const size_t n = 4096;
+  TestResources res(3, n);
+  for (size_t i = 0; i < n; ++i)
+    res.states[0].data[i] = static_cast<float>(i);
+  WorkerPool pool(2);
+  PerfCounters counters;
+  TraceRecorder recorder;
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  ctx.perf = &counters;
+  ctx.trace = &recorder;
+  res.attach(ctx);
+  ctx.registerCpuKernel("fn_scale", scaleKernel(0, 1));
+
+  for (int i = 0; i < 2; ++i)
+    ctx.dispatchShader("fn_scale", static_cast<int>(n), 1, 1, {2.0f, 1.0f});
+  ctx.copyBuffer(1, 2, 1, 0, 0, -1);
+  ctx.waitForPendingCommands();
+  bool correct = res.states[2].data[5] == 11.0f;
+
+  auto totals = counters.snapshot();
+  auto find = [&](const char *name) -> const PerfCounters::Totals * {
+    for (const auto &t : totals)
+      if (t.name == name)
+        return &t;
+    return nullptr;
+  };
+  const PerfCounters::Totals *scale = find("fn_scale");
+  const PerfCounters::Totals *copy = find("copyBuffer");
+  bool recorded = counters.available()
+                      ? scale && scale->calls == 2 && scale->counters.cycles > 0 &&
+                            scale->counters.instructions > 0 && copy &&
+                            copy->calls == 1 && copy->counters.instructions > 0
+                      : totals.empty();
+  bool traced = true;
+  if (counters.available()) {
+    traced = false;
+    for (const TraceEvent &e : recorder.snapshot())
+      if (std::strcmp(e.name, "dispatch") == 0 &&
+          std::strcmp(e.category, "exec") == 0)
+        traced = e.counters.cycles > 0;
+  }
+
+  std::ostringstream json;
+  counters.writeJson(json);
+  bool report = json.str().find(counters.available()
+                                    ? "{\"available\":true,\"functions\":[{"
+                                    : "{\"available\":false,\"reason\":\"") == 0;
+
+  std::cout << "{\"available\":" << (counters.available() ? "true" : "false")
+            << ",\"explained\":"
+            << (counters.available() != !counters.reason().empty() ? "true"
+                                                                   : "false")
+            << ",\"recorded\":" << (recorded ? "true" : "false")
+            << ",\"traced\":" << (traced ? "true" : "false")
+            << ",\"report\":" << (report ? "true" : "false")
+            << ",\"correct\":" << (correct ? "true" : "false") << "}"
+            << std::endl;
+  return 0;
+}
+
+// Autotune cache: the last entry for this graph and machine is applied,
+// others (different graph, machine, comments, malformed lines) are not.
+int runTuningCache() {
+  std::string machine = tuningMachineKey();
+  char path[] = "/tmp/nano-tuning-cache-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    std::cerr << "{\"error\": \"mkstemp failed\"}" << std::endl;
+    return 1;
+  }
+  close(fd);
+  {
+    std::ofstream out(path);
+    out << "# graph\tmachine\tframeMs\tvalues\n"
+        << "g1\t" << machine << "\t2.5\tt_samples=8 t_tile=16\n"
+        << "g2\t" << machine << "\t1.0\tt_samples=99\n"
+        << "g1\tother-machine\t1.0\tt_samples=77\n"
+        << "malformed line\n"
+        << "g1\t" << machine << "\t2.0\tt_samples=12 t_gain_0=0.5\n";
+  }
+
+  TuningCache cache;
+  bool loaded = cache.load(path);
+  const TuningEntry *entry = cache.find("g1", machine);
+
+  EvalContext ctx;
+  ctx.inputs["t_samples"] = 4.0f;
+  ctx.inputs["t_tile"] = 32.0f;
+  int applied = applyTuningCache(ctx.inputs, path, "g1");
+  int unknownGraph = applyTuningCache(ctx.inputs, path, "g3");
+  int noPath = applyTuningCache(ctx.inputs, "", "g1");
+  std::remove(path);
+  int missingFile = applyTuningCache(ctx.inputs, path, "g1");
+
+  bool keySafe = !machine.empty() &&
+                 machine.find_first_of(" \t\n") == std::string::npos;
+  std::cout << "{\"loaded\":" << (loaded ? "true" : "false")
+            << ",\"entries\":" << cache.size()
+            << ",\"frameMs\":" << (entry ? entry->frameMs : -1.0)
+            << ",\"applied\":" << applied
+            << ",\"samples\":" << ctx.inputs["t_samples"]
+            << ",\"tile\":" << ctx.inputs["t_tile"]
+            << ",\"gain0\":" << ctx.inputs["t_gain_0"]
+            << ",\"unknownGraph\":" << unknownGraph
+            << ",\"noPath\":" << noPath
+            << ",\"missingFile\":" << missingFile
+            << ",\"keySafe\":" << (keySafe ? "true" : "false") << "}"
+            << std::endl;
+  return 0;
+}
+
+// Direct 2D convolution with the exact (untruncated to r) kernel, per tap.
+std::vector<float> referenceBlur(const std::vector<float> &src, int w, int h,
+                                 const std::vector<double> &kernel,
+                                 int wrapMode) {
+  int r = static_cast<int>(kernel.size() / 2);
+  std::vector<float> out(src.size());
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      for (int c = 0; c < 4; ++c) {
+        double sum = 0.0;
+        for (int ky = -r; ky <= r; ++ky)
+          for (int kx = -r; kx <= r; ++kx) {
+            int sx = texture_blur::wrapIndex(x + kx, w, wrapMode);
+            int sy = texture_blur::wrapIndex(y + ky, h, wrapMode);
+            sum += kernel[kx + r] * kernel[ky + r] * src[(sy * w + sx) * 4 + c];
+          }
+        out[(y * w + x) * 4 + c] = static_cast<float>(sum);
+      }
+  return out;
+}
+
+std::vector<double> gaussianKernel(int r, double sigma) {
+  std::vector<double> k(2 * r + 1);
+  double sum = 0.0;
+  for (int i = -r; i <= r; ++i)
+    sum += k[i + r] = std::exp(-0.5 * i * i / (sigma * sigma));
+  for (double &v : k)
+    v /= sum;
+  return k;
+}
+
+float maxDiff(const std::vector<float> &a, const std::vector<float> &b) {
+  float m = 0.0f;
+  for (size_t i = 0; i < a.size() && i < b.size(); ++i)
+    m = std::max(m, std::fabs(a[i] - b[i]));
+  return m;
+}
+
+// blurTexture against a per-tap reference for each wrap mode: exact
+// Gaussian, running-sum box, and the three-box approximation of a wide
+// Gaussian. Also in-place blurs, batching, steady-state allocations and the
+// time for a 1080p frame.
+int runBlur() {
+  const int w = 37, h = 23;
+  WorkerPool pool(4);
+  std::vector<float> image(static_cast<size_t>(w) * h * 4);
+  uint32_t seed = 12345;
+  for (float &v : image) {
+    seed = seed * 1664525u + 1013904223u;
+    v = static_cast<float>(seed >> 8) / 16777216.0f;
+  }
+  // The box approximation is judged on smooth content, where it is used.
+  std::vector<float> smooth(image.size());
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      for (int c = 0; c < 4; ++c)
+        smooth[(y * w + x) * 4 + c] =
+            0.5f + 0.5f * std::sin(0.3f * x + c) * std::cos(0.4f * y);
+
+  float gaussianErr = 0.0f, boxErr = 0.0f, wideErr = 0.0f, inPlaceErr = 0.0f;
+  for (int wrap = 0; wrap < 3; ++wrap) {
+    std::vector<ResourceState> states(2);
+    for (auto &st : states) {
+      st.width = w;
+      st.height = h;
+    }
+    EvalContext ctx;
+    ctx.workerPool = &pool;
+    for (auto &st : states)
+      ctx.resources.push_back(&st);
+    ctx.texWrapModes = {wrap, wrap};
+    auto blur = [&](float radius, float sigma, int mode,
+                    const std::vector<float> &input) {
+      states[0].data = input;
+      states[1].data.assign(image.size(), 0.0f);
+      ctx.blurTexture(0, 1, radius, sigma, mode);
+      return states[1].data;
+    };
+
+    gaussianErr = std::max(
+        gaussianErr, maxDiff(blur(3.0f, 1.5f, 0, image),
+                             referenceBlur(image, w, h,
+                                           gaussianKernel(3, 1.5), wrap)));
+    boxErr = std::max(boxErr, maxDiff(blur(5.0f, 0.0f, 1, image),
+                                      referenceBlur(image, w, h,
+                                                    std::vector<double>(
+                                                        11, 1.0 / 11),
+                                                    wrap)));
+    // Radius 15 (sigma 5) is past the direct kernel: compare with a
+    // Gaussian wide enough to be untruncated.
+    wideErr = std::max(
+        wideErr, maxDiff(blur(15.0f, 0.0f, 0, smooth),
+                         referenceBlur(smooth, w, h, gaussianKernel(25, 5.0),
+                                       wrap)));
+
+    std::vector<float> separate = blur(4.0f, 0.0f, 0, image);
+    states[0].data = image;
+    ctx.beginBatch();
+    ctx.blurTexture(0, 0, 4.0f, 0.0f, 0);
+    ctx.submitBatch();
+    inPlaceErr = std::max(inPlaceErr, maxDiff(states[0].data, separate));
+  }
+
+  // Mismatched sizes are rejected and leave the destination alone.
+  std::vector<ResourceState> mismatched(2);
+  mismatched[0].width = 4;
+  mismatched[0].height = 4;
+  mismatched[0].data.assign(64, 1.0f);
+  mismatched[1].width = 2;
+  mismatched[1].height = 2;
+  mismatched[1].data.assign(16, 0.0f);
+  EvalContext rejectCtx;
+  for (auto &st : mismatched)
+    rejectCtx.resources.push_back(&st);
+  std::streambuf *cerrBuf = std::cerr.rdbuf(nullptr);
+  rejectCtx.blurTexture(0, 1, 2.0f, 0.0f, 0);
+  std::cerr.rdbuf(cerrBuf);
+  bool rejected = mismatched[1].data[0] == 0.0f;
+
+  // 1080p, on a pool of one thread per core.
+  const int bw = 1920, bh = 1080;
+  std::vector<ResourceState> big(2);
+  for (auto &st : big) {
+    st.width = bw;
+    st.height = bh;
+    st.data.assign(static_cast<size_t>(bw) * bh * 4, 0.5f);
+  }
+  WorkerPool fullPool;
+  EvalContext bigCtx;
+  bigCtx.workerPool = &fullPool;
+  for (auto &st : big)
+    bigCtx.resources.push_back(&st);
+  bigCtx.texWrapModes = {1, 1};
+  auto time1080p = [&](float radius, int mode) {
+    bigCtx.blurTexture(0, 1, radius, 0.0f, mode); // warm scratch
+    std::vector<double> ms;
+    for (int i = 0; i < 5; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      bigCtx.blurTexture(0, 1, radius, 0.0f, mode);
+      ms.push_back(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+  };
+  double gaussianMs = time1080p(8.0f, 0);
+  double wideMs = time1080p(32.0f, 0);
+  double boxMs = time1080p(32.0f, 1);
+
+  auto allocStart = AllocCounter::now();
+  for (int i = 0; i < 4; ++i)
+    bigCtx.blurTexture(0, 1, 32.0f, 0.0f, 0);
+  uint64_t steadyAllocations = AllocCounter::since(allocStart).allocations;
+
+  std::cout << "{\"gaussianErr\":" << gaussianErr
+            << ",\"boxErr\":" << boxErr << ",\"wideErr\":" << wideErr
+            << ",\"inPlaceErr\":" << inPlaceErr
+            << ",\"rejected\":" << (rejected ? "true" : "false")
+            << ",\"threads\":" << fullPool.threadCount()
+            << ",\"gaussianMs\":" << gaussianMs << ",\"wideMs\":" << wideMs
+            << ",\"boxMs\":" << boxMs
+            << ",\"steadyAllocations\":" << steadyAllocations << "}"
+            << std::endl;
+  return 0;
+}
+
+// scanBuffer and compactBuffer against serial references, on buffers large
+// enough to split into blocks: scalar and float4 scans (exclusive,
+// inclusive, in place in a batch, with the total stored as an atomic
+// counter), compaction by a flags buffer and in place by each element's
+// first component, a destination too small for what is kept, and the time
+// for a few million elements.
+int runScan() {
+  const int n = 200003; // not a multiple of the chunk or block size
+  WorkerPool pool(4);
+  uint32_t seed = 777;
+  auto next = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+  };
+
+  // Small integers sum exactly, so every block split gives the serial result.
+  std::vector<ResourceState> states(6);
+  states[0].data.resize(n);
+  for (float &v : states[0].data)
+    v = static_cast<float>(next() % 4);
+  states[1].data.assign(n, 0.0f);
+  states[2].data.assign(1, 0.0f);
+  states[3].data.resize(static_cast<size_t>(n) * 4);
+  for (float &v : states[3].data)
+    v = static_cast<float>(next() % 3);
+  states[4].data.assign(static_cast<size_t>(n) * 4, 0.0f);
+  states[5].data.assign(4, 0.0f);
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  for (auto &st : states)
+    ctx.resources.push_back(&st);
+
+  auto scanErr = [&](size_t src, size_t dst, int stride, bool inclusive) {
+    const auto &in = states[src].data;
+    const auto &out = states[dst].data;
+    double err = 0.0;
+    for (int s = 0; s < stride; ++s) {
+      double sum = 0.0;
+      for (size_t i = s; i < in.size(); i += stride) {
+        double before = sum;
+        sum += in[i];
+        err = std::max(err, std::fabs(out[i] - (inclusive ? sum : before)));
+      }
+    }
+    return err;
+  };
+
+  double exclusiveErr = 0.0, inclusiveErr = 0.0, vec4Err = 0.0;
+  ctx.scanBuffer(0, 1, 1, false, -1, 2, true);
+  exclusiveErr = scanErr(0, 1, 1, false);
+  int total = float_bits_to_int(states[2].data[0]);
+  double expectedTotal = 0.0;
+  for (float v : states[0].data)
+    expectedTotal += v;
+  ctx.scanBuffer(0, 1, 1, true, -1, -1, false);
+  inclusiveErr = scanErr(0, 1, 1, true);
+  ctx.scanBuffer(3, 4, 4, false, -1, 5, false);
+  vec4Err = scanErr(3, 4, 4, false);
+  double vec4Total = 0.0;
+  for (size_t i = 3; i < states[3].data.size(); i += 4)
+    vec4Total += states[3].data[i];
+  bool vec4TotalOk = states[5].data[3] == static_cast<float>(vec4Total);
+
+  // In place, recorded in a batch with a later reader of the result.
+  std::vector<float> expected = states[1].data; // inclusive scan of 0
+  states[1].data = states[0].data;
+  ctx.beginBatch();
+  ctx.scanBuffer(1, 1, 1, true, -1, -1, false);
+  ctx.copyBuffer(1, 4, 1, 0, 0, n);
+  ctx.submitBatch();
+  bool inPlaceOk = states[1].data == expected &&
+                   std::equal(expected.begin(), expected.end(),
+                              states[4].data.begin());
+
+  // count limits the scan and leaves the rest of dst alone.
+  states[1].data.assign(n, -1.0f);
+  ctx.scanBuffer(0, 1, 1, false, 10, -1, false);
+  bool countOk = states[1].data[9] >= 0.0f && states[1].data[10] == -1.0f;
+
+  // Compaction by flags: keep float4 particles whose flag is set.
+  std::vector<ResourceState> particles(4);
+  particles[0].data.resize(static_cast<size_t>(n) * 4);
+  for (size_t i = 0; i < particles[0].data.size(); ++i)
+    particles[0].data[i] = static_cast<float>(i);
+  particles[1].data.resize(n);
+  for (float &f : particles[1].data)
+    f = next() % 3 == 0 ? 1.0f : 0.0f;
+  particles[2].data.assign(static_cast<size_t>(n) * 4, -1.0f);
+  particles[3].data.assign(1, 0.0f);
+  EvalContext pctx;
+  pctx.workerPool = &pool;
+  for (auto &st : particles)
+    pctx.resources.push_back(&st);
+  std::vector<float> kept;
+  for (int i = 0; i < n; ++i)
+    if (particles[1].data[i] > 0.0f)
+      kept.insert(kept.end(), particles[0].data.begin() + i * 4,
+                  particles[0].data.begin() + i * 4 + 4);
+  pctx.compactBuffer(0, 1, 2, 4, 1, 3, true);
+  int keptCount = float_bits_to_int(particles[3].data[0]);
+  bool compactOk =
+      keptCount == static_cast<int>(kept.size() / 4) &&
+      std::equal(kept.begin(), kept.end(), particles[2].data.begin()) &&
+      particles[2].data[kept.size()] == -1.0f;
+
+  // In place by the first component (e.g. remaining life).
+  std::vector<float> alive;
+  for (size_t i = 0; i < kept.size(); i += 4)
+    if (kept[i] > 0.0f)
+      alive.insert(alive.end(), kept.begin() + i, kept.begin() + i + 4);
+  particles[2].data.resize(kept.size());
+  pctx.compactBuffer(2, -1, 2, 4, 4, 3, false);
+  bool inPlaceCompactOk =
+      particles[3].data[0] == static_cast<float>(alive.size() / 4) &&
+      std::equal(alive.begin(), alive.end(), particles[2].data.begin());
+
+  // A destination with room for 10 elements takes the first 10.
+  particles[2].data.assign(40, 0.0f);
+  pctx.compactBuffer(0, 1, 2, 4, 1, 3, true);
+  bool clampedOk = float_bits_to_int(particles[3].data[0]) == 10 &&
+                   std::equal(kept.begin(), kept.begin() + 40,
+                              particles[2].data.begin());
+
+  // A few million elements, on a pool of one thread per core.
+  const int big = 1 << 22;
+  std::vector<ResourceState> large(4);
+  large[0].data.assign(big, 1.0f);
+  large[1].data.assign(big, 0.0f);
+  large[2].data.resize(big);
+  for (float &f : large[2].data)
+    f = next() % 2 ? 1.0f : 0.0f;
+  large[3].data.assign(1, 0.0f);
+  WorkerPool fullPool;
+  EvalContext bigCtx;
+  bigCtx.workerPool = &fullPool;
+  for (auto &st : large)
+    bigCtx.resources.push_back(&st);
+  auto median = [](const std::function<void()> &fn) {
+    fn();
+    std::vector<double> ms;
+    for (int i = 0; i < 5; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      ms.push_back(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+  };
+  double scanMs =
+      median([&] { bigCtx.scanBuffer(0, 1, 1, false, -1, 3, false); });
+  double compactMs =
+      median([&] { bigCtx.compactBuffer(0, 2, 1, 1, 1, 3, false); });
+
+  auto allocStart = AllocCounter::now();
+  for (int i = 0; i < 4; ++i) {
+    bigCtx.scanBuffer(0, 1, 1, true, -1, 3, false);
+    bigCtx.compactBuffer(0, 2, 1, 1, 1, 3, false);
+  }
+  uint64_t steadyAllocations = AllocCounter::since(allocStart).allocations;
+
+  std::cout << "{\"exclusiveErr\":" << exclusiveErr
+            << ",\"inclusiveErr\":" << inclusiveErr
+            << ",\"totalOk\":"
+            << (total == static_cast<int>(expectedTotal) ? "true" : "false")
+            << ",\"vec4Err\":" << vec4Err
+            << ",\"vec4TotalOk\":" << (vec4TotalOk ? "true" : "false")
+            << ",\"inPlaceOk\":" << (inPlaceOk ? "true" : "false")
+            << ",\"countOk\":" << (countOk ? "true" : "false")
+            << ",\"compactOk\":" << (compactOk ? "true" : "false")
+            << ",\"inPlaceCompactOk\":"
+            << (inPlaceCompactOk ? "true" : "false")
+            << ",\"clampedOk\":" << (clampedOk ? "true" : "false")
+            << ",\"threads\":" << fullPool.threadCount()
+            << ",\"scanMs\":" << scanMs << ",\"compactMs\":" << compactMs
+            << ",\"steadyAllocations\":" << steadyAllocations << "}"
+            << std::endl;
+  return 0;
+}
+
+// sortBuffer against std::stable_sort on elements split into blocks: scalar
+// keys with negatives, signed zeros and duplicates, float4 particles sorted
+// by a component (payload kept with its key), descending order, a separate
+// keys buffer, in place in a batch, a partial count, and the time for a
+// million keys.
+int runSort() {
+  const int n = 150001;
+  WorkerPool pool(4);
+  uint32_t seed = 4242;
+  auto next = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+  };
+  auto randomKey = [&]() {
+    switch (next() % 8) {
+    case 0: return 0.0f;
+    case 1: return -0.0f;
+    case 2: return static_cast<float>(next() % 100); // duplicates
+    default:
+      return (static_cast<float>(next()) / 16777216.0f - 0.5f) * 2000.0f;
+    }
+  };
+  // Sort key bits (so -0 precedes +0), as the runtime orders them.
+  auto less = [](float a, float b) {
+    return buffer_sort::sortableKey(a) < buffer_sort::sortableKey(b);
+  };
+  auto sameBits = [](const std::vector<float> &a, const float *b,
+                     size_t count) {
+    return std::memcmp(a.data(), b, count * sizeof(float)) == 0;
+  };
+
+  std::vector<ResourceState> states(5);
+  states[0].data.resize(n);
+  for (float &v : states[0].data)
+    v = randomKey();
+  states[1].data.assign(n, 0.0f);
+  states[2].data.resize(static_cast<size_t>(n) * 4);
+  for (int i = 0; i < n; ++i) {
+    states[2].data[i * 4] = static_cast<float>(i);
+    states[2].data[i * 4 + 1] = static_cast<float>(i) * 2.0f;
+    states[2].data[i * 4 + 2] = randomKey();
+    states[2].data[i * 4 + 3] = -static_cast<float>(i);
+  }
+  states[3].data.assign(static_cast<size_t>(n) * 4, 0.0f);
+  states[4].data.resize(n);
+  for (float &v : states[4].data)
+    v = randomKey();
+  EvalContext ctx;
+  ctx.workerPool = &pool;
+  for (auto &st : states)
+    ctx.resources.push_back(&st);
+
+  std::vector<float> expected = states[0].data;
+  std::stable_sort(expected.begin(), expected.end(), less);
+  ctx.sortBuffer(0, 1, 1, 0, -1, 1, false, -1);
+  bool scalarOk = sameBits(expected, states[1].data.data(), n);
+
+  std::vector<std::array<float, 4>> particles(n), sortedParticles;
+  for (int i = 0; i < n; ++i)
+    std::copy_n(states[2].data.begin() + i * 4, 4, particles[i].begin());
+  sortedParticles = particles;
+  std::stable_sort(sortedParticles.begin(), sortedParticles.end(),
+                   [&](const std::array<float, 4> &a,
+                       const std::array<float, 4> &b) {
+                     return less(a[2], b[2]);
+                   });
+  std::vector<float> flat;
+  for (auto &p : sortedParticles)
+    flat.insert(flat.end(), p.begin(), p.end());
+  ctx.sortBuffer(2, 3, 4, 2, -1, 1, false, -1);
+  bool payloadOk = sameBits(flat, states[3].data.data(), flat.size());
+
+  // Descending (back to front): stable, so equal keys keep their order.
+  std::vector<std::array<float, 4>> backToFront = particles;
+  std::stable_sort(backToFront.begin(), backToFront.end(),
+                   [&](const std::array<float, 4> &a,
+                       const std::array<float, 4> &b) {
+                     return less(b[2], a[2]);
+                   });
+  flat.clear();
+  for (auto &p : backToFront)
+    flat.insert(flat.end(), p.begin(), p.end());
+  ctx.sortBuffer(2, 3, 4, 2, -1, 1, true, -1);
+  bool descendingOk = sameBits(flat, states[3].data.data(), flat.size());
+
+  // Separate keys: particles follow the keys, which come back sorted.
+  std::vector<int> order(n);
+  for (int i = 0; i < n; ++i)
+    order[i] = i;
+  std::vector<float> keys = states[4].data;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return less(keys[a], keys[b]); });
+  flat.clear();
+  std::vector<float> sortedKeys;
+  for (int i : order) {
+    flat.insert(flat.end(), particles[i].begin(), particles[i].end());
+    sortedKeys.push_back(keys[i]);
+  }
+  ctx.sortBuffer(2, 3, 4, 0, 4, 1, false, -1);
+  bool keysBufferOk = sameBits(flat, states[3].data.data(), flat.size()) &&
+                      sameBits(sortedKeys, states[4].data.data(), n);
+
+  // In place, recorded in a batch with a later reader of the result.
+  std::vector<float> inPlaceExpected = states[0].data;
+  std::stable_sort(inPlaceExpected.begin(), inPlaceExpected.end(), less);
+  ctx.beginBatch();
+  ctx.sortBuffer(0, 0, 1, 0, -1, 1, false, -1);
+  ctx.copyBuffer(0, 1, 1, 0, 0, n);
+  ctx.submitBatch();
+  bool inPlaceOk = sameBits(inPlaceExpected, states[0].data.data(), n) &&
+                   sameBits(inPlaceExpected, states[1].data.data(), n);
+
+  // count sorts a prefix (e.g. the live particles) and leaves the rest.
+  for (int i = 0; i < n; ++i)
+    states[0].data[i] = static_cast<float>(n - i);
+  ctx.sortBuffer(0, 0, 1, 0, -1, 1, false, 10);
+  bool countOk = states[0].data[0] == static_cast<float>(n - 9) &&
+                 states[0].data[9] == static_cast<float>(n) &&
+                 states[0].data[10] == static_cast<float>(n - 10);
+
+  // A million keys, on a pool of one thread per core.
+  const int big = 1 << 20;
+  std::vector<ResourceState> large(2);
+  large[0].data.resize(big);
+  for (float &v : large[0].data)
+    v = randomKey();
+  large[1].data.assign(static_cast<size_t>(big) * 4, 0.0f);
+  std::vector<float> bigKeys = large[0].data;
+  WorkerPool fullPool;
+  EvalContext bigCtx;
+  bigCtx.workerPool = &fullPool;
+  for (auto &st : large)
+    bigCtx.resources.push_back(&st);
+  std::vector<double> ms;
+  for (int i = 0; i < 6; ++i) {
+    large[0].data = bigKeys;
+    auto start = std::chrono::steady_clock::now();
+    bigCtx.sortBuffer(0, 0, 1, 0, -1, 1, false, -1);
+    ms.push_back(std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start)
+                     .count());
+  }
+  std::sort(ms.begin() + 1, ms.end()); // the first run warms the scratch
+  double sortMs = ms[3];
+
+  auto allocStart = AllocCounter::now();
+  for (int i = 0; i < 4; ++i)
+    bigCtx.sortBuffer(0, 1, 1, 0, -1, 1, true, -1);
+  uint64_t steadyAllocations = AllocCounter::since(allocStart).allocations;
+
+  std::cout << "{\"scalarOk\":" << (scalarOk ? "true" : "false")
+            << ",\"payloadOk\":" << (payloadOk ? "true" : "false")
+            << ",\"descendingOk\":" << (descendingOk ? "true" : "false")
+            << ",\"keysBufferOk\":" << (keysBufferOk ? "true" : "false")
+            << ",\"inPlaceOk\":" << (inPlaceOk ? "true" : "false")
+            << ",\"countOk\":" << (countOk ? "true" : "false")
+            << ",\"threads\":" << fullPool.threadCount()
+            << ",\"sortMs\":" << sortMs
+            << ",\"steadyAllocations\":" << steadyAllocations << "}"
+            << std::endl;
+  return 0;
+}
+
+int runReduce() {
+  const int n = 100003;
+  uint32_t seed = 99;
+  auto next = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<float>(seed >> 8) / 16777216.0f;
+  };
+  // 0: scalars, 1: float4, 2: 64x64 texture, 3-5: results, 6: counter
+  std::vector<ResourceState> states(7);
+  states[0].data.resize(n);
+  for (float &v : states[0].data)
+    v = (next() - 0.5f) * 1000.0f;
+  states[1].data.resize(static_cast<size_t>(n) * 4);
+  for (float &v : states[1].data)
+    v = next() * 10.0f - 2.0f;
+  states[2].width = states[2].height = 64;
+  states[2].data.resize(64 * 64 * 4);
+  for (float &v : states[2].data)
+    v = next() * 1.5f - 0.25f; // some below 0 and above 1
+  states[3].data.assign(4, 0.0f);
+  states[4].data.assign(4, 0.0f);
+  states[5].data.assign(16, 0.0f);
+  states[6].data.assign(16, 0.0f);
+  WorkerPool pool(4), single(1);
+  EvalContext ctx, serialCtx;
+  ctx.workerPool = &pool;
+  serialCtx.workerPool = &single;
+  for (auto &st : states) {
+    ctx.resources.push_back(&st);
+    serialCtx.resources.push_back(&st);
+  }
+  auto sum = static_cast<int>(ReduceMode::Sum);
+  auto near = [](double a, double b) {
+    return std::fabs(a - b) <= 1e-5 * std::max(1.0, std::fabs(b));
+  };
+
+  // Scalar sum, min, max and mean against a double reference.
+  double refSum = 0.0;
+  float refMin = INFINITY, refMax = -INFINITY;
+  for (float v : states[0].data) {
+    refSum += v;
+    refMin = std::min(refMin, v);
+    refMax = std::max(refMax, v);
+  }
+  ctx.reduceBuffer(0, 3, 1, sum, -1, -1, 0, 0.0f, 0.0f, false);
+  float gotSum = states[3].data[0];
+  ctx.reduceBuffer(0, 3, 1, static_cast<int>(ReduceMode::Min), -1, -1, 0,
+                   0.0f, 0.0f, false);
+  float gotMin = states[3].data[0];
+  ctx.reduceBuffer(0, 3, 1, static_cast<int>(ReduceMode::Max), -1, -1, 0,
+                   0.0f, 0.0f, false);
+  float gotMax = states[3].data[0];
+  ctx.reduceBuffer(0, 3, 1, static_cast<int>(ReduceMode::Mean), -1, -1, 0,
+                   0.0f, 0.0f, false);
+  float gotMean = states[3].data[0];
+  bool scalarOk = near(gotSum, refSum) && gotMin == refMin &&
+                  gotMax == refMax && near(gotMean, refSum / n);
+
+  // Same bits on one thread as on four, run after run.
+  serialCtx.reduceBuffer(0, 4, 1, sum, -1, -1, 0, 0.0f, 0.0f, false);
+  bool deterministic = std::memcmp(&states[4].data[0], &gotSum,
+                                   sizeof(float)) == 0;
+  serialCtx.reduceBuffer(1, 4, 4, sum, -1, -1, 0, 0.0f, 0.0f, false);
+  std::vector<float> serialVec = states[4].data;
+  for (int run = 0; run < 3; ++run) {
+    ctx.reduceBuffer(1, 4, 4, sum, -1, -1, 0, 0.0f, 0.0f, false);
+    deterministic = deterministic &&
+                    std::memcmp(states[4].data.data(), serialVec.data(),
+                                4 * sizeof(float)) == 0;
+  }
+
+  // float4: per component, or one component.
+  double refVec[4] = {};
+  float refVecMax[4] = {-INFINITY, -INFINITY, -INFINITY, -INFINITY};
+  for (int i = 0; i < n; ++i)
+    for (int c = 0; c < 4; ++c) {
+      refVec[c] += states[1].data[i * 4 + c];
+      refVecMax[c] = std::max(refVecMax[c], states[1].data[i * 4 + c]);
+    }
+  bool vectorOk = true;
+  for (int c = 0; c < 4; ++c)
+    vectorOk = vectorOk && near(states[4].data[c], refVec[c]);
+  states[3].data.assign(4, -1.0f);
+  ctx.reduceBuffer(1, 3, 4, static_cast<int>(ReduceMode::Max), 2, -1, 0, 0.0f,
+                   0.0f, false);
+  vectorOk = vectorOk && states[3].data[0] == refVecMax[2] &&
+             states[3].data[1] == -1.0f;
+
+  // argmin/argmax: first index of the extreme, NaN skipped.
+  states[0].data[777] = std::nanf("");
+  states[0].data[5000] = -1e6f;
+  states[0].data[90000] = -1e6f;
+  states[0].data[123] = 1e6f;
+  ctx.reduceBuffer(0, 3, 1, static_cast<int>(ReduceMode::ArgMin), 0, -1, 0,
+                   0.0f, 0.0f, false);
+  float argMin = states[3].data[0];
+  ctx.reduceBuffer(0, 6, 1, static_cast<int>(ReduceMode::ArgMax), 0, -1, 0,
+                   0.0f, 0.0f, true);
+  bool argOk = argMin == 5000.0f && float_bits_to_int(states[6].data[0]) == 123;
+
+  // Histogram of a texture channel into 16 bins over [0, 1); values
+  // outside land in the end bins, so the counts add up to every pixel.
+  std::vector<uint32_t> refBins(16, 0);
+  for (int i = 0; i < 64 * 64; ++i) {
+    float t = states[2].data[i * 4 + 1] * 16.0f;
+    refBins[std::min(15, std::max(0, static_cast<int>(std::floor(t))))]++;
+  }
+  ctx.reduceBuffer(2, 5, 4, static_cast<int>(ReduceMode::Histogram), 1, -1,
+                   -1, 0.0f, 1.0f, false);
+  ctx.reduceBuffer(2, 6, 4, static_cast<int>(ReduceMode::Histogram), 1, -1,
+                   16, 0.0f, 1.0f, true);
+  bool histogramOk = true;
+  for (int k = 0; k < 16; ++k)
+    histogramOk = histogramOk &&
+                  states[5].data[k] == static_cast<float>(refBins[k]) &&
+                  float_bits_to_int(states[6].data[k]) ==
+                      static_cast<int>(refBins[k]);
+
+  // count reduces a prefix; in a batch, a later copy sees the result.
+  ctx.beginBatch();
+  ctx.reduceBuffer(1, 3, 4, sum, 0, 2, 0, 0.0f, 0.0f, false);
+  ctx.copyBuffer(3, 4, 1, 0, 0, 1);
+  ctx.submitBatch();
+  bool countOk = states[4].data[0] == states[1].data[0] + states[1].data[4];
+
+  // A million floats, on a pool of one thread per core.
+  const int big = 1 << 20;
+  std::vector<ResourceState> large(3);
+  large[0].data.resize(big);
+  for (float &v : large[0].data)
+    v = next();
+  large[1].data.assign(4, 0.0f);
+  large[2].data.assign(256, 0.0f);
+  WorkerPool fullPool;
+  EvalContext bigCtx;
+  bigCtx.workerPool = &fullPool;
+  for (auto &st : large)
+    bigCtx.resources.push_back(&st);
+  auto median = [&](int mode, size_t dst, int bins) {
+    std::vector<double> ms;
+    for (int i = 0; i < 6; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      bigCtx.reduceBuffer(0, dst, 1, mode, -1, -1, bins, 0.0f, 1.0f, false);
+      ms.push_back(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+    }
+    std::sort(ms.begin() + 1, ms.end());
+    return ms[3];
+  };
+  double sumMs = median(sum, 1, 0);
+  double histogramMs =
+      median(static_cast<int>(ReduceMode::Histogram), 2, 256);
+
+  auto allocStart = AllocCounter::now();
+  for (int i = 0; i < 4; ++i) {
+    bigCtx.reduceBuffer(0, 1, 1, static_cast<int>(ReduceMode::ArgMax), 0, -1,
+                        0, 0.0f, 0.0f, false);
+    bigCtx.reduceBuffer(0, 2, 1, static_cast<int>(ReduceMode::Histogram), 0,
+                        -1, 256, 0.0f, 1.0f, false);
+  }
+  uint64_t steadyAllocations = AllocCounter::since(allocStart).allocations;
+
+  std::cout << "{\"scalarOk\":" << (scalarOk ? "true" : "false")
+            << ",\"deterministic\":" << (deterministic ? "true" : "false")
+            << ",\"vectorOk\":" << (vectorOk ? "true" : "false")
+            << ",\"argOk\":" << (argOk ? "true" : "false")
+            << ",\"histogramOk\":" << (histogramOk ? "true" : "false")
+            << ",\"countOk\":" << (countOk ? "true" : "false")
+            << ",\"threads\":" << fullPool.threadCount()
+            << ",\"sumMs\":" << sumMs << ",\"histogramMs\":" << histogramMs
+            << ",\"steadyAllocations\":" << steadyAllocations << "}"
+            << std::endl;
+  return 0;
+}
+
+// Direct 2D convolution with a kw x kh kernel centred on (kw / 2, kh / 2).
+std::vector<float> referenceConvolve(const std::vector<float> &src, int w,
+                                     int h, const std::vector<double> &kernel,
+                                     int kw, int kh, int wrapMode) {
+  std::vector<float> out(src.size());
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x)
+      for (int c = 0; c < 4; ++c) {
+        double sum = 0.0;
+        for (int ky = 0; ky < kh; ++ky)
+          for (int kx = 0; kx < kw; ++kx) {
+            int sx = texture_blur::wrapIndex(x - (kx - kw / 2), w, wrapMode);
+            int sy = texture_blur::wrapIndex(y - (ky - kh / 2), h, wrapMode);
+            sum += kernel[ky * kw + kx] * src[(sy * w + sx) * 4 + c];
+          }
+        out[(y * w + x) * 4 + c] = static_cast<float>(sum);
+      }
+  return out;
+}
+
+// convolveTexture against direct convolution for each wrap mode: a Gaussian
+// and an asymmetric kernel texture, raw and normalized, in place in a
+// batch. Also the spectrum cache, steady-state allocations, and the time
+// for a 1024x1024 frame with kernels of radius 32 and 256 (the same padded
+// size, so about the same time).
+int runConvolve() {
+  const int w = 29, h = 19, kw = 6, kh = 5;
+  WorkerPool pool(4);
+  std::vector<float> image(static_cast<size_t>(w) * h * 4);
+  uint32_t seed = 4242;
+  auto next = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<float>(seed >> 8) / 16777216.0f;
+  };
+  for (float &v : image)
+    v = next();
+  std::vector<double> taps(kw * kh);
+  double tapSum = 0.0;
+  for (double &t : taps)
+    tapSum += t = next() - 0.2;
+  std::vector<double> normalized = taps;
+  for (double &t : normalized)
+    t /= tapSum;
+
+  float gaussianErr = 0.0f, kernelErr = 0.0f, normalizedErr = 0.0f,
+        inPlaceErr = 0.0f;
+  uint64_t hits = 0, misses = 0;
+  for (int wrap = 0; wrap < 3; ++wrap) {
+    // 0: source, 1: destination, 2: kernel texture
+    std::vector<ResourceState> states(3);
+    for (int i = 0; i < 2; ++i) {
+      states[i].width = w;
+      states[i].height = h;
+    }
+    states[2].width = kw;
+    states[2].height = kh;
+    states[2].data.assign(kw * kh * 4, 0.0f);
+    for (int i = 0; i < kw * kh; ++i)
+      states[2].data[i * 4] = static_cast<float>(taps[i]);
+    EvalContext ctx;
+    ctx.workerPool = &pool;
+    for (auto &st : states)
+      ctx.resources.push_back(&st);
+    ctx.texWrapModes = {wrap, wrap, 0};
+    auto convolve = [&](int kernelIdx, float radius, float sigma,
+                        bool normalize) {
+      states[0].data = image;
+      states[1].data.assign(image.size(), 0.0f);
+      ctx.convolveTexture(0, 1, kernelIdx, radius, sigma, normalize);
+      return states[1].data;
+    };
+
+    gaussianErr = std::max(
+        gaussianErr,
+        maxDiff(convolve(-1, 7.0f, 2.5f, true),
+                referenceBlur(image, w, h, gaussianKernel(7, 2.5), wrap)));
+    kernelErr = std::max(
+        kernelErr, maxDiff(convolve(2, 0.0f, 0.0f, false),
+                           referenceConvolve(image, w, h, taps, kw, kh, wrap)));
+    normalizedErr = std::max(
+        normalizedErr,
+        maxDiff(convolve(2, 0.0f, 0.0f, true),
+                referenceConvolve(image, w, h, normalized, kw, kh, wrap)));
+
+    std::vector<float> separate = convolve(-1, 7.0f, 2.5f, true);
+    states[0].data = image;
+    ctx.beginBatch();
+    ctx.convolveTexture(0, 0, -1, 7.0f, 2.5f, true);
+    ctx.submitBatch();
+    inPlaceErr = std::max(inPlaceErr, maxDiff(states[0].data, separate));
+    hits += ctx.fftSpectra.hits();
+    misses += ctx.fftSpectra.misses();
+  }
+
+  // 1024x1024, on a pool of one thread per core.
+  const int bw = 1024, bh = 1024;
+  std::vector<ResourceState> big(2);
+  for (auto &st : big) {
+    st.width = bw;
+    st.height = bh;
+    st.data.resize(static_cast<size_t>(bw) * bh * 4);
+  }
+  for (float &v : big[0].data)
+    v = next();
+  WorkerPool fullPool;
+  EvalContext bigCtx;
+  bigCtx.workerPool = &fullPool;
+  for (auto &st : big)
+    bigCtx.resources.push_back(&st);
+  bigCtx.texWrapModes = {1, 1};
+  auto time1024 = [&](float radius) {
+    bigCtx.convolveTexture(0, 1, -1, radius, 0.0f, true); // cache spectrum
+    std::vector<double> ms;
+    for (int i = 0; i < 3; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      bigCtx.convolveTexture(0, 1, -1, radius, 0.0f, true);
+      ms.push_back(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[1];
+  };
+  double radius32Ms = time1024(32.0f);
+  double radius256Ms = time1024(256.0f);
+
+  auto allocStart = AllocCounter::now();
+  for (int i = 0; i < 2; ++i)
+    bigCtx.convolveTexture(0, 1, -1, 256.0f, 0.0f, true);
+  uint64_t steadyAllocations = AllocCounter::since(allocStart).allocations;
+
+  std::cout << "{\"gaussianErr\":" << gaussianErr
+            << ",\"kernelErr\":" << kernelErr
+            << ",\"normalizedErr\":" << normalizedErr
+            << ",\"inPlaceErr\":" << inPlaceErr << ",\"spectrumHits\":" << hits
+            << ",\"spectrumMisses\":" << misses
+            << ",\"threads\":" << fullPool.threadCount()
+            << ",\"radius32Ms\":" << radius32Ms
+            << ",\"radius256Ms\":" << radius256Ms
+            << ",\"steadyAllocations\":" << steadyAllocations << "}"
+            << std::endl;
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "{\"error\": \"Usage: cpu-runtime-runner <case>\"}"
+              << std::endl;
+    return 1;
+  }
+  std::string name = argv[1];
+  if (name == "frame_graph")
+    return runFrameGraph();
+  if (name == "hazards")
+    return runHazards();
+  if (name == "tiles")
+    return runTiles();
+  if (name == "transient")
+    return runTransient();
+  if (name == "per_resource")
+    return runPerResource();
+  if (name == "residency")
+    return runResidency();
+  if (name == "pipelined")
+    return runPipelined(true);
+  if (name == "sequential")
+    return runPipelined(false);
+  if (name == "arg_arena")
+    return runArgArena();
+  if (name == "pipeline_cache")
+    return runPipelineCache();
+  if (name == "async_queue")
+    return runAsyncQueue();
+  if (name == "budget")
+    return runBudget();
+  if (name == "node_profiler")
+    return runNodeProfiler();
+  if (name == "trace")
+    return runTrace();
+  if (name == "memory")
+    return runMemory();
+  if (name == "action_log")
+    return runActionLog();
+  if (name == "perf_counters")
+    return runPerfCounters();
+  if (name == "tuning_cache")
+    return runTuningCache();
+  if (name == "blur")
+    return runBlur();
+  if (name == "scan")
+    return runScan();
+  if (name == "sort")
+    return runSort();
+  if (name == "reduce")
+    return runReduce();
+  if (name == "convolve")
+    return runConvolve();
+  std::cerr << "{\"error\": \"Unknown case: " << name << "\"}" << std::endl;
+  return 1;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+// Frame time budget and cancellation for CPU dispatches.
+//
+// A CPU dispatch runs as batches of tiles on the worker pool. With a
+// DispatchBudget attached to an EvalContext, every tile batch first checks
+// the budget: once the frame's deadline has passed (or the host cancelled
+// the frame) the remaining batches are skipped, so a host waiting on the
+// frame is released within one tile batch of the deadline. Skipped tiles
+// are not written, so their region keeps the previous frame's contents.
+//
+// That only holds for resources that still hold the previous frame. A
+// transient aliased by a MemoryPlanner holds another resource's data, and a
+// pipelined context carries only persistent resources over; dispatches
+// writing either run to completion at the deadline (the miss is still
+// counted). Cancellation skips them too, as the frame is discarded.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class DispatchBudget {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Policy {
+    // Stop at the deadline; unfinished tiles keep the previous frame's
+    // contents (dispatches that cannot keep them run to completion).
+    KeepPrevious,
+    // The deadline is only reported (deadlineMisses); dispatches still run
+    // to completion unless cancelled.
+    RunToCompletion,
+  };
+
+  explicit DispatchBudget(std::chrono::microseconds budget =
+                              std::chrono::microseconds(0),
+                          Policy policy = Policy::KeepPrevious)
+      : budget(budget), policy(policy) {}
+
+  // Per-frame time budget (0 = no deadline)
+  std::chrono::microseconds budget;
+  Policy policy;
+
+  // Start a frame: the deadline is `budget` from now and any cancellation
+  // is cleared.
+  void beginFrame() {
+    int64_t d = budget.count() > 0
+                    ? toNs(Clock::now() + budget)
+                    : INT64_MAX;
+    deadline.store(d, std::memory_order_relaxed);
+    cancelled.store(false, std::memory_order_relaxed);
+    missed.store(false, std::memory_order_relaxed);
+    frameTilesSkipped.store(0, std::memory_order_relaxed);
+  }
+
+  // Skip the rest of the frame's tiles. Safe to call from any thread.
+  void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+  bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+  // Called before each tile batch; true if the batch should be skipped.
+  // `keepsPrevious` is false for dispatches whose outputs do not hold the
+  // previous frame, which only stop when cancelled.
+  bool shouldStop(bool keepsPrevious = true) {
+    if (cancelled.load(std::memory_order_relaxed))
+      return true;
+    int64_t d = deadline.load(std::memory_order_relaxed);
+    if (d == INT64_MAX || toNs(Clock::now()) < d)
+      return false;
+    if (!missed.exchange(true, std::memory_order_relaxed))
+      deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+    return keepsPrevious && policy == Policy::KeepPrevious;
+  }
+
+  void countTiles(size_t run, size_t skipped) {
+    if (run)
+      tilesRun.fetch_add(run, std::memory_order_relaxed);
+    if (skipped) {
+      tilesSkipped.fetch_add(skipped, std::memory_order_relaxed);
+      frameTilesSkipped.fetch_add(skipped, std::memory_order_relaxed);
+    }
+  }
+
+  // True if every tile of the current frame has run so far.
+  bool frameComplete() const {
+    return frameTilesSkipped.load(std::memory_order_relaxed) == 0;
+  }
+
+  // Statistics (all frames)
+  std::atomic<size_t> tilesRun{0};
+  std::atomic<size_t> tilesSkipped{0};
+  std::atomic<size_t> deadlineMisses{0}; // frames that passed their deadline
+
+private:
+  static int64_t toNs(Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               t.time_since_epoch())
+        .count();
+  }
+
+  std::atomic<int64_t> deadline{INT64_MAX};
+  std::atomic<bool> cancelled{false};
+  std::atomic<bool> missed{false};
+  std::atomic<size_t> frameTilesSkipped{0};
+};
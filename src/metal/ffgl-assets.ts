@@ -21,6 +21,26 @@ import pluginMm from './ffgl-plugin.mm?raw';
 import interopM from './InteropTexture.m?raw';
 import interopH from './InteropTexture.h?raw';
 import intrinsicsH from './intrinsics.incl.h?raw';
+import frameGraphH from './frame-graph.h?raw';
+import memoryPlannerH from './memory-planner.h?raw';
+import hazardTrackerH from './hazard-tracker.h?raw';
+import residencyH from './residency.h?raw';
+import framePipelineH from './frame-pipeline.h?raw';
+import actionLogH from './action-log.h?raw';
+import argArenaH from './arg-arena.h?raw';
+import perfCountersH from './perf-counters.h?raw';
+import pipelineCacheH from './pipeline-cache.h?raw';
+import cpuQueueH from './cpu-queue.h?raw';
+import dispatchBudgetH from './dispatch-budget.h?raw';
+import nodeProfilerH from './node-profiler.h?raw';
+import traceRecorderH from './trace-recorder.h?raw';
+import tuningCacheH from './tuning-cache.h?raw';
+import textureBlurH from './texture-blur.h?raw';
+import bufferScanH from './buffer-scan.h?raw';
+import bufferSortH from './buffer-sort.h?raw';
+import bufferReduceH from './buffer-reduce.h?raw';
+import textureFftH from './texture-fft.h?raw';
+import pluginLifecycleH from './plugin-lifecycle.h?raw';
 import mslIntrinsicsH from './msl-intrinsics.incl.h?raw';
 
 export const FFGL_ASSETS: Record<string, string> = {
@@ -46,5 +66,25 @@ export const FFGL_ASSETS: Record<string, string> = {
   'InteropTexture.m': interopM,
   'InteropTexture.h': interopH,
   'intrinsics.incl.h': intrinsicsH,
+  'frame-graph.h': frameGraphH,
+  'memory-planner.h': memoryPlannerH,
+  'hazard-tracker.h': hazardTrackerH,
+  'residency.h': residencyH,
+  'frame-pipeline.h': framePipelineH,
+  'action-log.h': actionLogH,
+  'arg-arena.h': argArenaH,
+  'perf-counters.h': perfCountersH,
+  'pipeline-cache.h': pipelineCacheH,
+  'cpu-queue.h': cpuQueueH,
+  'dispatch-budget.h': dispatchBudgetH,
+  'node-profiler.h': nodeProfilerH,
+  'trace-recorder.h': traceRecorderH,
+  'tuning-cache.h': tuningCacheH,
+  'texture-blur.h': textureBlurH,
+  'buffer-scan.h': bufferScanH,
+  'buffer-sort.h': bufferSortH,
+  'buffer-reduce.h': bufferReduceH,
+  'texture-fft.h': textureFftH,
+  'plugin-lifecycle.h': pluginLifecycleH,
   'msl-intrinsics.incl.h': mslIntrinsicsH
 };
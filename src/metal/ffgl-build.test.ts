@@ -29,7 +29,7 @@ describe('FFGL Build Pipeline with Bash Script Generation', () => {
     }
     // Create a dummy logic.cpp if it doesn't exist to allow initial compilation
     if (!fs.existsSync(path.join(generatedDir, 'logic.cpp'))) {
-      fs.writeFileSync(path.join(generatedDir, 'logic.cpp'), 'void func_main(EvalContext& ctx) {}');
+      fs.writeFileSync(path.join(generatedDir, 'logic.cpp'), 'void func_main(EvalContext& ctx) {}\nvoid declare_frame_graph(EvalContext& ctx) {}\nvoid register_cpu_kernels(EvalContext& ctx) {}');
     }
   });
 
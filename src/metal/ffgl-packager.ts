@@ -28,6 +28,8 @@ export interface CppCompileOptions {
   outputPath: string;
   frameworks?: string[];
   extraFlags?: string[];
+  /** Compile as Objective-C++ with Apple frameworks (default). Set false for plain C++ sources. */
+  objc?: boolean;
 }
 
 export interface FFGLCompilePaths {
@@ -70,11 +72,13 @@ export function generateMetalCompileCmds(shaderPath: string, outputDir: string,
  * Generate bash command to compile an Objective-C++ source file
  */
 export function generateCppCompileCmd(options: CppCompileOptions): string {
-  const { sourcePaths, outputPath, frameworks = ['Metal', 'Foundation'], extraFlags = [] } = options;
+  const { sourcePaths, outputPath, frameworks = ['Metal', 'Foundation'], extraFlags = [], objc = true } = options;
   const outputDir = path.dirname(outputPath);
 
   const frameworkFlags = frameworks.map(f => `-framework ${f}`).join(' ');
-  const cmd = `clang++ -std=c++17 -O2 -D GL_SILENCE_DEPRECATION -D TARGET_MACOS=1 -x objective-c++ ${frameworkFlags} ${extraFlags.join(' ')} "${sourcePaths.join('" "')}" -o "${outputPath}"`;
+  const cmd = objc
+    ? `clang++ -std=c++17 -O2 -D GL_SILENCE_DEPRECATION -D TARGET_MACOS=1 -x objective-c++ ${frameworkFlags} ${extraFlags.join(' ')} "${sourcePaths.join('" "')}" -o "${outputPath}"`
+    : `clang++ -std=c++17 -O2 ${extraFlags.join(' ')} "${sourcePaths.join('" "')}" -o "${outputPath}"`;
 
   return [
     `# Compile C++ Host: ${path.basename(outputPath)}`,
@@ -246,6 +250,26 @@ const NANO_PROJECT_FILES: Array<{ file: string; vfsDir: string }> = [
   { file: 'InteropTexture.m', vfsDir: 'src' },
   { file: 'InteropTexture.h', vfsDir: 'src' },
   { file: 'intrinsics.incl.h', vfsDir: 'src' },
+  { file: 'frame-graph.h', vfsDir: 'src' },
+  { file: 'memory-planner.h', vfsDir: 'src' },
+  { file: 'hazard-tracker.h', vfsDir: 'src' },
+  { file: 'residency.h', vfsDir: 'src' },
+  { file: 'frame-pipeline.h', vfsDir: 'src' },
+  { file: 'action-log.h', vfsDir: 'src' },
+  { file: 'arg-arena.h', vfsDir: 'src' },
+  { file: 'perf-counters.h', vfsDir: 'src' },
+  { file: 'pipeline-cache.h', vfsDir: 'src' },
+  { file: 'cpu-queue.h', vfsDir: 'src' },
+  { file: 'dispatch-budget.h', vfsDir: 'src' },
+  { file: 'node-profiler.h', vfsDir: 'src' },
+  { file: 'trace-recorder.h', vfsDir: 'src' },
+  { file: 'tuning-cache.h', vfsDir: 'src' },
+  { file: 'texture-blur.h', vfsDir: 'src' },
+  { file: 'buffer-scan.h', vfsDir: 'src' },
+  { file: 'buffer-sort.h', vfsDir: 'src' },
+  { file: 'buffer-reduce.h', vfsDir: 'src' },
+  { file: 'texture-fft.h', vfsDir: 'src' },
+  { file: 'plugin-lifecycle.h', vfsDir: 'src' },
   { file: 'msl-intrinsics.incl.h', vfsDir: 'generated' },
 ];
 
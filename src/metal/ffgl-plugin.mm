@@ -1,7 +1,9 @@
 
 #include <array>
 #include <cmath>
+#include <cstdlib>
 #include <dlfcn.h>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -257,9 +259,13 @@ public:
 #endif
 
 #include "intrinsics.incl.h"
+#include "plugin-lifecycle.h"
 
 // Forward declarations of generated functions
 void func_main(EvalContext &ctx);
+void declare_frame_graph(EvalContext &ctx);
+void register_cpu_kernels(EvalContext &ctx);
+int declare_tuning_params(EvalContext &ctx, const char *cachePath);
 
 static const char _blitFromRectVertexShaderCode[] = R"(#version 410 core
 uniform vec2 MaxUV;
@@ -336,6 +342,10 @@ public:
   void setup_resources(EvalContext &ctx, ResourceState *outputRes,
                        const std::vector<ResourceState *> &inputRes);
 
+  // PluginLifecycle hooks
+  void init_context(EvalContext &ctx);
+  bool bind_texture(ResourceState &state, InteropTexture &interop);
+
 public:
   NanoPlugin() : CFFGLPlugin() {
     // Explicitly initialize hostTime (FFGL SDK does NOT guarantee initialization)
@@ -345,6 +355,7 @@ public:
     SetMaxInputs(MAX_INPUTS);
 
     init_plugin();
+    readCpuOptions();
 
 #ifdef INTERNAL_RESOURCE_COUNT
     _internalResources.resize(INTERNAL_RESOURCE_COUNT);
@@ -404,6 +415,9 @@ public:
   }
 
   FFResult DeInitGL() override {
+    // The context references the interop textures released below.
+    _lifecycle.reset();
+    writeTrace();
     _blitShader.Free();
     _blitShader2D.Free();
     _screenQuad.Free();
@@ -502,32 +516,26 @@ public:
     }
     glFlush();
 
-    EvalContext ctx;
-    ctx.initMetal(_device, _commandQueue, _library);
-    map_params(ctx);
-
-    ResourceState outputState;
-    outputState.width = targetWidth;
-    outputState.height = targetHeight;
-    outputState.isExternal = true;
-    outputState.externalTexture = _interopTexture->getMetalTexture();
+    // The evaluation context lives as long as the plugin instance (see
+    // PluginLifecycle); bindings are patched when a texture is recreated.
+    EvalContext &ctx = _lifecycle.beginFrame();
 
-    std::vector<std::unique_ptr<ResourceState>> inputStates;
-    std::vector<ResourceState *> inputPtrs;
+    _activeInputs.clear();
     for (unsigned int i = 0; i < pGL->numInputTextures && i < MAX_INPUTS; ++i) {
-      if (_inputInterops[i] != nullptr) {
-        auto inputState = std::make_unique<ResourceState>();
-        inputState->width = _inputInterops[i]->getWidth();
-        inputState->height = _inputInterops[i]->getHeight();
-        inputState->isExternal = true;
-        inputState->externalTexture = _inputInterops[i]->getMetalTexture();
-        inputPtrs.push_back(inputState.get());
-        inputStates.push_back(std::move(inputState));
+      if (_inputInterops[i] != nullptr)
+        _activeInputs.push_back(_inputInterops[i].get());
+    }
+    _lifecycle.bind(*_interopTexture, _activeInputs);
+
+    // CPU backend: the kernels read host copies of the input textures
+    if (_cpuBackend) {
+      glFinish();
+      for (size_t i = 0; i < _activeInputs.size(); ++i) {
+        ctx.syncResourceForWrite(i + 1);
+        readInteropPixels(*_activeInputs[i], ctx.resources[i + 1]->data);
       }
     }
 
-    setup_resources(ctx, &outputState, inputPtrs);
-
     // Inject time builtins from FFGL host
     // FFGL hostTime is in milliseconds — convert to seconds
     double currentHostTime = hostTime / 1000.0;
@@ -539,12 +547,19 @@ public:
     double rawDelta = currentHostTime - _prevHostTime;
     // Clamp delta_time to prevent diffusion explosion from time jumps
     double clampedDelta = std::max(0.0, std::min(rawDelta, 0.1));
-    ctx.inputs["time"] = static_cast<float>(currentHostTime - _startHostTime);
-    ctx.inputs["delta_time"] = static_cast<float>(clampedDelta);
+    _lifecycle.setTime(static_cast<float>(currentHostTime - _startHostTime),
+                       static_cast<float>(clampedDelta));
     _prevHostTime = currentHostTime;
 
     func_main(ctx);
-    ctx.blitStagingToExternal();
+    if (_cpuBackend) {
+      // With a dispatch budget, tiles skipped at the deadline keep the
+      // previous frame's output.
+      writeInteropPixels(*_interopTexture, ctx.hostData(0));
+      ctx.endFrame(); // returns transient storage to the planner
+    } else {
+      ctx.blitStagingToExternal();
+    }
 
     // Blit IOSurface output to host FBO
     {
@@ -599,11 +614,147 @@ private:
 
   std::vector<ResourceState> _internalResources;
 
+  // Chrome trace of the context's commands (see NANO_FFGL_TRACE)
+  void writeTrace() {
+    if (!_trace || _tracePath.empty())
+      return;
+    std::ofstream out(_tracePath);
+    _trace->writeJson(out);
+    _trace->clear();
+  }
+
+  std::vector<float *> _paramSlots; // ctx.inputs entries, by parameter index
+  bool _paramsMapped = false;
+  std::unique_ptr<TraceRecorder> _trace;
+  std::string _tracePath;
+
+  // CPU backend and its options (see readCpuOptions)
+  void readCpuOptions();
+  void readInteropPixels(InteropTexture &interop, std::vector<float> &data);
+  void writeInteropPixels(InteropTexture &interop,
+                          const std::vector<float> &data);
+  bool _cpuBackend = false;
+  std::unique_ptr<MemoryPlanner> _memoryPlanner;
+  std::unique_ptr<CpuQueue> _cpuQueue;
+  std::unique_ptr<DispatchBudget> _budget;
+  std::vector<uint8_t> _pixelScratch; // BGRA8 rows, reused every frame
+
+  // Frame-persistent evaluation context and the bindings it refers to
+  // (declared last: it references the members above)
+  PluginLifecycle<NanoPlugin, InteropTexture> _lifecycle{*this};
+  std::vector<InteropTexture *> _activeInputs; // reused every frame
+
   double _startHostTime = 0;
   double _prevHostTime = 0;
   bool _timeInitialized = false;
 };
 
+// Set up a new evaluation context: Metal (unless NANO_FFGL_CPU is set), the
+// CPU options, frame graph, CPU kernels, tuning params and the optional trace.
+void NanoPlugin::init_context(EvalContext &ctx) {
+  if (!_cpuBackend)
+    ctx.initMetal(_device, _commandQueue, _library);
+  ctx.memoryPlanner = _memoryPlanner.get();
+  ctx.cpuQueue = _cpuQueue.get();
+  ctx.dispatchBudget = _budget.get();
+  declare_frame_graph(ctx);
+  register_cpu_kernels(ctx);
+  // Tuning params start at their defaults; NANO_TUNING_CACHE=<path>
+  // applies the values scripts/autotune.ts recorded for this machine.
+  declare_tuning_params(ctx, std::getenv("NANO_TUNING_CACHE"));
+  // NANO_FFGL_TRACE=<path> records a command timeline, written when GL
+  // is torn down.
+  if (const char *path = std::getenv("NANO_FFGL_TRACE")) {
+    if (!_trace)
+      _trace = std::make_unique<TraceRecorder>();
+    _tracePath = path;
+    ctx.trace = _trace.get();
+  }
+  _paramsMapped = false;
+}
+
+// Point `state` at the Metal texture of `interop`. Returns true if the
+// binding changed (the interop texture was recreated). On the CPU backend
+// the state holds a host copy instead, filled every frame.
+bool NanoPlugin::bind_texture(ResourceState &state, InteropTexture &interop) {
+  id<MTLTexture> texture = interop.getMetalTexture();
+  if (state.externalTexture == texture && state.isExternal == !_cpuBackend)
+    return false;
+  state.width = interop.getWidth();
+  state.height = interop.getHeight();
+  state.isExternal = !_cpuBackend;
+  state.externalTexture = texture;
+  if (_cpuBackend)
+    state.data.assign(state.width * state.height * 4, 0.0f);
+  return true;
+}
+
+// Opt-in CPU backend, for hosts without a usable GPU and for measuring the
+// CPU runtime inside a real host:
+//   NANO_FFGL_CPU=1              run kernels on the CPU backend
+//   NANO_FFGL_TRANSIENTS=1       alias transient resources (MemoryPlanner)
+//   NANO_FFGL_CPU_QUEUE=<n>      run commands on an async queue of n threads
+//   NANO_FFGL_BUDGET_MS=<ms>     stop dispatches <ms> after ProcessOpenGL
+//                                starts the frame; unfinished tiles keep the
+//                                previous frame's output (dispatches writing
+//                                aliased transients still run to completion)
+// The options only apply with NANO_FFGL_CPU=1; Metal dispatches cannot be
+// pre-empted.
+void NanoPlugin::readCpuOptions() {
+  const char *cpu = std::getenv("NANO_FFGL_CPU");
+  _cpuBackend = cpu && std::atoi(cpu) != 0;
+  if (!_cpuBackend)
+    return;
+  if (const char *v = std::getenv("NANO_FFGL_TRANSIENTS"); v && std::atoi(v))
+    _memoryPlanner = std::make_unique<MemoryPlanner>();
+  if (const char *v = std::getenv("NANO_FFGL_CPU_QUEUE"); v && std::atoi(v) > 0)
+    _cpuQueue = std::make_unique<CpuQueue>(static_cast<unsigned>(std::atoi(v)));
+  if (const char *v = std::getenv("NANO_FFGL_BUDGET_MS"); v && std::atof(v) > 0)
+    _budget = std::make_unique<DispatchBudget>(
+        std::chrono::microseconds(static_cast<long long>(std::atof(v) * 1000)));
+}
+
+// BGRA8 interop texture <-> RGBA float host data (CPU backend)
+void NanoPlugin::readInteropPixels(InteropTexture &interop,
+                                   std::vector<float> &data) {
+  size_t w = interop.getWidth(), h = interop.getHeight();
+  _pixelScratch.resize(w * h * 4);
+  [interop.getMetalTexture() getBytes:_pixelScratch.data()
+                          bytesPerRow:w * 4
+                           fromRegion:MTLRegionMake2D(0, 0, w, h)
+                          mipmapLevel:0];
+  data.resize(w * h * 4);
+  for (size_t p = 0; p < w * h; ++p) {
+    const uint8_t *px = &_pixelScratch[p * 4];
+    data[p * 4 + 0] = px[2] / 255.0f;
+    data[p * 4 + 1] = px[1] / 255.0f;
+    data[p * 4 + 2] = px[0] / 255.0f;
+    data[p * 4 + 3] = px[3] / 255.0f;
+  }
+}
+
+void NanoPlugin::writeInteropPixels(InteropTexture &interop,
+                                    const std::vector<float> &data) {
+  size_t w = interop.getWidth(), h = interop.getHeight();
+  if (data.size() < w * h * 4)
+    return;
+  _pixelScratch.resize(w * h * 4);
+  auto unorm = [](float v) {
+    return static_cast<uint8_t>(std::lround(std::max(0.0f, std::min(1.0f, v)) * 255.0f));
+  };
+  for (size_t p = 0; p < w * h; ++p) {
+    uint8_t *px = &_pixelScratch[p * 4];
+    px[0] = unorm(data[p * 4 + 2]);
+    px[1] = unorm(data[p * 4 + 1]);
+    px[2] = unorm(data[p * 4 + 0]);
+    px[3] = unorm(data[p * 4 + 3]);
+  }
+  [interop.getMetalTexture() replaceRegion:MTLRegionMake2D(0, 0, w, h)
+                               mipmapLevel:0
+                                 withBytes:_pixelScratch.data()
+                               bytesPerRow:w * 4];
+}
+
 // Include generated code
 #define PLUGIN_CLASS NanoPlugin
 #include "generated/logic.cpp"
@@ -0,0 +1,565 @@
+#pragma once
+
+// Backend-neutral command scheduling for EvalContext.
+//
+// WorkerPool is the CPU backend's thread pool. FrameGraph records the
+// commands issued between EvalContext::beginBatch() and submitBatch() together
+// with the resources each one reads and writes, groups them into dependency
+// levels, and runs the commands of a level concurrently on the pool.
+// Schedules are cached by the structure of the command stream, so a frame
+// that issues the same commands as the previous one skips the analysis. The
+// cache keeps the most recently used few structures.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// =====================
+// WorkerPool
+// =====================
+
+// Fixed-size thread pool. parallelFor() lets the calling thread take part in
+// the work, so it may be nested (a command running on a worker can itself
+// split into tiles) without deadlocking.
+class WorkerPool {
+public:
+  explicit WorkerPool(unsigned threadCount = 0) {
+    if (threadCount == 0)
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+    // The caller participates in every parallelFor, so spawn one fewer.
+    for (unsigned i = 1; i < threadCount; ++i)
+      threads.emplace_back([this] { workerLoop(); });
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads)
+      t.join();
+  }
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  unsigned threadCount() const {
+    return static_cast<unsigned>(threads.size()) + 1;
+  }
+
+  // Process-wide pool used when an EvalContext has no explicit pool.
+  static WorkerPool &shared() {
+    static WorkerPool pool;
+    return pool;
+  }
+
+  // Run fn(begin, end) over [0, count) in chunks of at most `grain` items.
+  // Returns when every chunk has finished.
+  void parallelFor(int count, int grain,
+                   const std::function<void(int, int)> &fn) {
+    if (count <= 0)
+      return;
+    grain = std::max(1, grain);
+    int chunks = (count + grain - 1) / grain;
+    if (chunks == 1 || threads.empty()) {
+      fn(0, count);
+      return;
+    }
+
+    std::shared_ptr<Job> job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = takeJob();
+      job->fn = &fn;
+      job->count = count;
+      job->grain = grain;
+      job->chunks = chunks;
+      jobs.push_back(job);
+    }
+    wake.notify_all();
+
+    runChunks(*job);
+
+    {
+      std::unique_lock<std::mutex> lock(job->doneMutex);
+      job->doneCv.wait(lock, [&] { return job->done.load() == job->chunks; });
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find(jobs.begin(), jobs.end(), job);
+    if (it != jobs.end())
+      jobs.erase(it);
+    spareJobs.push_back(std::move(job));
+  }
+
+private:
+  struct Job {
+    const std::function<void(int, int)> *fn = nullptr;
+    int count = 0;
+    int grain = 1;
+    int chunks = 0;
+    std::atomic<int> next{0};
+    std::atomic<int> done{0};
+    std::atomic<int> workers{0}; // worker threads inside runChunks
+    std::mutex doneMutex;
+    std::condition_variable doneCv;
+  };
+
+  // A finished job no worker is still running, or a new one. Jobs are
+  // reused so steady-state dispatches do not allocate. Called with `mutex`
+  // held.
+  std::shared_ptr<Job> takeJob() {
+    for (auto it = spareJobs.begin(); it != spareJobs.end(); ++it) {
+      if ((*it)->workers.load(std::memory_order_acquire) != 0)
+        continue;
+      std::shared_ptr<Job> job = std::move(*it);
+      spareJobs.erase(it);
+      job->next.store(0);
+      job->done.store(0);
+      return job;
+    }
+    return std::make_shared<Job>();
+  }
+
+  // Claim and run chunks until none are left.
+  static void runChunks(Job &job) {
+    for (;;) {
+      int chunk = job.next.fetch_add(1);
+      if (chunk >= job.chunks)
+        break;
+      int begin = chunk * job.grain;
+      int end = std::min(job.count, begin + job.grain);
+      (*job.fn)(begin, end);
+      if (job.done.fetch_add(1) + 1 == job.chunks) {
+        std::lock_guard<std::mutex> lock(job.doneMutex);
+        job.doneCv.notify_all();
+      }
+    }
+  }
+
+  void workerLoop() {
+    for (;;) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+        if (stopping)
+          return;
+        job = jobs.front();
+        // Fully claimed jobs leave the queue; the owner waits on `done`.
+        if (job->next.load() >= job->chunks) {
+          jobs.erase(jobs.begin());
+          continue;
+        }
+        job->workers.fetch_add(1, std::memory_order_relaxed);
+      }
+      runChunks(*job);
+      job->workers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<std::shared_ptr<Job>> jobs; // oldest first
+  std::vector<std::shared_ptr<Job>> spareJobs;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+};
+
+// =====================
+// ScratchPool
+// =====================
+
+// Working storage for commands that may run concurrently (frame-graph
+// levels, the CPU queue). Released objects are handed out again, so
+// steady-state frames do not allocate.
+template <typename T> class ScratchPool {
+public:
+  std::unique_ptr<T> acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (spare.empty())
+      return std::unique_ptr<T>(new T());
+    std::unique_ptr<T> item = std::move(spare.back());
+    spare.pop_back();
+    return item;
+  }
+
+  void release(std::unique_ptr<T> item) {
+    std::lock_guard<std::mutex> lock(mutex);
+    spare.push_back(std::move(item));
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<std::unique_ptr<T>> spare;
+};
+
+// =====================
+// ResourceSet
+// =====================
+
+// Set of resource indices (bitset over EvalContext::resources). The first
+// 64 indices live inline, so typical sets never allocate.
+struct ResourceSet {
+  uint64_t low = 0;
+  std::vector<uint64_t> high; // indices 64 and up
+
+  ResourceSet() = default;
+  ResourceSet(std::initializer_list<int> indices) {
+    for (int i : indices)
+      insert(static_cast<size_t>(i));
+  }
+
+  static ResourceSet all(size_t resourceCount) {
+    ResourceSet s;
+    for (size_t i = 0; i < resourceCount; ++i)
+      s.insert(i);
+    return s;
+  }
+
+  void insert(size_t idx) {
+    if (idx < 64) {
+      low |= uint64_t(1) << idx;
+      return;
+    }
+    size_t word = idx / 64 - 1;
+    if (word >= high.size())
+      high.resize(word + 1, 0);
+    high[word] |= uint64_t(1) << (idx % 64);
+  }
+
+  void merge(const ResourceSet &other) {
+    low |= other.low;
+    if (other.high.size() > high.size())
+      high.resize(other.high.size(), 0);
+    for (size_t w = 0; w < other.high.size(); ++w)
+      high[w] |= other.high[w];
+  }
+
+  bool intersects(const ResourceSet &other) const {
+    if (low & other.low)
+      return true;
+    size_t n = std::min(high.size(), other.high.size());
+    for (size_t w = 0; w < n; ++w)
+      if (high[w] & other.high[w])
+        return true;
+    return false;
+  }
+
+  bool contains(size_t idx) const {
+    if (idx < 64)
+      return (low >> idx) & 1;
+    size_t word = idx / 64 - 1;
+    return word < high.size() && (high[word] >> (idx % 64)) & 1;
+  }
+
+  bool empty() const {
+    if (low)
+      return false;
+    for (uint64_t w : high)
+      if (w)
+        return false;
+    return true;
+  }
+
+  template <typename F> void forEach(F fn) const {
+    for (size_t w = 0; w <= high.size(); ++w) {
+      uint64_t word = w == 0 ? low : high[w - 1];
+      while (word) {
+        int bit = __builtin_ctzll(word);
+        fn(w * 64 + static_cast<size_t>(bit));
+        word &= word - 1;
+      }
+    }
+  }
+
+  // Append the set to a structural signature (trailing empty words are
+  // skipped so equal sets always produce equal signatures).
+  void appendTo(std::vector<uint64_t> &sig) const {
+    size_t n = high.size();
+    while (n > 0 && high[n - 1] == 0)
+      --n;
+    size_t words = n > 0 ? n + 1 : (low ? 1 : 0);
+    sig.push_back(words);
+    if (words > 0)
+      sig.push_back(low);
+    sig.insert(sig.end(), high.begin(), high.begin() + n);
+  }
+};
+
+// =====================
+// FrameGraph
+// =====================
+
+enum class FrameOp : uint8_t {
+  Dispatch,
+  Draw,
+  CopyBuffer,
+  CopyTexture,
+  BlurTexture,
+  ScanBuffer,
+  CompactBuffer,
+  SortBuffer,
+  ReduceBuffer,
+  ConvolveTexture,
+  Resize,
+};
+
+inline uint64_t hashName(const char *s) {
+  uint64_t h = 1469598103934665603ull;
+  for (; *s; ++s) {
+    h ^= static_cast<unsigned char>(*s);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+// Move-only void() callable that stores its target inline. Recorded
+// commands capture more than std::function's small-buffer storage holds, so
+// a std::function would allocate once per command per frame; a capture that
+// does not fit here fails to compile instead.
+class FrameTask {
+public:
+  static constexpr size_t kCapacity = 128;
+
+  FrameTask() = default;
+
+  template <typename F, typename Fn = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same<Fn, FrameTask>::value>>
+  FrameTask(F &&f) {
+    static_assert(sizeof(Fn) <= kCapacity, "FrameTask capture too large");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                  "FrameTask capture over-aligned");
+    new (storage) Fn(std::forward<F>(f));
+    ops = &Impl<Fn>::ops;
+  }
+
+  FrameTask(FrameTask &&other) noexcept { take(other); }
+  FrameTask &operator=(FrameTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+  FrameTask(const FrameTask &) = delete;
+  FrameTask &operator=(const FrameTask &) = delete;
+  ~FrameTask() { reset(); }
+
+  void operator()() { ops->call(storage); }
+  explicit operator bool() const { return ops != nullptr; }
+
+private:
+  struct Ops {
+    void (*call)(void *);
+    void (*move)(void *dst, void *src); // move-construct, then destroy src
+    void (*destroy)(void *);
+  };
+
+  template <typename Fn> struct Impl {
+    static void call(void *p) { (*static_cast<Fn *>(p))(); }
+    static void move(void *dst, void *src) {
+      new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+      static_cast<Fn *>(src)->~Fn();
+    }
+    static void destroy(void *p) { static_cast<Fn *>(p)->~Fn(); }
+    static constexpr Ops ops{&call, &move, &destroy};
+  };
+
+  void take(FrameTask &other) {
+    if (other.ops) {
+      other.ops->move(storage, other.storage);
+      ops = other.ops;
+      other.ops = nullptr;
+    }
+  }
+
+  void reset() {
+    if (ops) {
+      ops->destroy(storage);
+      ops = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage[kCapacity];
+  const Ops *ops = nullptr;
+};
+
+class FrameGraph {
+public:
+  struct Node {
+    FrameOp op;
+    uint64_t key; // e.g. hashName(shader function)
+    ResourceSet reads;
+    ResourceSet writes;
+    FrameTask run;
+  };
+
+  // Dependency levels: every node in level L depends only on nodes in levels
+  // < L, so the nodes within one level may run concurrently.
+  using Schedule = std::vector<std::vector<uint32_t>>;
+
+  void add(FrameOp op, uint64_t key, ResourceSet reads, ResourceSet writes,
+           FrameTask run) {
+    nodes.push_back(
+        {op, key, std::move(reads), std::move(writes), std::move(run)});
+  }
+
+  bool empty() const { return nodes.empty(); }
+  size_t size() const { return nodes.size(); }
+
+  // Run all recorded nodes respecting read/write hazards, then clear.
+  void execute(WorkerPool &pool) {
+    if (nodes.empty())
+      return;
+    const Schedule &schedule = scheduleFor();
+    lastLevelCount = schedule.size();
+    for (const auto &level : schedule) {
+      if (level.size() == 1) {
+        nodes[level[0]].run();
+        continue;
+      }
+      pool.parallelFor(static_cast<int>(level.size()), 1,
+                       [&](int begin, int end) {
+                         for (int i = begin; i < end; ++i)
+                           nodes[level[i]].run();
+                       });
+    }
+    nodes.clear();
+  }
+
+  // Run only the recorded nodes that must finish before the host can access
+  // `needed`: their writers (and readers, if the host is going to write)
+  // plus everything those depend on. The remaining nodes stay recorded, in
+  // order.
+  void executeFor(const ResourceSet &needed, WorkerPool &pool,
+                  bool includeReaders = false) {
+    std::vector<bool> selected(nodes.size(), false);
+    for (size_t j = nodes.size(); j-- > 0;) {
+      bool sel = nodes[j].writes.intersects(needed) ||
+                 (includeReaders && nodes[j].reads.intersects(needed));
+      for (size_t k = j + 1; !sel && k < nodes.size(); ++k)
+        sel = selected[k] && conflicts(nodes[j], nodes[k]);
+      selected[j] = sel;
+    }
+    FrameGraph subset;
+    std::vector<Node> rest;
+    for (size_t i = 0; i < nodes.size(); ++i)
+      (selected[i] ? subset.nodes : rest).push_back(std::move(nodes[i]));
+    nodes = std::move(rest);
+    subset.execute(pool);
+  }
+
+  // Build the level schedule for the recorded nodes (exposed for tests).
+  Schedule buildSchedule() const {
+    // A node must come after the last writer of anything it touches (RAW,
+    // WAW) and after the last reader of anything it writes (WAR).
+    std::vector<int> lastWrite, lastRead;
+    auto at = [](std::vector<int> &v, size_t idx) -> int & {
+      if (idx >= v.size())
+        v.resize(idx + 1, -1);
+      return v[idx];
+    };
+    Schedule schedule;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      const Node &n = nodes[i];
+      int level = 0;
+      n.reads.forEach([&](size_t r) { level = std::max(level, at(lastWrite, r) + 1); });
+      n.writes.forEach([&](size_t r) {
+        level = std::max(level, at(lastWrite, r) + 1);
+        level = std::max(level, at(lastRead, r) + 1);
+      });
+      n.reads.forEach([&](size_t r) { at(lastRead, r) = std::max(at(lastRead, r), level); });
+      n.writes.forEach([&](size_t r) { at(lastWrite, r) = level; });
+      if (static_cast<size_t>(level) >= schedule.size())
+        schedule.resize(level + 1);
+      schedule[level].push_back(static_cast<uint32_t>(i));
+    }
+    return schedule;
+  }
+
+  // Cache statistics
+  size_t cacheHits = 0;
+  size_t cacheMisses = 0;
+  size_t lastLevelCount = 0;
+
+private:
+  static bool conflicts(const Node &a, const Node &b) {
+    return a.writes.intersects(b.reads) || a.writes.intersects(b.writes) ||
+           a.reads.intersects(b.writes);
+  }
+
+  struct CachedSchedule {
+    uint64_t hash = 0;
+    uint64_t used = 0;
+    std::vector<uint64_t> signature;
+    Schedule schedule;
+  };
+
+  // Structural signature of the recorded nodes, built into `sigScratch` and
+  // hashed as it grows. The scratch buffer keeps its capacity, so a frame
+  // that hits the cache does not allocate.
+  uint64_t signature() {
+    sigScratch.clear();
+    size_t hashed = 0;
+    uint64_t h = 1469598103934665603ull;
+    for (const auto &n : nodes) {
+      sigScratch.push_back((n.key << 8) ^ static_cast<uint64_t>(n.op));
+      n.reads.appendTo(sigScratch);
+      n.writes.appendTo(sigScratch);
+      for (; hashed < sigScratch.size(); ++hashed) {
+        h ^= sigScratch[hashed];
+        h *= 1099511628211ull;
+      }
+    }
+    return h;
+  }
+
+  const Schedule &scheduleFor() {
+    uint64_t h = signature();
+    for (auto &entry : cache)
+      if (entry.hash == h && entry.signature == sigScratch) {
+        entry.used = ++tick;
+        ++cacheHits;
+        return entry.schedule;
+      }
+    ++cacheMisses;
+    // Least recently used entry is replaced once the cache is full
+    CachedSchedule *entry;
+    if (cache.size() < kMaxCachedSchedules) {
+      cache.emplace_back();
+      entry = &cache.back();
+    } else {
+      entry = &*std::min_element(cache.begin(), cache.end(),
+                                 [](const CachedSchedule &a,
+                                    const CachedSchedule &b) {
+                                   return a.used < b.used;
+                                 });
+    }
+    entry->hash = h;
+    entry->used = ++tick;
+    entry->signature = sigScratch;
+    entry->schedule = buildSchedule();
+    return entry->schedule;
+  }
+
+  // Distinct batch structures whose schedules are kept. Hosts issue a few
+  // shapes of batch per frame; graphs that keep changing stay bounded.
+  static constexpr size_t kMaxCachedSchedules = 16;
+
+  std::vector<Node> nodes;
+  std::vector<CachedSchedule> cache;
+  uint64_t tick = 0;
+  std::vector<uint64_t> sigScratch;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+// Pipelined frame execution for the CPU backend.
+//
+// Without a pipeline, a frame's host logic (func_main) records commands and
+// then waits for them before the next frame starts. With a FramePipeline
+// attached, EvalContext::endFrame() hands the frame's recorded commands to
+// the pipeline's executor thread and returns, so the host logic of frame N+1
+// overlaps the kernels of frame N. Throughput is then bounded by the slower
+// of the two stages instead of their sum.
+//
+// The host drives a ring of EvalContexts (one per frame in flight). The
+// pipeline carries per-resource fences from one frame to the next so that
+// host reads, host writes and commands of a later frame wait only for the
+// earlier-frame work they conflict with. Resources declared persistent are
+// double-buffered: every context in the ring has its own copy, seeded from
+// the previous frame's copy, so a frame can overwrite them while the
+// previous frame still reads its own.
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "hazard-tracker.h"
+
+struct ResourceState;
+
+class FramePipeline {
+public:
+  // At most `maxFramesInFlight` frames are queued or running at once;
+  // submitting another blocks until the oldest finishes.
+  explicit FramePipeline(unsigned maxFramesInFlight = 2)
+      : limit(std::max(1u, maxFramesInFlight)) {
+    worker = std::thread([this] { run(); });
+  }
+
+  ~FramePipeline() {
+    drain();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+  }
+
+  FramePipeline(const FramePipeline &) = delete;
+  FramePipeline &operator=(const FramePipeline &) = delete;
+
+  unsigned maxFramesInFlight() const { return limit; }
+
+  // Queue a frame's work; frames run one after another in submission order.
+  void submit(std::function<void()> work) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (inFlight >= limit) {
+      ++latencyStalls;
+      done.wait(lock, [&] { return inFlight < limit; });
+    }
+    ++inFlight;
+    ++framesSubmitted;
+    maxObservedInFlight = std::max(maxObservedInFlight, inFlight);
+    queue.push_back(std::move(work));
+    wake.notify_all();
+  }
+
+  // Wait until every submitted frame has finished.
+  void drain() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return inFlight == 0; });
+  }
+
+  // Fences of the most recently submitted frame, imported by the next one.
+  HazardTracker hazards;
+
+  // Copy of each double-buffered resource used by the most recent frame.
+  ResourceState *latestCopy(size_t idx) const {
+    auto it = latest.find(idx);
+    return it != latest.end() ? it->second.copy : nullptr;
+  }
+  // Fence of the node that seeds a copy from `latestCopy(idx)` (it reads
+  // that copy until it has run).
+  FencePtr latestSeed(size_t idx) const {
+    auto it = latest.find(idx);
+    return it != latest.end() ? it->second.seed : nullptr;
+  }
+  void setLatestCopy(size_t idx, ResourceState *copy, FencePtr seed) {
+    latest[idx] = {copy, std::move(seed)};
+  }
+
+  // Statistics (host thread)
+  size_t framesSubmitted = 0;
+  size_t latencyStalls = 0; // submits that waited for the latency bound
+  unsigned maxObservedInFlight = 0;
+
+private:
+  void run() {
+    for (;;) {
+      std::function<void()> work;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || !queue.empty(); });
+        if (queue.empty())
+          return;
+        work = std::move(queue.front());
+        queue.pop_front();
+      }
+      work();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        --inFlight;
+      }
+      done.notify_all();
+    }
+  }
+
+  struct Latest {
+    ResourceState *copy = nullptr;
+    FencePtr seed;
+  };
+
+  unsigned limit;
+  unsigned inFlight = 0;
+  std::deque<std::function<void()>> queue;
+  std::unordered_map<size_t, Latest> latest;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping = false;
+  std::thread worker;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+// Per-resource hazard tracking for EvalContext.
+//
+// Every submitted unit of work (a Metal command buffer, or a command recorded
+// into a CPU frame-graph batch) gets a Fence that is signalled when it
+// completes. HazardTracker remembers, per resource, the fence of the last
+// write and of the last access of any kind, and whether the host copy of the
+// resource is out of date. A host read of resource A then waits only for the
+// work writing A, and only resources that are actually read are copied back.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "frame-graph.h"
+
+// One-shot completion signal. Safe to signal from any thread (e.g. a Metal
+// completion handler).
+class Fence {
+public:
+  void signal() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      done.store(true, std::memory_order_release);
+    }
+    cv.notify_all();
+  }
+
+  bool isDone() const { return done.load(std::memory_order_acquire); }
+
+  // Re-arm a signalled fence nobody else holds (see FencePool).
+  void reset() { done.store(false, std::memory_order_relaxed); }
+
+  void wait() {
+    if (isDone())
+      return;
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return done.load(std::memory_order_acquire); });
+  }
+
+private:
+  std::atomic<bool> done{false};
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+using FencePtr = std::shared_ptr<Fence>;
+
+// Fences for deferred CPU commands. A fence that has been signalled and is
+// no longer held by the hazard tracker or a command is handed out again, so
+// steady frames do not allocate one per command.
+class FencePool {
+public:
+  FencePtr acquire() {
+    for (size_t n = 0; n < fences.size(); ++n) {
+      FencePtr &f = fences[cursor];
+      cursor = (cursor + 1) % fences.size();
+      if (f.use_count() == 1 && f->isDone()) {
+        f->reset();
+        return f;
+      }
+    }
+    fences.push_back(std::make_shared<Fence>());
+    return fences.back();
+  }
+
+private:
+  std::vector<FencePtr> fences;
+  size_t cursor = 0; // where the next search starts
+};
+
+class HazardTracker {
+public:
+  // Record submitted work that reads `reads` and writes `writes`, completing
+  // when `fence` is signalled. Written resources become stale on the host.
+  void recordAccess(const ResourceSet &reads, const ResourceSet &writes,
+                    const FencePtr &fence) {
+    reads.forEach([&](size_t i) { state(i).lastAccess = fence; });
+    writes.forEach([&](size_t i) {
+      State &s = state(i);
+      s.lastWriter = fence;
+      s.lastAccess = fence;
+      s.stale = true;
+    });
+  }
+
+  bool isStale(size_t idx) const {
+    return idx < states.size() && states[idx].stale;
+  }
+
+  // Fence of the last write / last access (nullptr if none is outstanding).
+  FencePtr lastWriter(size_t idx) const {
+    return idx < states.size() ? states[idx].lastWriter : nullptr;
+  }
+  FencePtr lastAccess(size_t idx) const {
+    return idx < states.size() ? states[idx].lastAccess : nullptr;
+  }
+
+  // The host copy of `idx` is current again.
+  void markSynced(size_t idx) {
+    if (idx < states.size()) {
+      states[idx].stale = false;
+      states[idx].lastWriter = nullptr;
+    }
+  }
+
+  // Drop all state for `idx` (it now refers to different storage).
+  void forget(size_t idx) {
+    if (idx < states.size())
+      states[idx] = State();
+  }
+
+  // Drop all per-resource state (indices are about to be reassigned).
+  // Statistics are kept.
+  void clear() { states.clear(); }
+
+  // Indices of resources whose host copy is out of date, written to `out`
+  // (a caller-owned scratch vector, so repeated calls do not allocate).
+  void staleResources(std::vector<size_t> &out) const {
+    out.clear();
+    for (size_t i = 0; i < states.size(); ++i)
+      if (states[i].stale)
+        out.push_back(i);
+  }
+
+  // Statistics
+  size_t waits = 0;     // host waits on an unfinished fence
+  size_t readbacks = 0; // resources copied back to the host
+
+private:
+  struct State {
+    FencePtr lastWriter;
+    FencePtr lastAccess;
+    bool stale = false;
+  };
+
+  State &state(size_t idx) {
+    if (idx >= states.size())
+      states.resize(idx + 1);
+    return states[idx];
+  }
+
+  std::vector<State> states;
+};
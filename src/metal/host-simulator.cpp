@@ -0,0 +1,262 @@
+// Host simulator
+// Drives the FFGL plugin's per-frame lifecycle (PluginLifecycle, as used by
+// ProcessOpenGL in ffgl-plugin.mm) on the CPU backend, so per-frame setup
+// cost can be measured and regression-tested without a GPU or an FFGL host.
+// SimPlugin stands in for NanoPlugin plus its generated map_params /
+// setup_resources; the host textures are plain float buffers.
+//
+// Usage: host-simulator [persistent|fresh] [frames]
+//   persistent  keep one EvalContext across frames (the plugin's behaviour)
+//   fresh       build a new context every frame (the previous behaviour)
+// Prints a JSON object with timings, binding counters and an output
+// checksum.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "intrinsics.incl.h"
+#include "plugin-lifecycle.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kFeedbackSize = 64;
+
+// What the host hands the plugin for one frame.
+struct HostFrame {
+  size_t width;
+  size_t height;
+  size_t inputCount;
+  float time;
+  float gain;
+};
+
+// Host-side texture: RGBA floats, recreated when its size changes (like
+// InteropTexture).
+struct HostTexture {
+  size_t width = 0;
+  size_t height = 0;
+  std::vector<float> pixels;
+
+  void ensure(size_t w, size_t h) {
+    if (w == width && h == height)
+      return;
+    width = w;
+    height = h;
+    pixels.assign(w * h * 4, 0.0f);
+  }
+};
+
+void registerKernels(EvalContext &ctx) {
+  // feedback[i] = feedback[i] * 0.5 + time
+  ctx.registerCpuKernel("fn_feedback", [](EvalContext &c, const CpuDispatch &d,
+                                          const CpuTile &t) {
+    size_t fb = static_cast<size_t>(d.args[2]) + 1;
+    auto &data = c.resources[fb]->data;
+    for (int x = t.x0; x < t.x1; ++x)
+      data[x] = data[x] * 0.5f + d.args[1];
+  });
+  // output = gain * sum(inputs) + feedback[x % 64]
+  ctx.registerCpuKernel("fn_composite", [](EvalContext &c, const CpuDispatch &d,
+                                           const CpuTile &t) {
+    size_t inputCount = static_cast<size_t>(d.args[2]);
+    const auto &fb = c.resources[inputCount + 1]->data;
+    auto &out = c.resources[0]->data;
+    for (int y = t.y0; y < t.y1; ++y) {
+      for (int x = t.x0; x < t.x1; ++x) {
+        size_t p = (static_cast<size_t>(y) * d.dimX + x) * 4;
+        for (size_t ch = 0; ch < 4; ++ch) {
+          float sum = 0.0f;
+          for (size_t k = 1; k <= inputCount; ++k)
+            sum += c.resources[k]->data[p + ch];
+          out[p + ch] = d.args[0] * sum + fb[x % kFeedbackSize];
+        }
+      }
+    }
+  });
+}
+
+// Stand-in for the generated entry point.
+void func_main(EvalContext &ctx) {
+  float inputCount = static_cast<float>(ctx.resources.size() - 2);
+  int w = ctx.texWidths[0];
+  int h = ctx.texHeights[0];
+  ctx.dispatchShader("fn_feedback", kFeedbackSize, 1, 1,
+                     {ctx.getInput("gain"), ctx.getInput("time"), inputCount});
+  ctx.dispatchShader("fn_composite", w, h, 1,
+                     {ctx.getInput("gain"), ctx.getInput("time"), inputCount});
+}
+
+class SimPlugin {
+public:
+  explicit SimPlugin(bool persistent) : persistent(persistent) {
+    _internalResources.resize(1);
+    _internalResources[0].width = kFeedbackSize;
+    _internalResources[0].height = 1;
+  }
+
+  // PluginLifecycle hooks (see ffgl-plugin.mm)
+  void init_context(EvalContext &ctx) {
+    ctx.workerPool = &_pool;
+    registerKernels(ctx);
+    _paramsMapped = false;
+  }
+
+  // Bind a host texture's size to `state`. Returns true if it changed.
+  static bool bind_texture(ResourceState &state, HostTexture &tex) {
+    if (state.width == tex.width && state.height == tex.height &&
+        state.data.size() == tex.pixels.size())
+      return false;
+    state.width = tex.width;
+    state.height = tex.height;
+    state.data.assign(tex.pixels.size(), 0.0f);
+    return true;
+  }
+
+  // Generated-code equivalents (see CppGenerator's PLUGIN_CLASS section)
+  void map_params(EvalContext &ctx) {
+    if (!_paramsMapped) {
+      _paramSlots.clear();
+      _paramSlots.push_back(&ctx.inputs["gain"]);
+      ctx.inputs["tex_bound_input"] = 1.0f;
+      _paramsMapped = true;
+    }
+    *_paramSlots[0] = _gain;
+  }
+
+  void setup_resources(EvalContext &ctx, ResourceState *outputRes,
+                       const std::vector<ResourceState *> &inputRes) {
+    ctx.resources.push_back(outputRes);
+    ctx.isTextureResource.push_back(true);
+    ctx.texWidths.push_back(outputRes->width);
+    ctx.texHeights.push_back(outputRes->height);
+    for (auto *res : inputRes) {
+      ctx.resources.push_back(res);
+      ctx.isTextureResource.push_back(true);
+      ctx.texWidths.push_back(res->width);
+      ctx.texHeights.push_back(res->height);
+    }
+    ctx.resources.push_back(&_internalResources[0]);
+    ctx.isTextureResource.push_back(false);
+    ctx.texWidths.push_back(_internalResources[0].width);
+    ctx.texHeights.push_back(_internalResources[0].height);
+    if (_internalResources[0].data.empty())
+      _internalResources[0].data.resize(kFeedbackSize);
+  }
+
+  // The host side of NanoPlugin::ProcessOpenGL. Returns the nanoseconds
+  // spent before func_main (context and binding setup).
+  long long processFrame(const HostFrame &f) {
+    _gain = f.gain;
+
+    // Host textures (the plugin's interop textures)
+    _output.ensure(f.width, f.height);
+    if (_inputs.size() < f.inputCount)
+      _inputs.resize(f.inputCount);
+    _activeInputs.clear();
+    for (size_t k = 0; k < f.inputCount; ++k) {
+      _inputs[k].ensure(f.width, f.height);
+      for (size_t i = 0; i < _inputs[k].pixels.size(); ++i)
+        _inputs[k].pixels[i] =
+            static_cast<float>((i + k * 7 + _frame) % 17) / 17.0f;
+      _activeInputs.push_back(&_inputs[k]);
+    }
+
+    auto setupStart = Clock::now();
+    if (!persistent) {
+      // Previous behaviour: everything is rebuilt every frame.
+      _lifecycle.reset();
+    }
+    EvalContext &ctx = _lifecycle.beginFrame();
+    _lifecycle.bind(_output, _activeInputs);
+    _lifecycle.setTime(f.time, 1.0f / 60.0f);
+    long long setupNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - setupStart)
+                            .count();
+
+    // The host blit into the input textures
+    for (size_t k = 0; k < f.inputCount; ++k)
+      _lifecycle.input(k).data = _inputs[k].pixels;
+
+    func_main(ctx);
+    ctx.endFrame();
+
+    _output.pixels = _lifecycle.output().data;
+    for (float v : _output.pixels)
+      checksum += v;
+    ++_frame;
+    return setupNs;
+  }
+
+  const PluginLifecycle<SimPlugin, HostTexture> &lifecycle() const {
+    return _lifecycle;
+  }
+
+  const bool persistent;
+  double checksum = 0.0;
+
+private:
+  WorkerPool _pool{4};
+  std::vector<ResourceState> _internalResources;
+  std::vector<float *> _paramSlots;
+  bool _paramsMapped = false;
+  float _gain = 0.5f;
+  PluginLifecycle<SimPlugin, HostTexture> _lifecycle{*this};
+
+  HostTexture _output;
+  std::vector<HostTexture> _inputs;
+  std::vector<HostTexture *> _activeInputs;
+  size_t _frame = 0;
+};
+
+// Frame schedule: the viewport grows a third of the way in and a second
+// input is connected two thirds of the way in.
+HostFrame frameAt(int i, int frames) {
+  HostFrame f;
+  f.width = i < frames / 3 ? 64 : 96;
+  f.height = 64;
+  f.inputCount = i < 2 * frames / 3 ? 1 : 2;
+  f.time = static_cast<float>(i) / 60.0f;
+  f.gain = 0.25f + 0.5f * static_cast<float>(i % 4) / 4.0f;
+  return f;
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  std::string mode = argc > 1 ? argv[1] : "persistent";
+  if (mode != "persistent" && mode != "fresh") {
+    std::cerr << "{\"error\": \"Usage: host-simulator [persistent|fresh] "
+                 "[frames]\"}"
+              << std::endl;
+    return 1;
+  }
+  int frames = argc > 2 ? std::atoi(argv[2]) : 120;
+  if (frames < 3)
+    frames = 3;
+
+  SimPlugin plugin(mode == "persistent");
+  long long setupNs = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < frames; ++i)
+    setupNs += plugin.processFrame(frameAt(i, frames));
+  long long totalNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+          .count();
+
+  std::cout << "{\"mode\":\"" << mode << "\",\"frames\":" << frames
+            << ",\"contextsCreated\":" << plugin.lifecycle().contextsCreated
+            << ",\"rebinds\":" << plugin.lifecycle().rebinds
+            << ",\"patches\":" << plugin.lifecycle().patches
+            << ",\"setupNsPerFrame\":" << setupNs / frames
+            << ",\"frameNsPerFrame\":" << totalNs / frames
+            << ",\"checksum\":" << static_cast<long long>(std::llround(plugin.checksum))
+            << "}" << std::endl;
+  return 0;
+}
@@ -0,0 +1,490 @@
+// Intrinsics micro-benchmarks
+// Times the math helpers of intrinsics.incl.h (elem:: functions, std::array
+// operators, mat_mul, quat_*, _prng_hash) and the EvalContext operations
+// generated code calls (sampleTexture for every wrap/filter/stride
+// combination, copyTexture modes, blurTexture, convolveTexture,
+// resizeResource*, copyBuffer, scanBuffer, compactBuffer, sortBuffer,
+// reduceBuffer) on the CPU backend.
+//
+// Usage: intrinsics-bench [--quick] [--filter <substring>]
+//                         [--baseline <results.json>] [--tolerance <ratio>]
+//   --quick      short runs (tests, smoke checks)
+//   --filter     only benchmarks whose name contains <substring>
+//   --baseline   compare with the output of an earlier run; a benchmark
+//                slower than baseline * (1 + tolerance) is a regression
+//                (default tolerance 0.25)
+// Prints {"results":[{"name","nsPerOp","gbPerSec"}],"regressions":[...]}
+// and exits with status 2 if anything regressed.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "intrinsics.incl.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keep `value` (and the work that produced it) from being optimized away.
+template <typename T> inline void keep(T &value) {
+  asm volatile("" : "+m"(value) : : "memory");
+}
+
+struct Result {
+  std::string name;
+  double nsPerOp;
+  double bytesPerOp; // 0 for pure math
+};
+
+struct Options {
+  bool quick = false;
+  std::string filter;
+  std::string baselinePath;
+  double tolerance = 0.25;
+};
+
+class Runner {
+public:
+  explicit Runner(const Options &options) : options(options) {}
+
+  // Time `body`, which performs `opsPerCall` operations moving `bytesPerOp`
+  // bytes each. The iteration count is calibrated to a minimum run time and
+  // the best of several repetitions is kept.
+  void run(const std::string &name, size_t opsPerCall, double bytesPerOp,
+           const std::function<void()> &body) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+      return;
+    const auto minTime = options.quick ? std::chrono::microseconds(500)
+                                       : std::chrono::microseconds(40000);
+    const int repetitions = options.quick ? 2 : 5;
+    body(); // warm up caches and lazily sized state
+    size_t calls = 1;
+    for (;;) {
+      auto start = Clock::now();
+      for (size_t i = 0; i < calls; ++i)
+        body();
+      if (Clock::now() - start >= minTime || calls >= (size_t(1) << 30))
+        break;
+      calls *= 2;
+    }
+    double best = 1e300;
+    for (int r = 0; r < repetitions; ++r) {
+      auto start = Clock::now();
+      for (size_t i = 0; i < calls; ++i)
+        body();
+      double ns = static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                               start)
+              .count());
+      best = std::min(best, ns / static_cast<double>(calls * opsPerCall));
+    }
+    results.push_back({name, best, bytesPerOp});
+  }
+
+  std::vector<Result> results;
+
+private:
+  const Options &options;
+};
+
+// 1024 varied inputs, so results cannot be folded at compile time.
+template <size_t N> std::vector<std::array<float, N>> inputs(float lo, float hi) {
+  std::vector<std::array<float, N>> v(1024);
+  for (size_t i = 0; i < v.size(); ++i)
+    for (size_t k = 0; k < N; ++k)
+      v[i][k] = lo + (hi - lo) * _prng_hash_to_float(static_cast<int>(i * N + k));
+  return v;
+}
+
+const size_t kBatch = 1024;
+
+template <size_t N, typename F>
+void mathBench(Runner &runner, const std::string &name, float lo, float hi,
+               F fn) {
+  auto in = inputs<N>(lo, hi);
+  runner.run(name, kBatch, 0, [in, fn]() {
+    std::array<float, N> acc{};
+    for (const auto &x : in)
+      acc = acc + fn(x);
+    keep(acc);
+  });
+}
+
+void benchMath(Runner &r) {
+  using F4 = std::array<float, 4>;
+  using F3 = std::array<float, 3>;
+  mathBench<4>(r, "elem::abs/float4", -4, 4, [](const F4 &x) { return elem::abs(x); });
+  mathBench<4>(r, "elem::sin/float4", -4, 4, [](const F4 &x) { return elem::sin(x); });
+  mathBench<4>(r, "elem::cos/float4", -4, 4, [](const F4 &x) { return elem::cos(x); });
+  mathBench<4>(r, "elem::tan/float4", -1, 1, [](const F4 &x) { return elem::tan(x); });
+  mathBench<4>(r, "elem::atan/float4", -4, 4, [](const F4 &x) { return elem::atan(x); });
+  mathBench<4>(r, "elem::exp/float4", -4, 4, [](const F4 &x) { return elem::exp(x); });
+  mathBench<4>(r, "elem::log/float4", 0.1f, 8, [](const F4 &x) { return elem::log(x); });
+  mathBench<4>(r, "elem::sqrt/float4", 0, 8, [](const F4 &x) { return elem::sqrt(x); });
+  mathBench<4>(r, "elem::floor/float4", -8, 8, [](const F4 &x) { return elem::floor(x); });
+  mathBench<4>(r, "elem::pow/float4", 0.1f, 4, [](const F4 &x) { return elem::pow(x, x); });
+  mathBench<4>(r, "elem::fmod/float4", -8, 8, [](const F4 &x) { return elem::fmod(x, 1.5f); });
+  mathBench<4>(r, "elem::min/float4", -8, 8, [](const F4 &x) { return elem::min(x, 0.5f); });
+  mathBench<4>(r, "elem::atan2/float4", -4, 4,
+               [](const F4 &x) { return elem::atan2(x, F4{x[3], x[2], x[1], x[0]}); });
+
+  mathBench<4>(r, "operator+/float4", -4, 4, [](const F4 &x) { return x + x; });
+  mathBench<4>(r, "operator*/float4*scalar", -4, 4, [](const F4 &x) { return x * 1.5f; });
+  mathBench<4>(r, "operator//float4", 1, 4, [](const F4 &x) { return 1.0f / x; });
+  mathBench<4>(r, "operator-/unary-float4", -4, 4, [](const F4 &x) { return -x; });
+  mathBench<3>(r, "operator*/float3", -4, 4, [](const F3 &x) { return x * x; });
+  mathBench<3>(r, "normalize/float3", -4, 4, [](const F3 &x) { return normalize(x); });
+  mathBench<3>(r, "cross/float3", -4, 4,
+               [](const F3 &x) { return cross(x, F3{x[2], x[0], x[1]}); });
+
+  auto m3 = inputs<9>(-1, 1);
+  auto m4 = inputs<16>(-1, 1);
+  auto v4 = inputs<4>(-1, 1);
+  auto v3 = inputs<3>(-1, 1);
+  r.run("mat_mul/3x3*3x3", kBatch, 0, [&]() {
+    std::array<float, 9> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + mat_mul(m3[i], m3[(i + 1) % kBatch]);
+    keep(acc);
+  });
+  r.run("mat_mul/4x4*4x4", kBatch, 0, [&]() {
+    std::array<float, 16> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + mat_mul(m4[i], m4[(i + 1) % kBatch]);
+    keep(acc);
+  });
+  r.run("mat_mul/3x3*vec3", kBatch, 0, [&]() {
+    std::array<float, 3> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + mat_mul(m3[i], v3[i]);
+    keep(acc);
+  });
+  r.run("mat_mul/4x4*vec4", kBatch, 0, [&]() {
+    std::array<float, 4> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + mat_mul(m4[i], v4[i]);
+    keep(acc);
+  });
+  r.run("mat_mul/vec4*4x4", kBatch, 0, [&]() {
+    std::array<float, 4> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + mat_mul(v4[i], m4[i]);
+    keep(acc);
+  });
+  r.run("mat_transpose/4x4", kBatch, 0, [&]() {
+    std::array<float, 16> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + mat_transpose(m4[i]);
+    keep(acc);
+  });
+
+  std::vector<std::array<float, 4>> quats(kBatch);
+  for (size_t i = 0; i < kBatch; ++i)
+    quats[i] = normalize(v4[i]);
+  r.run("quat_mul", kBatch, 0, [&]() {
+    std::array<float, 4> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + quat_mul(quats[i], quats[(i + 1) % kBatch]);
+    keep(acc);
+  });
+  r.run("quat_rotate", kBatch, 0, [&]() {
+    std::array<float, 3> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + quat_rotate(quats[i], v3[i]);
+    keep(acc);
+  });
+  r.run("quat_slerp", kBatch, 0, [&]() {
+    std::array<float, 4> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + quat_slerp(quats[i], quats[(i + 1) % kBatch], 0.3f);
+    keep(acc);
+  });
+  r.run("quat_to_float4x4", kBatch, 0, [&]() {
+    std::array<float, 16> acc{};
+    for (size_t i = 0; i < kBatch; ++i)
+      acc = acc + quat_to_float4x4(quats[i]);
+    keep(acc);
+  });
+
+  r.run("_prng_hash", kBatch, 0, []() {
+    int acc = 0;
+    for (size_t i = 0; i < kBatch; ++i)
+      acc ^= _prng_hash(static_cast<int>(i) + acc);
+    keep(acc);
+  });
+  r.run("_prng_hash_to_float", kBatch, 0, []() {
+    float acc = 0.0f;
+    for (size_t i = 0; i < kBatch; ++i)
+      acc += _prng_hash_to_float(static_cast<int>(i));
+    keep(acc);
+  });
+}
+
+// CPU-backend context over resources owned by the benchmark.
+struct BenchContext {
+  std::vector<ResourceState> states;
+  EvalContext ctx;
+
+  void add(size_t width, size_t height, size_t floatsPerElement, bool texture) {
+    ResourceState s;
+    s.width = width;
+    s.height = height;
+    s.data.resize(width * height * floatsPerElement);
+    for (size_t i = 0; i < s.data.size(); ++i)
+      s.data[i] = _prng_hash_to_float(static_cast<int>(i));
+    states.push_back(std::move(s));
+    ctx.isTextureResource.push_back(texture);
+    ctx.texWidths.push_back(static_cast<int>(width));
+    ctx.texHeights.push_back(static_cast<int>(height));
+    ctx.texWrapModes.push_back(0);
+  }
+
+  // Call once all resources are added (the vector no longer reallocates).
+  void attach() {
+    ctx.resources.clear();
+    for (auto &s : states)
+      ctx.resources.push_back(&s);
+  }
+};
+
+void benchSampling(Runner &r) {
+  const size_t size = 256;
+  BenchContext b;
+  b.add(size, size, 1, true); // single-channel
+  b.add(size, size, 4, true); // RGBA
+  b.attach();
+  // Coordinates cover [-1, 2] so every wrap mode does work.
+  auto uv = inputs<2>(-1, 2);
+  const char *wraps[] = {"repeat", "clamp", "mirror"};
+  const char *filters[] = {"nearest", "linear"};
+  for (int wrap = 0; wrap < 3; ++wrap) {
+    for (int filter = 0; filter < 2; ++filter) {
+      for (int stride : {1, 4}) {
+        size_t res = stride == 1 ? 0 : 1;
+        double taps = filter == 0 ? 1 : 4;
+        std::string name = std::string("sampleTexture/") + wraps[wrap] + "/" +
+                           filters[filter] + "/stride" + std::to_string(stride);
+        r.run(name, kBatch, taps * stride * sizeof(float), [&, wrap, filter,
+                                                            stride, res]() {
+          std::array<float, 4> acc{};
+          for (const auto &c : uv)
+            acc = acc + b.ctx.sampleTexture(res, c[0], c[1], wrap, filter,
+                                            stride);
+          keep(acc);
+        });
+      }
+    }
+  }
+}
+
+void benchCopies(Runner &r) {
+  const int src = 256;
+  const int dst = 512;
+  BenchContext b;
+  b.add(src, src, 4, true);
+  b.add(src, src, 4, true);
+  b.add(dst, dst, 4, true);
+  const size_t bufferFloats = 1 << 20;
+  b.add(bufferFloats, 1, 1, false);
+  b.add(bufferFloats, 1, 1, false);
+  b.add(bufferFloats, 1, 1, false); // compaction flags, about half set
+  b.attach();
+  EvalContext &ctx = b.ctx;
+  for (float &f : b.states[5].data)
+    f = f < 0.5f ? 0.0f : 1.0f;
+
+  double srcBytes = static_cast<double>(src) * src * 4 * sizeof(float);
+  double dstBytes = static_cast<double>(dst) * dst * 4 * sizeof(float);
+  r.run("copyTexture/direct", 1, 2 * srcBytes, [&]() {
+    ctx.copyTexture(0, 1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1.0f, false);
+  });
+  r.run("copyTexture/alpha", 1, 3 * srcBytes, [&]() {
+    ctx.copyTexture(0, 1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0.5f, false);
+  });
+  r.run("copyTexture/nearest", 1, srcBytes + dstBytes, [&]() {
+    ctx.copyTexture(0, 2, -1, -1, -1, -1, -1, -1, -1, -1, 1, 1.0f, false);
+  });
+  r.run("copyTexture/bilinear", 1, srcBytes + dstBytes, [&]() {
+    ctx.copyTexture(0, 2, -1, -1, -1, -1, -1, -1, -1, -1, 2, 1.0f, false);
+  });
+  r.run("blurTexture/gaussian3", 1, 2 * srcBytes,
+        [&]() { ctx.blurTexture(0, 1, 3.0f, 0.0f, 0); });
+  r.run("blurTexture/gaussian8", 1, 2 * srcBytes,
+        [&]() { ctx.blurTexture(0, 1, 8.0f, 0.0f, 0); });
+  r.run("blurTexture/gaussian32", 1, 2 * srcBytes,
+        [&]() { ctx.blurTexture(0, 1, 32.0f, 0.0f, 0); });
+  r.run("blurTexture/box32", 1, 2 * srcBytes,
+        [&]() { ctx.blurTexture(0, 1, 32.0f, 0.0f, 1); });
+  // Both pad to 512x512, so they should cost about the same
+  r.run("convolveTexture/gaussian32", 1, 2 * srcBytes,
+        [&]() { ctx.convolveTexture(0, 1, -1, 32.0f, 0.0f, true); });
+  r.run("convolveTexture/gaussian128", 1, 2 * srcBytes,
+        [&]() { ctx.convolveTexture(0, 1, -1, 128.0f, 0.0f, true); });
+
+  double bufferBytes = static_cast<double>(bufferFloats) * sizeof(float);
+  r.run("copyBuffer/stride1", 1, 2 * bufferBytes,
+        [&]() { ctx.copyBuffer(3, 4, 1, 0, 0, -1); });
+  r.run("copyBuffer/stride4", 1, 2 * bufferBytes,
+        [&]() { ctx.copyBuffer(3, 4, 4, 0, 0, -1); });
+  r.run("scanBuffer/exclusive", 1, 2 * bufferBytes,
+        [&]() { ctx.scanBuffer(3, 4, 1, false, -1, -1, false); });
+  r.run("scanBuffer/float4", 1, 2 * bufferBytes,
+        [&]() { ctx.scanBuffer(3, 4, 4, true, -1, -1, false); });
+  r.run("compactBuffer/flags", 1, 2.5 * bufferBytes,
+        [&]() { ctx.compactBuffer(3, 5, 4, 1, 1, -1, false); });
+  r.run("compactBuffer/float4", 1, 1.75 * bufferBytes,
+        [&]() { ctx.compactBuffer(3, 5, 4, 4, 1, -1, false); });
+  r.run("sortBuffer/keys", 1, 2 * bufferBytes,
+        [&]() { ctx.sortBuffer(3, 4, 1, 0, -1, 1, false, -1); });
+  r.run("sortBuffer/float4", 1, 2 * bufferBytes,
+        [&]() { ctx.sortBuffer(3, 4, 4, 2, -1, 1, true, -1); });
+  r.run("reduceBuffer/sum", 1, bufferBytes, [&]() {
+    ctx.reduceBuffer(3, 4, 1, static_cast<int>(ReduceMode::Sum), -1, -1, 0,
+                     0.0f, 0.0f, false);
+  });
+  r.run("reduceBuffer/float4", 1, bufferBytes, [&]() {
+    ctx.reduceBuffer(3, 4, 4, static_cast<int>(ReduceMode::Max), -1, -1, 0,
+                     0.0f, 0.0f, false);
+  });
+  r.run("reduceBuffer/argmin", 1, bufferBytes, [&]() {
+    ctx.reduceBuffer(3, 4, 1, static_cast<int>(ReduceMode::ArgMin), 0, -1, 0,
+                     0.0f, 0.0f, false);
+  });
+  r.run("reduceBuffer/histogram", 1, bufferBytes, [&]() {
+    ctx.reduceBuffer(3, 4, 1, static_cast<int>(ReduceMode::Histogram), 0, -1,
+                     256, 0.0f, 1.0f, false);
+  });
+}
+
+void benchResize(Runner &r) {
+  BenchContext b;
+  b.add(1 << 16, 1, 1, false);
+  b.add(256, 256, 4, true);
+  b.add(256, 256, 4, true);
+  b.attach();
+  EvalContext &ctx = b.ctx;
+
+  // Each op alternates between two sizes, so every call reallocates or
+  // shrinks; bytes are those of the size written.
+  const int small = 1 << 16;
+  const int large = 1 << 17;
+  double avgBufferBytes = (small + large) / 2.0 * sizeof(float);
+  bool toggle = false;
+  r.run("resizeResource/keep", 1, avgBufferBytes, [&]() {
+    toggle = !toggle;
+    ctx.resizeResource(0, toggle ? large : small, 1, false);
+  });
+  r.run("resizeResource/clear", 1, avgBufferBytes, [&]() {
+    toggle = !toggle;
+    ctx.resizeResource(0, toggle ? large : small, 1, true);
+  });
+  double avgTexBytes = (256.0 * 256 + 512.0 * 512) / 2 * 4 * sizeof(float);
+  r.run("resizeResource2D/keep", 1, avgTexBytes, [&]() {
+    toggle = !toggle;
+    int s = toggle ? 512 : 256;
+    ctx.resizeResource2D(1, s, s, false);
+  });
+  r.run("resizeResource2DWithClear", 1, avgTexBytes, [&]() {
+    toggle = !toggle;
+    int s = toggle ? 512 : 256;
+    ctx.resizeResource2DWithClear(2, s, s, {0.25f, 0.5f, 0.75f, 1.0f});
+  });
+}
+
+// Baseline file: the JSON this program prints. Only name/nsPerOp pairs are
+// read.
+std::unordered_map<std::string, double> readBaseline(const std::string &path) {
+  std::unordered_map<std::string, double> baseline;
+  std::ifstream in(path);
+  if (!in)
+    return baseline;
+  std::string json((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  const std::string nameKey = "\"name\":\"";
+  const std::string nsKey = "\"nsPerOp\":";
+  size_t pos = 0;
+  while ((pos = json.find(nameKey, pos)) != std::string::npos) {
+    pos += nameKey.size();
+    size_t end = json.find('"', pos);
+    size_t ns = json.find(nsKey, end);
+    if (end == std::string::npos || ns == std::string::npos)
+      break;
+    baseline[json.substr(pos, end - pos)] =
+        std::strtod(json.c_str() + ns + nsKey.size(), nullptr);
+    pos = ns;
+  }
+  return baseline;
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--quick") {
+      options.quick = true;
+    } else if (arg == "--filter" && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else if (arg == "--baseline" && i + 1 < argc) {
+      options.baselinePath = argv[++i];
+    } else if (arg == "--tolerance" && i + 1 < argc) {
+      options.tolerance = std::atof(argv[++i]);
+    } else {
+      std::cerr << "{\"error\": \"Usage: intrinsics-bench [--quick] [--filter "
+                   "<substring>] [--baseline <results.json>] [--tolerance "
+                   "<ratio>]\"}"
+                << std::endl;
+      return 1;
+    }
+  }
+  std::unordered_map<std::string, double> baseline;
+  if (!options.baselinePath.empty()) {
+    baseline = readBaseline(options.baselinePath);
+    if (baseline.empty()) {
+      std::cerr << "{\"error\": \"No results in baseline "
+                << options.baselinePath << "\"}" << std::endl;
+      return 1;
+    }
+  }
+
+  Runner runner(options);
+  benchMath(runner);
+  benchSampling(runner);
+  benchCopies(runner);
+  benchResize(runner);
+
+  std::ostringstream regressions;
+  size_t regressionCount = 0;
+  std::cout << "{\"results\":[";
+  for (size_t i = 0; i < runner.results.size(); ++i) {
+    const Result &res = runner.results[i];
+    std::cout << (i ? "," : "") << "{\"name\":\"" << res.name
+              << "\",\"nsPerOp\":" << res.nsPerOp;
+    if (res.bytesPerOp > 0)
+      std::cout << ",\"gbPerSec\":" << res.bytesPerOp / res.nsPerOp;
+    std::cout << "}";
+    auto it = baseline.find(res.name);
+    if (it != baseline.end() &&
+        res.nsPerOp > it->second * (1.0 + options.tolerance)) {
+      regressions << (regressionCount++ ? "," : "") << "{\"name\":\""
+                  << res.name << "\",\"baselineNsPerOp\":" << it->second
+                  << ",\"nsPerOp\":" << res.nsPerOp << "}";
+      std::cerr << "REGRESSION " << res.name << ": " << res.nsPerOp
+                << " ns/op (baseline " << it->second << ")" << std::endl;
+    }
+  }
+  std::cout << "],\"regressions\":[" << regressions.str() << "]}"
+            << std::endl;
+  return regressionCount > 0 ? 2 : 0;
+}
@@ -1,4 +1,34 @@
 
+// Metal is only available when compiled as Objective-C++. Plain C++ builds
+// (runtime tests, host tools) run every command on the CPU backend.
+#ifndef NANO_HAS_METAL
+#if defined(__OBJC__)
+#define NANO_HAS_METAL 1
+#else
+#define NANO_HAS_METAL 0
+#endif
+#endif
+
+#include "action-log.h"
+#include "arg-arena.h"
+#include "buffer-reduce.h"
+#include "buffer-scan.h"
+#include "buffer-sort.h"
+#include "cpu-queue.h"
+#include "dispatch-budget.h"
+#include "frame-graph.h"
+#include "frame-pipeline.h"
+#include "hazard-tracker.h"
+#include "memory-planner.h"
+#include "node-profiler.h"
+#include "perf-counters.h"
+#include "pipeline-cache.h"
+#include "residency.h"
+#include "texture-blur.h"
+#include "texture-fft.h"
+#include "trace-recorder.h"
+#include "tuning-cache.h"
+
 // Bit-cast helpers for packing int32 into float32 storage (preserves bit pattern).
 // Used by atomic counters: CPU stores int bits as float, GPU reads via atomic_int*.
 inline float int_bits_to_float(int v) { float f; std::memcpy(&f, &v, 4); return f; }
@@ -487,9 +517,26 @@ struct ResourceState {
   size_t width = 0;
   size_t height = 0;
   bool isExternal = false;
+#if NANO_HAS_METAL
   id<MTLTexture> externalTexture = nil;
   id<MTLBuffer> retainedMetalBuffer = nil;   // Persistent GPU buffer across frames
   id<MTLTexture> retainedStagingTexture = nil; // Cached staging texture for external textures
+#endif
+
+  // Host memory accounting for `data`: the most storage it has held, and how
+  // often storeVec or a resize moved it to a new allocation.
+  size_t peakBytes = 0;
+  size_t reallocations = 0;
+
+  // Storage currently held by `data`
+  size_t bytes() const { return data.capacity() * sizeof(float); }
+
+  // Account for a change to `data`; `before` is data.data() from before it.
+  void noteStorage(const float *before) {
+    if (data.capacity() != 0 && data.data() != before)
+      ++reallocations;
+    peakBytes = std::max(peakBytes, bytes());
+  }
 
   // Store a vector at the given index (vec stored as contiguous floats)
   template <size_t N>
@@ -497,8 +544,11 @@ struct ResourceState {
     if (isExternal)
       return;
     size_t base = idx * N;
-    if (base + N > data.size())
+    if (base + N > data.size()) {
+      const float *before = data.data();
       data.resize(base + N);
+      noteStorage(before);
+    }
     for (size_t i = 0; i < N; ++i)
       data[base + i] = vec[i];
   }
@@ -506,7 +556,7 @@ struct ResourceState {
   // Load a vector from the given index
   template <size_t N> std::array<float, N> loadVec(size_t idx) const {
     if (isExternal)
-      return;
+      return {};
     std::array<float, N> result = {};
     size_t base = idx * N;
     for (size_t i = 0; i < N && base + i < data.size(); ++i) {
@@ -514,8 +564,207 @@ struct ResourceState {
     }
     return result;
   }
+
+  // Element access for generated CPU kernels. As on the GPU, out-of-range
+  // loads read 0 and out-of-range stores are dropped; nothing resizes `data`,
+  // so tiles of a dispatch may run concurrently.
+  float kernelLoad(int idx) const {
+    return idx >= 0 && static_cast<size_t>(idx) < data.size() ? data[idx]
+                                                               : 0.0f;
+  }
+  template <size_t N> std::array<float, N> kernelLoadVec(int idx) const {
+    std::array<float, N> result = {};
+    if (idx >= 0 && static_cast<size_t>(idx) < data.size() / N)
+      for (size_t i = 0; i < N; ++i)
+        result[i] = data[idx * N + i];
+    return result;
+  }
+  void kernelStore(int idx, float value) {
+    if (idx >= 0 && static_cast<size_t>(idx) < data.size())
+      data[idx] = value;
+  }
+  template <size_t N>
+  void kernelStoreVec(int idx, const std::array<float, N> &vec) {
+    if (idx >= 0 && static_cast<size_t>(idx) < data.size() / N)
+      for (size_t i = 0; i < N; ++i)
+        data[idx * N + i] = vec[i];
+  }
+
+  // Texel (x, y) of a texture with `stride` floats per texel (1 or 4).
+  std::array<float, 4> kernelTexel(int x, int y, int stride) const {
+    std::array<float, 4> result = {0, 0, 0, 1};
+    if (x < 0 || y < 0 || static_cast<size_t>(x) >= width ||
+        static_cast<size_t>(y) >= height)
+      return result;
+    size_t base = (static_cast<size_t>(y) * width + x) * stride;
+    for (int i = 0; i < stride && base + i < data.size(); ++i)
+      result[i] = data[base + i];
+    if (stride == 1)
+      result[1] = result[2] = result[0];
+    return result;
+  }
+  template <size_t N>
+  void kernelStoreTexel(int x, int y, const std::array<float, N> &value,
+                        int stride, bool unorm) {
+    if (x < 0 || y < 0 || static_cast<size_t>(x) >= width ||
+        static_cast<size_t>(y) >= height)
+      return;
+    size_t base = (static_cast<size_t>(y) * width + x) * stride;
+    for (size_t i = 0; i < N && static_cast<int>(i) < stride &&
+                       base + i < data.size();
+         ++i)
+      data[base + i] =
+          unorm ? std::max(0.0f, std::min(1.0f, value[i])) : value[i];
+  }
+  void kernelStoreTexel(int x, int y, float value, int stride, bool unorm) {
+    kernelStoreTexel(x, y, std::array<float, 1>{value}, stride, unorm);
+  }
+
+  // Atomic counter elements (int bits in float storage). Concurrent kernel
+  // tiles update them with compare-and-swap.
+  enum class AtomicOp { Add, Sub, Min, Max, Exchange };
+  int kernelAtomicLoad(int idx) const {
+    if (idx < 0 || static_cast<size_t>(idx) >= data.size())
+      return 0;
+    float value;
+    __atomic_load(&data[idx], &value, __ATOMIC_ACQUIRE);
+    return float_bits_to_int(value);
+  }
+  void kernelAtomicStore(int idx, int value) {
+    if (idx < 0 || static_cast<size_t>(idx) >= data.size())
+      return;
+    float bits = int_bits_to_float(value);
+    __atomic_store(&data[idx], &bits, __ATOMIC_RELEASE);
+  }
+  int kernelAtomic(int idx, AtomicOp op, int value) {
+    if (idx < 0 || static_cast<size_t>(idx) >= data.size())
+      return 0;
+    float expected;
+    __atomic_load(&data[idx], &expected, __ATOMIC_RELAXED);
+    for (;;) {
+      int old = float_bits_to_int(expected);
+      // Add and Sub wrap like GPU integer atomics
+      unsigned u = static_cast<unsigned>(old), v = static_cast<unsigned>(value);
+      int next = op == AtomicOp::Add   ? static_cast<int>(u + v)
+                 : op == AtomicOp::Sub ? static_cast<int>(u - v)
+                 : op == AtomicOp::Min ? std::min(old, value)
+                 : op == AtomicOp::Max ? std::max(old, value)
+                                       : value;
+      float desired = int_bits_to_float(next);
+      if (__atomic_compare_exchange(&data[idx], &expected, &desired, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return old;
+    }
+  }
+};
+
+// Sample a texture's host data at normalized (u, v). Does not sync the
+// resource, so generated CPU kernels may call it from worker threads.
+// wrapMode: 0=repeat, 1=clamp, 2=mirror
+// filterMode: 0=nearest, 1=linear
+// elemStride: number of floats per texel (1 for R32F, 4 for RGBA8)
+inline std::array<float, 4> sampleResource(const ResourceState &res, float u,
+                                           float v, int wrapMode,
+                                           int filterMode, int elemStride) {
+  int w = static_cast<int>(res.width);
+  int h = static_cast<int>(res.height);
+  if (w <= 0 || h <= 0)
+    return {0, 0, 0, 0};
+
+  auto applyWrap = [](float coord, int mode) -> float {
+    if (mode == 1) { // clamp
+      return std::max(0.0f, std::min(1.0f, coord));
+    } else if (mode == 2) { // mirror
+      float c = fmod(coord, 2.0f);
+      if (c < 0)
+        c += 2.0f;
+      return c > 1.0f ? 2.0f - c : c;
+    } else { // repeat
+      return coord - floorf(coord);
+    }
+  };
+
+  auto getSample = [&](int x, int y) -> std::array<float, 4> {
+    // Apply wrap in pixel space
+    if (wrapMode == 1) { // clamp
+      x = std::max(0, std::min(w - 1, x));
+      y = std::max(0, std::min(h - 1, y));
+    } else if (wrapMode == 0) { // repeat
+      x = ((x % w) + w) % w;
+      y = ((y % h) + h) % h;
+    } else if (wrapMode == 2) { // mirror
+      int mx = ((x % (2 * w)) + (2 * w)) % (2 * w);
+      x = mx >= w ? 2 * w - 1 - mx : mx;
+      int my = ((y % (2 * h)) + (2 * h)) % (2 * h);
+      y = my >= h ? 2 * h - 1 - my : my;
+    }
+    size_t idx = y * w + x;
+    std::array<float, 4> result = {0, 0, 0, 1};
+    size_t base = idx * elemStride;
+    for (int i = 0; i < elemStride && i < 4 && base + i < res.data.size();
+         ++i) {
+      result[i] = res.data[base + i];
+    }
+    // For single-channel textures, replicate to RGB
+    if (elemStride == 1) {
+      result[1] = result[0];
+      result[2] = result[0];
+      result[3] = 1.0f;
+    }
+    return result;
+  };
+
+  float wu = applyWrap(u, wrapMode);
+  float wv = applyWrap(v, wrapMode);
+
+  if (filterMode == 0) { // nearest
+    int x = std::min(static_cast<int>(wu * w), w - 1);
+    int y = std::min(static_cast<int>(wv * h), h - 1);
+    return getSample(x, y);
+  } else { // linear (bilinear)
+    float tx = wu * w - 0.5f;
+    float ty = wv * h - 0.5f;
+    int x0 = static_cast<int>(floorf(tx));
+    int y0 = static_cast<int>(floorf(ty));
+    float fx = tx - x0;
+    float fy = ty - y0;
+
+    auto s00 = getSample(x0, y0);
+    auto s10 = getSample(x0 + 1, y0);
+    auto s01 = getSample(x0, y0 + 1);
+    auto s11 = getSample(x0 + 1, y0 + 1);
+
+    std::array<float, 4> result;
+    for (int i = 0; i < 4; ++i) {
+      float r0 = s00[i] * (1 - fx) + s10[i] * fx;
+      float r1 = s01[i] * (1 - fx) + s11[i] * fx;
+      result[i] = r0 * (1 - fy) + r1 * fy;
+    }
+    return result;
+  }
+}
+
+struct EvalContext;
+
+// Grid region handed to a CPU kernel: [x0, x1) x [y0, y1) x [z0, z1).
+struct CpuTile {
+  int x0, y0, z0;
+  int x1, y1, z1;
 };
 
+// A dispatch as seen by a CPU kernel: the flattened shader args (same layout
+// as the Metal `inputs` buffer) and the full grid size.
+struct CpuDispatch {
+  const float *args;
+  size_t argCount;
+  int dimX, dimY, dimZ;
+};
+
+// Native implementation of a shader entry point for the CPU backend. Called
+// concurrently for disjoint tiles of the dispatch grid.
+using CpuKernel = std::function<void(EvalContext &ctx, const CpuDispatch &dispatch,
+                                     const CpuTile &tile)>;
+
 // Context passed to generated code - includes Metal dispatch support
 struct EvalContext {
   std::vector<ResourceState *> resources;
@@ -523,40 +772,707 @@ struct EvalContext {
   // IR global inputs (for input inheritance)
   std::unordered_map<std::string, float> inputs;
 
+  // CPU backend: shader entry points implemented natively, keyed by function
+  // name. Used when no Metal device is attached.
+  std::unordered_map<std::string, CpuKernel> cpuKernels;
+  // Shaders dispatched on the CPU backend without a kernel (skipped, so
+  // their outputs are wrong); hosts treat any as an error.
+  std::vector<std::string> missingCpuKernels;
+  // Pool for CPU kernels and concurrent frame-graph levels
+  // (nullptr = WorkerPool::shared()).
+  WorkerPool *workerPool = nullptr;
+
+  // Resources read and written by each shader entry point, declared by the
+  // generated declare_frame_graph(). Undeclared shaders are assumed to touch
+  // every resource.
+  struct ShaderAccess {
+    ResourceSet reads;
+    ResourceSet writes;
+  };
+  std::unordered_map<std::string, ShaderAccess> shaderAccess;
+
+  // Commands recorded between beginBatch() and submitBatch()
+  FrameGraph frameGraph;
+  bool batching = false;
+
+  // Transient resource aliasing (CPU backend). Owned by the host so the plan
+  // survives across frames; nullptr disables aliasing.
+  MemoryPlanner *memoryPlanner = nullptr;
+  std::vector<size_t> pendingReleases; // released once the batch has run
+
+  // Pipelined frames (CPU backend). Owned by the host, which drives a ring of
+  // contexts; nullptr runs each frame to completion in endFrame().
+  FramePipeline *framePipeline = nullptr;
+  std::vector<size_t> persistentResources;              // double-buffered
+  std::unordered_map<size_t, ResourceState> frameCopies; // this context's copies
+  FencePtr frameDone;           // this context's last submitted frame
+  bool inPipelinedFrame = false; // between beginFrame() and endFrame()
+  bool frameOnExecutor = false;  // frameGraph is owned by the pipeline
+
+  // Asynchronous CPU commands. Owned by the host (may be shared between
+  // contexts); nullptr runs unbatched CPU commands synchronously. Ignored in
+  // pipelined mode.
+  CpuQueue *cpuQueue = nullptr;
+  std::vector<FencePtr> queuedCommands; // not yet known to be finished
+
+  // Deadline and cancellation for CPU dispatches (checked between tile
+  // batches). Owned by the host; nullptr runs every dispatch to completion.
+  DispatchBudget *dispatchBudget = nullptr;
+
+  // Command timeline (Chrome trace). Owned by the host; nullptr records
+  // nothing, and -DNANO_TRACE=0 compiles the recording out.
+  TraceRecorder *trace = nullptr;
+
+  // Hardware counters per shader function and copy kind (perf-counters.h).
+  // Owned by the host; nullptr samples nothing.
+  PerfCounters *perf = nullptr;
+
+  // Scratch images for blurTexture, reused across frames
+  ScratchPool<std::vector<float>> blurScratch;
+  // Key/index pairs for sortBuffer, reused across frames
+  ScratchPool<SortScratch> sortScratch;
+  // Per-block counts for histogram reductions
+  ScratchPool<std::vector<uint32_t>> histogramScratch;
+  // Kernel spectra and transform buffers for convolveTexture
+  FftSpectrumCache fftSpectra;
+  ScratchPool<FftScratch> fftScratch;
+
+  ~EvalContext() {
+    if (frameDone)
+      frameDone->wait();
+    waitQueuedCommands();
+  }
+
+  void registerCpuKernel(const std::string &name, CpuKernel kernel) {
+    cpuKernels[name] = std::move(kernel);
+  }
+
+  void declareShaderAccess(const std::string &name, ResourceSet reads,
+                           ResourceSet writes) {
+    shaderAccess[name] = {std::move(reads), std::move(writes)};
+  }
+
+  void declareTransient(size_t idx, bool clear = false, float clearValue = 0.0f) {
+    if (memoryPlanner)
+      memoryPlanner->declareTransient(idx, clear, clearValue);
+  }
+
+  // Resource whose contents carry over between frames; double-buffered in
+  // pipelined mode.
+  void declarePersistent(size_t idx) {
+    if (std::find(persistentResources.begin(), persistentResources.end(),
+                  idx) == persistentResources.end())
+      persistentResources.push_back(idx);
+  }
+
+  bool usesCpuBackend() const {
+#if NANO_HAS_METAL
+    return device == nil;
+#else
+    return true;
+#endif
+  }
+
+  bool asyncCpu() const {
+    return cpuQueue && !framePipeline && usesCpuBackend();
+  }
+
+  WorkerPool &pool() { return workerPool ? *workerPool : WorkerPool::shared(); }
+
+  // Record the following commands into frameGraph instead of running them
+  // immediately. Only the CPU backend batches; the Metal queue already runs
+  // command buffers in submission order, and the async CPU queue schedules
+  // every command by its dependencies.
+  void beginBatch() {
+    if (usesCpuBackend() && !asyncCpu())
+      batching = true;
+  }
+
+  // Run everything recorded since beginBatch(); commands that touch disjoint
+  // resources run concurrently.
+  void submitBatch() {
+    // A pipelined frame is one batch, handed over in endFrame().
+    if (inPipelinedFrame)
+      return;
+    flushBatch();
+    batching = false;
+  }
+
+  // Run the recorded commands but keep recording (used before commands that
+  // must execute immediately, like resizes).
+  void flushBatch() {
+    if (!frameGraph.empty())
+      frameGraph.execute(pool());
+    for (size_t idx : pendingReleases)
+      memoryPlanner->release(idx, resources[idx]->data);
+    pendingReleases.clear();
+  }
+
+  // Transient lifetime tracking: call beginUse() before issuing a command
+  // that touches `touched` and endUse() after it. Transient resources borrow
+  // their slot storage at first use and return it after their last use
+  // (deferred until the batch runs when recording).
+  int beginUse(const ResourceSet &touched) {
+    if (!memoryPlanner || !usesCpuBackend() || framePipeline || cpuQueue)
+      return -1;
+    int cmd = memoryPlanner->beginCommand();
+    touched.forEach([&](size_t i) {
+      if (i >= resources.size() || !memoryPlanner->isTransient(i))
+        return;
+      memoryPlanner->recordUse(i, cmd);
+      if (!memoryPlanner->needsAcquire(i))
+        return;
+      if (batching && memoryPlanner->slotBusy(i))
+        flushBatch();
+      memoryPlanner->acquire(i, resources[i]->data);
+    });
+    return cmd;
+  }
+
+  void endUse(const ResourceSet &touched, int cmd) {
+    if (cmd < 0)
+      return;
+    touched.forEach([&](size_t i) {
+      if (i >= resources.size() || !memoryPlanner->isTransient(i) ||
+          !memoryPlanner->releasesAfter(i, cmd))
+        return;
+      if (batching)
+        pendingReleases.push_back(i);
+      else
+        memoryPlanner->release(i, resources[i]->data);
+    });
+  }
+
+  // Resizing a transient resource between its uses only records the new
+  // size; storage is sized when the resource next borrows its slot.
+  bool deferTransientResize(size_t idx, size_t floatCount, bool clearData) {
+    return memoryPlanner && usesCpuBackend() && !framePipeline && !cpuQueue &&
+           memoryPlanner->deferResize(idx, floatCount, clearData);
+  }
+
+  // Pipelined mode: start a frame on this context. Waits for the frame this
+  // context ran last (so the ring of contexts bounds latency), imports the
+  // fences of earlier frames, and points each persistent resource at this
+  // context's copy, seeded from the previous frame's copy once that frame
+  // has written it. The whole frame records into one batch.
+  void beginFrame() {
+    if (!framePipeline || !usesCpuBackend())
+      return;
+    if (frameDone) {
+      NANO_TRACE_SPAN(waitSpan, "wait", "host");
+      frameDone->wait();
+      frameDone = nullptr;
+    }
+    frameOnExecutor = false;
+    hazards = framePipeline->hazards;
+    for (size_t idx : persistentResources) {
+      if (idx >= resources.size())
+        continue;
+      ResourceState &copy = frameCopies[idx];
+      ResourceState *src = framePipeline->latestCopy(idx);
+      if (!src)
+        src = resources[idx];
+      resources[idx] = &copy;
+      FencePtr seed;
+      if (src != &copy) {
+        // The previous frame's seed may still be reading this copy.
+        if (FencePtr prevSeed = framePipeline->latestSeed(idx))
+          prevSeed->wait();
+        copy.width = src->width;
+        copy.height = src->height;
+        copy.isExternal = src->isExternal;
+        FencePtr writer = hazards.lastWriter(idx);
+        hazards.forget(idx);
+        if (!writer || writer->isDone()) {
+          copy.data = src->data;
+        } else {
+          seed = std::make_shared<Fence>();
+          hazards.recordAccess({}, {static_cast<int>(idx)}, seed);
+          ResourceState *to = &copy;
+          frameGraph.add(FrameOp::CopyBuffer, hashName("seed"), {},
+                         {static_cast<int>(idx)}, [src, to, writer, seed]() {
+                           writer->wait();
+                           to->data = src->data;
+                           seed->signal();
+                         });
+        }
+      }
+      framePipeline->setLatestCopy(idx, &copy, seed);
+    }
+    batching = true;
+    inPipelinedFrame = true;
+  }
+
+  // End of frame: run outstanding work and return transient storage to the
+  // planner's pool. Transient resources have no data until their next use.
+  void endFrame() {
+    if (inPipelinedFrame) {
+      // Hand the frame to the pipeline; the next frame's host logic runs
+      // while it executes.
+      inPipelinedFrame = false;
+      batching = false;
+      FencePtr done = std::make_shared<Fence>();
+      frameDone = done;
+      frameOnExecutor = true;
+      framePipeline->hazards = hazards;
+      residency.endFrame();
+      endArgFrame();
+      framePipeline->submit([this, done]() {
+        frameGraph.execute(pool());
+        done->signal();
+      });
+      return;
+    }
+    waitForPendingCommands();
+    residency.endFrame();
+    endArgFrame();
+    if (memoryPlanner && usesCpuBackend() && !cpuQueue)
+      memoryPlanner->endFrame(
+          [&](size_t i) -> std::vector<float> & { return resources[i]->data; });
+  }
+
+  // Hosts that keep one context across frames (the FFGL plugin, the host
+  // simulator) call beginHostFrame() at the start of every frame. Resource
+  // bindings, device copies, samplers and cached pipelines carry over; only
+  // per-frame outputs are cleared and external inputs are staged again.
+  void beginHostFrame() {
+    actionLog.flush();
+    returnValue.clear();
+    endArgFrame();
+    if (dispatchBudget)
+      dispatchBudget->beginFrame();
+#if NANO_HAS_METAL
+    externalInputsStaged = false;
+#endif
+  }
+
+  // Retire the argument blocks of the frame that just ended; they are
+  // reused once the commands reading them have completed.
+  void endArgFrame() {
+    hostArgs.endFrame();
+#if NANO_HAS_METAL
+    metalArgs.endFrame();
+#endif
+  }
+
+  // Drop all resource bindings before the host binds a different set (e.g.
+  // the number of inputs changed, which shifts the indices of internal
+  // resources). Outstanding work is finished and host writes are flushed to
+  // the retained buffers first; kernels, declared shader access and cached
+  // pipelines are kept.
+  void resetBindings() {
+    waitForPendingCommands();
+#if NANO_HAS_METAL
+    for (size_t i = 0; i < metalBuffers.size() && i < resources.size(); ++i)
+      if (metalBuffers[i] != nil && residency.hostDirty(i))
+        ensureResident(i);
+    metalBuffers.clear();
+    metalTextures.clear();
+    stagingTextures.clear();
+    metalSamplers.clear();
+    metalTransfer.sizes.clear();
+    externalInputsStaged = false;
+#endif
+    resources.clear();
+    isTextureResource.clear();
+    texWidths.clear();
+    texHeights.clear();
+    texWrapModes.clear();
+    hazards.clear();
+    residency.clear();
+  }
+
+  // The host resized or replaced the storage behind binding `idx` in place
+  // (e.g. a new output texture after a viewport resize): refresh its
+  // recorded size and drop its device copy.
+  void rebindResource(size_t idx) {
+    syncResourceForWrite(idx);
+    hazards.forget(idx);
+    if (idx < texWidths.size()) {
+      texWidths[idx] = static_cast<int>(resources[idx]->width);
+      texHeights[idx] = static_cast<int>(resources[idx]->height);
+    }
+#if NANO_HAS_METAL
+    invalidateDeviceCopy(idx);
+    if (idx < stagingTextures.size())
+      stagingTextures[idx] = nil;
+    externalInputsStaged = false;
+#endif
+  }
+
+  void accessFor(const char *funcName, ResourceSet &reads, ResourceSet &writes) {
+    auto it = shaderAccess.find(funcName);
+    if (it != shaderAccess.end()) {
+      reads = it->second.reads;
+      writes = it->second.writes;
+    } else {
+      reads = ResourceSet::all(resources.size());
+      writes = ResourceSet::all(resources.size());
+    }
+  }
+
+  // Texture support
+  std::vector<bool> isTextureResource;
+  std::vector<int> texWidths;
+  std::vector<int> texHeights;
+
+  // Sampler configuration per texture: 0=repeat, 1=clamp
+  std::vector<int> texWrapModes;
+
+#if NANO_HAS_METAL
   // Metal infrastructure
   id<MTLDevice> device = nil;
   id<MTLLibrary> library = nil;
   id<MTLCommandQueue> commandQueue = nil;
   std::unordered_map<std::string, id<MTLComputePipelineState>> pipelines;
+  // Render pipelines for draw(), keyed by functions, target format and load
+  // state
+  PipelineCache<id<MTLRenderPipelineState>> renderPipelines;
   std::vector<id<MTLBuffer>> metalBuffers;
-
-  // Texture support
-  std::vector<bool> isTextureResource;
-  std::vector<int> texWidths;
-  std::vector<int> texHeights;
   std::vector<id<MTLTexture>> metalTextures;
 
   // Staging textures: for external (IOSurface-backed) textures that may lack
   // MTLTextureUsageShaderWrite, we create internal staging textures with full
   // usage and blit results to the external texture after GPU work completes.
   std::vector<id<MTLTexture>> stagingTextures;
-
-  // Sampler configuration per texture: 0=repeat, 1=clamp
-  std::vector<int> texWrapModes;
   std::vector<id<MTLSamplerState>> metalSamplers;
 
-  // Deferred synchronization support
-  id<MTLCommandBuffer> pendingCmdBuffer = nil;
+  // Commit a command buffer and record its resource access; the returned
+  // fence is signalled from the completion handler. Written resources become
+  // device-dirty as a whole unless the caller marks the exact range. With a
+  // trace attached, the GPU execution is recorded as a "gpu" event named
+  // `name` / `target` (string literals or otherwise long-lived).
+  FencePtr commitTracked(id<MTLCommandBuffer> cmdBuffer, const char *name,
+                         const char *target, const ResourceSet &reads,
+                         const ResourceSet &writes, bool wholeWrites = true) {
+    FencePtr fence = std::make_shared<Fence>();
+    TraceRecorder *recorder = trace;
+    [cmdBuffer addCompletedHandler:^(id<MTLCommandBuffer> _Nonnull done) {
+#if NANO_TRACE
+      // GPU timestamps are host time in seconds on the mach_absolute_time
+      // base, which steady_clock also uses on Apple platforms.
+      if (recorder && done.GPUEndTime > 0)
+        recorder->record(name, "gpu", target,
+                         static_cast<uint64_t>(done.GPUStartTime * 1e9),
+                         static_cast<uint64_t>(done.GPUEndTime * 1e9), -1, 0);
+#else
+      (void)recorder;
+      (void)done;
+#endif
+      fence->signal();
+    }];
+    [cmdBuffer commit];
+    hazards.recordAccess(reads, writes, fence);
+    if (wholeWrites) {
+      writes.forEach([&](size_t i) {
+        if (i >= isTextureResource.size() || !isTextureResource[i])
+          residency.markDeviceDirty(i);
+      });
+    }
+    return fence;
+  }
+
+  // TransferDevice over the shared-storage Metal buffers of this context.
+  struct MetalBufferDevice : TransferDevice {
+    EvalContext &ctx;
+    std::vector<size_t> sizes; // logical byte size per resource
+
+    explicit MetalBufferDevice(EvalContext &c) : ctx(c) {}
+
+    size_t allocatedBytes(size_t idx) const override {
+      bool present = idx < ctx.metalBuffers.size() &&
+                     ctx.metalBuffers[idx] != nil && idx < sizes.size();
+      return present ? sizes[idx] : 0;
+    }
+
+    void allocate(size_t idx, const void *src, size_t bytes) override {
+      id<MTLBuffer> buffer =
+          bytes > 0 ? [ctx.device newBufferWithBytes:src
+                                              length:bytes
+                                             options:MTLResourceStorageModeShared]
+                    : [ctx.device newBufferWithLength:sizeof(float)
+                                              options:MTLResourceStorageModeShared];
+      adopt(idx, buffer, bytes);
+    }
+
+    // Make `buffer` the device copy of `idx` (and the resource's retained
+    // buffer) without transferring anything.
+    void adopt(size_t idx, id<MTLBuffer> buffer, size_t bytes) {
+      if (idx >= ctx.metalBuffers.size())
+        ctx.metalBuffers.resize(idx + 1, nil);
+      if (idx >= sizes.size())
+        sizes.resize(idx + 1, 0);
+      ctx.metalBuffers[idx] = buffer;
+      ctx.resources[idx]->retainedMetalBuffer = buffer;
+      sizes[idx] = bytes;
+    }
+
+    void upload(size_t idx, size_t offset, const void *src,
+                size_t bytes) override {
+      std::memcpy(static_cast<uint8_t *>([ctx.metalBuffers[idx] contents]) + offset,
+                  src, bytes);
+    }
+
+    void download(size_t idx, size_t offset, void *dst, size_t bytes) override {
+      std::memcpy(dst,
+                  static_cast<const uint8_t *>([ctx.metalBuffers[idx] contents]) +
+                      offset,
+                  bytes);
+    }
+  };
+  MetalBufferDevice metalTransfer{*this};
+
+  // Arena blocks backed by shared Metal buffers (bound with an offset).
+  struct MetalArenaStorage : ArenaStorage {
+    EvalContext &ctx;
+    std::vector<id<MTLBuffer>> buffers;
+
+    explicit MetalArenaStorage(EvalContext &c) : ctx(c) {}
+
+    void *createBlock(size_t index, size_t bytes) override {
+      if (index >= buffers.size())
+        buffers.resize(index + 1, nil);
+      buffers[index] = [ctx.device newBufferWithLength:bytes
+                                               options:MTLResourceStorageModeShared];
+      return [buffers[index] contents];
+    }
+  };
+  MetalArenaStorage metalArgStorage{*this};
+  // Dispatch/draw arguments (buffer offsets must be 256-byte aligned)
+  ArgArena metalArgs{metalArgStorage};
+
+  // One-float buffer bound where a shader expects a buffer but there is no
+  // data (empty args, texture slots); created once per context.
+  id<MTLBuffer> placeholderBuffer = nil;
+
+  id<MTLBuffer> placeholder() {
+    if (placeholderBuffer == nil)
+      placeholderBuffer = [device newBufferWithLength:sizeof(float)
+                                              options:MTLResourceStorageModeShared];
+    return placeholderBuffer;
+  }
+
+  // External input textures are copied into their staging textures once.
+  bool externalInputsStaged = false;
+#endif
+
+  // Host/device dirty ranges and bytes transferred per frame
+  ResidencyTracker residency;
+
+  // Arguments of commands recorded into a CPU batch
+  HostArenaStorage hostArgStorage;
+  ArgArena hostArgs{hostArgStorage, 16 * 1024, alignof(std::max_align_t)};
+
+  // Last-writer fences and host staleness per resource
+  HazardTracker hazards;
+  FencePool batchFences;
+  std::vector<size_t> staleScratch;
+
+  // Per-IR-node timings of generated code built with CppOptions.profile
+  NodeProfiler profiler;
+
+  // Host memory held by resource data, summed over `resources`.
+  struct MemoryStats {
+    size_t currentBytes = 0;
+    size_t peakBytes = 0; // most held at once after a resize or storeVec
+    size_t reallocations = 0;
+  };
+
+  MemoryStats memoryStats() const {
+    MemoryStats stats;
+    for (const ResourceState *res : resources) {
+      stats.currentBytes += res->bytes();
+      stats.reallocations += res->reallocations;
+    }
+    stats.peakBytes = std::max(peakResourceBytes, stats.currentBytes);
+    return stats;
+  }
+
+  size_t peakResourceBytes = 0;
+
+  // Account for a resize of resource `idx` whose data was at `before`.
+  void noteResize(size_t idx, const float *before) {
+    resources[idx]->noteStorage(before);
+    noteResourceBytes();
+  }
+
+  void noteResourceBytes() {
+    size_t total = 0;
+    for (const ResourceState *res : resources)
+      total += res->bytes();
+    peakResourceBytes = std::max(peakResourceBytes, total);
+  }
+
+  // Make the host copy of resource `idx` current: wait only for the work that
+  // writes it, and read back only this resource.
+  void syncResource(size_t idx) {
+    if (!hazards.isStale(idx))
+      return;
+    NANO_TRACE_SPAN(span, "sync", "host", "", static_cast<int>(idx));
+    FencePtr fence = hazards.lastWriter(idx);
+    if (fence && !fence->isDone()) {
+      NANO_TRACE_SPAN(waitSpan, "wait", "host", "", static_cast<int>(idx));
+      ++hazards.waits;
+      // Writers still recorded in a CPU batch run here (with what they
+      // depend on); the rest of the batch stays recorded.
+      if (!frameGraph.empty() && !frameOnExecutor)
+        frameGraph.executeFor(ResourceSet{static_cast<int>(idx)}, pool());
+      fence->wait();
+    }
+#if NANO_HAS_METAL
+    if (!usesCpuBackend() && !resources[idx]->isExternal) {
+      NANO_TRACE_BYTES(span, resources[idx]->data.size() * sizeof(float));
+      readbackResource(idx);
+      ++hazards.readbacks;
+    }
+#endif
+    hazards.markSynced(idx);
+  }
+
+  // Like syncResource, but also waits for outstanding reads of `idx`, so the
+  // host may overwrite it.
+  void syncResourceForWrite(size_t idx) {
+    syncResource(idx);
+    FencePtr fence = hazards.lastAccess(idx);
+    if (fence && !fence->isDone()) {
+      NANO_TRACE_SPAN(waitSpan, "wait", "host", "", static_cast<int>(idx));
+      ++hazards.waits;
+      if (!frameGraph.empty() && !frameOnExecutor) {
+        if (inPipelinedFrame)
+          frameGraph.executeFor(ResourceSet{static_cast<int>(idx)}, pool(),
+                                true);
+        else
+          flushBatch();
+      }
+      fence->wait();
+    }
+  }
+
+  // Fence for a deferred CPU command; the command signals it when it has
+  // run. In pipelined mode and on the async queue `after` receives the
+  // fences of earlier work the command must wait for (within a batch the
+  // schedule orders commands).
+  FencePtr recordBatched(const ResourceSet &reads, const ResourceSet &writes,
+                         std::vector<FencePtr> &after) {
+    if (framePipeline || asyncCpu()) {
+      auto add = [&](FencePtr f) {
+        if (f && !f->isDone())
+          after.push_back(std::move(f));
+      };
+      reads.forEach([&](size_t i) { add(hazards.lastWriter(i)); });
+      writes.forEach([&](size_t i) {
+        add(hazards.lastWriter(i));
+        add(hazards.lastAccess(i));
+      });
+    }
+    FencePtr fence = batchFences.acquire();
+    hazards.recordAccess(reads, writes, fence);
+    return fence;
+  }
+
+  static void waitAll(const std::vector<FencePtr> &fences) {
+    for (const auto &f : fences)
+      f->wait();
+  }
+
+  // Defer a CPU command that reads `reads` and writes `writes`: record it
+  // into the batch, or enqueue it on the async queue. Returns its fence, or
+  // nullptr if the command must run now (`work` is then not stored, so an
+  // immediate command does not allocate).
+  template <typename Work>
+  FencePtr deferCpu(FrameOp op, uint64_t key, ResourceSet reads,
+                    ResourceSet writes, Work work) {
+    if (!batching && !asyncCpu())
+      return nullptr;
+    std::vector<FencePtr> after;
+    FencePtr fence = recordBatched(reads, writes, after);
+    if (batching) {
+      frameGraph.add(op, key, std::move(reads), std::move(writes),
+                     [after = std::move(after), work = std::move(work),
+                      fence]() {
+                       waitAll(after);
+                       work();
+                       fence->signal();
+                     });
+      return fence;
+    }
+    // Forget finished commands so the list stays short.
+    if (queuedCommands.size() >= 64)
+      queuedCommands.erase(
+          std::remove_if(queuedCommands.begin(), queuedCommands.end(),
+                         [](const FencePtr &f) { return f->isDone(); }),
+          queuedCommands.end());
+    queuedCommands.push_back(fence);
+    cpuQueue->submit(std::move(after), [work = std::move(work), fence]() {
+      work();
+      fence->signal();
+    });
+    return fence;
+  }
+
+  // Wait for every command this context enqueued on the async queue.
+  void waitQueuedCommands() {
+    for (const auto &f : queuedCommands)
+      f->wait();
+    queuedCommands.clear();
+  }
+
+  // Commands recorded before a resize of `idx` must run first. In a
+  // pipelined frame or on the async queue only those touching `idx` (and
+  // earlier frames' access) are waited for.
+  void prepareResize(size_t idx) {
+    if (inPipelinedFrame || asyncCpu())
+      syncResourceForWrite(idx);
+    else if (batching)
+      flushBatch();
+  }
+
+  // Host access to resource data (used by generated CPU code).
+  std::vector<float> &hostData(size_t idx) {
+    syncResource(idx);
+    return resources[idx]->data;
+  }
+
+  // Host write of element `k` of resource `idx` (marks only that element
+  // for upload).
+  float &hostElementForWrite(size_t idx, size_t k) {
+    syncResourceForWrite(idx);
+    if (!usesCpuBackend())
+      residency.markHostDirty(idx, k * sizeof(float), (k + 1) * sizeof(float));
+    return resources[idx]->data[k];
+  }
+  template <size_t N>
+  void hostStoreVec(size_t idx, size_t k, const std::array<float, N> &vec) {
+    syncResourceForWrite(idx);
+    if (!usesCpuBackend())
+      residency.markHostDirty(idx, k * N * sizeof(float),
+                              (k + 1) * N * sizeof(float));
+    ResourceState *res = resources[idx];
+    size_t capacity = res->data.capacity();
+    res->storeVec(k, vec);
+    if (res->data.capacity() != capacity)
+      noteResourceBytes();
+  }
 
   void waitForPendingCommands() {
-    if (pendingCmdBuffer) {
-      [pendingCmdBuffer waitUntilCompleted];
-      pendingCmdBuffer = nil;
+    NANO_TRACE_SPAN(span, "wait", "host");
+    if (frameDone) {
+      frameDone->wait();
+      frameOnExecutor = false;
     }
+    submitBatch();
+    waitQueuedCommands();
+    hazards.staleResources(staleScratch);
+    for (size_t idx : staleScratch)
+      if (idx < resources.size())
+        syncResource(idx);
+#if NANO_HAS_METAL
     blitStagingToExternal();
-    syncFromMetal();
+#endif
   }
 
+#if NANO_HAS_METAL
+
   // Copy staging texture contents to external (IOSurface-backed) textures.
   // This is needed because IOSurface textures may lack ShaderWrite usage,
   // so we render into a staging texture and blit the result.
@@ -593,19 +1509,16 @@ struct EvalContext {
     [cmdBuffer commit];
     [cmdBuffer waitUntilScheduled];
   }
+#endif
 
   ResourceState *getResource(size_t idx) {
     return idx < resources.size() ? resources[idx] : nullptr;
   }
 
-  // Action log (resize, dispatch, etc.)
-  struct LogAction {
-    std::string type;
-    std::string target;
-    int width = 0;
-    int height = 0;
-  };
-  std::vector<LogAction> actionLog;
+  // Actions of the current frame (resizes), in a fixed-capacity ring.
+  // Hosts that keep them set a drain with actionLog.setDrain();
+  // beginHostFrame() flushes the log.
+  ActionLog actionLog;
 
   // Return value storage (for func_return)
   std::vector<float> returnValue;
@@ -623,6 +1536,8 @@ struct EvalContext {
   }
 
   void resizeResource(size_t idx, int newSize, int stride, bool clearData) {
+    NANO_TRACE_SPAN(span, "resize", "host", "", static_cast<int>(idx));
+    prepareResize(idx);
     if (idx < resources.size()) {
       auto *res = resources[idx];
       if (res->isExternal)
@@ -632,29 +1547,39 @@ struct EvalContext {
       size_t totalFloats =
           static_cast<size_t>(newSize) * static_cast<size_t>(stride);
       size_t newByteSize = totalFloats * sizeof(float);
+      NANO_TRACE_BYTES(span, newByteSize);
+      if (deferTransientResize(idx, totalFloats, clearData)) {
+        actionLog.push(ActionOp::Resize, static_cast<int>(idx), newSize, 1);
+        return;
+      }
 
+#if NANO_HAS_METAL
       // GPU-to-GPU buffer copy when a retained GPU buffer exists
       if (res->retainedMetalBuffer != nil && device != nil) {
-        id<MTLBuffer> newBuffer = resizeGpuBuffer(res->retainedMetalBuffer, newByteSize, clearData);
-        res->retainedMetalBuffer = newBuffer;
-        if (!metalBuffers.empty() && idx < metalBuffers.size()) {
-          metalBuffers[idx] = newBuffer;
-        }
+        id<MTLBuffer> newBuffer = resizeGpuBuffer(idx, res->retainedMetalBuffer, newByteSize, clearData);
+        metalTransfer.adopt(idx, newBuffer, newByteSize);
       } else {
-        metalBuffers.clear(); // Force syncToMetal() on next dispatch
+        invalidateDeviceCopy(idx); // Recreated on next syncToMetal()
       }
+#else
+      (void)newByteSize;
+#endif
 
-      // Always keep CPU data sized correctly (for metadata, syncFromMetal)
+      // Always keep CPU data sized correctly (for metadata, readbackResource)
+      const float *before = res->data.data();
       if (clearData) {
         res->data.assign(totalFloats, 0.0f);
       } else {
         res->data.resize(totalFloats, 0.0f);
       }
-      actionLog.push_back({"resize", "", newSize, 1});
+      noteResize(idx, before);
+      actionLog.push(ActionOp::Resize, static_cast<int>(idx), newSize, 1);
     }
   }
 
   void resizeResource2D(size_t idx, int w, int h, bool clearData) {
+    NANO_TRACE_SPAN(span, "resize", "host", "", static_cast<int>(idx));
+    prepareResize(idx);
     if (idx < resources.size()) {
       auto *res = resources[idx];
       if (res->isExternal)
@@ -667,30 +1592,42 @@ struct EvalContext {
       if (isTex)
         total *= 4;
       size_t newByteSize = total * sizeof(float);
+      NANO_TRACE_BYTES(span, newByteSize);
+      if (deferTransientResize(idx, total, clearData)) {
+        actionLog.push(ActionOp::Resize, static_cast<int>(idx), w, h);
+        return;
+      }
 
+#if NANO_HAS_METAL
       // GPU-to-GPU buffer copy when a retained GPU buffer exists
       if (res->retainedMetalBuffer != nil && device != nil) {
-        id<MTLBuffer> newBuffer = resizeGpuBuffer(res->retainedMetalBuffer, newByteSize, clearData);
-        res->retainedMetalBuffer = newBuffer;
-        if (!metalBuffers.empty() && idx < metalBuffers.size()) {
-          metalBuffers[idx] = newBuffer;
-        }
+        id<MTLBuffer> newBuffer = resizeGpuBuffer(idx, res->retainedMetalBuffer, newByteSize, clearData);
+        metalTransfer.adopt(idx, newBuffer, newByteSize);
       } else {
-        metalBuffers.clear(); // Force syncToMetal() on next dispatch
+        invalidateDeviceCopy(idx); // Recreated on next syncToMetal()
       }
+#else
+      (void)newByteSize;
+#endif
 
-      // Always keep CPU data sized correctly (for metadata, syncFromMetal)
+      // Always keep CPU data sized correctly (for metadata, readbackResource)
+      const float *before = res->data.data();
       if (clearData) {
         res->data.assign(total, 0.0f);
       } else {
         res->data.resize(total, 0.0f);
       }
-      actionLog.push_back({"resize", "", w, h});
+      noteResize(idx, before);
+      actionLog.push(ActionOp::Resize, static_cast<int>(idx), w, h);
     }
   }
 
   void resizeResource2DWithClear(size_t idx, int w, int h,
                                  std::initializer_list<float> clearVal) {
+    NANO_TRACE_SPAN(span, "resize", "host", "", static_cast<int>(idx));
+    prepareResize(idx);
+    ResourceSet touched{static_cast<int>(idx)};
+    int use = beginUse(touched);
     if (idx < resources.size()) {
       auto *res = resources[idx];
       res->width = static_cast<size_t>(w);
@@ -702,13 +1639,17 @@ struct EvalContext {
       // Pad pattern to elemSize if needed
       while (pattern.size() < elemSize)
         pattern.push_back(0.0f);
+      const float *before = res->data.data();
       res->data.resize(total * elemSize);
+      noteResize(idx, before);
+      NANO_TRACE_BYTES(span, res->data.size() * sizeof(float));
       for (size_t i = 0; i < total; ++i) {
         for (size_t j = 0; j < elemSize && j < pattern.size(); ++j) {
           res->data[i * elemSize + j] = pattern[j];
         }
       }
 
+#if NANO_HAS_METAL
       // CPU pattern data is authoritative — upload from CPU
       if (res->retainedMetalBuffer != nil && device != nil) {
         size_t byteSize = res->data.size() * sizeof(float);
@@ -716,27 +1657,29 @@ struct EvalContext {
             [device newBufferWithBytes:res->data.data()
                                 length:std::max(byteSize, (size_t)sizeof(float))
                                options:MTLResourceStorageModeShared];
-        res->retainedMetalBuffer = newBuffer;
-        if (!metalBuffers.empty() && idx < metalBuffers.size()) {
-          metalBuffers[idx] = newBuffer;
-        }
+        metalTransfer.adopt(idx, newBuffer, byteSize);
+        residency.countUpload(byteSize);
       } else {
-        metalBuffers.clear(); // Force syncToMetal() on next dispatch
+        invalidateDeviceCopy(idx); // Recreated on next syncToMetal()
       }
-      actionLog.push_back({"resize", "", w, h});
+#endif
+      actionLog.push(ActionOp::Resize, static_cast<int>(idx), w, h);
     }
+    endUse(touched, use);
   }
 
   // Copy elements between buffers. stride = floats per typed element.
   // count = -1 means copy as many as fit.
   void copyBuffer(size_t srcIdx, size_t dstIdx, int stride, int srcOffset, int dstOffset, int count) {
     if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
-    auto *srcRes = resources[srcIdx];
-    auto *dstRes = resources[dstIdx];
+    NANO_TRACE_SPAN(span, "copyBuffer", "host", "", static_cast<int>(dstIdx));
 
+#if NANO_HAS_METAL
     // GPU path: use Metal blit when Metal buffers exist
-    if (!metalBuffers.empty() && srcIdx < metalBuffers.size() && dstIdx < metalBuffers.size()
+    if (!usesCpuBackend() && srcIdx < metalBuffers.size() && dstIdx < metalBuffers.size()
         && metalBuffers[srcIdx] != nil && metalBuffers[dstIdx] != nil) {
+      ensureResident(srcIdx);
+      ensureResident(dstIdx);
       int srcElems = static_cast<int>(metalBuffers[srcIdx].length / (stride * sizeof(float)));
       int dstElems = static_cast<int>(metalBuffers[dstIdx].length / (stride * sizeof(float)));
       int maxFromSrc = srcElems - srcOffset;
@@ -747,17 +1690,35 @@ struct EvalContext {
       size_t srcByteOff = srcOffset * stride * sizeof(float);
       size_t dstByteOff = dstOffset * stride * sizeof(float);
       size_t byteCount = actualCount * stride * sizeof(float);
+      NANO_TRACE_BYTES(span, byteCount);
       id<MTLCommandBuffer> cmdBuf = [commandQueue commandBuffer];
       id<MTLBlitCommandEncoder> blit = [cmdBuf blitCommandEncoder];
       [blit copyFromBuffer:metalBuffers[srcIdx] sourceOffset:srcByteOff
                   toBuffer:metalBuffers[dstIdx] destinationOffset:dstByteOff size:byteCount];
       [blit endEncoding];
-      [cmdBuf commit];
-      pendingCmdBuffer = cmdBuf;
+      commitTracked(cmdBuf, "copyBuffer", "", {static_cast<int>(srcIdx)},
+                    {static_cast<int>(dstIdx)},
+                    false);
+      residency.markDeviceDirty(dstIdx, dstByteOff, dstByteOff + byteCount);
       return;
     }
+#endif
+
+    ResourceSet touched{static_cast<int>(srcIdx), static_cast<int>(dstIdx)};
+    int use = beginUse(touched);
+    if (!deferCpu(FrameOp::CopyBuffer, 0, {static_cast<int>(srcIdx)},
+                  {static_cast<int>(dstIdx)}, [=]() {
+                    copyBufferCpu(srcIdx, dstIdx, stride, srcOffset, dstOffset,
+                                  count);
+                  }))
+      copyBufferCpu(srcIdx, dstIdx, stride, srcOffset, dstOffset, count);
+    endUse(touched, use);
+  }
 
-    // CPU fallback
+  void copyBufferCpu(size_t srcIdx, size_t dstIdx, int stride, int srcOffset,
+                     int dstOffset, int count) {
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
     int srcElems = static_cast<int>(srcRes->data.size()) / stride;
     int dstElems = static_cast<int>(dstRes->data.size()) / stride;
     int maxFromSrc = srcElems - srcOffset;
@@ -765,6 +1726,10 @@ struct EvalContext {
     int actualCount = std::min(maxFromSrc, maxToDst);
     if (count >= 0) actualCount = std::min(actualCount, count);
     if (actualCount <= 0) return;
+    NANO_TRACE_SPAN(span, "copyBuffer", "exec", "", static_cast<int>(dstIdx),
+                    static_cast<size_t>(actualCount) * stride * sizeof(float));
+    PerfCounters::Command counted(perf, "copyBuffer", NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
     for (int i = 0; i < actualCount; i++) {
       for (int j = 0; j < stride; j++) {
         dstRes->data[(dstOffset + i) * stride + j] = srcRes->data[(srcOffset + i) * stride + j];
@@ -772,6 +1737,7 @@ struct EvalContext {
     }
   }
 
+#if NANO_HAS_METAL
   // Sync a single Metal texture's data into the resource's CPU data vector.
   void syncTextureToData(size_t idx) {
     if (idx >= metalTextures.size() || metalTextures[idx] == nil) return;
@@ -791,6 +1757,16 @@ struct EvalContext {
     }
   }
 
+  // Host copy of texture `idx` for a texture op run on the CPU, after
+  // syncResource. External inputs are restaged every frame and never read
+  // back by syncResource, so they are always read here; other textures only
+  // when their host copy was never populated.
+  void syncTextureForHost(size_t idx) {
+    auto *res = resources[idx];
+    if (res->isExternal || res->data.size() < res->width * res->height * 4)
+      syncTextureToData(idx);
+  }
+
   // Sync a single resource's CPU data vector back to its Metal texture.
   void syncDataToTexture(size_t idx) {
     if (idx >= metalTextures.size() || metalTextures[idx] == nil) return;
@@ -810,6 +1786,7 @@ struct EvalContext {
                             withBytes:bytes.data()
                           bytesPerRow:w * 4];
   }
+#endif
 
   // Copy/blit pixels between textures.
   // sampleMode: 0=direct, 1=nearest, 2=bilinear
@@ -819,6 +1796,7 @@ struct EvalContext {
                    float dx, float dy, float dw, float dh,
                    int sampleMode, float alpha, bool normalized) {
     if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    NANO_TRACE_SPAN(span, "copyTexture", "host", "", static_cast<int>(dstIdx));
     auto *srcRes = resources[srcIdx];
     auto *dstRes = resources[dstIdx];
     int srcW = static_cast<int>(srcRes->width);
@@ -850,7 +1828,11 @@ struct EvalContext {
     }
 
     if (alpha <= 0.0f) return;
+    NANO_TRACE_BYTES(span, static_cast<size_t>(std::max(idw, 0)) *
+                               static_cast<size_t>(std::max(idh, 0)) * 4 *
+                               sizeof(float));
 
+#if NANO_HAS_METAL
     bool isSimpleCopy = (isw == idw && ish == idh && alpha >= 1.0f && sampleMode == 0);
 
     // GPU path: simple copy via Metal blit (no scaling, no alpha)
@@ -868,20 +1850,64 @@ struct EvalContext {
                   toTexture:metalTextures[dstIdx] destinationSlice:0 destinationLevel:0
            destinationOrigin:MTLOriginMake(idx_, idy, 0)];
       [blit endEncoding];
-      [cmdBuf commit];
-      pendingCmdBuffer = cmdBuf;
+      commitTracked(cmdBuf, "copyTexture", "", {static_cast<int>(srcIdx)},
+                    {static_cast<int>(dstIdx)});
       return;
     }
 
-    // Complex case with Metal textures: wait for GPU, sync textures to CPU, do CPU copy, sync back
+    // Complex case with Metal textures: wait for the work touching src/dst,
+    // sync them to CPU, do CPU copy, sync back
     if (!isSimpleCopy && !metalTextures.empty()
         && srcIdx < metalTextures.size() && dstIdx < metalTextures.size()
         && metalTextures[srcIdx] != nil && metalTextures[dstIdx] != nil) {
-      if (pendingCmdBuffer) { [pendingCmdBuffer waitUntilCompleted]; pendingCmdBuffer = nil; }
-      syncTextureToData(srcIdx);
-      syncTextureToData(dstIdx);
+      syncResource(srcIdx);
+      syncResourceForWrite(dstIdx);
+      syncTextureForHost(srcIdx);
+      syncTextureForHost(dstIdx);
       // Fall through to CPU sampling/compositing code below, then sync back
     }
+#endif
+
+    ResourceSet touched{static_cast<int>(srcIdx), static_cast<int>(dstIdx)};
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::CopyTexture, 0, {static_cast<int>(srcIdx)},
+                 {static_cast<int>(dstIdx)}, [=]() {
+                   copyTextureCpu(srcIdx, dstIdx, isx, isy, isw, ish, idx_,
+                                  idy, idw, idh, sampleMode, alpha);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    copyTextureCpu(srcIdx, dstIdx, isx, isy, isw, ish, idx_, idy, idw, idh,
+                   sampleMode, alpha);
+    endUse(touched, use);
+
+#if NANO_HAS_METAL
+    // If we synced from Metal textures for complex copy, write result back
+    if (!isSimpleCopy && !metalTextures.empty()
+        && dstIdx < metalTextures.size() && metalTextures[dstIdx] != nil) {
+      syncDataToTexture(dstIdx);
+    }
+#endif
+  }
+
+  // CPU sampling/compositing for copyTexture, on resolved pixel rects.
+  void copyTextureCpu(size_t srcIdx, size_t dstIdx, int isx, int isy, int isw,
+                      int ish, int idx_, int idy, int idw, int idh,
+                      int sampleMode, float alpha) {
+    NANO_TRACE_SPAN(span, "copyTexture", "exec", "", static_cast<int>(dstIdx),
+                    static_cast<size_t>(std::max(idw, 0)) *
+                        static_cast<size_t>(std::max(idh, 0)) * 4 *
+                        sizeof(float));
+    PerfCounters::Command counted(perf, "copyTexture",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    int srcW = static_cast<int>(srcRes->width);
+    int srcH = static_cast<int>(srcRes->height);
+    int dstW = static_cast<int>(dstRes->width);
+    int dstH = static_cast<int>(dstRes->height);
 
     auto getSrcPixel = [&](int px, int py) -> std::array<float, 4> {
       int cx = std::max(0, std::min(srcW - 1, px));
@@ -956,12 +1982,518 @@ struct EvalContext {
         }
       }
     }
+  }
 
-    // If we synced from Metal textures for complex copy, write result back
-    if (!isSimpleCopy && !metalTextures.empty()
-        && dstIdx < metalTextures.size() && metalTextures[dstIdx] != nil) {
+  // Separable blur of a whole texture into another of the same size (or in
+  // place). mode: 0=gaussian, 1=box. radius in texels; sigma <= 0 means
+  // radius / 3. Edges follow the source's wrap mode. See texture-blur.h.
+  void blurTexture(size_t srcIdx, size_t dstIdx, float radius, float sigma,
+                   int mode) {
+    if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    NANO_TRACE_SPAN(span, "blurTexture", "host", "", static_cast<int>(dstIdx));
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    if (srcRes->width != dstRes->width || srcRes->height != dstRes->height) {
+      std::cerr << "blurTexture: source is " << srcRes->width << "x"
+                << srcRes->height << ", destination is " << dstRes->width
+                << "x" << dstRes->height << std::endl;
+      return;
+    }
+    int r = static_cast<int>(std::lround(std::max(0.0f, radius)));
+    NANO_TRACE_BYTES(span, srcRes->width * srcRes->height * 4 * sizeof(float));
+
+#if NANO_HAS_METAL
+    // Metal textures: wait for the work touching src/dst, blur on the CPU
+    // and sync back
+    bool onMetal = !metalTextures.empty() && srcIdx < metalTextures.size() &&
+                   dstIdx < metalTextures.size() &&
+                   metalTextures[srcIdx] != nil && metalTextures[dstIdx] != nil;
+    if (onMetal) {
+      syncResource(srcIdx);
+      syncResourceForWrite(dstIdx);
+      syncTextureForHost(srcIdx);
+    }
+#endif
+
+    ResourceSet touched{static_cast<int>(srcIdx), static_cast<int>(dstIdx)};
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::BlurTexture, 0, {static_cast<int>(srcIdx)},
+                 {static_cast<int>(dstIdx)}, [=]() {
+                   blurTextureCpu(srcIdx, dstIdx, r, sigma, mode);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    blurTextureCpu(srcIdx, dstIdx, r, sigma, mode);
+    endUse(touched, use);
+
+#if NANO_HAS_METAL
+    if (onMetal)
+      syncDataToTexture(dstIdx);
+#endif
+  }
+
+  void blurTextureCpu(size_t srcIdx, size_t dstIdx, int radius, float sigma,
+                      int mode) {
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    int w = static_cast<int>(srcRes->width);
+    int h = static_cast<int>(srcRes->height);
+    size_t floats = static_cast<size_t>(w) * h * 4;
+    NANO_TRACE_SPAN(span, "blurTexture", "exec", "", static_cast<int>(dstIdx),
+                    floats * sizeof(float));
+    PerfCounters::Command counted(perf, "blurTexture",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    if (srcRes->data.size() < floats)
+      return;
+    if (dstRes->data.size() < floats)
+      dstRes->data.resize(floats, 0.0f);
+    int wrapMode = srcIdx < texWrapModes.size() ? texWrapModes[srcIdx] : 0;
+    auto scratch = blurScratch.acquire();
+    if (scratch->size() < floats)
+      scratch->resize(floats);
+    blurRgba(srcRes->data.data(), dstRes->data.data(), scratch->data(), w, h,
+             mode == 1 ? BlurMode::Box : BlurMode::Gaussian, radius, sigma,
+             wrapMode, pool());
+    blurScratch.release(std::move(scratch));
+  }
+
+  // Convolve a whole texture with a large kernel into another of the same
+  // size (or in place), through FFTs. kernelIdx >= 0 is a texture whose
+  // first channel is the kernel, centred on its middle texel; otherwise a
+  // Gaussian of radius texels (sigma <= 0 means radius / 3). normalize
+  // scales the kernel to sum to 1. Edges follow the source's wrap mode.
+  // Kernel spectra are cached, so the cost depends on the padded image size
+  // rather than the kernel's. See texture-fft.h.
+  void convolveTexture(size_t srcIdx, size_t dstIdx, int kernelIdx,
+                       float radius, float sigma, bool normalize) {
+    if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    if (kernelIdx >= static_cast<int>(resources.size())) return;
+    NANO_TRACE_SPAN(span, "convolveTexture", "host", "",
+                    static_cast<int>(dstIdx));
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    if (srcRes->width != dstRes->width || srcRes->height != dstRes->height) {
+      std::cerr << "convolveTexture: source is " << srcRes->width << "x"
+                << srcRes->height << ", destination is " << dstRes->width
+                << "x" << dstRes->height << std::endl;
+      return;
+    }
+    int r = static_cast<int>(std::lround(std::max(0.0f, radius)));
+    NANO_TRACE_BYTES(span, srcRes->width * srcRes->height * 4 * sizeof(float));
+
+#if NANO_HAS_METAL
+    // Metal textures: wait for the work touching src/dst/kernel, convolve on
+    // the CPU and sync back
+    bool onMetal = !metalTextures.empty() && srcIdx < metalTextures.size() &&
+                   dstIdx < metalTextures.size() &&
+                   metalTextures[srcIdx] != nil && metalTextures[dstIdx] != nil;
+    if (onMetal) {
+      syncResource(srcIdx);
+      syncResourceForWrite(dstIdx);
+      syncTextureForHost(srcIdx);
+      size_t k = static_cast<size_t>(kernelIdx);
+      if (kernelIdx >= 0 && k < metalTextures.size() &&
+          metalTextures[k] != nil) {
+        syncResource(k);
+        syncTextureForHost(k);
+      }
+    }
+#endif
+
+    ResourceSet reads{static_cast<int>(srcIdx)};
+    if (kernelIdx >= 0)
+      reads.insert(static_cast<size_t>(kernelIdx));
+    ResourceSet writes{static_cast<int>(dstIdx)};
+    ResourceSet touched = reads;
+    touched.merge(writes);
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::ConvolveTexture, 0, std::move(reads),
+                 std::move(writes), [=]() {
+                   convolveTextureCpu(srcIdx, dstIdx, kernelIdx, r, sigma,
+                                      normalize);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    convolveTextureCpu(srcIdx, dstIdx, kernelIdx, r, sigma, normalize);
+    endUse(touched, use);
+
+#if NANO_HAS_METAL
+    if (onMetal)
       syncDataToTexture(dstIdx);
+#endif
+  }
+
+  void convolveTextureCpu(size_t srcIdx, size_t dstIdx, int kernelIdx,
+                          int radius, float sigma, bool normalize) {
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    int w = static_cast<int>(srcRes->width);
+    int h = static_cast<int>(srcRes->height);
+    size_t floats = static_cast<size_t>(w) * h * 4;
+    NANO_TRACE_SPAN(span, "convolveTexture", "exec", "",
+                    static_cast<int>(dstIdx), floats * sizeof(float));
+    PerfCounters::Command counted(perf, "convolveTexture",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    if (srcRes->data.size() < floats)
+      return;
+    FftKernel kernel;
+    kernel.radius = radius;
+    kernel.sigma = sigma;
+    kernel.normalize = normalize;
+    if (kernelIdx >= 0) {
+      auto *kernelRes = resources[static_cast<size_t>(kernelIdx)];
+      kernel.kw = static_cast<int>(kernelRes->width);
+      kernel.kh = static_cast<int>(kernelRes->height);
+      if (kernel.kw <= 0 || kernel.kh <= 0 ||
+          kernelRes->data.size() < static_cast<size_t>(kernel.kw) * kernel.kh * 4)
+        return;
+      kernel.data = kernelRes->data.data();
+    }
+    if (dstRes->data.size() < floats)
+      dstRes->data.resize(floats, 0.0f);
+    int wrapMode = srcIdx < texWrapModes.size() ? texWrapModes[srcIdx] : 0;
+    auto scratch = fftScratch.acquire();
+    if (!convolveRgba(srcRes->data.data(), dstRes->data.data(), w, h,
+                      wrapMode, kernel, fftSpectra, *scratch, pool()))
+      std::cerr << "convolveTexture: " << w << "x" << h
+                << " texture padded by the kernel exceeds the FFT size limit"
+                << std::endl;
+    fftScratch.release(std::move(scratch));
+  }
+
+  // Prefix sum of buffer elements (stride floats, component-wise) into dst,
+  // which may be src: exclusive, or inclusive. count = -1 means as many as
+  // fit. totalIdx >= 0 receives the component sums at element 0 (as int
+  // bits when totalAsInt, for atomic counters). See buffer-scan.h.
+  void scanBuffer(size_t srcIdx, size_t dstIdx, int stride, bool inclusive,
+                  int count, int totalIdx, bool totalAsInt) {
+    if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    if (totalIdx >= static_cast<int>(resources.size())) totalIdx = -1;
+    stride = std::max(1, std::min(stride, buffer_scan::kMaxScanStride));
+    NANO_TRACE_SPAN(span, "scanBuffer", "host", "", static_cast<int>(dstIdx));
+
+    // Device buffers: wait for the work touching them and scan the host
+    // copies; the results upload with the next dispatch.
+    if (!usesCpuBackend()) {
+      syncResource(srcIdx);
+      syncResourceForWrite(dstIdx);
+      if (totalIdx >= 0)
+        syncResourceForWrite(static_cast<size_t>(totalIdx));
+    }
+
+    ResourceSet touched{static_cast<int>(srcIdx), static_cast<int>(dstIdx)};
+    ResourceSet writes{static_cast<int>(dstIdx)};
+    if (totalIdx >= 0) {
+      touched.insert(static_cast<size_t>(totalIdx));
+      writes.insert(static_cast<size_t>(totalIdx));
+    }
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::ScanBuffer, 0, {static_cast<int>(srcIdx)},
+                 std::move(writes), [=]() {
+                   scanBufferCpu(srcIdx, dstIdx, stride, inclusive, count,
+                                 totalIdx, totalAsInt);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    scanBufferCpu(srcIdx, dstIdx, stride, inclusive, count, totalIdx,
+                  totalAsInt);
+    endUse(touched, use);
+
+    if (!usesCpuBackend()) {
+      residency.markHostDirty(dstIdx);
+      if (totalIdx >= 0)
+        residency.markHostDirty(static_cast<size_t>(totalIdx));
+    }
+  }
+
+  void scanBufferCpu(size_t srcIdx, size_t dstIdx, int stride, bool inclusive,
+                     int count, int totalIdx, bool totalAsInt) {
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    int n = static_cast<int>(std::min(srcRes->data.size(),
+                                      dstRes->data.size()) / stride);
+    if (count >= 0) n = std::min(n, count);
+    NANO_TRACE_SPAN(span, "scanBuffer", "exec", "", static_cast<int>(dstIdx),
+                    static_cast<size_t>(n) * stride * sizeof(float));
+    PerfCounters::Command counted(perf, "scanBuffer",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    float total[buffer_scan::kMaxScanStride] = {};
+    if (n > 0)
+      scanFloats(srcRes->data.data(), dstRes->data.data(), n, stride,
+                 inclusive, total, pool());
+    if (totalIdx >= 0)
+      storeHostValues(static_cast<size_t>(totalIdx), total, stride,
+                      totalAsInt);
+  }
+
+  // Stream compaction: copy, in order, the elements of src (stride floats)
+  // whose flag is positive to the front of dst (which may be src). Flags are
+  // element i of flagsIdx (flagStride floats apart), or each element's first
+  // component when flagsIdx < 0. counterIdx >= 0 receives the number kept
+  // at element 0 (as int bits when counterAsInt). See buffer-scan.h.
+  void compactBuffer(size_t srcIdx, int flagsIdx, size_t dstIdx, int stride,
+                     int flagStride, int counterIdx, bool counterAsInt) {
+    if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    if (flagsIdx >= static_cast<int>(resources.size())) flagsIdx = -1;
+    if (counterIdx >= static_cast<int>(resources.size())) counterIdx = -1;
+    stride = std::max(1, stride);
+    flagStride = std::max(1, flagStride);
+    NANO_TRACE_SPAN(span, "compactBuffer", "host", "",
+                    static_cast<int>(dstIdx));
+    if (flagsIdx == static_cast<int>(dstIdx) && dstIdx != srcIdx) {
+      std::cerr << "compactBuffer: flags buffer " << flagsIdx
+                << " is also the destination" << std::endl;
+      return;
+    }
+
+    if (!usesCpuBackend()) {
+      syncResource(srcIdx);
+      if (flagsIdx >= 0)
+        syncResource(static_cast<size_t>(flagsIdx));
+      syncResourceForWrite(dstIdx);
+      if (counterIdx >= 0)
+        syncResourceForWrite(static_cast<size_t>(counterIdx));
+    }
+
+    ResourceSet reads{static_cast<int>(srcIdx)};
+    ResourceSet writes{static_cast<int>(dstIdx)};
+    if (flagsIdx >= 0)
+      reads.insert(static_cast<size_t>(flagsIdx));
+    if (counterIdx >= 0)
+      writes.insert(static_cast<size_t>(counterIdx));
+    ResourceSet touched = reads;
+    touched.merge(writes);
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::CompactBuffer, 0, std::move(reads),
+                 std::move(writes), [=]() {
+                   compactBufferCpu(srcIdx, flagsIdx, dstIdx, stride,
+                                    flagStride, counterIdx, counterAsInt);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    compactBufferCpu(srcIdx, flagsIdx, dstIdx, stride, flagStride, counterIdx,
+                     counterAsInt);
+    endUse(touched, use);
+
+    if (!usesCpuBackend()) {
+      residency.markHostDirty(dstIdx);
+      if (counterIdx >= 0)
+        residency.markHostDirty(static_cast<size_t>(counterIdx));
+    }
+  }
+
+  void compactBufferCpu(size_t srcIdx, int flagsIdx, size_t dstIdx,
+                        int stride, int flagStride, int counterIdx,
+                        bool counterAsInt) {
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    const float *flags = srcRes->data.data();
+    int n = static_cast<int>(srcRes->data.size()) / stride;
+    if (flagsIdx >= 0) {
+      auto &flagData = resources[static_cast<size_t>(flagsIdx)]->data;
+      flags = flagData.data();
+      n = std::min(n, static_cast<int>(flagData.size()) / flagStride);
+    } else {
+      flagStride = stride;
+    }
+    int capacity = static_cast<int>(dstRes->data.size()) / stride;
+    NANO_TRACE_SPAN(span, "compactBuffer", "exec", "",
+                    static_cast<int>(dstIdx),
+                    static_cast<size_t>(n) * stride * sizeof(float));
+    PerfCounters::Command counted(perf, "compactBuffer",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    float kept = 0.0f;
+    if (n > 0)
+      kept = static_cast<float>(compactFloats(srcRes->data.data(), flags,
+                                              dstRes->data.data(), n, stride,
+                                              flagStride, capacity, pool()));
+    if (counterIdx >= 0)
+      storeHostValues(static_cast<size_t>(counterIdx), &kept, 1,
+                      counterAsInt);
+  }
+
+  // Stable radix sort of the first `count` elements of src (stride floats;
+  // count = -1 means all that fit dst) into dst, which may be src, by
+  // ascending or descending key. Keys are component keyComponent of each
+  // element, or element i of keysIdx (keyStride floats apart), which then
+  // receives the keys in sorted order. See buffer-sort.h.
+  void sortBuffer(size_t srcIdx, size_t dstIdx, int stride, int keyComponent,
+                  int keysIdx, int keyStride, bool descending, int count) {
+    if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    if (keysIdx >= static_cast<int>(resources.size())) keysIdx = -1;
+    stride = std::max(1, stride);
+    keyStride = std::max(1, keyStride);
+    keyComponent = std::max(0, std::min(keyComponent, stride - 1));
+    NANO_TRACE_SPAN(span, "sortBuffer", "host", "", static_cast<int>(dstIdx));
+    if (keysIdx == static_cast<int>(srcIdx) ||
+        keysIdx == static_cast<int>(dstIdx)) {
+      std::cerr << "sortBuffer: keys buffer " << keysIdx
+                << " is also the source or destination" << std::endl;
+      return;
+    }
+
+    if (!usesCpuBackend()) {
+      syncResource(srcIdx);
+      syncResourceForWrite(dstIdx);
+      if (keysIdx >= 0)
+        syncResourceForWrite(static_cast<size_t>(keysIdx));
+    }
+
+    ResourceSet reads{static_cast<int>(srcIdx)};
+    ResourceSet writes{static_cast<int>(dstIdx)};
+    if (keysIdx >= 0) {
+      reads.insert(static_cast<size_t>(keysIdx));
+      writes.insert(static_cast<size_t>(keysIdx));
+    }
+    ResourceSet touched = reads;
+    touched.merge(writes);
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::SortBuffer, 0, std::move(reads), std::move(writes),
+                 [=]() {
+                   sortBufferCpu(srcIdx, dstIdx, stride, keyComponent,
+                                 keysIdx, keyStride, descending, count);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    sortBufferCpu(srcIdx, dstIdx, stride, keyComponent, keysIdx, keyStride,
+                  descending, count);
+    endUse(touched, use);
+
+    if (!usesCpuBackend()) {
+      residency.markHostDirty(dstIdx);
+      if (keysIdx >= 0)
+        residency.markHostDirty(static_cast<size_t>(keysIdx));
+    }
+  }
+
+  void sortBufferCpu(size_t srcIdx, size_t dstIdx, int stride,
+                     int keyComponent, int keysIdx, int keyStride,
+                     bool descending, int count) {
+    auto *srcRes = resources[srcIdx];
+    auto *dstRes = resources[dstIdx];
+    int n = static_cast<int>(std::min(srcRes->data.size(),
+                                      dstRes->data.size()) / stride);
+    if (count >= 0) n = std::min(n, count);
+    const float *keys = srcRes->data.data() + keyComponent;
+    float *sortedKeys = nullptr;
+    if (keysIdx >= 0) {
+      auto &keyData = resources[static_cast<size_t>(keysIdx)]->data;
+      n = std::min(n, static_cast<int>(keyData.size()) / keyStride);
+      keys = sortedKeys = keyData.data();
+    } else {
+      keyStride = stride;
+    }
+    NANO_TRACE_SPAN(span, "sortBuffer", "exec", "", static_cast<int>(dstIdx),
+                    static_cast<size_t>(n) * stride * sizeof(float));
+    PerfCounters::Command counted(perf, "sortBuffer",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    if (n <= 0)
+      return;
+    auto scratch = sortScratch.acquire();
+    sortFloats(srcRes->data.data(), keys, dstRes->data.data(), sortedKeys, n,
+               stride, keyStride, descending, *scratch, pool());
+    sortScratch.release(std::move(scratch));
+  }
+
+  // Reduce the first `count` elements of src (stride floats; count = -1
+  // means all; textures are 4-float pixels) into dst, as floats or, when
+  // dstAsInt, int bits. Sum, Min, Max and Mean write one value per component
+  // (or that of `component` when >= 0); ArgMin/ArgMax write the first index
+  // of the extreme value of `component` (-1 if none); Histogram writes `bins`
+  // counts (bins < 0: as many as dst holds) of `component` over [lo, hi).
+  // Results do not depend on the worker pool size. See buffer-reduce.h.
+  void reduceBuffer(size_t srcIdx, size_t dstIdx, int stride, int mode,
+                    int component, int count, int bins, float lo, float hi,
+                    bool dstAsInt) {
+    if (srcIdx >= resources.size() || dstIdx >= resources.size()) return;
+    stride = std::max(1, std::min(stride, buffer_reduce::kMaxReduceStride));
+    component = std::min(component, stride - 1);
+    mode = std::max(0, std::min(mode, static_cast<int>(ReduceMode::Histogram)));
+    NANO_TRACE_SPAN(span, "reduceBuffer", "host", "",
+                    static_cast<int>(dstIdx));
+
+    if (!usesCpuBackend()) {
+      syncResource(srcIdx);
+      syncResourceForWrite(dstIdx);
+    }
+
+    ResourceSet reads{static_cast<int>(srcIdx)};
+    ResourceSet writes{static_cast<int>(dstIdx)};
+    ResourceSet touched = reads;
+    touched.merge(writes);
+    int use = beginUse(touched);
+    if (deferCpu(FrameOp::ReduceBuffer, 0, std::move(reads),
+                 std::move(writes), [=]() {
+                   reduceBufferCpu(srcIdx, dstIdx, stride, mode, component,
+                                   count, bins, lo, hi, dstAsInt);
+                 })) {
+      endUse(touched, use);
+      return;
+    }
+    reduceBufferCpu(srcIdx, dstIdx, stride, mode, component, count, bins, lo,
+                    hi, dstAsInt);
+    endUse(touched, use);
+
+    if (!usesCpuBackend())
+      residency.markHostDirty(dstIdx);
+  }
+
+  void reduceBufferCpu(size_t srcIdx, size_t dstIdx, int stride, int mode,
+                       int component, int count, int bins, float lo, float hi,
+                       bool dstAsInt) {
+    auto *srcRes = resources[srcIdx];
+    auto &out = resources[dstIdx]->data;
+    int n = static_cast<int>(srcRes->data.size() / stride);
+    if (count >= 0) n = std::min(n, count);
+    NANO_TRACE_SPAN(span, "reduceBuffer", "exec", "", static_cast<int>(dstIdx),
+                    static_cast<size_t>(std::max(n, 0)) * stride *
+                        sizeof(float));
+    PerfCounters::Command counted(perf, "reduceBuffer",
+                                  NANO_TRACE_COUNTERS(span));
+    PerfCounters::Scope sample(perf, counted.accumulator());
+    const float *src = srcRes->data.data();
+    if (static_cast<ReduceMode>(mode) == ReduceMode::Histogram) {
+      if (bins < 0) bins = static_cast<int>(out.size());
+      bins = std::min(bins, static_cast<int>(out.size()));
+      if (bins <= 0)
+        return;
+      auto scratch = histogramScratch.acquire();
+      const uint32_t *totals = histogramFloats(src, n, stride, component,
+                                               bins, lo, hi, *scratch, pool());
+      for (int k = 0; k < bins; ++k)
+        out[k] = dstAsInt ? int_bits_to_float(static_cast<int>(totals[k]))
+                          : static_cast<float>(totals[k]);
+      histogramScratch.release(std::move(scratch));
+      return;
     }
+    double values[buffer_reduce::kMaxReduceStride];
+    int written = reduceFloats(src, n, stride, static_cast<ReduceMode>(mode),
+                               component, values, pool());
+    float results[buffer_reduce::kMaxReduceStride];
+    for (int i = 0; i < written; ++i)
+      results[i] = static_cast<float>(values[i]);
+    storeHostValues(dstIdx, results, written, dstAsInt);
+  }
+
+  // Store n values at the start of buffer idx (as int bits when asInt, the
+  // atomic counter layout), as many as fit.
+  void storeHostValues(size_t idx, const float *values, int n, bool asInt) {
+    auto &data = resources[idx]->data;
+    n = std::min(n, static_cast<int>(data.size()));
+    for (int i = 0; i < n; ++i)
+      data[i] = asInt ? int_bits_to_float(
+                            static_cast<int>(std::lround(values[i])))
+                      : values[i];
   }
 
   float getInput(const std::string &name) {
@@ -971,10 +2503,23 @@ struct EvalContext {
     return 0.0f;
   }
 
+#if NANO_HAS_METAL
   // Create a new Metal buffer and optionally blit old data into it (GPU-to-GPU copy).
-  // Serial queue ordering ensures the blit executes after any pending dispatch.
-  id<MTLBuffer> resizeGpuBuffer(id<MTLBuffer> oldBuffer, size_t newByteSize, bool clearData) {
+  // A resize to the current size keeps the buffer (cleared on the GPU if
+  // requested). Serial queue ordering ensures the blit executes after any
+  // pending dispatch.
+  id<MTLBuffer> resizeGpuBuffer(size_t idx, id<MTLBuffer> oldBuffer, size_t newByteSize, bool clearData) {
     size_t safeSize = std::max(newByteSize, (size_t)sizeof(float));
+    if (oldBuffer != nil && oldBuffer.length == safeSize) {
+      if (clearData) {
+        id<MTLCommandBuffer> cmdBuf = [commandQueue commandBuffer];
+        id<MTLBlitCommandEncoder> blit = [cmdBuf blitCommandEncoder];
+        [blit fillBuffer:oldBuffer range:NSMakeRange(0, safeSize) value:0];
+        [blit endEncoding];
+        commitTracked(cmdBuf, "resize", "", {}, {static_cast<int>(idx)});
+      }
+      return oldBuffer;
+    }
     id<MTLBuffer> newBuffer = [device newBufferWithLength:safeSize
                                                   options:MTLResourceStorageModeShared];
     if (!clearData && oldBuffer != nil && oldBuffer.length > 0 && newByteSize > 0) {
@@ -985,100 +2530,25 @@ struct EvalContext {
                   toBuffer:newBuffer destinationOffset:0
                       size:copySize];
       [blit endEncoding];
-      [cmdBuf commit];
-      pendingCmdBuffer = cmdBuf;
+      commitTracked(cmdBuf, "resize", "", {}, {static_cast<int>(idx)});
     }
     return newBuffer;
   }
+#endif
 
-  // CPU-side texture sampling (for CPU functions that sample textures directly)
-  // wrapMode: 0=repeat, 1=clamp, 2=mirror
-  // filterMode: 0=nearest, 1=linear
-  // elemStride: number of floats per texel (1 for R32F, 4 for RGBA8)
+  // CPU-side texture sampling (for CPU functions that sample textures
+  // directly); see sampleResource.
   std::array<float, 4> sampleTexture(size_t resIdx, float u, float v,
                                      int wrapMode, int filterMode,
                                      int elemStride) {
     if (resIdx >= resources.size())
       return {0, 0, 0, 0};
-    auto *res = resources[resIdx];
-    int w = static_cast<int>(res->width);
-    int h = static_cast<int>(res->height);
-    if (w <= 0 || h <= 0)
-      return {0, 0, 0, 0};
-
-    auto applyWrap = [](float coord, int mode) -> float {
-      if (mode == 1) { // clamp
-        return std::max(0.0f, std::min(1.0f, coord));
-      } else if (mode == 2) { // mirror
-        float c = fmod(coord, 2.0f);
-        if (c < 0)
-          c += 2.0f;
-        return c > 1.0f ? 2.0f - c : c;
-      } else { // repeat
-        return coord - floorf(coord);
-      }
-    };
-
-    auto getSample = [&](int x, int y) -> std::array<float, 4> {
-      // Apply wrap in pixel space
-      if (wrapMode == 1) { // clamp
-        x = std::max(0, std::min(w - 1, x));
-        y = std::max(0, std::min(h - 1, y));
-      } else if (wrapMode == 0) { // repeat
-        x = ((x % w) + w) % w;
-        y = ((y % h) + h) % h;
-      } else if (wrapMode == 2) { // mirror
-        int mx = ((x % (2 * w)) + (2 * w)) % (2 * w);
-        x = mx >= w ? 2 * w - 1 - mx : mx;
-        int my = ((y % (2 * h)) + (2 * h)) % (2 * h);
-        y = my >= h ? 2 * h - 1 - my : my;
-      }
-      size_t idx = y * w + x;
-      std::array<float, 4> result = {0, 0, 0, 1};
-      size_t base = idx * elemStride;
-      for (int i = 0; i < elemStride && i < 4 && base + i < res->data.size();
-           ++i) {
-        result[i] = res->data[base + i];
-      }
-      // For single-channel textures, replicate to RGB
-      if (elemStride == 1) {
-        result[1] = result[0];
-        result[2] = result[0];
-        result[3] = 1.0f;
-      }
-      return result;
-    };
-
-    float wu = applyWrap(u, wrapMode);
-    float wv = applyWrap(v, wrapMode);
-
-    if (filterMode == 0) { // nearest
-      int x = std::min(static_cast<int>(wu * w), w - 1);
-      int y = std::min(static_cast<int>(wv * h), h - 1);
-      return getSample(x, y);
-    } else { // linear (bilinear)
-      float tx = wu * w - 0.5f;
-      float ty = wv * h - 0.5f;
-      int x0 = static_cast<int>(floorf(tx));
-      int y0 = static_cast<int>(floorf(ty));
-      float fx = tx - x0;
-      float fy = ty - y0;
-
-      auto s00 = getSample(x0, y0);
-      auto s10 = getSample(x0 + 1, y0);
-      auto s01 = getSample(x0, y0 + 1);
-      auto s11 = getSample(x0 + 1, y0 + 1);
-
-      std::array<float, 4> result;
-      for (int i = 0; i < 4; ++i) {
-        float r0 = s00[i] * (1 - fx) + s10[i] * fx;
-        float r1 = s01[i] * (1 - fx) + s11[i] * fx;
-        result[i] = r0 * (1 - fy) + r1 * fy;
-      }
-      return result;
-    }
+    syncResource(resIdx);
+    return sampleResource(*resources[resIdx], u, v, wrapMode, filterMode,
+                          elemStride);
   }
 
+#if NANO_HAS_METAL
   // Initialize Metal if not already done
   void initMetal(id<MTLDevice> existingDevice,
                  id<MTLCommandQueue> existingQueue,
@@ -1116,128 +2586,144 @@ struct EvalContext {
     return pipeline;
   }
 
-  // Sync CPU data to Metal buffers and textures
+  // Make the Metal copies of all resources current. Only resources without a
+  // device copy (or whose size changed) are (re)created; other buffers get
+  // their host-dirty ranges uploaded.
   void syncToMetal() {
-    metalBuffers.clear();
-    metalTextures.clear();
-    metalTextures.resize(resources.size(), nil);
-    stagingTextures.clear();
-    stagingTextures.resize(resources.size(), nil);
-    metalSamplers.clear();
-    metalSamplers.resize(resources.size(), nil);
+    size_t n = resources.size();
+    metalBuffers.resize(n, nil);
+    metalTextures.resize(n, nil);
+    stagingTextures.resize(n, nil);
+    metalSamplers.resize(n, nil);
+    for (size_t i = 0; i < n; ++i)
+      ensureResident(i);
 
-    for (size_t i = 0; i < resources.size(); ++i) {
-      auto *res = resources[i];
-      if (i < isTextureResource.size() && isTextureResource[i]) {
-        if (res->isExternal && res->externalTexture) {
-          // External (IOSurface-backed) textures may lack ShaderWrite usage.
-          // Create a staging texture with full usage for compute/render work,
-          // then blit to the external texture after GPU commands complete.
-          int w = res->externalTexture.width;
-          int h = res->externalTexture.height;
-          // Reuse cached staging texture if dimensions match
-          if (res->retainedStagingTexture != nil &&
-              (int)res->retainedStagingTexture.width == w &&
-              (int)res->retainedStagingTexture.height == h) {
-            metalTextures[i] = res->retainedStagingTexture;
-            stagingTextures[i] = res->retainedStagingTexture;
-          } else {
-            MTLTextureDescriptor *desc = [[MTLTextureDescriptor alloc] init];
-            desc.textureType = MTLTextureType2D;
-            desc.pixelFormat = res->externalTexture.pixelFormat;
-            desc.width = w;
-            desc.height = h;
-            desc.usage = MTLTextureUsageShaderWrite | MTLTextureUsageShaderRead |
-                         MTLTextureUsageRenderTarget;
-            desc.storageMode = MTLStorageModeShared;
-            id<MTLTexture> staging = [device newTextureWithDescriptor:desc];
-            metalTextures[i] = staging;
-            stagingTextures[i] = staging;
-            res->retainedStagingTexture = staging;
-          }
-        } else {
-          // Create a Metal texture for texture resources
-          MTLTextureDescriptor *desc = [[MTLTextureDescriptor alloc] init];
-          desc.textureType = MTLTextureType2D;
-          desc.pixelFormat = MTLPixelFormatRGBA8Unorm;
-          desc.width = texWidths[i];
-          desc.height = texHeights[i];
-          desc.usage = MTLTextureUsageShaderWrite | MTLTextureUsageShaderRead |
-                       MTLTextureUsageRenderTarget;
-          desc.storageMode = MTLStorageModeShared;
-          id<MTLTexture> texture = [device newTextureWithDescriptor:desc];
-          metalTextures[i] = texture;
-
-          // Upload pre-populated texture data if available (float RGBA -> RGBA8
-          // bytes)
-          if (!res->data.empty()) {
-            int w = texWidths[i];
-            int h = texHeights[i];
-            size_t pixelCount = w * h;
-            if (res->data.size() >= pixelCount * 4) {
-              std::vector<uint8_t> bytes(pixelCount * 4);
-              for (size_t j = 0; j < pixelCount * 4; ++j) {
-                float v = std::max(0.0f, std::min(1.0f, res->data[j]));
-                bytes[j] = static_cast<uint8_t>(v * 255.0f + 0.5f);
-              }
-              MTLRegion region = MTLRegionMake2D(0, 0, w, h);
-              [texture replaceRegion:region
-                         mipmapLevel:0
-                           withBytes:bytes.data()
-                         bytesPerRow:w * 4];
-            }
-          }
-        }
+    // Blit external input textures into their staging textures so shaders
+    // can read input data. (Output textures are written by shaders and
+    // blitted back to external in blitStagingToExternal.)
+    if (!externalInputsStaged) {
+      blitExternalToStaging();
+      externalInputsStaged = true;
+    }
+  }
 
-        // Create sampler for this texture (needed for both internal and
-        // external)
-        MTLSamplerDescriptor *samplerDesc = [[MTLSamplerDescriptor alloc] init];
-        samplerDesc.minFilter = MTLSamplerMinMagFilterNearest;
-        samplerDesc.magFilter = MTLSamplerMinMagFilterNearest;
-        int wrapMode = (i < texWrapModes.size()) ? texWrapModes[i] : 0;
-        if (wrapMode == 1) {
-          samplerDesc.sAddressMode = MTLSamplerAddressModeClampToEdge;
-          samplerDesc.tAddressMode = MTLSamplerAddressModeClampToEdge;
-        } else {
-          samplerDesc.sAddressMode = MTLSamplerAddressModeRepeat;
-          samplerDesc.tAddressMode = MTLSamplerAddressModeRepeat;
-        }
-        metalSamplers[i] = [device newSamplerStateWithDescriptor:samplerDesc];
-
-        // Create a dummy buffer placeholder to keep indices aligned
-        float dummy = 0;
-        metalBuffers.push_back([device
-            newBufferWithBytes:&dummy
-                        length:sizeof(float)
-                       options:MTLResourceStorageModeShared]);
+  // Drop the device copy of a resource whose host copy was replaced (e.g.
+  // by a resize); it is recreated by the next syncToMetal().
+  void invalidateDeviceCopy(size_t idx) {
+    if (idx < metalTextures.size())
+      metalTextures[idx] = nil;
+    if (idx < isTextureResource.size() && isTextureResource[idx]) {
+      if (idx < texWidths.size()) {
+        texWidths[idx] = static_cast<int>(resources[idx]->width);
+        texHeights[idx] = static_cast<int>(resources[idx]->height);
+      }
+    } else {
+      residency.markHostDirty(idx);
+    }
+  }
+
+  void ensureResident(size_t i) {
+    auto *res = resources[i];
+    if (i < isTextureResource.size() && isTextureResource[i]) {
+      if (metalTextures[i] == nil)
+        createTexture(i);
+      return;
+    }
+    size_t bytes = res->data.size() * sizeof(float);
+    // Reuse a persistent GPU buffer from an earlier frame (its contents are
+    // authoritative) if the size still matches.
+    if (metalBuffers[i] == nil && res->retainedMetalBuffer != nil &&
+        res->retainedMetalBuffer.length == std::max(bytes, sizeof(float))) {
+      metalTransfer.adopt(i, res->retainedMetalBuffer, bytes);
+    }
+    if (metalBuffers[i] == nil && bytes == 0)
+      metalTransfer.allocate(i, nullptr, 0); // placeholder binding
+    residency.makeDeviceCurrent(i, metalTransfer, res->data.data(), bytes);
+  }
+
+  void createTexture(size_t i) {
+    auto *res = resources[i];
+    if (res->isExternal && res->externalTexture) {
+      // External (IOSurface-backed) textures may lack ShaderWrite usage.
+      // Create a staging texture with full usage for compute/render work,
+      // then blit to the external texture after GPU commands complete.
+      int w = res->externalTexture.width;
+      int h = res->externalTexture.height;
+      // Reuse cached staging texture if dimensions match
+      if (res->retainedStagingTexture != nil &&
+          (int)res->retainedStagingTexture.width == w &&
+          (int)res->retainedStagingTexture.height == h) {
+        metalTextures[i] = res->retainedStagingTexture;
+        stagingTextures[i] = res->retainedStagingTexture;
       } else {
-        // Safety check: invalidate retained buffer if size doesn't match
-        if (res->retainedMetalBuffer != nil) {
-          size_t expectedSize = res->data.size() * sizeof(float);
-          if (res->retainedMetalBuffer.length != expectedSize) {
-            res->retainedMetalBuffer = nil;
+        MTLTextureDescriptor *desc = [[MTLTextureDescriptor alloc] init];
+        desc.textureType = MTLTextureType2D;
+        desc.pixelFormat = res->externalTexture.pixelFormat;
+        desc.width = w;
+        desc.height = h;
+        desc.usage = MTLTextureUsageShaderWrite | MTLTextureUsageShaderRead |
+                     MTLTextureUsageRenderTarget;
+        desc.storageMode = MTLStorageModeShared;
+        id<MTLTexture> staging = [device newTextureWithDescriptor:desc];
+        metalTextures[i] = staging;
+        stagingTextures[i] = staging;
+        res->retainedStagingTexture = staging;
+      }
+    } else {
+      // Create a Metal texture for texture resources
+      MTLTextureDescriptor *desc = [[MTLTextureDescriptor alloc] init];
+      desc.textureType = MTLTextureType2D;
+      desc.pixelFormat = MTLPixelFormatRGBA8Unorm;
+      desc.width = texWidths[i];
+      desc.height = texHeights[i];
+      desc.usage = MTLTextureUsageShaderWrite | MTLTextureUsageShaderRead |
+                   MTLTextureUsageRenderTarget;
+      desc.storageMode = MTLStorageModeShared;
+      id<MTLTexture> texture = [device newTextureWithDescriptor:desc];
+      metalTextures[i] = texture;
+
+      // Upload pre-populated texture data if available (float RGBA -> RGBA8
+      // bytes)
+      if (!res->data.empty()) {
+        int w = texWidths[i];
+        int h = texHeights[i];
+        size_t pixelCount = w * h;
+        if (res->data.size() >= pixelCount * 4) {
+          std::vector<uint8_t> bytes(pixelCount * 4);
+          for (size_t j = 0; j < pixelCount * 4; ++j) {
+            float v = std::max(0.0f, std::min(1.0f, res->data[j]));
+            bytes[j] = static_cast<uint8_t>(v * 255.0f + 0.5f);
           }
+          MTLRegion region = MTLRegionMake2D(0, 0, w, h);
+          [texture replaceRegion:region
+                     mipmapLevel:0
+                       withBytes:bytes.data()
+                     bytesPerRow:w * 4];
+          residency.countUpload(bytes.size());
         }
-        if (res->retainedMetalBuffer != nil) {
-          // Reuse persistent GPU buffer (data stays on GPU across frames)
-          metalBuffers.push_back(res->retainedMetalBuffer);
-        } else {
-          size_t byteSize = res->data.size() * sizeof(float);
-          id<MTLBuffer> buffer =
-              [device newBufferWithBytes:res->data.data()
-                                  length:byteSize
-                                 options:MTLResourceStorageModeShared];
-          metalBuffers.push_back(buffer);
-          res->retainedMetalBuffer = buffer;
-        }
-        metalTextures.push_back(nil);
       }
     }
 
-    // Blit external input textures into their staging textures so shaders
-    // can read input data. (Output textures are written by shaders and
-    // blitted back to external in blitStagingToExternal.)
-    blitExternalToStaging();
+    // Create sampler for this texture (needed for both internal and
+    // external)
+    if (metalSamplers[i] == nil) {
+      MTLSamplerDescriptor *samplerDesc = [[MTLSamplerDescriptor alloc] init];
+      samplerDesc.minFilter = MTLSamplerMinMagFilterNearest;
+      samplerDesc.magFilter = MTLSamplerMinMagFilterNearest;
+      int wrapMode = (i < texWrapModes.size()) ? texWrapModes[i] : 0;
+      if (wrapMode == 1) {
+        samplerDesc.sAddressMode = MTLSamplerAddressModeClampToEdge;
+        samplerDesc.tAddressMode = MTLSamplerAddressModeClampToEdge;
+      } else {
+        samplerDesc.sAddressMode = MTLSamplerAddressModeRepeat;
+        samplerDesc.tAddressMode = MTLSamplerAddressModeRepeat;
+      }
+      metalSamplers[i] = [device newSamplerStateWithDescriptor:samplerDesc];
+    }
+
+    // Placeholder buffer to keep indices aligned
+    if (metalBuffers[i] == nil)
+      metalBuffers[i] = placeholder();
   }
 
   // Copy external (IOSurface) input textures into staging textures before
@@ -1255,9 +2741,11 @@ struct EvalContext {
 
     id<MTLCommandBuffer> cmdBuffer = [commandQueue commandBuffer];
     id<MTLBlitCommandEncoder> blit = [cmdBuffer blitCommandEncoder];
+    ResourceSet staged;
     for (size_t i = 0; i < resources.size(); ++i) {
       if (i < stagingTextures.size() && stagingTextures[i] != nil &&
           resources[i]->isExternal && resources[i]->externalTexture) {
+        staged.insert(i);
         int w = resources[i]->externalTexture.width;
         int h = resources[i]->externalTexture.height;
         [blit copyFromTexture:resources[i]->externalTexture
@@ -1272,13 +2760,13 @@ struct EvalContext {
       }
     }
     [blit endEncoding];
-    [cmdBuffer commit];
+    // Host-side texture ops on these inputs wait for the copy
+    commitTracked(cmdBuffer, "stageInputs", "", {}, staged, false);
   }
 
-  // Sync Metal buffers and textures back to CPU
-  void syncFromMetal() {
-    for (size_t i = 0; i < resources.size(); ++i) {
-      if (resources[i]->isExternal) continue;
+  // Read one Metal buffer or texture back into the resource's CPU data
+  void readbackResource(size_t i) {
+    {
       if (i < metalTextures.size() && metalTextures[i] != nil) {
         // Read back texture data as RGBA8 bytes, convert to floats
         int w = texWidths[i];
@@ -1295,15 +2783,16 @@ struct EvalContext {
         for (size_t j = 0; j < bytes.size(); ++j) {
           resources[i]->data[j] = bytes[j] / 255.0f;
         }
-      } else if (i < metalBuffers.size()) {
-        float *ptr = (float *)[metalBuffers[i] contents];
-        size_t count = resources[i]->data.size();
-        for (size_t j = 0; j < count; ++j) {
-          resources[i]->data[j] = ptr[j];
-        }
+        residency.countDownload(bytes.size());
+      } else if (i < metalBuffers.size() && metalBuffers[i] != nil) {
+        // Only the ranges written on the device since the last readback
+        auto &data = resources[i]->data;
+        residency.makeHostCurrent(i, metalTransfer, data.data(),
+                                  data.size() * sizeof(float));
       }
     }
   }
+#endif
 
   // Dispatch a compute shader (no args version)
   void dispatchShader(const char *funcName, int dimX, int dimY, int dimZ) {
@@ -1313,11 +2802,19 @@ struct EvalContext {
   // Dispatch with args (initializer list)
   void dispatchShader(const char *funcName, int dimX, int dimY, int dimZ,
                       std::initializer_list<float> args) {
-    std::vector<float> argsVec(args);
-    dispatchShaderImpl(funcName, dimX, dimY, dimZ, argsVec.data(),
-                       argsVec.size());
+    dispatchShaderImpl(funcName, dimX, dimY, dimZ,
+                       const_cast<float *>(args.begin()), args.size());
   }
 
+  // Cleared scratch vector generated code flattens dispatch and draw args
+  // into; reusing it keeps steady-state frames from allocating. Dispatches
+  // copy their args, so each call site can take it afresh.
+  std::vector<float> &shaderArgs() {
+    shaderArgScratch.clear();
+    return shaderArgScratch;
+  }
+  std::vector<float> shaderArgScratch;
+
   // Dispatch with args (vector - used for complex type marshalling)
   void dispatchShader(const char *funcName, int dimX, int dimY, int dimZ,
                       const std::vector<float> &args) {
@@ -1327,34 +2824,33 @@ struct EvalContext {
 
   void dispatchShaderImpl(const char *funcName, int dimX, int dimY, int dimZ,
                           float *args, size_t argCount) {
+    NANO_TRACE_SPAN(span, "dispatch", "host", funcName, -1,
+                    argCount * sizeof(float));
+    if (usesCpuBackend()) {
+      dispatchCpu(funcName, dimX, dimY, dimZ, args, argCount);
+      return;
+    }
+#if NANO_HAS_METAL
     id<MTLComputePipelineState> pipeline = getPipeline(funcName);
     if (!pipeline)
       return;
 
-    // Sync CPU data to GPU if not done yet
-    if (metalBuffers.empty()) {
-      syncToMetal();
-    }
+    // Upload what changed on the host since the last command
+    syncToMetal();
 
     id<MTLCommandBuffer> cmdBuffer = [commandQueue commandBuffer];
     id<MTLComputeCommandEncoder> encoder = [cmdBuffer computeCommandEncoder];
     [encoder setComputePipelineState:pipeline];
 
     // Bind uniform buffer with args (binding 0)
+    ArgArena::Allocation argSlot;
     if (argCount > 0) {
-      id<MTLBuffer> argsBuffer =
-          [device newBufferWithBytes:args
-                              length:argCount * sizeof(float)
-                             options:MTLResourceStorageModeShared];
-      [encoder setBuffer:argsBuffer offset:0 atIndex:0];
+      argSlot = metalArgs.push(args, argCount * sizeof(float));
+      [encoder setBuffer:metalArgStorage.buffers[argSlot.block]
+                  offset:argSlot.offset
+                 atIndex:0];
     } else {
-      // Empty uniform buffer
-      float dummy = 0;
-      id<MTLBuffer> argsBuffer =
-          [device newBufferWithBytes:&dummy
-                              length:sizeof(float)
-                             options:MTLResourceStorageModeShared];
-      [encoder setBuffer:argsBuffer offset:0 atIndex:0];
+      [encoder setBuffer:placeholder() offset:0 atIndex:0];
     }
 
     // Bind resource buffers, textures, and samplers (starting at binding 1)
@@ -1377,8 +2873,125 @@ struct EvalContext {
     [encoder dispatchThreads:gridSize threadsPerThreadgroup:threadGroupSize];
     [encoder endEncoding];
 
-    [cmdBuffer commit];
-    pendingCmdBuffer = cmdBuffer;
+    ResourceSet reads, writes;
+    accessFor(funcName, reads, writes);
+    FencePtr fence =
+        commitTracked(cmdBuffer, "dispatch", funcName, reads, writes);
+    if (argCount > 0)
+      metalArgs.retireAfter(fence);
+#endif
+  }
+
+  // Run a dispatch on the CPU backend (recorded into the frame graph while
+  // batching).
+  void dispatchCpu(const char *funcName, int dimX, int dimY, int dimZ,
+                   const float *args, size_t argCount) {
+    auto it = cpuKernels.find(funcName);
+    if (it == cpuKernels.end()) {
+      if (std::find(missingCpuKernels.begin(), missingCpuKernels.end(),
+                    funcName) == missingCpuKernels.end()) {
+        std::cerr << "CPU kernel not found: " << funcName << std::endl;
+        missingCpuKernels.push_back(funcName);
+      }
+      return;
+    }
+    const CpuKernel *kernel = &it->second;
+    const char *kernelName = it->first.c_str(); // lives as long as the kernel
+    ResourceSet reads, writes;
+    if (batching || asyncCpu() || memoryPlanner || dispatchBudget)
+      accessFor(funcName, reads, writes);
+    bool keepsPrevious = !dispatchBudget || keepsPreviousFrame(writes);
+    ResourceSet touched = reads;
+    touched.merge(writes);
+    int use = beginUse(touched);
+    if (batching || asyncCpu()) {
+      // The arguments live in the arena until the command has run.
+      const float *argsCopy = static_cast<const float *>(
+          hostArgs.push(args, argCount * sizeof(float)).data);
+      FencePtr fence = deferCpu(
+          FrameOp::Dispatch, hashName(funcName), std::move(reads),
+          std::move(writes), [this, kernel, kernelName, argsCopy, argCount,
+                              dimX, dimY, dimZ, keepsPrevious]() {
+            runCpuKernel(*kernel, {argsCopy, argCount, dimX, dimY, dimZ},
+                         kernelName, keepsPrevious);
+          });
+      hostArgs.retireAfter(fence);
+    } else {
+      runCpuKernel(*kernel, {args, argCount, dimX, dimY, dimZ}, kernelName,
+                   keepsPrevious);
+    }
+    endUse(touched, use);
+  }
+
+  // Whether every resource in `writes` still holds the previous frame, so a
+  // dispatch budget may leave some of its tiles unwritten (DispatchBudget).
+  bool keepsPreviousFrame(const ResourceSet &writes) const {
+    bool aliased = memoryPlanner && usesCpuBackend() && !framePipeline &&
+                   !cpuQueue;
+    bool keeps = true;
+    writes.forEach([&](size_t i) {
+      if (aliased && memoryPlanner->isTransient(i))
+        keeps = false;
+      else if (framePipeline &&
+               std::find(persistentResources.begin(),
+                         persistentResources.end(),
+                         i) == persistentResources.end())
+        keeps = false;
+    });
+    return keeps;
+  }
+
+  // Split the dispatch grid into row tiles (splitting rows along X when there
+  // are too few to occupy the pool) and run them on the worker pool. With a
+  // dispatch budget, each batch of tiles is skipped once the budget says so.
+  void runCpuKernel(const CpuKernel &kernel, const CpuDispatch &d,
+                    const char *name = "", bool keepsPrevious = true) {
+    if (d.dimX <= 0 || d.dimY <= 0 || d.dimZ <= 0)
+      return;
+    NANO_TRACE_SPAN(span, "dispatch", "exec", name);
+    // Each thread running tiles samples its own counters into `counted`.
+    PerfCounters::Command counted(perf, name, NANO_TRACE_COUNTERS(span));
+    WorkerPool &p = pool();
+    int rows = d.dimY * d.dimZ;
+    int target = static_cast<int>(p.threadCount()) * 4;
+    int xSplit = rows >= target ? 1 : std::min(d.dimX, (target + rows - 1) / rows);
+    int tileW = (d.dimX + xSplit - 1) / xSplit;
+    int tiles = rows * xSplit;
+    int grain = std::max(1, tiles / target);
+    // The chunk callback captures one pointer, so wrapping it in a
+    // std::function does not allocate.
+    struct Tiling {
+      EvalContext *ctx;
+      const CpuKernel *kernel;
+      const CpuDispatch *d;
+      DispatchBudget *budget;
+      const PerfCounters *perf;
+      PerfCounters::Accumulator *counters;
+      int xSplit, tileW;
+      bool keepsPrevious;
+    } tiling{this, &kernel, &d, dispatchBudget, perf, &counted.accumulator(),
+             xSplit, tileW, keepsPrevious};
+    p.parallelFor(tiles, grain, [tp = &tiling](int begin, int end) {
+      const Tiling &tl = *tp;
+      if (tl.budget) {
+        bool skip = tl.budget->shouldStop(tl.keepsPrevious);
+        tl.budget->countTiles(skip ? 0 : end - begin, skip ? end - begin : 0);
+        if (skip)
+          return;
+      }
+      const CpuDispatch &d = *tl.d;
+      PerfCounters::Scope sample(tl.perf, *tl.counters);
+      for (int t = begin; t < end; ++t) {
+        int row = t / tl.xSplit;
+        int x0 = (t % tl.xSplit) * tl.tileW;
+        int x1 = std::min(d.dimX, x0 + tl.tileW);
+        if (x0 >= x1)
+          continue;
+        int y = row % d.dimY;
+        int z = row / d.dimY;
+        (*tl.kernel)(*tl.ctx, d, CpuTile{x0, y, z, x1, y + 1, z + 1});
+      }
+    });
   }
 
   // Draw call (render pipeline)
@@ -1386,9 +2999,14 @@ struct EvalContext {
             int vertexCount,
             const std::vector<float> &args = {},
             bool loadExisting = false) {
-    if (metalBuffers.empty()) {
-      syncToMetal();
+    NANO_TRACE_SPAN(span, "draw", "host", fsFunc, static_cast<int>(targetIdx),
+                    args.size() * sizeof(float));
+#if NANO_HAS_METAL
+    if (usesCpuBackend()) {
+      std::cerr << "draw requires the Metal backend" << std::endl;
+      return;
     }
+    syncToMetal();
 
     if (targetIdx >= metalTextures.size() || metalTextures[targetIdx] == nil) {
       std::cerr << "Draw target texture not found for index " << targetIdx
@@ -1396,33 +3014,44 @@ struct EvalContext {
       return;
     }
 
-    MTLRenderPipelineDescriptor *pipelineDesc =
-        [[MTLRenderPipelineDescriptor alloc] init];
-    pipelineDesc.colorAttachments[0].pixelFormat =
-        metalTextures[targetIdx].pixelFormat;
-
-    NSString *vsName = [NSString stringWithUTF8String:vsFunc];
-    NSString *fsName = [NSString stringWithUTF8String:fsFunc];
-
-    pipelineDesc.vertexFunction = [library newFunctionWithName:vsName];
-    pipelineDesc.fragmentFunction = [library newFunctionWithName:fsName];
-
-    if (!pipelineDesc.vertexFunction || !pipelineDesc.fragmentFunction) {
-      std::cerr << "Failed to load shaders for draw: " << vsFunc << ", "
-                << fsFunc << std::endl;
-      return;
-    }
-
-    NSError *error = nil;
+    PipelineKey key;
+    key.vertexFunction = vsFunc;
+    key.fragmentFunction = fsFunc;
+    key.targetFormat =
+        static_cast<uint64_t>(metalTextures[targetIdx].pixelFormat);
+    key.loadExisting = loadExisting;
     id<MTLRenderPipelineState> pipelineState =
-        [device newRenderPipelineStateWithDescriptor:pipelineDesc error:&error];
-    if (!pipelineState) {
-      std::cerr << "Failed to create render pipeline state: "
-                << (error ? [[error localizedDescription] UTF8String]
-                          : "unknown")
-                << std::endl;
+        renderPipelines.get(key, [&]() -> id<MTLRenderPipelineState> {
+      MTLRenderPipelineDescriptor *pipelineDesc =
+          [[MTLRenderPipelineDescriptor alloc] init];
+      pipelineDesc.colorAttachments[0].pixelFormat =
+          metalTextures[targetIdx].pixelFormat;
+
+      NSString *vsName = [NSString stringWithUTF8String:vsFunc];
+      NSString *fsName = [NSString stringWithUTF8String:fsFunc];
+
+      pipelineDesc.vertexFunction = [library newFunctionWithName:vsName];
+      pipelineDesc.fragmentFunction = [library newFunctionWithName:fsName];
+
+      if (!pipelineDesc.vertexFunction || !pipelineDesc.fragmentFunction) {
+        std::cerr << "Failed to load shaders for draw: " << vsFunc << ", "
+                  << fsFunc << std::endl;
+        return nil;
+      }
+
+      NSError *error = nil;
+      id<MTLRenderPipelineState> state =
+          [device newRenderPipelineStateWithDescriptor:pipelineDesc error:&error];
+      if (!state) {
+        std::cerr << "Failed to create render pipeline state: "
+                  << (error ? [[error localizedDescription] UTF8String]
+                            : "unknown")
+                  << std::endl;
+      }
+      return state;
+    });
+    if (!pipelineState)
       return;
-    }
 
     MTLRenderPassDescriptor *passDesc =
         [MTLRenderPassDescriptor renderPassDescriptor];
@@ -1441,12 +3070,11 @@ struct EvalContext {
 
     // Bind global inputs buffer at binding 0 (shared with vertex/fragment)
     if (!args.empty()) {
-      id<MTLBuffer> argsBuffer =
-          [device newBufferWithBytes:args.data()
-                              length:args.size() * sizeof(float)
-                             options:MTLResourceStorageModeShared];
-      [encoder setVertexBuffer:argsBuffer offset:0 atIndex:0];
-      [encoder setFragmentBuffer:argsBuffer offset:0 atIndex:0];
+      ArgArena::Allocation argSlot =
+          metalArgs.push(args.data(), args.size() * sizeof(float));
+      id<MTLBuffer> argsBuffer = metalArgStorage.buffers[argSlot.block];
+      [encoder setVertexBuffer:argsBuffer offset:argSlot.offset atIndex:0];
+      [encoder setFragmentBuffer:argsBuffer offset:argSlot.offset atIndex:0];
     }
 
     // Bind resources (buffers and textures) to both vertex and fragment stages
@@ -1470,7 +3098,19 @@ struct EvalContext {
                 vertexCount:vertexCount];
     [encoder endEncoding];
 
-    [cmdBuffer commit];
-    pendingCmdBuffer = cmdBuffer;
+    ResourceSet reads, writes, fsReads, fsWrites;
+    accessFor(vsFunc, reads, writes);
+    accessFor(fsFunc, fsReads, fsWrites);
+    reads.merge(fsReads);
+    writes.merge(fsWrites);
+    writes.insert(targetIdx);
+    FencePtr fence = commitTracked(cmdBuffer, "draw", fsFunc, reads, writes);
+    if (!args.empty())
+      metalArgs.retireAfter(fence);
+#else
+    (void)targetIdx; (void)vsFunc; (void)fsFunc; (void)vertexCount;
+    (void)args; (void)loadExisting;
+    std::cerr << "draw requires the Metal backend" << std::endl;
+#endif
   }
 };
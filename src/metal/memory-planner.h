@@ -0,0 +1,265 @@
+#pragma once
+
+// Transient resource aliasing for EvalContext.
+//
+// Resources declared transient (scratch data that does not need to survive
+// between frames) do not own storage. Each frame, EvalContext reports the
+// commands that touch them; at the end of the frame the planner turns that
+// trace into a lifetime interval [first, last] per resource and packs
+// resources with disjoint lifetimes into shared slots. On the next frame a
+// resource borrows its slot's storage at its first use and hands it back
+// after its last use, so peak memory is the sum of the slots rather than the
+// sum of all scratch resources, and the same few allocations stay hot in
+// cache across passes.
+//
+// The first frame (and any frame whose command trace differs from the plan)
+// runs unaliased while the plan is rebuilt.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MemoryPlanner {
+public:
+  // Mark resource `idx` as transient. Its contents are undefined at first use
+  // each frame, unless `clear` is set, in which case it starts filled with
+  // `clearValue`.
+  void declareTransient(size_t idx, bool clear = false,
+                        float clearValue = 0.0f) {
+    Entry &e = entry(idx);
+    e.transient = true;
+    e.clear = clear;
+    e.clearValue = clearValue;
+  }
+
+  bool isTransient(size_t idx) const {
+    return idx < entries.size() && entries[idx].transient;
+  }
+
+  // Start a command; returns its index within the frame.
+  int beginCommand() { return commandCount++; }
+
+  // Record that command `cmd` touches transient resource `idx`.
+  void recordUse(size_t idx, int cmd) {
+    Entry &e = entry(idx);
+    if (e.traceFirst < 0)
+      e.traceFirst = cmd;
+    e.traceLast = cmd;
+  }
+
+  // True if `idx` has a planned slot but does not hold its storage yet.
+  bool needsAcquire(size_t idx) const {
+    const Entry &e = entries[idx];
+    return e.slot >= 0 && !e.bound && !e.spilled;
+  }
+
+  // True if the slot `idx` is planned into is still held by another
+  // resource (whose release is pending).
+  bool slotBusy(size_t idx) const {
+    const Entry &e = entries[idx];
+    return e.slot >= 0 && slots[e.slot].tenant >= 0 &&
+           slots[e.slot].tenant != static_cast<int>(idx);
+  }
+
+  // Resize of a transient resource that holds no storage: remember the size
+  // (and whether to clear) for its next acquire instead of allocating.
+  // Returns false if the resize must be applied to the data directly.
+  bool deferResize(size_t idx, size_t floatCount, bool clear) {
+    if (!isTransient(idx))
+      return false;
+    Entry &e = entries[idx];
+    if (!needsAcquire(idx))
+      return false;
+    e.floatCount = floatCount;
+    e.clearPending = e.clearPending || clear;
+    return true;
+  }
+
+  // Move the slot's storage into `data`, sized to the resource's last known
+  // size. If the slot is unexpectedly still in use (the frame diverged from
+  // the plan), the resource gets private storage for the rest of the frame.
+  void acquire(size_t idx, std::vector<float> &data) {
+    Entry &e = entries[idx];
+    if (slotBusy(idx)) {
+      e.spilled = true;
+      data.resize(e.floatCount);
+      fill(e, data);
+      return;
+    }
+    Slot &s = slots[e.slot];
+    s.tenant = static_cast<int>(idx);
+    s.storage.resize(e.floatCount);
+    fill(e, s.storage);
+    data.swap(s.storage);
+    e.bound = true;
+  }
+
+  // True if `idx` holds slot storage and command `cmd` is its last planned
+  // use.
+  bool releasesAfter(size_t idx, int cmd) const {
+    const Entry &e = entries[idx];
+    return e.bound && cmd >= e.planLast;
+  }
+
+  // Return borrowed storage to the slot.
+  void release(size_t idx, std::vector<float> &data) {
+    Entry &e = entries[idx];
+    if (!e.bound)
+      return;
+    Slot &s = slots[e.slot];
+    e.floatCount = data.size();
+    data.swap(s.storage);
+    std::vector<float>().swap(data);
+    s.tenant = -1;
+    e.bound = false;
+  }
+
+  // Close the frame: return all storage to the pool and, if this frame's
+  // command trace differs from the plan, rebuild the plan from it.
+  // `dataOf(idx)` returns the data vector of resource idx.
+  template <typename DataOf> void endFrame(DataOf dataOf) {
+    bool changed = false;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      Entry &e = entries[i];
+      if (!e.transient)
+        continue;
+      std::vector<float> &data = dataOf(i);
+      if (e.bound) {
+        release(i, data);
+      } else if (!data.empty()) {
+        // Private storage (unplanned or spilled): keep its size for the plan.
+        e.floatCount = data.size();
+      }
+      if (e.traceFirst != e.planFirst || e.traceLast != e.planLast)
+        changed = true;
+    }
+    if (changed)
+      rebuildPlan();
+
+    // Hand private storage to the pool so the next frame runs aliased.
+    for (size_t i = 0; i < entries.size(); ++i) {
+      Entry &e = entries[i];
+      if (!e.transient || e.slot < 0)
+        continue;
+      std::vector<float> &data = dataOf(i);
+      if (data.empty())
+        continue;
+      Slot &s = slots[e.slot];
+      if (data.capacity() > s.storage.capacity())
+        data.swap(s.storage);
+      std::vector<float>().swap(data);
+    }
+    for (auto &e : entries) {
+      e.traceFirst = e.traceLast = -1;
+      e.spilled = false;
+    }
+    commandCount = 0;
+    ++frames;
+  }
+
+  // Statistics (floats)
+  size_t pooledFloats() const {
+    size_t n = 0;
+    for (const auto &s : slots)
+      n += s.storage.capacity();
+    return n;
+  }
+  size_t unaliasedFloats() const {
+    size_t n = 0;
+    for (const auto &e : entries)
+      if (e.transient)
+        n += e.floatCount;
+    return n;
+  }
+  size_t slotCount() const { return slots.size(); }
+  size_t frameCount() const { return frames; }
+
+private:
+  struct Entry {
+    bool transient = false;
+    bool clear = false;
+    float clearValue = 0.0f;
+    size_t floatCount = 0;
+    int traceFirst = -1, traceLast = -1; // current frame
+    int planFirst = -1, planLast = -1;   // plan
+    int slot = -1;
+    bool bound = false;
+    bool spilled = false;
+    bool clearPending = false; // deferred clear-on-resize
+  };
+
+  struct Slot {
+    std::vector<float> storage;
+    int tenant = -1;
+    int lastEnd = -1;
+    size_t floatCount = 0;
+  };
+
+  Entry &entry(size_t idx) {
+    if (idx >= entries.size())
+      entries.resize(idx + 1);
+    return entries[idx];
+  }
+
+  static void fill(Entry &e, std::vector<float> &v) {
+    if (e.clear)
+      std::fill(v.begin(), v.end(), e.clearValue);
+    else if (e.clearPending)
+      std::fill(v.begin(), v.end(), 0.0f);
+    e.clearPending = false;
+  }
+
+  // Interval packing: visit lifetimes by start and reuse the free slot whose
+  // size is closest to the resource's, opening a new slot if none is free.
+  void rebuildPlan() {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      Entry &e = entries[i];
+      e.planFirst = e.traceFirst;
+      e.planLast = e.traceLast;
+      e.slot = -1;
+      if (e.transient && e.traceFirst >= 0)
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return entries[a].planFirst < entries[b].planFirst;
+    });
+
+    std::vector<Slot> planned;
+    for (size_t i : order) {
+      Entry &e = entries[i];
+      int best = -1;
+      size_t bestCost = SIZE_MAX;
+      for (size_t s = 0; s < planned.size(); ++s) {
+        if (planned[s].lastEnd >= e.planFirst)
+          continue;
+        size_t have = planned[s].floatCount;
+        size_t cost = have > e.floatCount ? have - e.floatCount
+                                          : e.floatCount - have;
+        if (cost < bestCost) {
+          bestCost = cost;
+          best = static_cast<int>(s);
+        }
+      }
+      if (best < 0) {
+        best = static_cast<int>(planned.size());
+        planned.emplace_back();
+      }
+      Slot &s = planned[best];
+      s.lastEnd = e.planLast;
+      s.floatCount = std::max(s.floatCount, e.floatCount);
+      e.slot = best;
+    }
+
+    // Keep existing allocations where possible.
+    for (size_t s = 0; s < planned.size() && s < slots.size(); ++s)
+      planned[s].storage.swap(slots[s].storage);
+    slots.swap(planned);
+  }
+
+  std::vector<Entry> entries;
+  std::vector<Slot> slots;
+  int commandCount = 0;
+  size_t frames = 0;
+};
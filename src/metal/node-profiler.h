@@ -0,0 +1,224 @@
+#pragma once
+
+// Per-IR-node profiling of generated host code.
+//
+// With CppOptions.profile, CppGenerator brackets every emitted function and
+// executable node (optionally also pure expressions) with NodeProfiler calls
+// keyed by a site index. The generated declare_profile_sites() registers the
+// site table, which maps each index back to its IR function id, node id and
+// op. Timestamps are raw CPU counters (rdtsc / cntvct_el0, steady_clock
+// elsewhere) and are converted to nanoseconds only when a report is written.
+//
+// Per site the profiler keeps the call count and inclusive and self time.
+// Per call path (a trie of sites rooted at the entry point) it keeps the self
+// time, which is what folded stacks for flamegraphs need. Generated host code
+// runs on one thread, so the profiler is not synchronized.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// One instrumented function or node, as emitted by CppGenerator.
+struct ProfileSite {
+  const char *function; // IR function id
+  const char *node;     // IR node id ("" for the function itself)
+  const char *op;       // IR op ("func" for the function itself)
+};
+
+class NodeProfiler {
+public:
+  struct SiteStats {
+    uint64_t count = 0;
+    uint64_t totalTicks = 0; // inclusive
+    uint64_t selfTicks = 0;  // excluding nested sites
+  };
+
+  static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+  }
+
+  // Register the site table (the generated declare_profile_sites() does
+  // this) and clear all statistics. Until then enter() records nothing.
+  void declareSites(const ProfileSite *table, size_t count) {
+    sites.assign(table, table + count);
+    reset();
+  }
+
+  bool enabled() const { return !sites.empty(); }
+
+  // Clear statistics, keeping the site table.
+  void reset() {
+    stats.assign(sites.size(), SiteStats{});
+    paths.clear();
+    pathIndex.clear();
+    stack.clear();
+    startTicks = ticks();
+    startTime = std::chrono::steady_clock::now();
+  }
+
+  void enter(uint32_t site) {
+    if (site >= stats.size())
+      return;
+    uint32_t parent = stack.empty() ? kRoot : stack.back().path;
+    stack.push_back(Frame{site, pathFor(parent, site), ticks(), 0});
+  }
+
+  // Close the innermost open site.
+  void exit() {
+    if (stack.empty())
+      return;
+    uint64_t now = ticks();
+    Frame f = stack.back();
+    stack.pop_back();
+    uint64_t total = now - f.start;
+    uint64_t self = total > f.childTicks ? total - f.childTicks : 0;
+    SiteStats &s = stats[f.site];
+    ++s.count;
+    s.totalTicks += total;
+    s.selfTicks += self;
+    paths[f.path].selfTicks += self;
+    if (!stack.empty())
+      stack.back().childTicks += total;
+  }
+
+  size_t depth() const { return stack.size(); }
+
+  // Close sites until `d` remain open.
+  void exitTo(size_t d) {
+    while (stack.size() > d)
+      exit();
+  }
+
+  // Function-level guard. Its destructor also closes node sites left open by
+  // an early return.
+  class Scope {
+  public:
+    Scope(NodeProfiler &profiler, uint32_t site)
+        : profiler(profiler), depth(profiler.depth()) {
+      profiler.enter(site);
+    }
+    ~Scope() { profiler.exitTo(depth); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    NodeProfiler &profiler;
+    size_t depth;
+  };
+
+  const std::vector<ProfileSite> &siteTable() const { return sites; }
+  const SiteStats &siteStats(size_t site) const { return stats[site]; }
+
+  // Counter ticks per nanosecond, measured since the last reset().
+  double ticksPerNs() const {
+    double ns = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count());
+    double t = static_cast<double>(ticks() - startTicks);
+    return ns > 0.0 && t > 0.0 ? t / ns : 1.0;
+  }
+
+  // JSON array with one entry per site that ran:
+  // {"function","node","op","count","totalNs","selfNs"}
+  void writeReport(std::ostream &out) const {
+    double scale = 1.0 / ticksPerNs();
+    out << "[";
+    bool first = true;
+    for (size_t i = 0; i < sites.size(); ++i) {
+      const SiteStats &s = stats[i];
+      if (s.count == 0)
+        continue;
+      if (!first)
+        out << ",";
+      first = false;
+      out << "{\"function\":\"" << sites[i].function << "\",\"node\":\""
+          << sites[i].node << "\",\"op\":\"" << sites[i].op
+          << "\",\"count\":" << s.count << ",\"totalNs\":"
+          << static_cast<uint64_t>(static_cast<double>(s.totalTicks) * scale)
+          << ",\"selfNs\":"
+          << static_cast<uint64_t>(static_cast<double>(s.selfTicks) * scale)
+          << "}";
+    }
+    out << "]";
+  }
+
+  // Folded stacks ("frame;frame;frame selfNs" per line) for flamegraph.pl
+  // and speedscope. Function frames are the function id; node frames are
+  // "node_id (op)".
+  void writeFolded(std::ostream &out) const {
+    double scale = 1.0 / ticksPerNs();
+    std::vector<uint32_t> chain;
+    for (uint32_t p = 0; p < paths.size(); ++p) {
+      uint64_t ns =
+          static_cast<uint64_t>(static_cast<double>(paths[p].selfTicks) * scale);
+      if (ns == 0)
+        continue;
+      chain.clear();
+      for (uint32_t q = p; q != kRoot; q = paths[q].parent)
+        chain.push_back(paths[q].site);
+      for (size_t i = chain.size(); i-- > 0;) {
+        const ProfileSite &s = sites[chain[i]];
+        if (s.node[0] == '\0')
+          out << s.function;
+        else
+          out << s.node << " (" << s.op << ")";
+        out << (i > 0 ? ";" : " ");
+      }
+      out << ns << "\n";
+    }
+  }
+
+private:
+  static constexpr uint32_t kRoot = UINT32_MAX;
+
+  struct Frame {
+    uint32_t site;
+    uint32_t path;
+    uint64_t start;
+    uint64_t childTicks;
+  };
+
+  struct PathNode {
+    uint32_t parent;
+    uint32_t site;
+    uint64_t selfTicks = 0;
+  };
+
+  uint32_t pathFor(uint32_t parent, uint32_t site) {
+    uint64_t key = (static_cast<uint64_t>(parent) << 32) | site;
+    auto it = pathIndex.find(key);
+    if (it != pathIndex.end())
+      return it->second;
+    uint32_t idx = static_cast<uint32_t>(paths.size());
+    paths.push_back(PathNode{parent, site});
+    pathIndex.emplace(key, idx);
+    return idx;
+  }
+
+  std::vector<ProfileSite> sites;
+  std::vector<SiteStats> stats;
+  std::vector<PathNode> paths;
+  std::unordered_map<uint64_t, uint32_t> pathIndex; // (parent, site) -> path
+  std::vector<Frame> stack;
+  uint64_t startTicks = 0;
+  std::chrono::steady_clock::time_point startTime;
+};
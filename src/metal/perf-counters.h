@@ -0,0 +1,287 @@
+#pragma once
+
+// Hardware performance counters around CPU dispatches and copies.
+//
+// A host attaches a PerfCounters as `ctx.perf`. Every thread that runs part
+// of a CPU command (the issuing thread for copies, each worker for dispatch
+// tiles) then reads its own counter group (cycles, instructions, last-level
+// cache misses, branch misses) before and after its share. The deltas are
+// summed per command and aggregated per shader function, or per copy kind.
+//
+// Groups are opened with perf_event_open on Linux, one per thread on first
+// use, counting user space only. When counters are not permitted
+// (perf_event_paranoid, containers, VMs) or on other platforms, available()
+// is false, reason() says why and nothing is sampled. Counters the CPU lacks
+// read as zero.
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct PerfSample {
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t llcMisses = 0;
+  uint64_t branchMisses = 0;
+
+  PerfSample &operator+=(const PerfSample &o) {
+    cycles += o.cycles;
+    instructions += o.instructions;
+    llcMisses += o.llcMisses;
+    branchMisses += o.branchMisses;
+    return *this;
+  }
+  PerfSample operator-(const PerfSample &o) const {
+    return {cycles - o.cycles, instructions - o.instructions,
+            llcMisses - o.llcMisses, branchMisses - o.branchMisses};
+  }
+};
+
+class PerfCounters {
+public:
+  // Probes the counters on the constructing thread.
+  PerfCounters() {
+    PerfSample probe;
+    ok = readThread(probe);
+    if (!ok)
+      why = threadGroup().error;
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool available() const { return ok; }
+  // Why counters are unavailable (empty when available).
+  const std::string &reason() const { return why; }
+
+  // Current counts of the calling thread's group. False when it could not
+  // be opened.
+  static bool readThread(PerfSample &out) {
+    Group &g = threadGroup();
+    return g.read(out);
+  }
+
+  // Deltas of the threads running parts of one command, summed.
+  class Accumulator {
+  public:
+    void add(const PerfSample &s) {
+      values[0].fetch_add(s.cycles, std::memory_order_relaxed);
+      values[1].fetch_add(s.instructions, std::memory_order_relaxed);
+      values[2].fetch_add(s.llcMisses, std::memory_order_relaxed);
+      values[3].fetch_add(s.branchMisses, std::memory_order_relaxed);
+    }
+    PerfSample total() const {
+      return {values[0].load(std::memory_order_relaxed),
+              values[1].load(std::memory_order_relaxed),
+              values[2].load(std::memory_order_relaxed),
+              values[3].load(std::memory_order_relaxed)};
+    }
+
+  private:
+    std::atomic<uint64_t> values[4] = {};
+  };
+
+  // Adds the calling thread's counts over the enclosing scope to
+  // `accumulator` when `counters` is non-null and available.
+  class Scope {
+  public:
+    Scope(const PerfCounters *counters, Accumulator &accumulator)
+        : accumulator(accumulator),
+          active(counters && counters->available() && readThread(start)) {}
+    ~Scope() {
+      PerfSample end;
+      if (active && readThread(end))
+        accumulator.add(end - start);
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    Accumulator &accumulator;
+    PerfSample start;
+    bool active;
+  };
+
+  // One command: sums the Scopes opened on accumulator() and, when it ends,
+  // records the total under `name` and stores it in `*out` (the command's
+  // trace event) when `out` is non-null. Does nothing if `counters` is null
+  // or unavailable.
+  class Command {
+  public:
+    Command(PerfCounters *counters, const char *name, PerfSample *out)
+        : counters(counters), name(name), out(out) {}
+    ~Command() {
+      if (!counters || !counters->available())
+        return;
+      PerfSample total = sum.total();
+      counters->add(name, total);
+      if (out)
+        *out = total;
+    }
+    Command(const Command &) = delete;
+    Command &operator=(const Command &) = delete;
+
+    Accumulator &accumulator() { return sum; }
+
+  private:
+    PerfCounters *counters;
+    const char *name;
+    PerfSample *out;
+    Accumulator sum;
+  };
+
+  struct Totals {
+    std::string name;
+    uint64_t calls = 0;
+    PerfSample counters;
+  };
+
+  // Record one command's counters under `name` (a shader function, or
+  // copyBuffer / copyTexture).
+  void add(const char *name, const PerfSample &sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Totals &t : totals) {
+      if (t.name == name) {
+        ++t.calls;
+        t.counters += sample;
+        return;
+      }
+    }
+    totals.push_back({name, 1, sample});
+  }
+
+  std::vector<Totals> snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totals;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    totals.clear();
+  }
+
+  // {"available":true,"functions":[{"name","calls","cycles","instructions",
+  // "llcMisses","branchMisses","ipc"},...]} or {"available":false,
+  // "reason":"..."}.
+  void writeJson(std::ostream &out) const {
+    if (!ok) {
+      out << "{\"available\":false,\"reason\":\"";
+      for (char c : why)
+        out << (c == '"' || c == '\\' ? ' ' : c);
+      out << "\"}";
+      return;
+    }
+    out << "{\"available\":true,\"functions\":[";
+    bool first = true;
+    for (const Totals &t : snapshot()) {
+      if (!first)
+        out << ",";
+      first = false;
+      const PerfSample &c = t.counters;
+      out << "{\"name\":\"" << t.name << "\",\"calls\":" << t.calls
+          << ",\"cycles\":" << c.cycles
+          << ",\"instructions\":" << c.instructions
+          << ",\"llcMisses\":" << c.llcMisses
+          << ",\"branchMisses\":" << c.branchMisses << ",\"ipc\":"
+          << (c.cycles ? static_cast<double>(c.instructions) / c.cycles : 0.0)
+          << "}";
+    }
+    out << "]}";
+  }
+
+private:
+  // One thread's counter group: cycles leads, the others follow when the
+  // CPU has them.
+  struct Group {
+    int fds[4] = {-1, -1, -1, -1};
+    bool opened = false;
+    std::string error;
+
+    ~Group() {
+#if defined(__linux__)
+      for (int fd : fds)
+        if (fd >= 0)
+          close(fd);
+#endif
+    }
+
+    bool read(PerfSample &out) {
+      if (!opened) {
+        opened = true;
+        open();
+      }
+      if (fds[0] < 0)
+        return false;
+#if defined(__linux__)
+      // PERF_FORMAT_GROUP: {nr, values[nr]} in the order members were added
+      uint64_t buf[1 + 4] = {};
+      if (::read(fds[0], buf, sizeof(buf)) < static_cast<ssize_t>(sizeof(uint64_t)))
+        return false;
+      uint64_t *field[4] = {&out.cycles, &out.instructions, &out.llcMisses,
+                            &out.branchMisses};
+      size_t next = 1;
+      for (int i = 0; i < 4; ++i)
+        *field[i] = fds[i] >= 0 && next <= buf[0] ? buf[next++] : 0;
+      return true;
+#else
+      (void)out;
+      return false;
+#endif
+    }
+
+    void open() {
+#if defined(__linux__)
+      const uint64_t configs[4] = {
+          PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+          PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+      for (int i = 0; i < 4; ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = i == 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1,
+                          i == 0 ? -1 : fds[0], 0);
+        if (fd < 0) {
+          if (i == 0) {
+            error = std::string("perf_event_open: ") + std::strerror(errno);
+            return;
+          }
+          continue; // counter not supported here
+        }
+        fds[i] = static_cast<int>(fd);
+      }
+      ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+      error = "hardware counters need perf_event_open (Linux)";
+#endif
+    }
+  };
+
+  static Group &threadGroup() {
+    thread_local Group group;
+    return group;
+  }
+
+  bool ok = false;
+  std::string why;
+  mutable std::mutex mutex;
+  std::vector<Totals> totals;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+// Cache of compiled render pipeline states for EvalContext::draw().
+//
+// Building a render pipeline (looking up both functions and compiling the
+// state) is far more expensive than the draw itself, and a frame issues the
+// same draws every time. PipelineCache keeps one compiled state per
+// PipelineKey; the backend supplies the state type and a factory that
+// compiles it on a miss (an MTLRenderPipelineState for Metal, any
+// copyable handle for other backends and tests).
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// Everything a compiled render pipeline depends on.
+struct PipelineKey {
+  std::string vertexFunction;
+  std::string fragmentFunction;
+  uint64_t targetFormat = 0; // backend pixel format of the color target
+  uint32_t blendMode = 0;    // 0 = blending disabled
+  bool loadExisting = false; // color attachment is loaded, not cleared
+
+  bool operator==(const PipelineKey &o) const {
+    return vertexFunction == o.vertexFunction &&
+           fragmentFunction == o.fragmentFunction &&
+           targetFormat == o.targetFormat && blendMode == o.blendMode &&
+           loadExisting == o.loadExisting;
+  }
+};
+
+struct PipelineKeyHash {
+  size_t operator()(const PipelineKey &k) const {
+    size_t h = std::hash<std::string>()(k.vertexFunction);
+    auto mix = [&h](size_t v) { h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2); };
+    mix(std::hash<std::string>()(k.fragmentFunction));
+    mix(std::hash<uint64_t>()(k.targetFormat));
+    mix(std::hash<uint32_t>()(k.blendMode));
+    mix(k.loadExisting ? 1 : 0);
+    return h;
+  }
+};
+
+template <typename State> class PipelineCache {
+public:
+  // Return the state for `key`, compiling it with `create` on a miss.
+  // Failed compilations (a null state) are not cached, so the error is
+  // reported again on the next attempt.
+  template <typename Create> State get(const PipelineKey &key, Create create) {
+    auto it = states.find(key);
+    if (it != states.end()) {
+      ++hits;
+      return it->second;
+    }
+    ++misses;
+    State state = create();
+    if (state)
+      states.emplace(key, state);
+    return state;
+  }
+
+  size_t size() const { return states.size(); }
+  void clear() { states.clear(); }
+
+  // Statistics
+  size_t hits = 0;
+  size_t misses = 0;
+
+private:
+  std::unordered_map<PipelineKey, State, PipelineKeyHash> states;
+};
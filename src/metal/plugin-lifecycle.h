@@ -0,0 +1,112 @@
+#pragma once
+
+// Per-frame lifecycle of a generated plugin.
+//
+// PluginLifecycle drives the generated PLUGIN_CLASS helpers (map_params,
+// setup_resources) for a host that hands over one output and a list of input
+// textures every frame: NanoPlugin::ProcessOpenGL in ffgl-plugin.mm with
+// interop textures, and host-simulator.cpp with host float buffers. It keeps
+// one EvalContext for the life of the plugin instance, so pipelines,
+// samplers and device copies carry over between frames; bindings are rebuilt
+// only when the number of inputs changes and patched when a texture is
+// recreated at a new size.
+//
+// Plugin provides, besides the generated map_params / setup_resources:
+//   void init_context(EvalContext &ctx);  // once for every new context
+//   bool bind_texture(ResourceState &state, Texture &tex);
+//       // point `state` at `tex`; true if the binding changed
+//
+// Include after intrinsics.incl.h.
+
+#include <memory>
+#include <vector>
+
+template <typename Plugin, typename Texture> class PluginLifecycle {
+public:
+  explicit PluginLifecycle(Plugin &plugin) : plugin(plugin) {}
+
+  // Start a frame: create the context on first use, then write the
+  // parameters into it.
+  EvalContext &beginFrame() {
+    if (!ctx) {
+      ctx = std::make_unique<EvalContext>();
+      plugin.init_context(*ctx);
+      ++contextsCreated;
+    }
+    ctx->beginHostFrame();
+    plugin.map_params(*ctx);
+    return *ctx;
+  }
+
+  // Bind this frame's output and input textures (resources 0, 1..n).
+  void bind(Texture &output, const std::vector<Texture *> &inputs) {
+    EvalContext &c = *ctx;
+    if (!bindingsValid || inputs.size() != inputStates.size()) {
+      c.resetBindings();
+      plugin.bind_texture(outputState, output);
+      inputStates.clear();
+      inputPtrs.clear();
+      for (Texture *tex : inputs) {
+        auto state = std::make_unique<ResourceState>();
+        plugin.bind_texture(*state, *tex);
+        inputPtrs.push_back(state.get());
+        inputStates.push_back(std::move(state));
+      }
+      plugin.setup_resources(c, &outputState, inputPtrs);
+      bindingsValid = true;
+      ++rebinds;
+      return;
+    }
+    // Output first, then texture inputs (setup_resources order)
+    if (plugin.bind_texture(outputState, output)) {
+      c.rebindResource(0);
+      ++patches;
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      if (plugin.bind_texture(*inputStates[i], *inputs[i])) {
+        c.rebindResource(i + 1);
+        ++patches;
+      }
+    }
+  }
+
+  // Time builtins, in seconds. The input slots are looked up once per
+  // context.
+  void setTime(float time, float deltaTime) {
+    if (!timeInput) {
+      timeInput = &ctx->inputs["time"];
+      deltaTimeInput = &ctx->inputs["delta_time"];
+    }
+    *timeInput = time;
+    *deltaTimeInput = deltaTime;
+  }
+
+  // Drop the context and its bindings (GL teardown). The next frame starts
+  // from a new context.
+  void reset() {
+    ctx.reset();
+    bindingsValid = false;
+    timeInput = nullptr;
+    deltaTimeInput = nullptr;
+  }
+
+  EvalContext *context() const { return ctx.get(); }
+  ResourceState &output() { return outputState; }
+  ResourceState &input(size_t i) { return *inputStates[i]; }
+
+  // Statistics
+  size_t contextsCreated = 0;
+  size_t rebinds = 0; // bindings rebuilt
+  size_t patches = 0; // single bindings patched
+
+private:
+  Plugin &plugin;
+  ResourceState outputState;
+  std::vector<std::unique_ptr<ResourceState>> inputStates;
+  std::vector<ResourceState *> inputPtrs;
+  // Declared after the states it binds, so it is destroyed first
+  std::unique_ptr<EvalContext> ctx;
+  bool bindingsValid = false;
+  float *timeInput = nullptr;
+  float *deltaTimeInput = nullptr;
+};
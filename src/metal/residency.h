@@ -0,0 +1,221 @@
+#pragma once
+
+// Host/device residency tracking for EvalContext.
+//
+// Every resource has a host copy (ResourceState::data) and, on a GPU
+// backend, a device copy. ResidencyTracker records which byte ranges of each
+// copy have been written since the two were last in sync, and moves only
+// those ranges through a TransferDevice when the other side needs them. A
+// device copy is (re)allocated and fully uploaded only when its size
+// changes. Bytes moved are counted per frame.
+//
+// TransferDevice is the only contact with the backend, so the policy can be
+// exercised against SimulatedDevice without a GPU.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Half-open byte range [begin, end).
+struct ByteRange {
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+// Sorted, non-overlapping set of byte ranges. Adjacent and overlapping
+// ranges are merged on insert.
+class DirtyRanges {
+public:
+  void add(size_t begin, size_t end) {
+    if (begin >= end)
+      return;
+    auto it = std::lower_bound(
+        list.begin(), list.end(), begin,
+        [](const ByteRange &r, size_t b) { return r.end < b; });
+    auto last = it;
+    while (last != list.end() && last->begin <= end) {
+      begin = std::min(begin, last->begin);
+      end = std::max(end, last->end);
+      ++last;
+    }
+    it = list.erase(it, last);
+    list.insert(it, {begin, end});
+  }
+
+  // Drop everything at or beyond `size` (the resource shrank).
+  void clip(size_t size) {
+    while (!list.empty() && list.back().begin >= size)
+      list.pop_back();
+    if (!list.empty())
+      list.back().end = std::min(list.back().end, size);
+  }
+
+  void clear() { list.clear(); }
+  bool empty() const { return list.empty(); }
+
+  size_t bytes() const {
+    size_t n = 0;
+    for (const auto &r : list)
+      n += r.end - r.begin;
+    return n;
+  }
+
+  const std::vector<ByteRange> &ranges() const { return list; }
+
+private:
+  std::vector<ByteRange> list;
+};
+
+// Device-side storage for resources, addressed by resource index.
+class TransferDevice {
+public:
+  virtual ~TransferDevice() = default;
+
+  // Size of the device copy of `idx` in bytes (0 if none).
+  virtual size_t allocatedBytes(size_t idx) const = 0;
+  // Replace the device copy of `idx` with `bytes` bytes initialized from
+  // `src`.
+  virtual void allocate(size_t idx, const void *src, size_t bytes) = 0;
+  virtual void upload(size_t idx, size_t offset, const void *src,
+                      size_t bytes) = 0;
+  virtual void download(size_t idx, size_t offset, void *dst,
+                        size_t bytes) = 0;
+};
+
+// In-memory TransferDevice for tests and benchmarks.
+class SimulatedDevice : public TransferDevice {
+public:
+  size_t allocatedBytes(size_t idx) const override {
+    return idx < memory.size() ? memory[idx].size() : 0;
+  }
+
+  void allocate(size_t idx, const void *src, size_t bytes) override {
+    if (idx >= memory.size())
+      memory.resize(idx + 1);
+    memory[idx].assign(static_cast<const uint8_t *>(src),
+                       static_cast<const uint8_t *>(src) + bytes);
+  }
+
+  void upload(size_t idx, size_t offset, const void *src,
+              size_t bytes) override {
+    std::memcpy(memory[idx].data() + offset, src, bytes);
+  }
+
+  void download(size_t idx, size_t offset, void *dst, size_t bytes) override {
+    std::memcpy(dst, memory[idx].data() + offset, bytes);
+  }
+
+  // Direct access to the device copy (stands in for kernels writing it).
+  uint8_t *contents(size_t idx) { return memory[idx].data(); }
+
+private:
+  std::vector<std::vector<uint8_t>> memory;
+};
+
+class ResidencyTracker {
+public:
+  struct Stats {
+    size_t uploadedBytes = 0;
+    size_t downloadedBytes = 0;
+    size_t allocations = 0; // full (re)allocating uploads
+  };
+
+  // Host code wrote bytes [begin, end) of `idx`.
+  void markHostDirty(size_t idx, size_t begin, size_t end) {
+    state(idx).hostDirty.add(begin, end);
+  }
+
+  // Device work wrote bytes [begin, end) of `idx`.
+  void markDeviceDirty(size_t idx, size_t begin, size_t end) {
+    state(idx).deviceDirty.add(begin, end);
+  }
+
+  // Whole-resource variants (the size is clipped at transfer time).
+  void markHostDirty(size_t idx) { markHostDirty(idx, 0, SIZE_MAX); }
+  void markDeviceDirty(size_t idx) { markDeviceDirty(idx, 0, SIZE_MAX); }
+
+  bool hostDirty(size_t idx) const {
+    return idx < states.size() && !states[idx].hostDirty.empty();
+  }
+  bool deviceDirty(size_t idx) const {
+    return idx < states.size() && !states[idx].deviceDirty.empty();
+  }
+
+  // Bring the device copy of `idx` up to date with `bytes` bytes of host
+  // data: allocate it if its size differs, otherwise upload the host-dirty
+  // ranges.
+  void makeDeviceCurrent(size_t idx, TransferDevice &device, const void *host,
+                         size_t bytes) {
+    State &s = state(idx);
+    if (device.allocatedBytes(idx) != bytes) {
+      device.allocate(idx, host, bytes);
+      s.hostDirty.clear();
+      s.deviceDirty.clear();
+      frame.uploadedBytes += bytes;
+      ++frame.allocations;
+      return;
+    }
+    s.hostDirty.clip(bytes);
+    for (const auto &r : s.hostDirty.ranges()) {
+      device.upload(idx, r.begin, static_cast<const uint8_t *>(host) + r.begin,
+                    r.end - r.begin);
+      frame.uploadedBytes += r.end - r.begin;
+    }
+    s.hostDirty.clear();
+  }
+
+  // Bring `bytes` bytes of host data for `idx` up to date with the device
+  // copy by downloading the device-dirty ranges.
+  void makeHostCurrent(size_t idx, TransferDevice &device, void *host,
+                       size_t bytes) {
+    if (idx >= states.size())
+      return;
+    State &s = states[idx];
+    s.deviceDirty.clip(std::min(bytes, device.allocatedBytes(idx)));
+    for (const auto &r : s.deviceDirty.ranges()) {
+      device.download(idx, r.begin, static_cast<uint8_t *>(host) + r.begin,
+                      r.end - r.begin);
+      frame.downloadedBytes += r.end - r.begin;
+    }
+    s.deviceDirty.clear();
+  }
+
+  // Transfers done outside the tracker (e.g. format-converting texture
+  // uploads) still count towards the frame.
+  void countUpload(size_t bytes) { frame.uploadedBytes += bytes; }
+  void countDownload(size_t bytes) { frame.downloadedBytes += bytes; }
+
+  // Drop all dirty ranges (indices are about to be reassigned). Statistics
+  // are kept.
+  void clear() { states.clear(); }
+
+  // Close the frame's counters.
+  void endFrame() {
+    lastFrame = frame;
+    total.uploadedBytes += frame.uploadedBytes;
+    total.downloadedBytes += frame.downloadedBytes;
+    total.allocations += frame.allocations;
+    frame = {};
+  }
+
+  // Statistics
+  Stats frame;     // current frame
+  Stats lastFrame; // previous frame (after endFrame)
+  Stats total;     // all closed frames
+
+private:
+  struct State {
+    DirtyRanges hostDirty;
+    DirtyRanges deviceDirty;
+  };
+
+  State &state(size_t idx) {
+    if (idx >= states.size())
+      states.resize(idx + 1);
+    return states[idx];
+  }
+
+  std::vector<State> states;
+};
@@ -0,0 +1,254 @@
+// Scene throughput benchmark
+// Runs a generated graph (generated_code.cpp, as for cpp-harness.mm) for a
+// number of frames on one persistent EvalContext, the way the FFGL plugin
+// does, and reports frame-time percentiles and memory high-water marks.
+// scripts/bench-scenes.ts builds it per scene and sweeps resolutions and
+// thread counts. Built as plain C++ (-x c++) it has only the CPU backend and
+// runs on any platform.
+//
+// Usage: scene-bench [metallib_path] [-i name:value ...] [-n frames]
+//                    [-w warmup_frames] [-j threads] [-T tuning_cache]
+//                    <resource_specs...>
+//   Resource specs are those of cpp-harness.mm: <size> or B:<size>:<stride>
+//   for buffers, T:<width>:<height>[:<wrap>] for textures.
+//   Without a metallib, shaders run as CPU kernels (draws are skipped).
+//   -j sizes the CPU worker pool (0 = one thread per core).
+//   -T applies this machine's autotuned values (tuning-cache.h); -i wins.
+// Prints {"frames","threads","frameMs":{"mean","min","p50","p90","p99",
+// "max"},"peakResourceBytes","reallocations","allocationsPerFrame":{"mean",
+// "max"},"peakRssBytes","graphHash","machine","tunedValues"}; allocations
+// are counted over the measured frames. scripts/autotune.ts uses it as its
+// frame timer.
+
+#if defined(__OBJC__)
+#import <Foundation/Foundation.h>
+#import <Metal/Metal.h>
+#endif
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "alloc-counter.h"
+#include "intrinsics.incl.h"
+
+NANO_DEFINE_ALLOC_COUNTER()
+
+#if NANO_HAS_METAL
+// Load a .metallib file
+id<MTLLibrary> loadMetalLib(id<MTLDevice> device, const char *path) {
+  NSError *error = nil;
+  NSString *nsPath = [NSString stringWithUTF8String:path];
+  NSURL *libraryURL = [NSURL fileURLWithPath:nsPath];
+  id<MTLLibrary> library = [device newLibraryWithURL:libraryURL error:&error];
+  if (!library) {
+    std::cerr << "Failed to load metallib: "
+              << (error ? [[error localizedDescription] UTF8String] : "unknown")
+              << std::endl;
+    return nil;
+  }
+  return library;
+}
+#endif
+
+#include "generated_code.cpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Value at fraction `q` of the sorted samples (nearest rank).
+double percentile(const std::vector<double> &sorted, double q) {
+  if (sorted.empty())
+    return 0.0;
+  size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+size_t peakRssBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return static_cast<size_t>(usage.ru_maxrss); // bytes
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+}
+
+int runBench(int argc, const char *argv[]) {
+  EvalContext ctx;
+  std::vector<ResourceState> resourceStorage;
+
+  int argStart = 1;
+  if (argc > 1) {
+    std::string firstArg = argv[1];
+    if (firstArg.size() > 9 &&
+        firstArg.substr(firstArg.size() - 9) == ".metallib") {
+#if NANO_HAS_METAL
+      id<MTLDevice> device = MTLCreateSystemDefaultDevice();
+      id<MTLCommandQueue> commandQueue = [device newCommandQueue];
+      id<MTLLibrary> library = loadMetalLib(device, argv[1]);
+      ctx.initMetal(device, commandQueue, library);
+      argStart = 2;
+#else
+      std::cerr << "Built without Metal; run without a metallib"
+                << std::endl;
+      return 1;
+#endif
+    }
+  }
+
+  int frames = 120;
+  int warmup = 5;
+  unsigned threads = 0;
+  std::vector<std::string> resourceArgs;
+  std::vector<std::pair<std::string, float>> inputArgs;
+  std::string tuningPath;
+  for (int i = argStart; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-i" && i + 1 < argc) {
+      std::string input = argv[++i];
+      auto colonPos = input.find(':');
+      if (colonPos != std::string::npos)
+        inputArgs.emplace_back(input.substr(0, colonPos),
+                               std::stof(input.substr(colonPos + 1)));
+    } else if (arg == "-T" && i + 1 < argc) {
+      tuningPath = argv[++i];
+    } else if (arg == "-n" && i + 1 < argc) {
+      frames = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "-w" && i + 1 < argc) {
+      warmup = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "-j" && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else {
+      resourceArgs.push_back(arg);
+    }
+  }
+
+  for (const auto &arg : resourceArgs) {
+    if (arg.size() > 2 && arg[0] == 'T' && arg[1] == ':') {
+      auto firstColon = arg.find(':', 2);
+      auto secondColon = arg.find(':', firstColon + 1);
+      int w = std::stoi(arg.substr(2, firstColon - 2));
+      int h = std::stoi(
+          secondColon != std::string::npos
+              ? arg.substr(firstColon + 1, secondColon - firstColon - 1)
+              : arg.substr(firstColon + 1));
+      int wrap = secondColon != std::string::npos
+                     ? std::stoi(arg.substr(secondColon + 1))
+                     : 0;
+      resourceStorage.push_back(ResourceState{
+          std::vector<float>(static_cast<size_t>(w) * h * 4, 0.0f),
+          (size_t)w, (size_t)h});
+      ctx.isTextureResource.push_back(true);
+      ctx.texWidths.push_back(w);
+      ctx.texHeights.push_back(h);
+      ctx.texWrapModes.push_back(wrap);
+    } else {
+      size_t size = 0;
+      size_t stride = 1;
+      if (arg.size() > 2 && arg[0] == 'B' && arg[1] == ':') {
+        auto firstColon = arg.find(':', 2);
+        size = std::stoull(arg.substr(2, firstColon - 2));
+        if (firstColon != std::string::npos)
+          stride = std::stoull(arg.substr(firstColon + 1));
+      } else {
+        size = std::stoull(arg);
+      }
+      resourceStorage.push_back(
+          ResourceState{std::vector<float>(size * stride, 0.0f), size, 1});
+      ctx.isTextureResource.push_back(false);
+      ctx.texWidths.push_back(0);
+      ctx.texHeights.push_back(0);
+    }
+  }
+  for (auto &res : resourceStorage)
+    ctx.resources.push_back(&res);
+
+  // Tuning defaults (and -T cache values) first; -i overrides both.
+  int tuned = declare_tuning_params(ctx, tuningPath.c_str());
+  for (const auto &kv : inputArgs)
+    ctx.inputs[kv.first] = kv.second;
+
+  WorkerPool pool(threads);
+  ctx.workerPool = &pool;
+
+  declare_frame_graph(ctx);
+  register_cpu_kernels(ctx);
+  declare_profile_sites(ctx);
+
+  // Frames advance at 60 fps of graph time whatever the wall time.
+  const float dt = 1.0f / 60.0f;
+  std::vector<double> frameMs;
+  frameMs.reserve(frames);
+  uint64_t allocations = 0;
+  uint64_t maxAllocations = 0;
+  for (int f = 0; f < warmup + frames; ++f) {
+    auto allocStart = AllocCounter::now();
+    auto start = Clock::now();
+    ctx.beginHostFrame();
+    ctx.inputs["time"] = f * dt;
+    ctx.inputs["delta_time"] = dt;
+    func_main(ctx);
+    ctx.waitForPendingCommands();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                          start)
+                    .count();
+    uint64_t frameAllocs = AllocCounter::since(allocStart).allocations;
+    if (f >= warmup) {
+      frameMs.push_back(ms);
+      allocations += frameAllocs;
+      maxAllocations = std::max(maxAllocations, frameAllocs);
+    }
+  }
+
+  // A dispatch without a CPU kernel did not run, so the times are not the
+  // scene's.
+  if (!ctx.missingCpuKernels.empty())
+    return 1;
+
+  std::vector<double> sorted = frameMs;
+  std::sort(sorted.begin(), sorted.end());
+  auto memory = ctx.memoryStats();
+  double sum = 0.0;
+  for (double ms : sorted)
+    sum += ms;
+
+  std::cout << "{\"frames\":" << frames
+            << ",\"threads\":" << pool.threadCount()
+            << ",\"frameMs\":{\"mean\":" << sum / sorted.size()
+            << ",\"min\":" << sorted.front()
+            << ",\"p50\":" << percentile(sorted, 0.50)
+            << ",\"p90\":" << percentile(sorted, 0.90)
+            << ",\"p99\":" << percentile(sorted, 0.99)
+            << ",\"max\":" << sorted.back() << "}"
+            << ",\"peakResourceBytes\":" << memory.peakBytes
+            << ",\"reallocations\":" << memory.reallocations
+            << ",\"allocationsPerFrame\":{\"mean\":"
+            << static_cast<double>(allocations) / frames
+            << ",\"max\":" << maxAllocations << "}"
+            << ",\"peakRssBytes\":" << peakRssBytes()
+            << ",\"graphHash\":\"" << graph_hash() << "\",\"machine\":\""
+            << tuningMachineKey() << "\",\"tunedValues\":" << tuned << "}"
+            << std::endl;
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+#if NANO_HAS_METAL
+  @autoreleasepool {
+    return runBench(argc, argv);
+  }
+#else
+  return runBench(argc, argv);
+#endif
+}
@@ -0,0 +1,542 @@
+#pragma once
+
+// FFT convolution of RGBA float images with large kernels, for
+// EvalContext::convolveTexture.
+//
+// The image is padded with its edge mode by the kernel radius on every side,
+// up to power-of-two sizes, so the circular convolution of the FFT equals the
+// direct one over the original pixels. Channels are packed in pairs as
+// complex values (R + iG, B + iA): the kernel is real, so one complex
+// transform convolves two real channels, and no separate real-to-complex
+// step is needed. Per pair:
+//
+//  - row pass: forward transforms of the padded rows (all-padding rows below
+//    the image are zero and skipped);
+//  - column pass: forward transforms of the columns, a multiply by the
+//    kernel spectrum, and inverse transforms;
+//  - inverse row pass over only the rows that map to output pixels.
+//
+// Transforms run kFftLanes at a time (eight rows, or eight columns). Element
+// e of lane l sits at [e * kFftLanes + l] in separate real and imaginary
+// arrays, so every butterfly is a straight loop over lanes that the compiler
+// vectorizes. Columns load that layout directly from the row-major spectrum.
+// The transform is a Stockham autosort FFT: radix-4 stages, then one radix-2
+// stage for odd powers of two, with no bit reversal. Batches are spread over
+// the WorkerPool.
+//
+// Kernel spectra (with the 1 / size scale folded in) and the twiddle tables
+// for the padded size are cached by kernel and size, so a steady frame
+// costs the image transforms alone whatever the kernel radius. The cost
+// depends on the padded size only.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "frame-graph.h"
+#include "texture-blur.h"
+
+namespace texture_fft {
+
+constexpr int kFftLanes = 8;
+constexpr int kMaxFftSize = 8192;                // per axis, after padding
+constexpr size_t kMaxFftArea = size_t(1) << 24;  // padded pixels
+constexpr int kMaxCachedSpectra = 4;
+
+// Padded length: a power of two, at least one block of lanes.
+inline int fftSize(int n) {
+  int p = kFftLanes;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+// Twiddles w^k = exp(-2 pi i k / n), k < n.
+struct FftPlan {
+  int n = 0;
+  std::vector<float> re, im;
+
+  void build(int size) {
+    n = size;
+    re.resize(n);
+    im.resize(n);
+    for (int k = 0; k < n; ++k) {
+      double a = -2.0 * 3.14159265358979323846 * k / n;
+      re[k] = static_cast<float>(std::cos(a));
+      im[k] = static_cast<float>(std::sin(a));
+    }
+  }
+};
+
+// Radix-4 butterflies over `run` floats (a multiple of kFftLanes): inputs
+// x, x + in, x + 2 in, x + 3 in; outputs y, y + run, y + 2 run, y + 3 run,
+// times the twiddles. Each block of lanes is computed into arrays private
+// to the loop, so the compiler vectorizes without alias checks.
+inline void radix4(const float *xr, const float *xi, int in, float *yr,
+                   float *yi, int run, float conj, const float (&w)[6]) {
+  constexpr int L = kFftLanes;
+  for (int k0 = 0; k0 < run; k0 += L) {
+    float o[8][L];
+    for (int k = 0; k < L; ++k) {
+      int i = k0 + k;
+      float ar = xr[i], ai = xi[i], br = xr[i + in], bi = xi[i + in];
+      float cr = xr[i + 2 * in], ci = xi[i + 2 * in];
+      float dr = xr[i + 3 * in], di = xi[i + 3 * in];
+      float apcR = ar + cr, apcI = ai + ci;
+      float amcR = ar - cr, amcI = ai - ci;
+      float bpdR = br + dr, bpdI = bi + di;
+      // -i (b - d) forward, +i (b - d) inverse
+      float jR = conj * (bi - di), jI = -conj * (br - dr);
+      o[0][k] = apcR + bpdR;
+      o[1][k] = apcI + bpdI;
+      float t1r = amcR + jR, t1i = amcI + jI;
+      o[2][k] = w[0] * t1r - w[1] * t1i;
+      o[3][k] = w[0] * t1i + w[1] * t1r;
+      float t2r = apcR - bpdR, t2i = apcI - bpdI;
+      o[4][k] = w[2] * t2r - w[3] * t2i;
+      o[5][k] = w[2] * t2i + w[3] * t2r;
+      float t3r = amcR - jR, t3i = amcI - jI;
+      o[6][k] = w[4] * t3r - w[5] * t3i;
+      o[7][k] = w[4] * t3i + w[5] * t3r;
+    }
+    for (int j = 0; j < 4; ++j) {
+      std::copy_n(o[2 * j], L, yr + k0 + j * run);
+      std::copy_n(o[2 * j + 1], L, yi + k0 + j * run);
+    }
+  }
+}
+
+// kFftLanes transforms of length plan.n in place in (re, im); (tre, tim) is
+// scratch of the same size. Inverse transforms are unscaled.
+inline void fftBatch(float *re, float *im, float *tre, float *tim,
+                     const FftPlan &plan, bool inverse) {
+  constexpr int L = kFftLanes;
+  const int size = plan.n;
+  const float conj = inverse ? -1.0f : 1.0f; // conjugates the twiddles
+  float *xr = re, *xi = im, *yr = tre, *yi = tim;
+  int n = size, s = 1;
+  for (; n >= 4; n /= 4, s *= 4) {
+    const int q = n / 4, step = size / n, run = s * L;
+    for (int p = 0; p < q; ++p) {
+      const float w[6] = {plan.re[p * step], conj * plan.im[p * step],
+                          plan.re[2 * p * step], conj * plan.im[2 * p * step],
+                          plan.re[3 * p * step], conj * plan.im[3 * p * step]};
+      radix4(xr + p * run, xi + p * run, q * run, yr + 4 * p * run,
+             yi + 4 * p * run, run, conj, w);
+    }
+    std::swap(xr, yr);
+    std::swap(xi, yi);
+  }
+  if (n == 2) {
+    const int run = s * L;
+    for (int k0 = 0; k0 < run; k0 += L) {
+      float o[4][L];
+      for (int k = 0; k < L; ++k) {
+        int i = k0 + k;
+        o[0][k] = xr[i] + xr[i + run];
+        o[1][k] = xi[i] + xi[i + run];
+        o[2][k] = xr[i] - xr[i + run];
+        o[3][k] = xi[i] - xi[i + run];
+      }
+      std::copy_n(o[0], L, yr + k0);
+      std::copy_n(o[1], L, yi + k0);
+      std::copy_n(o[2], L, yr + k0 + run);
+      std::copy_n(o[3], L, yi + k0 + run);
+    }
+    std::swap(xr, yr);
+    std::swap(xi, yi);
+  }
+  if (xr != re) {
+    std::copy_n(xr, static_cast<size_t>(size) * L, re);
+    std::copy_n(xi, static_cast<size_t>(size) * L, im);
+  }
+}
+
+} // namespace texture_fft
+
+// A kernel's spectrum at one padded size, scaled by 1 / (pw * ph), with the
+// twiddle tables for that size.
+struct FftSpectrum {
+  int pw = 0, ph = 0;
+  texture_fft::FftPlan rows, cols;
+  std::vector<float> re, im; // ph rows of pw
+};
+
+// Kernel spectra by kernel and padded size, least recently used evicted.
+// Shared by commands that may run concurrently.
+class FftSpectrumCache {
+public:
+  FftSpectrumCache() { entries.reserve(texture_fft::kMaxCachedSpectra); }
+
+  std::shared_ptr<const FftSpectrum> find(uint64_t key, int pw, int ph) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &e : entries)
+      if (e.key == key && e.spectrum->pw == pw && e.spectrum->ph == ph) {
+        e.used = ++tick;
+        ++hitCount;
+        return e.spectrum;
+      }
+    ++missCount;
+    return nullptr;
+  }
+
+  void insert(uint64_t key, std::shared_ptr<const FftSpectrum> spectrum) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry entry{key, ++tick, std::move(spectrum)};
+    if (entries.size() < static_cast<size_t>(texture_fft::kMaxCachedSpectra)) {
+      entries.push_back(std::move(entry));
+      return;
+    }
+    auto oldest = std::min_element(
+        entries.begin(), entries.end(),
+        [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    *oldest = std::move(entry);
+  }
+
+  uint64_t hits() const { return hitCount; }
+  uint64_t misses() const { return missCount; }
+
+private:
+  struct Entry {
+    uint64_t key;
+    uint64_t used;
+    std::shared_ptr<const FftSpectrum> spectrum;
+  };
+  std::mutex mutex;
+  std::vector<Entry> entries;
+  uint64_t tick = 0;
+  std::atomic<uint64_t> hitCount{0}, missCount{0};
+};
+
+// Working storage for one convolution.
+struct FftScratch {
+  std::vector<float> re, im; // the pair's spectrum, ph rows of pw
+  std::vector<float> work;   // 4 lane arrays per chunk
+  std::vector<int> rowMap, colMap;
+};
+
+namespace texture_fft {
+
+// The passes over one pair of channels (or, for a kernel, one real
+// channel). Batch b of a pass is kFftLanes rows or columns; chunk c of the
+// pool runs batches c, c + chunks, ... on its own work arrays.
+struct ConvolveJob {
+  const FftSpectrum *plan;   // sizes and twiddles (spectrum unused while
+                             // building it)
+  const float *src;          // RGBA image, or the kernel (one float a tap)
+  float *dst;                // RGBA image
+  int w, h, channel;         // image size, first channel of the pair
+  int rx, ry;                // padding: kernel radius either side
+  const int *rowMap, *colMap; // padded to source row/column, -1 for zero
+  bool kernel;               // src is the kernel: forward passes only
+  float *re, *im;            // spectrum being built, ph rows of pw
+  float *work;
+  int chunks, batches, maxN;
+  void (ConvolveJob::*pass)(int, float *) = nullptr;
+
+  void run(void (ConvolveJob::*p)(int, float *), int count,
+           WorkerPool &pool) {
+    pass = p;
+    batches = count;
+    chunks = std::min(count, static_cast<int>(pool.threadCount()));
+    pool.parallelFor(chunks, 1, [job = this](int c0, int c1) {
+      for (int c = c0; c < c1; ++c) {
+        float *arrays = job->work + static_cast<size_t>(c) * 4 *
+                                        job->maxN * kFftLanes;
+        for (int b = c; b < job->batches; b += job->chunks)
+          (job->*(job->pass))(b, arrays);
+      }
+    });
+  }
+
+  // Forward transforms of padded rows [b * L, b * L + L) into the spectrum.
+  void rowsForward(int b, float *arrays) {
+    constexpr int L = kFftLanes;
+    const int pw = plan->pw, n = pw * L;
+    float *xr = arrays, *xi = xr + maxN * L;
+    float *tr = xi + maxN * L, *ti = tr + maxN * L;
+    bool empty = true;
+    for (int l = 0; l < L && b * L + l < plan->ph; ++l)
+      empty = empty && rowMap[b * L + l] < 0;
+    if (empty) {
+      size_t first = static_cast<size_t>(b) * L * pw;
+      size_t count = static_cast<size_t>(std::min(L, plan->ph - b * L)) * pw;
+      std::fill_n(re + first, count, 0.0f);
+      std::fill_n(im + first, count, 0.0f);
+      return;
+    }
+    std::fill_n(xr, n, 0.0f);
+    std::fill_n(xi, n, 0.0f);
+    for (int l = 0; l < L; ++l) {
+      int y = b * L + l;
+      int sy = y < plan->ph ? rowMap[y] : -1;
+      if (sy < 0)
+        continue;
+      if (kernel) {
+        const float *row = src + static_cast<size_t>(sy) * w;
+        for (int x = 0; x < pw; ++x)
+          if (colMap[x] >= 0)
+            xr[x * L + l] = row[colMap[x]];
+        continue;
+      }
+      const float *row = src + static_cast<size_t>(sy) * w * 4 + channel;
+      for (int x = 0; x < pw; ++x) {
+        int sx = colMap[x];
+        if (sx < 0)
+          continue;
+        xr[x * L + l] = row[sx * 4];
+        xi[x * L + l] = row[sx * 4 + 1];
+      }
+    }
+    fftBatch(xr, xi, tr, ti, plan->rows, false);
+    for (int l = 0; l < L; ++l) {
+      int y = b * L + l;
+      if (y >= plan->ph)
+        break;
+      float *orow = re + static_cast<size_t>(y) * pw;
+      float *irow = im + static_cast<size_t>(y) * pw;
+      for (int x = 0; x < pw; ++x) {
+        orow[x] = xr[x * L + l];
+        irow[x] = xi[x * L + l];
+      }
+    }
+  }
+
+  // Forward transforms of columns [b * L, b * L + L). For an image, then
+  // multiply by the kernel spectrum and transform back, keeping the rows
+  // that map to output pixels.
+  void columns(int b, float *arrays) {
+    constexpr int L = kFftLanes;
+    const int pw = plan->pw, ph = plan->ph, x0 = b * L;
+    float *xr = arrays, *xi = xr + maxN * L;
+    float *tr = xi + maxN * L, *ti = tr + maxN * L;
+    for (int y = 0; y < ph; ++y) {
+      size_t at = static_cast<size_t>(y) * pw + x0;
+      std::copy_n(re + at, L, xr + y * L);
+      std::copy_n(im + at, L, xi + y * L);
+    }
+    fftBatch(xr, xi, tr, ti, plan->cols, false);
+    int first = 0, last = ph;
+    if (!kernel) {
+      for (int y = 0; y < ph; ++y) {
+        const float *kr = plan->re.data() + static_cast<size_t>(y) * pw + x0;
+        const float *ki = plan->im.data() + static_cast<size_t>(y) * pw + x0;
+        float *pr = xr + y * L, *pi = xi + y * L;
+        float o[2][L];
+        for (int l = 0; l < L; ++l) {
+          o[0][l] = pr[l] * kr[l] - pi[l] * ki[l];
+          o[1][l] = pr[l] * ki[l] + pi[l] * kr[l];
+        }
+        std::copy_n(o[0], L, pr);
+        std::copy_n(o[1], L, pi);
+      }
+      fftBatch(xr, xi, tr, ti, plan->cols, true);
+      first = ry;
+      last = ry + h;
+    }
+    for (int y = first; y < last; ++y) {
+      size_t at = static_cast<size_t>(y) * pw + x0;
+      std::copy_n(xr + y * L, L, re + at);
+      std::copy_n(xi + y * L, L, im + at);
+    }
+  }
+
+  // Inverse transforms of the spectrum rows for output rows
+  // [b * L, b * L + L), written to the pair's channels of dst.
+  void rowsInverse(int b, float *arrays) {
+    constexpr int L = kFftLanes;
+    const int pw = plan->pw, n = pw * L;
+    float *xr = arrays, *xi = xr + maxN * L;
+    float *tr = xi + maxN * L, *ti = tr + maxN * L;
+    const int lanes = std::min(L, h - b * L);
+    if (lanes < L) {
+      std::fill_n(xr, n, 0.0f);
+      std::fill_n(xi, n, 0.0f);
+    }
+    for (int l = 0; l < lanes; ++l) {
+      size_t at = static_cast<size_t>(b * L + l + ry) * pw;
+      for (int x = 0; x < pw; ++x) {
+        xr[x * L + l] = re[at + x];
+        xi[x * L + l] = im[at + x];
+      }
+    }
+    fftBatch(xr, xi, tr, ti, plan->rows, true);
+    for (int l = 0; l < lanes; ++l) {
+      float *row = dst + static_cast<size_t>(b * L + l) * w * 4 + channel;
+      for (int x = 0; x < w; ++x) {
+        row[x * 4] = xr[(x + rx) * L + l];
+        row[x * 4 + 1] = xi[(x + rx) * L + l];
+      }
+    }
+  }
+};
+
+inline uint64_t hashBytes(uint64_t h, const void *data, size_t n) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < n; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+} // namespace texture_fft
+
+// Convolution kernel for convolveRgba: the first channel of an RGBA image
+// (data non-null; kw x kh, centred on (kw / 2, kh / 2)), or a Gaussian of
+// `radius` and `sigma` (radius / 3 when <= 0). Normalized kernels are scaled
+// to sum to 1, so they keep the image's brightness.
+struct FftKernel {
+  const float *data = nullptr;
+  int kw = 0, kh = 0;
+  int radius = 0;
+  float sigma = 0.0f;
+  bool normalize = true;
+};
+
+// Convolve the w x h RGBA image src with `kernel` into dst (which may be
+// src), edges following wrapMode (0=repeat, 1=clamp, 2=mirror). Returns
+// false, leaving dst unchanged, if the padded image would exceed the
+// transform limits.
+inline bool convolveRgba(const float *src, float *dst, int w, int h,
+                         int wrapMode, const FftKernel &kernel,
+                         FftSpectrumCache &cache, FftScratch &scratch,
+                         WorkerPool &pool) {
+  using namespace texture_fft;
+  if (w <= 0 || h <= 0)
+    return true;
+  int cx, cy;
+  if (kernel.data) {
+    cx = kernel.kw / 2;
+    cy = kernel.kh / 2;
+  } else {
+    cx = cy = std::max(0, kernel.radius);
+  }
+  const int rx = kernel.data ? std::max(cx, kernel.kw - 1 - cx) : cx;
+  const int ry = kernel.data ? std::max(cy, kernel.kh - 1 - cy) : cy;
+  const int pw = fftSize(w + 2 * rx), ph = fftSize(h + 2 * ry);
+  if (pw > kMaxFftSize || ph > kMaxFftSize ||
+      static_cast<size_t>(pw) * ph > kMaxFftArea)
+    return false;
+
+  // Key: the kernel's values (or Gaussian parameters) and normalization.
+  uint64_t key = 1469598103934665603ull;
+  float sigma = kernel.sigma > 0.0f ? kernel.sigma
+                                    : std::max(kernel.radius, 1) / 3.0f;
+  if (kernel.data) {
+    int dims[2] = {kernel.kw, kernel.kh};
+    key = hashBytes(key, dims, sizeof(dims));
+    size_t texels = static_cast<size_t>(kernel.kw) * kernel.kh;
+    for (size_t i = 0; i < texels; ++i)
+      key = hashBytes(key, kernel.data + i * 4, sizeof(float));
+  } else {
+    key = hashBytes(key, &kernel.radius, sizeof(kernel.radius));
+    key = hashBytes(key, &sigma, sizeof(sigma));
+  }
+  key = hashBytes(key, &kernel.normalize, sizeof(kernel.normalize));
+
+  const int maxN = std::max(pw, ph);
+  const size_t area = static_cast<size_t>(pw) * ph;
+  const size_t workFloats = static_cast<size_t>(pool.threadCount()) * 4 *
+                            maxN * kFftLanes;
+  if (scratch.re.size() < area) {
+    scratch.re.resize(area);
+    scratch.im.resize(area);
+  }
+  if (scratch.work.size() < workFloats)
+    scratch.work.resize(workFloats);
+  if (scratch.rowMap.size() < static_cast<size_t>(maxN)) {
+    scratch.rowMap.resize(maxN);
+    scratch.colMap.resize(maxN);
+  }
+
+  ConvolveJob job{};
+  job.dst = dst;
+  job.re = scratch.re.data();
+  job.im = scratch.im.data();
+  job.work = scratch.work.data();
+  job.maxN = maxN;
+  job.rowMap = scratch.rowMap.data();
+  job.colMap = scratch.colMap.data();
+  const int rowBatches = (ph + kFftLanes - 1) / kFftLanes;
+  const int colBatches = (pw + kFftLanes - 1) / kFftLanes;
+
+  std::shared_ptr<const FftSpectrum> spectrum = cache.find(key, pw, ph);
+  if (!spectrum) {
+    // Sample the kernel, then transform it in place: padded (dx, dy) sits at
+    // (dx mod pw, dy mod ph) so that the kernel centre is the origin.
+    auto built = std::make_shared<FftSpectrum>();
+    built->pw = pw;
+    built->ph = ph;
+    built->rows.build(pw);
+    built->cols.build(ph);
+    const int kw = kernel.data ? kernel.kw : 2 * cx + 1;
+    const int kh = kernel.data ? kernel.kh : 2 * cy + 1;
+    std::vector<float> taps(static_cast<size_t>(kw) * kh);
+    double sum = 0.0;
+    for (int y = 0; y < kh; ++y)
+      for (int x = 0; x < kw; ++x) {
+        double v;
+        if (kernel.data) {
+          v = kernel.data[(static_cast<size_t>(y) * kw + x) * 4];
+        } else {
+          double dx = x - cx, dy = y - cy;
+          v = std::exp(-0.5 * (dx * dx + dy * dy) /
+                       (static_cast<double>(sigma) * sigma));
+        }
+        taps[static_cast<size_t>(y) * kw + x] = static_cast<float>(v);
+        sum += v;
+      }
+    double scale = 1.0 / (static_cast<double>(pw) * ph);
+    if (kernel.normalize && sum != 0.0)
+      scale /= sum;
+    for (float &t : taps)
+      t = static_cast<float>(t * scale);
+    std::fill_n(scratch.rowMap.data(), maxN, -1);
+    std::fill_n(scratch.colMap.data(), maxN, -1);
+    for (int y = 0; y < kh; ++y)
+      scratch.rowMap[((y - cy) % ph + ph) % ph] = y;
+    for (int x = 0; x < kw; ++x)
+      scratch.colMap[((x - cx) % pw + pw) % pw] = x;
+    job.plan = built.get();
+    job.src = taps.data();
+    job.w = kw;
+    job.kernel = true;
+    job.run(&ConvolveJob::rowsForward, rowBatches, pool);
+    job.run(&ConvolveJob::columns, colBatches, pool);
+    built->re.assign(job.re, job.re + area);
+    built->im.assign(job.im, job.im + area);
+    spectrum = built;
+    cache.insert(key, std::move(built));
+  }
+
+  // Padded rows and columns to source ones; rows past the padding only
+  // wrap into pixels the output never reads, so they stay zero.
+  for (int y = 0; y < ph; ++y)
+    scratch.rowMap[y] =
+        y < h + 2 * ry ? texture_blur::wrapIndex(y - ry, h, wrapMode) : -1;
+  for (int x = 0; x < pw; ++x)
+    scratch.colMap[x] =
+        x < w + 2 * rx ? texture_blur::wrapIndex(x - rx, w, wrapMode) : -1;
+  job.plan = spectrum.get();
+  job.src = src;
+  job.w = w;
+  job.h = h;
+  job.rx = rx;
+  job.ry = ry;
+  job.kernel = false;
+  // Channels 0-1, then 2-3: the first pair's output only overwrites its own
+  // channels, so in place the second pair still reads its source.
+  for (int channel = 0; channel < 4; channel += 2) {
+    job.channel = channel;
+    job.run(&ConvolveJob::rowsForward, rowBatches, pool);
+    job.run(&ConvolveJob::columns, colBatches, pool);
+    job.run(&ConvolveJob::rowsInverse, (h + kFftLanes - 1) / kFftLanes, pool);
+  }
+  return true;
+}
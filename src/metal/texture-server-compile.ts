@@ -1,10 +1,11 @@
 /**
  * Build infrastructure for the texture server binary.
  * Compiles the Objective-C++ sources, caches via source hash, and provides
- * a helper to spawn the server process and wait for readiness.
+ * a helper to spawn the server process and wait for readiness, plus the
+ * load generator (texture-server-load.cpp) and a helper to run it.
  */
 
-import { execSync, spawn, ChildProcess } from 'child_process';
+import { execFileSync, execSync, spawn, ChildProcess } from 'child_process';
 import * as crypto from 'crypto';
 import * as fs from 'fs';
 import * as path from 'path';
@@ -18,8 +19,13 @@ const SOURCE_FILES = [
 
 const HEADER_FILES = [
   'texture-server.h',
+  'texture-server-ws.h',
+  'texture-server-stats.h',
 ];
 
+const LOAD_SOURCE = 'texture-server-load.cpp';
+const LOAD_BINARY_NAME = 'texture-server-load';
+
 const BUILD_DIR = path.join(os.tmpdir(), 'nano-ffglify-texture-server');
 const BINARY_NAME = 'texture-server';
 
@@ -93,6 +99,88 @@ export function getTextureServerBinary(): string {
   return binaryPath;
 }
 
+/**
+ * Compile the load generator (plain C++) if needed, cached by source hash.
+ */
+export function getTextureServerLoadBinary(): string {
+  if (!fs.existsSync(BUILD_DIR)) {
+    fs.mkdirSync(BUILD_DIR, { recursive: true });
+  }
+
+  const srcPath = path.join(getSourceDir(), LOAD_SOURCE);
+  const binaryPath = path.join(BUILD_DIR, LOAD_BINARY_NAME);
+  const hashPath = path.join(BUILD_DIR, `${LOAD_BINARY_NAME}.hash`);
+  const currentHash = crypto.createHash('sha256')
+    .update(fs.readFileSync(srcPath)).digest('hex').slice(0, 16);
+
+  if (fs.existsSync(binaryPath) && fs.existsSync(hashPath)) {
+    const cachedHash = fs.readFileSync(hashPath, 'utf-8').trim();
+    if (cachedHash === currentHash) {
+      return binaryPath;
+    }
+  }
+
+  const compileCmd = [
+    'clang++',
+    '-std=c++17',
+    '-O2',
+    '-pthread',
+    `"${srcPath}"`,
+    `-o "${binaryPath}"`,
+  ].join(' ');
+
+  try {
+    execSync(compileCmd, {
+      encoding: 'utf-8',
+      stdio: ['pipe', 'pipe', 'pipe'],
+    });
+  } catch (e: any) {
+    const stderr = e.stderr || '';
+    throw new Error(`Texture server load generator compilation failed:\n${stderr}`);
+  }
+
+  fs.writeFileSync(hashPath, currentHash);
+  return binaryPath;
+}
+
+export interface TextureServerLoadOptions {
+  producers?: number;
+  readers?: number;
+  width?: number;
+  height?: number;
+  maxDim?: number;
+  seconds?: number;
+  fps?: number;
+}
+
+/**
+ * Run the load generator against a server on `port` and return its JSON
+ * summary (see texture-server-load.cpp).
+ */
+export function runTextureServerLoad(port: number, options: TextureServerLoadOptions = {}): any {
+  const binaryPath = getTextureServerLoadBinary();
+  const flags: [string, number | undefined][] = [
+    ['--producers', options.producers],
+    ['--readers', options.readers],
+    ['--width', options.width],
+    ['--height', options.height],
+    ['--max-dim', options.maxDim],
+    ['--seconds', options.seconds],
+    ['--fps', options.fps],
+  ];
+  const args = ['--port', String(port)];
+  for (const [flag, value] of flags) {
+    if (value !== undefined) {
+      args.push(flag, String(value));
+    }
+  }
+  const stdout = execFileSync(binaryPath, args, {
+    encoding: 'utf-8',
+    timeout: ((options.seconds ?? 5) + 30) * 1000,
+  });
+  return JSON.parse(stdout.trim().split('\n').pop()!);
+}
+
 export interface TextureServerProcess {
   process: ChildProcess;
   port: number;
@@ -0,0 +1,531 @@
+// Load generator for the texture server.
+//
+// Opens one WebSocket connection per simulated client: `--producers` clients
+// push frames to channels load-0 .. load-(N-1) with debug_push_texture, and
+// `--readers` clients read them back with debug_read_texture (reader r reads
+// channel load-(r % N)). Each client issues requests back to back, or at
+// `--fps` when given, for `--seconds`. It then prints one JSON line:
+//
+//   {"producers","readers","width","height","maxDim","seconds",
+//    "push":{"frames","errors","fps","latencyMs":{"p50","p90","p99","max"}},
+//    "read":{...same...},"megabytesPerSecond","sustained"?,"serverStats"}
+//
+// fps is per client (frames / seconds / clients). "sustained" is present
+// when --fps is set: true if every producer and reader kept within 95% of
+// the target rate. "serverStats" is the server's get_stats result at the
+// end of the run.
+//
+// Usage:
+//   texture-server-load --port 9876 --producers 4 --readers 4
+//       --width 512 --height 512 --max-dim 256 --seconds 5 [--fps 60]
+//
+// Plain C++17 and POSIX sockets; no dependencies beyond the server itself.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+// =====================
+// Base64
+// =====================
+
+static std::string base64Encode(const uint8_t *data, size_t size) {
+  static const char *table =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((size + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 2 < size; i += 3) {
+    uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    out += table[(v >> 18) & 63];
+    out += table[(v >> 12) & 63];
+    out += table[(v >> 6) & 63];
+    out += table[v & 63];
+  }
+  if (i < size) {
+    uint32_t v = data[i] << 16;
+    if (i + 1 < size)
+      v |= data[i + 1] << 8;
+    out += table[(v >> 18) & 63];
+    out += table[(v >> 12) & 63];
+    out += i + 1 < size ? table[(v >> 6) & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+// =====================
+// Minimal WebSocket client (RFC 6455, text frames only)
+// =====================
+
+class WsClient {
+public:
+  WsClient() = default;
+  ~WsClient() { close(); }
+  WsClient(const WsClient &) = delete;
+  WsClient &operator=(const WsClient &) = delete;
+
+  bool connect(const std::string &host, int port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    std::string portStr = std::to_string(port);
+    if (getaddrinfo(host.c_str(), portStr.c_str(), &hints, &res) != 0)
+      return false;
+    for (addrinfo *a = res; a && fd < 0; a = a->ai_next) {
+      fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd < 0)
+        continue;
+      if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+      return false;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    timeval tv = {10, 0}; // a stalled server ends the client, not the run
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    uint8_t nonce[16];
+    for (uint8_t &b : nonce)
+      b = static_cast<uint8_t>(rng());
+    std::string handshake = "GET / HTTP/1.1\r\nHost: " + host + ":" +
+                            portStr +
+                            "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Key: " +
+                            base64Encode(nonce, sizeof(nonce)) +
+                            "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (!writeAll(handshake.data(), handshake.size()))
+      return false;
+
+    std::string reply;
+    char c;
+    while (reply.size() < 8192 &&
+           (reply.size() < 4 || reply.compare(reply.size() - 4, 4,
+                                              "\r\n\r\n") != 0)) {
+      if (::recv(fd, &c, 1, 0) != 1)
+        return false;
+      reply += c;
+    }
+    return reply.compare(0, 12, "HTTP/1.1 101") == 0;
+  }
+
+  void close() {
+    if (fd >= 0) {
+      sendFrame(0x8, nullptr, 0);
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  bool sendText(const std::string &text) {
+    return sendFrame(0x1, text.data(), text.size());
+  }
+
+  // Next complete text message; answers pings. False on close or error.
+  bool receiveText(std::string &out) {
+    out.clear();
+    for (;;) {
+      uint8_t header[2];
+      if (!readAll(header, 2))
+        return false;
+      bool fin = header[0] & 0x80;
+      int opcode = header[0] & 0x0f;
+      uint64_t len = header[1] & 0x7f;
+      if (len == 126) {
+        uint8_t ext[2];
+        if (!readAll(ext, 2))
+          return false;
+        len = (uint64_t(ext[0]) << 8) | ext[1];
+      } else if (len == 127) {
+        uint8_t ext[8];
+        if (!readAll(ext, 8))
+          return false;
+        len = 0;
+        for (uint8_t b : ext)
+          len = (len << 8) | b;
+      }
+      uint8_t mask[4] = {};
+      bool masked = header[1] & 0x80;
+      if (masked && !readAll(mask, 4))
+        return false;
+      payload.resize(len);
+      if (len && !readAll(&payload[0], len))
+        return false;
+      if (masked)
+        for (uint64_t i = 0; i < len; ++i)
+          payload[i] ^= mask[i & 3];
+
+      if (opcode == 0x8)
+        return false;
+      if (opcode == 0x9) {
+        sendFrame(0xA, payload.data(), payload.size());
+        continue;
+      }
+      if (opcode == 0xA)
+        continue;
+      out += payload; // text, binary or continuation
+      if (fin)
+        return true;
+    }
+  }
+
+  // Send `{"id","method","params"}` and wait for the matching response.
+  bool request(const std::string &method, const std::string &params,
+               std::string &response) {
+    std::string id = std::to_string(++nextId);
+    std::string msg;
+    msg.reserve(params.size() + method.size() + 48);
+    msg += "{\"id\":\"";
+    msg += id;
+    msg += "\",\"method\":\"";
+    msg += method;
+    msg += "\",\"params\":";
+    msg += params;
+    msg += "}";
+    if (!sendText(msg))
+      return false;
+    // The server answers in order on a connection.
+    return receiveText(response);
+  }
+
+private:
+  bool sendFrame(int opcode, const char *data, size_t size) {
+    if (fd < 0)
+      return false;
+    uint8_t header[14];
+    size_t n = 0;
+    header[n++] = static_cast<uint8_t>(0x80 | opcode);
+    if (size < 126) {
+      header[n++] = static_cast<uint8_t>(0x80 | size);
+    } else if (size <= 0xffff) {
+      header[n++] = 0x80 | 126;
+      header[n++] = static_cast<uint8_t>(size >> 8);
+      header[n++] = static_cast<uint8_t>(size);
+    } else {
+      header[n++] = 0x80 | 127;
+      for (int s = 56; s >= 0; s -= 8)
+        header[n++] = static_cast<uint8_t>(uint64_t(size) >> s);
+    }
+    uint8_t mask[4];
+    for (uint8_t &b : mask)
+      b = static_cast<uint8_t>(rng());
+    std::memcpy(header + n, mask, 4);
+    n += 4;
+
+    frame.assign(data, data + size);
+    for (size_t i = 0; i < size; ++i)
+      frame[i] ^= mask[i & 3];
+    return writeAll(reinterpret_cast<char *>(header), n) &&
+           writeAll(frame.data(), frame.size());
+  }
+
+  bool writeAll(const char *data, size_t size) {
+    while (size > 0) {
+      ssize_t n = ::send(fd, data, size, 0);
+      if (n <= 0)
+        return false;
+      data += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  bool readAll(void *dst, size_t size) {
+    char *p = static_cast<char *>(dst);
+    while (size > 0) {
+      ssize_t n = ::recv(fd, p, size, 0);
+      if (n <= 0)
+        return false;
+      p += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  int fd = -1;
+  uint64_t nextId = 0;
+  std::minstd_rand rng{std::random_device{}()};
+  std::string payload;
+  std::string frame;
+};
+
+// Raw JSON of the object or value under `"key":` in `json` (a flat scan
+// that skips strings; enough for the server's responses).
+static std::string extractValue(const std::string &json,
+                                const std::string &key) {
+  size_t pos = json.find("\"" + key + "\":");
+  if (pos == std::string::npos)
+    return "";
+  size_t start = pos + key.size() + 3;
+  int depth = 0;
+  bool inString = false;
+  for (size_t i = start; i < json.size(); ++i) {
+    char c = json[i];
+    if (inString) {
+      if (c == '\\')
+        ++i;
+      else if (c == '"')
+        inString = false;
+      continue;
+    }
+    if (c == '"')
+      inString = true;
+    else if (c == '{' || c == '[')
+      ++depth;
+    else if (c == '}' || c == ']') {
+      if (depth == 0)
+        return json.substr(start, i - start);
+      if (--depth == 0)
+        return json.substr(start, i + 1 - start);
+    } else if (c == ',' && depth == 0)
+      return json.substr(start, i - start);
+  }
+  return "";
+}
+
+// =====================
+// Load run
+// =====================
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 9876;
+  int producers = 1;
+  int readers = 1;
+  int width = 256;
+  int height = 256;
+  int maxDim = 0;
+  double seconds = 5.0;
+  double fps = 0.0; // 0: as fast as possible
+};
+
+struct ClientResult {
+  std::vector<double> latenciesMs;
+  uint64_t frames = 0;
+  uint64_t errors = 0;
+  uint64_t bytes = 0;
+};
+
+static std::string pushParams(const std::string &channel, int width,
+                              int height, const std::string &b64) {
+  std::ostringstream ss;
+  ss << "{\"channel\":\"" << channel << "\",\"width\":" << width
+     << ",\"height\":" << height << ",\"data\":\"" << b64 << "\"}";
+  return ss.str();
+}
+
+static std::string readParams(const std::string &channel, int maxDim) {
+  std::ostringstream ss;
+  ss << "{\"channel\":\"" << channel << "\"";
+  if (maxDim > 0)
+    ss << ",\"maxDim\":" << maxDim;
+  ss << "}";
+  return ss.str();
+}
+
+// Issue `method` until `end`, paced to `fps` when nonzero.
+static void runClient(WsClient &ws, const std::string &method,
+                      const std::string &params, const Options &opt,
+                      Clock::time_point end, ClientResult &result) {
+  std::string response;
+  auto next = Clock::now();
+  auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(opt.fps > 0 ? 1.0 / opt.fps : 0.0));
+  while (Clock::now() < end) {
+    if (opt.fps > 0) {
+      std::this_thread::sleep_until(next);
+      next += period;
+    }
+    auto t0 = Clock::now();
+    if (!ws.request(method, params, response)) {
+      ++result.errors;
+      return; // connection lost
+    }
+    result.latenciesMs.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    if (response.find("\"error\"") != std::string::npos) {
+      ++result.errors;
+      continue;
+    }
+    ++result.frames;
+    result.bytes += params.size() + response.size();
+  }
+}
+
+static double percentile(const std::vector<double> &sorted, double q) {
+  if (sorted.empty())
+    return 0.0;
+  size_t i = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+static void writeSummary(std::ostream &out, const char *name,
+                         const std::vector<ClientResult> &results,
+                         double seconds) {
+  std::vector<double> all;
+  uint64_t frames = 0, errors = 0;
+  for (const ClientResult &r : results) {
+    all.insert(all.end(), r.latenciesMs.begin(), r.latenciesMs.end());
+    frames += r.frames;
+    errors += r.errors;
+  }
+  std::sort(all.begin(), all.end());
+  double fps = results.empty() ? 0.0 : frames / seconds / results.size();
+  out << "\"" << name << "\":{\"frames\":" << frames
+      << ",\"errors\":" << errors << ",\"fps\":" << fps
+      << ",\"latencyMs\":{\"p50\":" << percentile(all, 0.50)
+      << ",\"p90\":" << percentile(all, 0.90)
+      << ",\"p99\":" << percentile(all, 0.99)
+      << ",\"max\":" << (all.empty() ? 0.0 : all.back()) << "}}";
+}
+
+static bool sustained(const std::vector<ClientResult> &results,
+                      double seconds, double fps) {
+  for (const ClientResult &r : results)
+    if (r.errors > 0 || r.frames < 0.95 * fps * seconds)
+      return false;
+  return true;
+}
+
+int main(int argc, const char *argv[]) {
+  Options opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << arg << std::endl;
+      return 1;
+    }
+    const char *v = argv[++i];
+    if (arg == "--host")
+      opt.host = v;
+    else if (arg == "--port")
+      opt.port = std::atoi(v);
+    else if (arg == "--producers")
+      opt.producers = std::max(1, std::atoi(v));
+    else if (arg == "--readers")
+      opt.readers = std::max(0, std::atoi(v));
+    else if (arg == "--width")
+      opt.width = std::max(1, std::atoi(v));
+    else if (arg == "--height")
+      opt.height = std::max(1, std::atoi(v));
+    else if (arg == "--max-dim")
+      opt.maxDim = std::max(0, std::atoi(v));
+    else if (arg == "--seconds")
+      opt.seconds = std::atof(v);
+    else if (arg == "--fps")
+      opt.fps = std::atof(v);
+    else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  // A server closing mid-send must fail the write, not kill the process.
+  signal(SIGPIPE, SIG_IGN);
+
+  int clients = opt.producers + opt.readers;
+  std::vector<WsClient> ws(clients);
+  for (int i = 0; i < clients; ++i) {
+    if (!ws[i].connect(opt.host, opt.port)) {
+      std::cerr << "Failed to connect to " << opt.host << ":" << opt.port
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // One frame per producer, encoded once; push each before the run so the
+  // readers' channels exist.
+  std::vector<std::string> params(clients);
+  std::vector<uint8_t> rgba(size_t(opt.width) * opt.height * 4);
+  for (int p = 0; p < opt.producers; ++p) {
+    for (size_t i = 0; i < rgba.size(); ++i)
+      rgba[i] = static_cast<uint8_t>(i * 7 + p * 31);
+    params[p] = pushParams("load-" + std::to_string(p), opt.width, opt.height,
+                           base64Encode(rgba.data(), rgba.size()));
+    std::string response;
+    if (!ws[p].request("debug_push_texture", params[p], response) ||
+        response.find("\"error\"") != std::string::npos) {
+      std::cerr << "Warm-up push failed: " << response << std::endl;
+      return 1;
+    }
+  }
+  for (int r = 0; r < opt.readers; ++r)
+    params[opt.producers + r] =
+        readParams("load-" + std::to_string(r % opt.producers), opt.maxDim);
+
+  std::vector<ClientResult> results(clients);
+  std::vector<std::thread> threads;
+  auto start = Clock::now();
+  auto end = start + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(opt.seconds));
+  for (int i = 0; i < clients; ++i) {
+    const char *method =
+        i < opt.producers ? "debug_push_texture" : "debug_read_texture";
+    threads.emplace_back([&, i, method] {
+      runClient(ws[i], method, params[i], opt, end, results[i]);
+    });
+  }
+  for (std::thread &t : threads)
+    t.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  uint64_t bytes = 0;
+  for (const ClientResult &r : results)
+    bytes += r.bytes;
+  std::vector<ClientResult> pushes(results.begin(),
+                                   results.begin() + opt.producers);
+  std::vector<ClientResult> reads(results.begin() + opt.producers,
+                                  results.end());
+
+  std::string statsResponse;
+  std::string serverStats = "null";
+  if (ws[0].request("get_stats", "{}", statsResponse)) {
+    std::string result = extractValue(statsResponse, "result");
+    if (!result.empty())
+      serverStats = result;
+  }
+
+  std::ostringstream out;
+  out << "{\"producers\":" << opt.producers << ",\"readers\":" << opt.readers
+      << ",\"width\":" << opt.width << ",\"height\":" << opt.height
+      << ",\"maxDim\":" << opt.maxDim << ",\"seconds\":" << elapsed << ",";
+  writeSummary(out, "push", pushes, elapsed);
+  out << ",";
+  writeSummary(out, "read", reads, elapsed);
+  out << ",\"megabytesPerSecond\":" << bytes / elapsed / 1e6;
+  if (opt.fps > 0)
+    out << ",\"sustained\":"
+        << (sustained(pushes, elapsed, opt.fps) &&
+                    sustained(reads, elapsed, opt.fps)
+                ? "true"
+                : "false");
+  out << ",\"serverStats\":" << serverStats << "}";
+  std::cout << out.str() << std::endl;
+  return 0;
+}
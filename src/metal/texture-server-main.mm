@@ -1,18 +1,10 @@
 #import <Foundation/Foundation.h>
+#include "texture-server-ws.h"
 #include "texture-server.h"
 #include <csignal>
 #include <cstdlib>
 #include <iostream>
 
-// Forward-declare the WS class (defined in texture-server-ws.mm)
-class TextureServerWS {
-public:
-  TextureServerWS(TextureChannelRegistry &registry, uint16_t port);
-  ~TextureServerWS();
-  void start();
-  void stop();
-};
-
 static volatile sig_atomic_t g_running = 1;
 
 static void signalHandler(int sig) {
@@ -0,0 +1,245 @@
+#pragma once
+
+// Request metrics for the texture server (get_stats).
+//
+// ServerStats counts each WebSocket method's calls and errors and keeps a
+// latency histogram per phase: parse (JSON request), handler, encode (JSON
+// response) and send (until the connection reports it written). It also
+// totals bytes in and out, and counts pushes and reads per channel with
+// their rate over the last few seconds. All methods are thread-safe.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Log2 histogram of latencies in microseconds: bucket 0 holds samples under
+// 1 us, bucket i those in [2^(i-1), 2^i) us.
+class LatencyHistogram {
+public:
+  static constexpr int kBuckets = 32;
+
+  void add(double us) {
+    int b = 0;
+    while (b < kBuckets - 1 && us >= static_cast<double>(1ull << b))
+      ++b;
+    ++buckets[b];
+    ++n;
+    sumUs += us;
+    if (us > maxUs)
+      maxUs = us;
+  }
+
+  uint64_t count() const { return n; }
+  double meanUs() const { return n ? sumUs / n : 0.0; }
+
+  // Upper bound of the bucket holding quantile `q` (capped at the maximum).
+  double percentileUs(double q) const {
+    if (n == 0)
+      return 0.0;
+    uint64_t rank = static_cast<uint64_t>(q * n + 0.5);
+    if (rank < 1)
+      rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+      seen += buckets[b];
+      if (seen >= rank) {
+        double upper = static_cast<double>(1ull << b);
+        return upper < maxUs ? upper : maxUs;
+      }
+    }
+    return maxUs;
+  }
+
+  // {"count","meanUs","p50Us","p90Us","p99Us","maxUs"}
+  void writeJson(std::ostream &out) const {
+    out << "{\"count\":" << n << ",\"meanUs\":" << meanUs()
+        << ",\"p50Us\":" << percentileUs(0.50)
+        << ",\"p90Us\":" << percentileUs(0.90)
+        << ",\"p99Us\":" << percentileUs(0.99) << ",\"maxUs\":" << maxUs
+        << "}";
+  }
+
+private:
+  uint64_t buckets[kBuckets] = {};
+  uint64_t n = 0;
+  double sumUs = 0.0;
+  double maxUs = 0.0;
+};
+
+// Events per second over the last kWindow whole seconds, in one-second
+// buckets.
+class RateMeter {
+public:
+  using Clock = std::chrono::steady_clock;
+  static constexpr int kWindow = 10;
+
+  void add(Clock::time_point now, uint64_t events = 1) {
+    int64_t s = secondOf(now);
+    Bucket &b = buckets[s % kWindow];
+    if (b.second != s) {
+      b.second = s;
+      b.count = 0;
+    }
+    b.count += events;
+    total += events;
+  }
+
+  // Rate over the window, excluding the second in progress.
+  double perSecond(Clock::time_point now) const {
+    int64_t s = secondOf(now);
+    uint64_t sum = 0;
+    for (const Bucket &b : buckets)
+      if (b.second < s && b.second >= s - kWindow)
+        sum += b.count;
+    return static_cast<double>(sum) / kWindow;
+  }
+
+  uint64_t total = 0;
+
+private:
+  struct Bucket {
+    int64_t second = -1;
+    uint64_t count = 0;
+  };
+
+  static int64_t secondOf(Clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               t.time_since_epoch())
+        .count();
+  }
+
+  Bucket buckets[kWindow];
+};
+
+class ServerStats {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum Phase { Parse, Handler, Encode, Send, kPhases };
+
+  ServerStats() : started(Clock::now()) {}
+
+  // One request/response: its method ("<invalid>" when it had none),
+  // whether the response was an error, and the bytes received and sent.
+  void recordRequest(const std::string &method, double parseUs,
+                     double handlerUs, double encodeUs, bool error,
+                     size_t bytesReceived, size_t bytesSent) {
+    std::lock_guard<std::mutex> lock(mutex);
+    MethodStats &m = methods[method];
+    ++m.calls;
+    if (error)
+      ++m.errors;
+    m.phases[Parse].add(parseUs);
+    m.phases[Handler].add(handlerUs);
+    m.phases[Encode].add(encodeUs);
+    bytesIn += bytesReceived;
+    bytesOut += bytesSent;
+  }
+
+  // Time from handing a response to the connection until it was written.
+  void recordSend(const std::string &method, double us) {
+    std::lock_guard<std::mutex> lock(mutex);
+    methods[method].phases[Send].add(us);
+  }
+
+  void recordPush(const std::string &channel, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ChannelStats &c = channels[channel];
+    c.pushes.add(Clock::now());
+    c.bytesPushed += bytes;
+  }
+
+  void recordRead(const std::string &channel, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ChannelStats &c = channels[channel];
+    c.reads.add(Clock::now());
+    c.bytesRead += bytes;
+  }
+
+  // {"uptimeSeconds","bytesIn","bytesOut","registry":{"bytes","channels"},
+  //  "methods":{name:{"calls","errors","parse","handler","encode","send"}},
+  //  "channels":{name:{"pushes","reads","pushesPerSecond","readsPerSecond",
+  //  "bytesPushed","bytesRead"}}}; the phases are LatencyHistogram JSON.
+  void writeJson(std::ostream &out, size_t registryBytes,
+                 size_t registryChannels) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = Clock::now();
+    static const char *phaseNames[kPhases] = {"parse", "handler", "encode",
+                                              "send"};
+    out << "{\"uptimeSeconds\":"
+        << std::chrono::duration<double>(now - started).count()
+        << ",\"bytesIn\":" << bytesIn << ",\"bytesOut\":" << bytesOut
+        << ",\"registry\":{\"bytes\":" << registryBytes
+        << ",\"channels\":" << registryChannels << "},\"methods\":{";
+    bool first = true;
+    for (const auto &kv : methods) {
+      out << (first ? "" : ",");
+      writeString(out, kv.first);
+      out << ":{\"calls\":" << kv.second.calls
+          << ",\"errors\":" << kv.second.errors;
+      for (int p = 0; p < kPhases; ++p) {
+        out << ",\"" << phaseNames[p] << "\":";
+        kv.second.phases[p].writeJson(out);
+      }
+      out << "}";
+      first = false;
+    }
+    out << "},\"channels\":{";
+    first = true;
+    for (const auto &kv : channels) {
+      const ChannelStats &c = kv.second;
+      out << (first ? "" : ",");
+      writeString(out, kv.first);
+      out << ":{\"pushes\":" << c.pushes.total
+          << ",\"reads\":" << c.reads.total
+          << ",\"pushesPerSecond\":" << c.pushes.perSecond(now)
+          << ",\"readsPerSecond\":" << c.reads.perSecond(now)
+          << ",\"bytesPushed\":" << c.bytesPushed
+          << ",\"bytesRead\":" << c.bytesRead << "}";
+      first = false;
+    }
+    out << "}}";
+  }
+
+private:
+  // Channel names come from clients: escape them.
+  static void writeString(std::ostream &out, const std::string &s) {
+    out << '"';
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        out << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char esc[8];
+        std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+        out << esc;
+      } else {
+        out << c;
+      }
+    }
+    out << '"';
+  }
+
+  struct MethodStats {
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    LatencyHistogram phases[kPhases];
+  };
+
+  struct ChannelStats {
+    RateMeter pushes;
+    RateMeter reads;
+    uint64_t bytesPushed = 0;
+    uint64_t bytesRead = 0;
+  };
+
+  Clock::time_point started;
+  mutable std::mutex mutex;
+  std::map<std::string, MethodStats> methods;
+  std::map<std::string, ChannelStats> channels;
+  uint64_t bytesIn = 0;
+  uint64_t bytesOut = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+// WebSocket front end of the texture server (Objective-C++, Network.framework).
+
+#import <Foundation/Foundation.h>
+#import <Network/Network.h>
+
+#include "texture-server-stats.h"
+#include "texture-server.h"
+#include <string>
+
+// =====================
+// TextureServerWS
+// =====================
+
+class TextureServerWS {
+public:
+  TextureServerWS(TextureChannelRegistry &registry, uint16_t port);
+  ~TextureServerWS();
+
+  void start();
+  void stop();
+  uint16_t port() const { return port_; }
+
+private:
+  void acceptConnection();
+  void handleMessage(nw_connection_t conn, const std::string &message);
+  void receiveMessage(nw_connection_t conn);
+  void sendResponse(nw_connection_t conn, const std::string &json,
+                    const std::string &method);
+
+  // Method handlers
+  NSDictionary *handleDebugReadTexture(NSDictionary *params);
+  NSDictionary *handleDebugPushTexture(NSDictionary *params);
+  NSDictionary *handleDebugListChannels(NSDictionary *params);
+  NSDictionary *handleGetTime(NSDictionary *params);
+  NSDictionary *handleGetStats(NSDictionary *params);
+
+  TextureChannelRegistry &registry_;
+  uint16_t port_;
+  nw_listener_t listener_;
+  dispatch_queue_t queue_;
+  ServerStats stats_;
+};
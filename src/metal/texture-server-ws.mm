@@ -1,9 +1,12 @@
 #import <Foundation/Foundation.h>
 #import <Network/Network.h>
 
+#include "texture-server-ws.h"
 #include "texture-server.h"
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 // =====================
@@ -51,37 +54,6 @@ static std::string serializeJSON(NSDictionary *dict) {
   return std::string((const char *)[data bytes], [data length]);
 }
 
-// =====================
-// TextureServerWS
-// =====================
-
-class TextureServerWS {
-public:
-  TextureServerWS(TextureChannelRegistry &registry, uint16_t port);
-  ~TextureServerWS();
-
-  void start();
-  void stop();
-  uint16_t port() const { return port_; }
-
-private:
-  void acceptConnection();
-  void handleMessage(nw_connection_t conn, const std::string &message);
-  void receiveMessage(nw_connection_t conn);
-  void sendResponse(nw_connection_t conn, const std::string &json);
-
-  // Method handlers
-  NSDictionary *handleDebugReadTexture(NSDictionary *params);
-  NSDictionary *handleDebugPushTexture(NSDictionary *params);
-  NSDictionary *handleDebugListChannels(NSDictionary *params);
-  NSDictionary *handleGetTime(NSDictionary *params);
-
-  TextureChannelRegistry &registry_;
-  uint16_t port_;
-  nw_listener_t listener_;
-  dispatch_queue_t queue_;
-};
-
 TextureServerWS::TextureServerWS(TextureChannelRegistry &registry,
                                  uint16_t port)
     : registry_(registry), port_(port), listener_(nil) {
@@ -196,13 +168,24 @@ void TextureServerWS::receiveMessage(nw_connection_t conn) {
       });
 }
 
+static double microsecondsSince(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - t)
+      .count();
+}
+
 void TextureServerWS::handleMessage(nw_connection_t conn,
                                     const std::string &message) {
+  auto t0 = std::chrono::steady_clock::now();
   NSDictionary *request = parseJSON(message);
+  double parseUs = microsecondsSince(t0);
   if (!request) {
-    sendResponse(conn, serializeJSON(@{
-                   @"error" : @{@"code" : @400, @"message" : @"Invalid JSON"}
-                 }));
+    std::string json = serializeJSON(@{
+      @"error" : @{@"code" : @400, @"message" : @"Invalid JSON"}
+    });
+    stats_.recordRequest("<invalid>", parseUs, 0, 0, true, message.size(),
+                         json.size());
+    sendResponse(conn, json, "<invalid>");
     return;
   }
 
@@ -218,14 +201,21 @@ void TextureServerWS::handleMessage(nw_connection_t conn,
       resp[@"id"] = requestId;
     resp[@"error"] =
         @{@"code" : @400, @"message" : @"Missing 'method' field"};
-    sendResponse(conn, serializeJSON(resp));
+    std::string json = serializeJSON(resp);
+    stats_.recordRequest("<invalid>", parseUs, 0, 0, true, message.size(),
+                         json.size());
+    sendResponse(conn, json, "<invalid>");
     return;
   }
 
   NSDictionary *result = nil;
   NSDictionary *errorDict = nil;
 
+  auto t1 = std::chrono::steady_clock::now();
   std::string methodStr = [method UTF8String];
+  // Stats are keyed by method; unknown names share one entry so clients
+  // cannot grow the table.
+  std::string statsName = methodStr;
   if (methodStr == "debug_read_texture") {
     result = handleDebugReadTexture(params);
   } else if (methodStr == "debug_push_texture") {
@@ -234,13 +224,17 @@ void TextureServerWS::handleMessage(nw_connection_t conn,
     result = handleDebugListChannels(params);
   } else if (methodStr == "get_time") {
     result = handleGetTime(params);
+  } else if (methodStr == "get_stats") {
+    result = handleGetStats(params);
   } else {
+    statsName = "<unknown>";
     errorDict = @{
       @"code" : @404,
       @"message" :
           [NSString stringWithFormat:@"Unknown method: %@", method]
     };
   }
+  double handlerUs = microsecondsSince(t1);
 
   // Check if result itself is an error
   if (result && result[@"__error"]) {
@@ -251,6 +245,7 @@ void TextureServerWS::handleMessage(nw_connection_t conn,
     result = nil;
   }
 
+  auto t2 = std::chrono::steady_clock::now();
   NSMutableDictionary *response = [NSMutableDictionary dictionary];
   if (requestId)
     response[@"id"] = requestId;
@@ -259,11 +254,16 @@ void TextureServerWS::handleMessage(nw_connection_t conn,
   if (errorDict)
     response[@"error"] = errorDict;
 
-  sendResponse(conn, serializeJSON(response));
+  std::string json = serializeJSON(response);
+  double encodeUs = microsecondsSince(t2);
+  stats_.recordRequest(statsName, parseUs, handlerUs, encodeUs,
+                       errorDict != nil, message.size(), json.size());
+  sendResponse(conn, json, statsName);
 }
 
 void TextureServerWS::sendResponse(nw_connection_t conn,
-                                   const std::string &json) {
+                                   const std::string &json,
+                                   const std::string &method) {
   NSData *data = [NSData dataWithBytes:json.data() length:json.size()];
   dispatch_data_t dispatchData = dispatch_data_create(
       [data bytes], [data length], queue_, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
@@ -275,8 +275,12 @@ void TextureServerWS::sendResponse(nw_connection_t conn,
       nw_content_context_create("ws-response");
   nw_content_context_set_metadata_for_protocol(context, metadata);
 
+  auto sent = std::chrono::steady_clock::now();
+  std::string methodName = method;
   nw_connection_send(conn, dispatchData, context, true,
                      ^(nw_error_t error) {
+                       stats_.recordSend(methodName,
+                                         microsecondsSince(sent));
                        if (error) {
                          std::cerr << "Send error: "
                                    << nw_error_get_error_code(error)
@@ -314,6 +318,7 @@ TextureServerWS::handleDebugReadTexture(NSDictionary *params) {
     };
   }
 
+  stats_.recordRead(channelStr, data.rgba.size());
   std::string b64 = base64Encode(data.rgba);
 
   return @{
@@ -356,8 +361,9 @@ TextureServerWS::handleDebugPushTexture(NSDictionary *params) {
     };
   }
 
-  registry_.pushDebugTexture([channel UTF8String], w, h, origW, origH,
-                             rgba);
+  std::string channelStr = [channel UTF8String];
+  registry_.pushDebugTexture(channelStr, w, h, origW, origH, rgba);
+  stats_.recordPush(channelStr, rgba.size());
   return @{@"ok" : @YES};
 }
 
@@ -396,3 +402,10 @@ NSDictionary *TextureServerWS::handleGetTime(NSDictionary *params) {
     @"timeSeconds" : @(t.timeSeconds)
   };
 }
+
+NSDictionary *TextureServerWS::handleGetStats(NSDictionary *params) {
+  std::ostringstream ss;
+  stats_.writeJson(ss, registry_.memoryBytes(),
+                   registry_.listChannels().size());
+  return parseJSON(ss.str());
+}
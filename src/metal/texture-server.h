@@ -51,6 +51,9 @@ public:
 
   std::vector<ChannelInfo> listChannels() const;
 
+  // Bytes held by stored textures and channel metadata
+  size_t memoryBytes() const;
+
   // Transport
   TransportInfo getTransport() const;
   void setTransport(const TransportInfo &info);
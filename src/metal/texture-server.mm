@@ -68,6 +68,20 @@ std::vector<ChannelInfo> TextureChannelRegistry::listChannels() const {
   return result;
 }
 
+size_t TextureChannelRegistry::memoryBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t bytes = 0;
+  for (const auto &kv : channels_) {
+    bytes += kv.first.capacity() + sizeof(TextureData) +
+             kv.second.rgba.capacity();
+  }
+  for (const auto &kv : channelInfo_) {
+    bytes += kv.first.capacity() + sizeof(ChannelInfo) +
+             kv.second.name.capacity();
+  }
+  return bytes;
+}
+
 TransportInfo TextureChannelRegistry::getTransport() const {
   std::lock_guard<std::mutex> lock(mutex_);
   return transport_;
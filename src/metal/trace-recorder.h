@@ -0,0 +1,213 @@
+#pragma once
+
+// Timeline of EvalContext commands in Chrome Trace Event format.
+//
+// A host attaches a TraceRecorder as `ctx.trace`. Dispatches, draws, copies,
+// resizes, host syncs and waits are then recorded as complete ("X") events
+// with begin/end timestamps, the recording thread, the resource they target
+// and the bytes they move. CPU work that runs later (batched commands, the
+// async queue, pipelined frames) also records an "exec" event on the thread
+// that runs it, next to the "host" event of the call that issued it.
+//
+// When the context also has PerfCounters attached, "exec" events of CPU
+// dispatches and copies carry their hardware counter deltas in args.
+//
+// Events go into a ring preallocated at construction. Recording claims a
+// slot with one atomic increment and never locks or allocates; once the ring
+// is full the oldest events are overwritten. Read it (snapshot / writeJson)
+// when no commands are running. The output loads in chrome://tracing and
+// Perfetto.
+//
+// Building with -DNANO_TRACE=0 removes every recording call from
+// EvalContext.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "perf-counters.h"
+
+#ifndef NANO_TRACE
+#define NANO_TRACE 1
+#endif
+
+struct TraceEvent {
+  const char *name = "";     // dispatch, draw, copyBuffer, resize, sync, wait...
+  const char *category = ""; // host (issuing call) or exec (CPU work)
+  char target[48] = {};      // kernel / shader name, if any
+  uint64_t beginNs = 0;
+  uint64_t endNs = 0;
+  uint32_t thread = 0;
+  int32_t resource = -1; // -1 = none or several
+  uint64_t bytes = 0;
+  PerfSample counters; // zero unless sampled
+};
+
+class TraceRecorder {
+public:
+  // `capacity` is rounded up to a power of two.
+  explicit TraceRecorder(size_t capacity = 1 << 16) {
+    size_t n = 1;
+    while (n < capacity)
+      n <<= 1;
+    slots.reset(new Slot[n]);
+    mask = n - 1;
+    origin = nowNs();
+  }
+
+  TraceRecorder(const TraceRecorder &) = delete;
+  TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+  static uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  // Small per-thread id (1, 2, ...) in first-use order.
+  static uint32_t threadId() {
+    static std::atomic<uint32_t> next{1};
+    thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+  }
+
+  // `name` and `category` must be string literals; `target` is copied.
+  void record(const char *name, const char *category, const char *target,
+              uint64_t beginNs, uint64_t endNs, int resource, uint64_t bytes,
+              const PerfSample &counters = PerfSample()) {
+    uint64_t i = head.fetch_add(1, std::memory_order_relaxed);
+    Slot &s = slots[i & mask];
+    TraceEvent &e = s.event;
+    e.name = name;
+    e.category = category;
+    size_t len = target ? std::strlen(target) : 0;
+    len = len < sizeof(e.target) - 1 ? len : sizeof(e.target) - 1;
+    if (len)
+      std::memcpy(e.target, target, len);
+    e.target[len] = '\0';
+    e.beginNs = beginNs;
+    e.endNs = endNs;
+    e.thread = threadId();
+    e.resource = resource;
+    e.bytes = bytes;
+    e.counters = counters;
+    s.seq.store(i + 1, std::memory_order_release);
+  }
+
+  // Records the enclosing scope as one event when the recorder is non-null.
+  class Span {
+  public:
+    Span(TraceRecorder *recorder, const char *name, const char *category,
+         const char *target = "", int resource = -1, uint64_t bytes = 0)
+        : recorder(recorder), name(name), category(category), target(target),
+          resource(resource), bytes(bytes),
+          beginNs(recorder ? nowNs() : 0) {}
+    ~Span() {
+      if (recorder)
+        recorder->record(name, category, target, beginNs, nowNs(), resource,
+                         bytes, counters);
+    }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+    TraceRecorder *recorder;
+    const char *name;
+    const char *category;
+    const char *target;
+    int resource;
+    uint64_t bytes;
+    uint64_t beginNs;
+    PerfSample counters;
+  };
+
+  size_t capacity() const { return mask + 1; }
+  uint64_t recorded() const { return head.load(std::memory_order_relaxed); }
+  // Events overwritten because the ring was full
+  uint64_t dropped() const {
+    uint64_t n = recorded();
+    return n > capacity() ? n - capacity() : 0;
+  }
+
+  // Events still in the ring, oldest first.
+  std::vector<TraceEvent> snapshot() const {
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity() ? end - capacity() : 0;
+    std::vector<TraceEvent> out;
+    out.reserve(static_cast<size_t>(end - begin));
+    for (uint64_t i = begin; i < end; ++i) {
+      const Slot &s = slots[i & mask];
+      if (s.seq.load(std::memory_order_acquire) != i + 1)
+        continue; // not yet published
+      out.push_back(s.event);
+    }
+    return out;
+  }
+
+  void clear() {
+    for (size_t i = 0; i <= mask; ++i)
+      slots[i].seq.store(0, std::memory_order_relaxed);
+    head.store(0, std::memory_order_relaxed);
+    origin = nowNs();
+  }
+
+  // Chrome Trace Event JSON ({"traceEvents": [...]}), timestamps in
+  // microseconds since the recorder was created or cleared.
+  void writeJson(std::ostream &out) const {
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    char num[64];
+    auto us = [&](uint64_t ns) {
+      std::snprintf(num, sizeof(num), "%.3f", static_cast<double>(ns) / 1000.0);
+      return num;
+    };
+    for (const TraceEvent &e : snapshot()) {
+      if (!first)
+        out << ",";
+      first = false;
+      uint64_t begin = e.beginNs > origin ? e.beginNs - origin : 0;
+      out << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+          << ",\"ts\":" << us(begin);
+      out << ",\"dur\":" << us(e.endNs - e.beginNs) << ",\"args\":{";
+      if (e.target[0] != '\0')
+        out << "\"target\":\"" << e.target << "\",";
+      out << "\"resource\":" << e.resource << ",\"bytes\":" << e.bytes;
+      const PerfSample &c = e.counters;
+      if (c.cycles || c.instructions)
+        out << ",\"cycles\":" << c.cycles << ",\"instructions\":"
+            << c.instructions << ",\"llcMisses\":" << c.llcMisses
+            << ",\"branchMisses\":" << c.branchMisses;
+      out << "}}";
+    }
+    out << "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":"
+        << dropped() << "}}";
+  }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> seq{0}; // index + 1 of the event it holds
+    TraceEvent event;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  size_t mask = 0;
+  std::atomic<uint64_t> head{0};
+  uint64_t origin = 0;
+};
+
+// Recording macros for EvalContext members (they read `trace`).
+#if NANO_TRACE
+#define NANO_TRACE_SPAN(var, ...) TraceRecorder::Span var(trace, __VA_ARGS__)
+#define NANO_TRACE_BYTES(var, n) ((var).bytes = static_cast<uint64_t>(n))
+#define NANO_TRACE_COUNTERS(var) (&(var).counters)
+#else
+#define NANO_TRACE_SPAN(var, ...) ((void)0)
+#define NANO_TRACE_BYTES(var, n) ((void)0)
+#define NANO_TRACE_COUNTERS(var) nullptr
+#endif
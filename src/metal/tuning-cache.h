@@ -0,0 +1,142 @@
+#pragma once
+
+// Autotuned tuning-parameter values, keyed by graph and machine.
+//
+// scripts/autotune.ts searches a graph's autotunable tuning params for the
+// fastest frame time and records the result in a cache file; hosts load it at
+// startup through the generated declare_tuning_params(ctx, path). The file is
+// plain text, one entry per line, fields separated by tabs:
+//
+//   <graph hash> <machine key> <frame ms> <name>=<value> <name>=<value> ...
+//
+// The graph hash is emitted by CppGenerator (graph_hash()); the machine key
+// comes from tuningMachineKey(). Lines starting with '#' are comments. When
+// several lines match, the last one wins. Vector params are stored per
+// component (name_0, name_1, ...), as in EvalContext::inputs.
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/utsname.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+// "<os>-<arch>-<cpu model>-<n>t", with anything but letters and digits
+// folded into single dashes so it fits in one cache field.
+inline std::string tuningMachineKey() {
+  std::string raw;
+  struct utsname u;
+  if (uname(&u) == 0)
+    raw = std::string(u.sysname) + " " + u.machine;
+  std::string model;
+#if defined(__APPLE__)
+  char brand[256] = {};
+  size_t size = sizeof(brand);
+  if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) ==
+      0)
+    model = brand;
+#else
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      auto colon = line.find(':');
+      if (colon != std::string::npos)
+        model = line.substr(colon + 1);
+      break;
+    }
+  }
+#endif
+  raw += " " + model + " " +
+         std::to_string(std::thread::hardware_concurrency()) + "t";
+
+  std::string key;
+  for (char c : raw) {
+    if (std::isalnum(static_cast<unsigned char>(c)))
+      key += c;
+    else if (!key.empty() && key.back() != '-')
+      key += '-';
+  }
+  while (!key.empty() && key.back() == '-')
+    key.pop_back();
+  return key;
+}
+
+struct TuningEntry {
+  std::string graph;
+  std::string machine;
+  double frameMs = 0.0;
+  std::vector<std::pair<std::string, float>> values;
+};
+
+class TuningCache {
+public:
+  // False when the file cannot be read; malformed lines are skipped.
+  bool load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in)
+      return false;
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#')
+        continue;
+      std::istringstream fields(line);
+      TuningEntry e;
+      std::string frameMs;
+      if (!std::getline(fields, e.graph, '\t') ||
+          !std::getline(fields, e.machine, '\t') ||
+          !std::getline(fields, frameMs, '\t'))
+        continue;
+      e.frameMs = std::atof(frameMs.c_str());
+      std::string pairs;
+      std::getline(fields, pairs);
+      std::istringstream tokens(pairs);
+      std::string token;
+      while (tokens >> token) {
+        auto eq = token.find('=');
+        if (eq == std::string::npos || eq == 0)
+          continue;
+        e.values.emplace_back(token.substr(0, eq),
+                              std::strtof(token.c_str() + eq + 1, nullptr));
+      }
+      entries.push_back(std::move(e));
+    }
+    return true;
+  }
+
+  // Last entry for `graph` on `machine`, or null.
+  const TuningEntry *find(const std::string &graph,
+                          const std::string &machine) const {
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+      if (it->graph == graph && it->machine == machine)
+        return &*it;
+    return nullptr;
+  }
+
+  size_t size() const { return entries.size(); }
+
+private:
+  std::vector<TuningEntry> entries;
+};
+
+// Write the values cached for `graph` on this machine into `inputs` (any
+// map from std::string to float). Returns how many were applied.
+template <typename InputMap>
+int applyTuningCache(InputMap &inputs, const char *path, const char *graph) {
+  TuningCache cache;
+  if (!path || !*path || !cache.load(path))
+    return 0;
+  const TuningEntry *e = cache.find(graph, tuningMachineKey());
+  if (!e)
+    return 0;
+  for (const auto &kv : e->values)
+    inputs[kv.first] = kv.second;
+  return static_cast<int>(e->values.size());
+}
@@ -0,0 +1,266 @@
+import { ResourceState } from '../webgpu/host-interface';
+
+// CPU implementations of the whole-resource commands (cmd_blur_texture and
+// friends) over ResourceState.data, shared by the interpreter and the mock
+// executor. The JIT executor carries the same algorithms in
+// webgpu/intrinsics.js, which is inlined into generated code and cannot
+// import this module, so keep the two in step.
+
+type Texel = number[];
+
+// Texture edges follow the sampler's wrap mode; textures without a sampler
+// repeat, as in the C++ runtime.
+const wrapModeOf = (res: ResourceState): string => res.def.sampler?.wrap ?? 'repeat';
+
+const wrapIndex = (i: number, n: number, wrap: string): number => {
+  if (wrap === 'clamp') return Math.max(0, Math.min(n - 1, i));
+  if (wrap === 'mirror') {
+    const m = ((i % (2 * n)) + 2 * n) % (2 * n);
+    return m >= n ? 2 * n - 1 - m : m;
+  }
+  return ((i % n) + n) % n;
+};
+
+const texel = (v: any): Texel => Array.isArray(v) ? v : [v, v, v, v];
+
+// Elements a buffer holds: its declared size, or its data if longer (data
+// the graph never wrote may still be empty).
+const capacityOf = (res: ResourceState): number => Math.max(res.data?.length ?? 0, res.width);
+
+// Components per element, from the data or else the declared vector type.
+const componentsOf = (res: ResourceState): number =>
+  Array.isArray(res.data?.[0]) ? res.data[0].length : Number(/([234])$/.exec(res.def.dataType ?? '')?.[1] ?? 1);
+
+// Gaussian weights for offsets -r..r, scaled to sum to 1 when normalize is set.
+const gaussianWeights = (r: number, sigma: number, normalize = true): number[] => {
+  const w = Array.from({ length: 2 * r + 1 }, (_, k) => Math.exp(-0.5 * (k - r) * (k - r) / (sigma * sigma)));
+  const sum = w.reduce((s, v) => s + v, 0);
+  return normalize ? w.map(v => v / sum) : w;
+};
+
+// One separable pass: out(p) = sum_k weights[k] * in(p + k - r) along x
+// (axis 0) or y (axis 1), edges wrapped.
+const filterAxis = (src: Texel[], w: number, h: number, weights: number[], axis: 0 | 1, wrap: string): Texel[] => {
+  const r = (weights.length - 1) / 2;
+  const out: Texel[] = new Array(w * h);
+  for (let y = 0; y < h; y++) {
+    for (let x = 0; x < w; x++) {
+      const acc = [0, 0, 0, 0];
+      for (let k = 0; k < weights.length; k++) {
+        const sx = axis === 0 ? wrapIndex(x + k - r, w, wrap) : x;
+        const sy = axis === 1 ? wrapIndex(y + k - r, h, wrap) : y;
+        const p = src[sy * w + sx];
+        for (let c = 0; c < 4; c++) acc[c] += weights[k] * p[c];
+      }
+      out[y * w + x] = acc;
+    }
+  }
+  return out;
+};
+
+/**
+ * Separable Gaussian or box blur of src into dst (which may be src). Wide
+ * Gaussians use the exact kernel here; the C++ runtime approximates them
+ * with box passes, within about 1%.
+ */
+export function blurTexture(resources: Map<string, ResourceState>, srcId: string, dstId: string,
+                            radius: number, sigma: number, mode: string): void {
+  const src = resources.get(srcId);
+  const dst = resources.get(dstId);
+  if (!src || !dst || !src.data) return;
+  const w = src.width, h = src.height;
+  if (dst.width !== w || dst.height !== h || src.data.length < w * h) return;
+  const pixels: Texel[] = src.data.slice(0, w * h).map((v: any) => [...texel(v)]);
+  const r = Math.round(Math.max(0, radius));
+  if (r <= 0) {
+    dst.data = pixels;
+    return;
+  }
+  const weights = mode === 'box'
+    ? new Array(2 * r + 1).fill(1 / (2 * r + 1))
+    : gaussianWeights(r, sigma > 0 ? sigma : r / 3);
+  const wrap = wrapModeOf(src);
+  dst.data = filterAxis(filterAxis(pixels, w, h, weights, 0, wrap), w, h, weights, 1, wrap);
+}
+
+/**
+ * Prefix sum (component-wise for vector elements) of src into dst, which may
+ * be src: exclusive unless inclusive is set. totalId receives the sum.
+ */
+export function scanBuffer(resources: Map<string, ResourceState>, srcId: string, dstId: string,
+                           inclusive: boolean, count: number, totalId: string | null): void {
+  const src = resources.get(srcId);
+  const dst = resources.get(dstId);
+  if (!src || !dst || !src.data || !dst.data) return;
+  let n = Math.min(src.data.length, capacityOf(dst));
+  if (count !== Infinity && count >= 0) n = Math.min(n, count);
+  const add = (a: any, b: any) => Array.isArray(a) ? a.map((v: number, i: number) => v + b[i]) : a + b;
+  let sum: any = Array.isArray(src.data[0]) ? src.data[0].map(() => 0) : 0;
+  for (let i = 0; i < n; i++) {
+    const before = sum;
+    sum = add(sum, src.data[i]);
+    dst.data[i] = inclusive ? sum : before;
+  }
+  const total = totalId ? resources.get(totalId) : undefined;
+  if (total?.data && capacityOf(total) > 0) total.data[0] = sum;
+}
+
+/**
+ * Copy, in order, the elements of src whose flag (flagsId, or each element's
+ * first component) is positive to the front of dst, which may be src.
+ * counterId receives how many were kept.
+ */
+export function compactBuffer(resources: Map<string, ResourceState>, srcId: string, dstId: string,
+                              flagsId: string | null, counterId: string | null): void {
+  const src = resources.get(srcId);
+  const dst = resources.get(dstId);
+  if (!src || !dst || !src.data || !dst.data) return;
+  const flags = flagsId ? resources.get(flagsId)?.data : src.data;
+  if (!flags) return;
+  const n = Math.min(src.data.length, flags.length);
+  let kept = 0;
+  const capacity = capacityOf(dst);
+  for (let i = 0; i < n && kept < capacity; i++) {
+    const flag = Array.isArray(flags[i]) ? flags[i][0] : flags[i];
+    if (flag > 0) dst.data[kept++] = src.data[i];
+  }
+  const counter = counterId ? resources.get(counterId) : undefined;
+  if (counter?.data && capacityOf(counter) > 0) counter.data[0] = kept;
+}
+
+/**
+ * Stable sort of src's elements into dst (which may be src) by component
+ * keyComponent of each, or by keysId, which is sorted along with them.
+ */
+export function sortBuffer(resources: Map<string, ResourceState>, srcId: string, dstId: string, keyComponent: number,
+                           keysId: string | null, descending: boolean, count: number): void {
+  const src = resources.get(srcId);
+  const dst = resources.get(dstId);
+  if (!src || !dst || !src.data || !dst.data) return;
+  const keys = keysId ? resources.get(keysId)?.data : undefined;
+  if (keysId && !keys) return;
+  let n = Math.min(src.data.length, capacityOf(dst), keys ? keys.length : Infinity);
+  if (count !== Infinity && count >= 0) n = Math.min(n, count);
+  const keyOf = (i: number): number => {
+    if (keys) return keys[i];
+    const v = src.data![i];
+    return Array.isArray(v) ? v[keyComponent] : v;
+  };
+  // Array.prototype.sort is stable
+  const order = Array.from({ length: n }, (_, i) => i);
+  order.sort((a, b) => descending ? keyOf(b) - keyOf(a) : keyOf(a) - keyOf(b));
+  const sorted = order.map(i => src.data![i]);
+  const sortedKeys = keys ? order.map(i => keys[i]) : null;
+  for (let i = 0; i < n; i++) {
+    dst.data[i] = sorted[i];
+    if (sortedKeys) keys![i] = sortedKeys[i];
+  }
+}
+
+/**
+ * Reduce src (a buffer or texture) into dst from index 0: sum/min/max/mean
+ * per component (or of component), argmin/argmax of component, or a
+ * histogram of component over [rangeMin, rangeMax).
+ */
+export function reduceBuffer(resources: Map<string, ResourceState>, srcId: string, dstId: string, mode: string,
+                             component: number, count: number, bins: number, rangeMin: number, rangeMax: number): void {
+  const src = resources.get(srcId);
+  const dst = resources.get(dstId);
+  if (!src || !src.data || !dst || !dst.data) return;
+  let n = src.data.length;
+  if (count !== Infinity && count >= 0) n = Math.min(n, count);
+  const width = Array.isArray(src.data[0]) ? src.data[0].length : 1;
+  const at = (i: number, c: number): number => Array.isArray(src.data![i]) ? src.data![i][c] : src.data![i];
+  const key = Math.max(component, 0);
+  const capacity = capacityOf(dst);
+  if (mode === 'histogram') {
+    const binCount = Math.min(bins >= 0 ? bins : capacity, capacity);
+    const counts = new Array(binCount).fill(0);
+    const scale = rangeMax > rangeMin ? binCount / (rangeMax - rangeMin) : 0;
+    for (let i = 0; i < n; i++) {
+      const v = at(i, key);
+      if (Number.isNaN(v)) continue;
+      counts[Math.min(binCount - 1, Math.max(0, Math.floor((v - rangeMin) * scale)))]++;
+    }
+    counts.forEach((c, k) => { dst.data![k] = c; });
+    return;
+  }
+  if (mode === 'argmin' || mode === 'argmax') {
+    let best = -1;
+    for (let i = 0; i < n; i++) {
+      const v = at(i, key);
+      if (Number.isNaN(v)) continue;
+      if (best < 0 || (mode === 'argmin' ? v < at(best, key) : v > at(best, key))) best = i;
+    }
+    dst.data[0] = best;
+    return;
+  }
+  const components = component >= 0 ? [component] : Array.from({ length: width }, (_, c) => c);
+  const results = components.map(c => {
+    let total = 0, min = Infinity, max = -Infinity, seen = false;
+    for (let i = 0; i < n; i++) {
+      const v = at(i, c);
+      total += v;
+      if (Number.isNaN(v)) continue;
+      min = Math.min(min, v);
+      max = Math.max(max, v);
+      seen = true;
+    }
+    if (mode === 'min') return seen ? min : 0;
+    if (mode === 'max') return seen ? max : 0;
+    if (mode === 'mean') return n > 0 ? total / n : 0;
+    return total;
+  });
+  // Vector results fill element 0 of a vector buffer
+  if (componentsOf(dst) > 1 && results.length > 1) dst.data[0] = results;
+  else results.forEach((v, k) => { if (k < capacity) dst.data![k] = v; });
+}
+
+/**
+ * Convolve src into dst (which may be src) with the first channel of
+ * kernelId, centred on its middle texel, or with a Gaussian of radius
+ * (sigma <= 0 means radius / 3). normalize scales the kernel to sum to 1.
+ * The C++ runtime does this through FFTs; here Gaussians run as two
+ * separable passes and kernel textures directly.
+ */
+export function convolveTexture(resources: Map<string, ResourceState>, srcId: string, dstId: string,
+                                kernelId: string | null, radius: number, sigma: number, normalize: boolean): void {
+  const src = resources.get(srcId);
+  const dst = resources.get(dstId);
+  if (!src || !dst || !src.data) return;
+  const w = src.width, h = src.height;
+  if (dst.width !== w || dst.height !== h || src.data.length < w * h) return;
+  const pixels: Texel[] = src.data.slice(0, w * h).map((v: any) => texel(v));
+  const wrap = wrapModeOf(src);
+  if (!kernelId) {
+    const r = Math.round(Math.max(0, radius));
+    const weights = gaussianWeights(r, sigma > 0 ? sigma : Math.max(r, 1) / 3, normalize);
+    dst.data = filterAxis(filterAxis(pixels, w, h, weights, 0, wrap), w, h, weights, 1, wrap);
+    return;
+  }
+  const kernel = resources.get(kernelId);
+  if (!kernel || !kernel.data) return;
+  const kw = kernel.width, kh = kernel.height;
+  if (kw <= 0 || kh <= 0 || kernel.data.length < kw * kh) return;
+  const taps: number[] = kernel.data.slice(0, kw * kh).map((v: any) => texel(v)[0]);
+  const sum = taps.reduce((s, v) => s + v, 0);
+  const scale = normalize && sum !== 0 ? 1 / sum : 1;
+  const cx = Math.floor(kw / 2), cy = Math.floor(kh / 2);
+  const out: Texel[] = new Array(w * h);
+  for (let y = 0; y < h; y++) {
+    for (let x = 0; x < w; x++) {
+      const acc = [0, 0, 0, 0];
+      for (let ky = 0; ky < kh; ky++) {
+        const sy = wrapIndex(y - (ky - cy), h, wrap);
+        for (let kx = 0; kx < kw; kx++) {
+          const t = taps[ky * kw + kx] * scale;
+          if (t === 0) continue;
+          const p = pixels[sy * w + wrapIndex(x - (kx - cx), w, wrap)];
+          for (let c = 0; c < 4; c++) acc[c] += t * p[c];
+        }
+      }
+      out[y * w + x] = acc;
+    }
+  }
+  dst.data = out;
+}
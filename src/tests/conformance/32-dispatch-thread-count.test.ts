@@ -1,12 +1,52 @@
 import { describe, it, expect } from 'vitest';
 import { runFullGraphTest, cpuBackends } from './test-runner';
 import { IRDocument } from '../../ir/types';
+import { CppGenerator } from '../../metal/cpp-generator';
 
 // These tests verify that `dispatch` means thread counts, not workgroup counts.
 // Each thread writes a marker value to its gid position in a result buffer.
 const backends = cpuBackends;
 
 describe('Conformance: Dispatch Thread Count Semantics', () => {
+  it('C++ generator emits and registers a CPU kernel per dispatched shader', () => {
+    const shader = (id: string, nodes: any[]) => ({ id, type: 'shader', inputs: [], outputs: [], localVars: [], nodes });
+    const ir: IRDocument = {
+      version: '1.0.0',
+      meta: { name: 'CPU Kernels' },
+      entryPoint: 'main',
+      inputs: [{ id: 'u_scale', type: 'float', default: 2 }],
+      resources: [{
+        id: 'b_res', type: 'buffer', dataType: 'float', size: { mode: 'fixed', value: 8 },
+        persistence: { retain: false, clearEveryFrame: false, clearOnResize: false, cpuAccess: true }
+      }],
+      structs: [],
+      functions: [
+        {
+          id: 'main', type: 'cpu', inputs: [], outputs: [], localVars: [],
+          nodes: [
+            { id: 'd1', op: 'cmd_dispatch', func: 'shader_scale', threads: [8, 1, 1], next: 'd2' },
+            { id: 'd2', op: 'cmd_dispatch', func: 'shader_call', threads: [8, 1, 1] }
+          ]
+        },
+        shader('shader_scale', [
+          { id: 'gid', op: 'builtin_get', name: 'global_invocation_id' },
+          { id: 'idx', op: 'vec_get_element', vec: 'gid', index: 0 },
+          { id: 'scale', op: 'var_get', var: 'u_scale' },
+          { id: 'w', op: 'buffer_store', buffer: 'b_res', index: 'idx', value: 'scale' }
+        ]),
+        shader('shader_call', [{ id: 'c', op: 'call_func', func: 'helper' }]),
+        { id: 'helper', type: 'cpu', inputs: [], outputs: [], localVars: [], nodes: [] }
+      ]
+    } as any;
+    const { code, diagnostics } = new CppGenerator().compile(ir, 'main');
+    expect(code).toContain('void func_shader_scale_cpu(');
+    expect(code).toContain('ctx.resources[0]->kernelStore(');
+    expect(code).toContain('ctx.registerCpuKernel("shader_scale", func_shader_scale_cpu);');
+    // A shader the CPU backend cannot run natively gets no kernel
+    expect(diagnostics).toEqual(['No CPU kernel for shader_call: calls helper']);
+    expect(code).not.toContain('registerCpuKernel("shader_call"');
+  });
+
   if (backends.length === 0) {
     it.skip('Skipping dispatch thread count tests for current backend', () => { });
   } else {
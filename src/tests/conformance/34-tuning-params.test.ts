@@ -1,6 +1,7 @@
 import { describe, expect, it } from 'vitest';
 import { IRDocument } from '../../ir/types';
 import { EvaluationContext } from '../../interpreter/context';
+import { CppGenerator, graphHash } from '../../metal/cpp-generator';
 import { availableBackends, cpuBackends, runFullGraphTest } from './test-runner';
 
 describe('Conformance: Tuning Parameters', () => {
@@ -306,4 +307,34 @@ describe('Conformance: Tuning Parameters', () => {
     }
   );
 
+  // 12. C++ hosts start tuning params at their defaults, then the autotune cache
+  it('C++ generator emits tuning defaults and an autotune graph hash', () => {
+    const ir: IRDocument = {
+      version: '1.0.0',
+      meta: { name: 'tuning-defaults', debug: true },
+      entryPoint: 'main',
+      inputs: [],
+      tuningParams: [
+        { id: 't_samples', type: 'int', default: 8, autotune: true, ui: { min: 1, max: 32, step: 1 } },
+        { id: 't_tint', type: 'float3', default: [0.5, 0.25, 1] },
+      ],
+      resources: [bufferRes as any],
+      functions: [{
+        id: 'main', type: 'cpu', inputs: [], outputs: [], localVars: [],
+        nodes: [{ id: 'store', op: 'buffer_store', buffer: 'b_result', index: 0, value: 't_samples' }],
+      }],
+    };
+    const { code, graphHash: hash } = new CppGenerator().compile(ir, 'main');
+    expect(hash).toMatch(/^[0-9a-f]{16}$/);
+    expect(code).toContain(`const char* graph_hash() { return "${hash}"; }`);
+    expect(code).toContain('ctx.inputs["t_samples"] = 8.0f;');
+    expect(code).toContain('ctx.inputs["t_tint_1"] = 0.25f;');
+    expect(code).toContain('return applyTuningCache(ctx.inputs, cachePath, graph_hash());');
+
+    // Defaults and metadata do not change the cache key; the graph does.
+    const retuned = { ...ir, meta: { name: 'renamed' }, tuningParams: [{ ...ir.tuningParams![0], default: 16 }, ir.tuningParams![1]] };
+    expect(graphHash(retuned)).toBe(hash);
+    const changed = { ...ir, resources: [{ ...bufferRes, size: { mode: 'fixed', value: 32 } } as any] };
+    expect(graphHash(changed)).not.toBe(hash);
+  });
 });
@@ -0,0 +1,93 @@
+import { describe, it, expect } from 'vitest';
+import { cpuBackends, fixedTexture, opGraph } from './test-runner';
+import { IRDocument } from '../../ir/types';
+import { CppGenerator } from '../../metal/cpp-generator';
+
+// cmd_blur_texture: texture-blur.h in the C++ runtime.
+const backends = cpuBackends;
+
+const blurGraph = (name: string, width: number, height: number, node: any): IRDocument => opGraph(
+  name,
+  [{ id: 'u_radius', type: 'float', default: 1 }],
+  [fixedTexture('t_src', width, height), fixedTexture('t_dst', width, height)],
+  [{ id: 'blur', op: 'cmd_blur_texture', src: 't_src', dst: 't_dst', ...node }]
+);
+
+describe('Conformance: Blur Texture', () => {
+  it('C++ generator batches cmd_blur_texture with its radius input', () => {
+    const ir = blurGraph('Blur Emit', 4, 4, { radius: 'u_radius', sigma: 2, mode: 'box' });
+    const { code } = new CppGenerator().compile(ir, 'main');
+    expect(code).toMatch(/ctx\.blurTexture\(0, 1, .*u_radius.*, 2\.0f, 1\);/);
+    expect(code).toContain('ctx.beginBatch();');
+  });
+
+  it('C++ generator resolves an optional sigma wired through args', () => {
+    const ir = blurGraph('Blur Sigma Edge', 4, 4, { radius: 2, args: { sigma: 'sig' } });
+    ir.functions[0].nodes.unshift({ id: 'sig', op: 'literal', val: 0.5 });
+    const { code } = new CppGenerator().compile(ir, 'main');
+    expect(code).toMatch(/ctx\.blurTexture\(0, 1, 2\.0f, (n_sig|0\.5f), 0\);/);
+  });
+
+  if (backends.length === 0) {
+    it.skip('Skipping blur texture tests (no compatible backend)', () => { });
+    return;
+  }
+
+  // Box of radius 1 over an impulse: each neighbour gets a third (repeat wrap,
+  // so the single row blurs vertically into itself).
+  const irBox = blurGraph('Box Blur', 5, 1, { radius: 'u_radius', mode: 'box' });
+
+  backends.forEach(backend => {
+    it(`Box blur spreads an impulse [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irBox);
+      const src = ctx.getResource('t_src');
+      src.width = 5; src.height = 1;
+      src.data = [[0, 0, 0, 0], [0, 0, 0, 0], [3, 6, 9, 3], [0, 0, 0, 0], [0, 0, 0, 0]];
+      const dst = ctx.getResource('t_dst');
+      dst.width = 5; dst.height = 1;
+      dst.data = src.data.map(() => [0, 0, 0, 0]);
+
+      await backend.run(ctx, 'main');
+
+      const result = ctx.getResource('t_dst').data as number[][];
+      expect(result[0]).toEqual([0, 0, 0, 0]);
+      for (const x of [1, 2, 3]) {
+        expect(result[x][0]).toBeCloseTo(1);
+        expect(result[x][1]).toBeCloseTo(2);
+        expect(result[x][2]).toBeCloseTo(3);
+        expect(result[x][3]).toBeCloseTo(1);
+      }
+      expect(result[4]).toEqual([0, 0, 0, 0]);
+      ctx.destroy();
+    });
+  });
+
+  // A Gaussian preserves a constant image, and is symmetric about an impulse.
+  const irGaussian = blurGraph('Gaussian Blur', 7, 7, { radius: 3 });
+
+  backends.forEach(backend => {
+    it(`Gaussian blur is normalized and symmetric [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irGaussian);
+      const src = ctx.getResource('t_src');
+      src.width = 7; src.height = 7;
+      src.data = Array.from({ length: 49 }, (_, i) => [0.5, 0.5, 0.5, i === 24 ? 1 : 0]);
+      const dst = ctx.getResource('t_dst');
+      dst.width = 7; dst.height = 7;
+      dst.data = Array.from({ length: 49 }, () => [0, 0, 0, 0]);
+
+      await backend.run(ctx, 'main');
+
+      const result = ctx.getResource('t_dst').data as number[][];
+      let alphaSum = 0;
+      for (const px of result) {
+        expect(px[0]).toBeCloseTo(0.5, 5);
+        alphaSum += px[3];
+      }
+      expect(alphaSum).toBeCloseTo(1, 4);
+      expect(result[24][3]).toBeGreaterThan(result[23][3]);
+      expect(result[23][3]).toBeCloseTo(result[25][3], 6);
+      expect(result[17][3]).toBeCloseTo(result[31][3], 6);
+      ctx.destroy();
+    });
+  });
+});
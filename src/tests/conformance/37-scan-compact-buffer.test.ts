@@ -0,0 +1,92 @@
+import { describe, it, expect } from 'vitest';
+import { cpuBackends, fixedBuffer, opGraph } from './test-runner';
+import { CppGenerator } from '../../metal/cpp-generator';
+
+// cmd_scan_buffer and cmd_compact_buffer: buffer-scan.h in the C++ runtime.
+const backends = cpuBackends;
+
+const inputs = [{ id: 'u_count', type: 'int', default: 3 }];
+
+describe('Conformance: Scan and Compact Buffer', () => {
+  it('C++ generator batches scan and compaction with element strides', () => {
+    const ir = opGraph('Scan Compact Emit', inputs, [
+      fixedBuffer('b_particles', 'float4', 8),
+      fixedBuffer('b_flags', 'float', 8),
+      fixedBuffer('b_live', 'float4', 8),
+      fixedBuffer('b_offsets', 'float', 8),
+      fixedBuffer('cnt', 'int', 1, 'atomic_counter')
+    ], [
+      { id: 'scan', op: 'cmd_scan_buffer', src: 'b_flags', dst: 'b_offsets', count: 'u_count', total: 'cnt' },
+      { id: 'compact', op: 'cmd_compact_buffer', src: 'b_particles', dst: 'b_live', flags: 'b_flags', counter: 'cnt' },
+      { id: 'live', op: 'cmd_compact_buffer', src: 'b_live', dst: 'b_live' }
+    ]);
+    const { code } = new CppGenerator().compile(ir, 'main');
+    expect(code).toMatch(/ctx\.scanBuffer\(1, 3, 1, false, static_cast<int>\(.*u_count.*\), 4, true\);/);
+    expect(code).toContain('ctx.compactBuffer(0, 1, 2, 4, 1, 4, true);');
+    expect(code).toContain('ctx.compactBuffer(2, -1, 2, 4, 4, -1, false);');
+    expect(code).toContain('ctx.beginBatch();');
+  });
+
+  if (backends.length === 0) {
+    it.skip('Skipping scan/compact buffer tests (no compatible backend)', () => { });
+    return;
+  }
+
+  const irScan = opGraph('Scan Buffer', inputs, [
+    fixedBuffer('b_src', 'float', 5),
+    fixedBuffer('b_exclusive', 'float', 5),
+    fixedBuffer('b_inclusive', 'float', 5),
+    fixedBuffer('b_total', 'float', 1)
+  ], [
+    { id: 'excl', op: 'cmd_scan_buffer', src: 'b_src', dst: 'b_exclusive', total: 'b_total' },
+    { id: 'incl', op: 'cmd_scan_buffer', src: 'b_src', dst: 'b_inclusive', inclusive: true }
+  ]);
+
+  backends.forEach(backend => {
+    it(`Exclusive and inclusive scans [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irScan);
+      ctx.getResource('b_src').data = [1, 2, 3, 4, 5];
+      ctx.getResource('b_exclusive').data = [0, 0, 0, 0, 0];
+      ctx.getResource('b_inclusive').data = [0, 0, 0, 0, 0];
+      ctx.getResource('b_total').data = [0];
+
+      await backend.run(ctx, 'main');
+
+      expect(ctx.getResource('b_exclusive').data).toEqual([0, 1, 3, 6, 10]);
+      expect(ctx.getResource('b_inclusive').data).toEqual([1, 3, 6, 10, 15]);
+      expect(ctx.getResource('b_total').data![0]).toBe(15);
+      ctx.destroy();
+    });
+  });
+
+  // Live particles keep their order; the count lands in an atomic counter.
+  const irCompact = opGraph('Compact Buffer', inputs, [
+    fixedBuffer('b_particles', 'float4', 4),
+    fixedBuffer('b_flags', 'float', 4),
+    fixedBuffer('b_live', 'float4', 4),
+    fixedBuffer('cnt', 'int', 1, 'atomic_counter'),
+    fixedBuffer('b_count', 'int', 1)
+  ], [
+    { id: 'compact', op: 'cmd_compact_buffer', src: 'b_particles', dst: 'b_live', flags: 'b_flags', counter: 'cnt' },
+    { id: 'load', op: 'atomic_load', counter: 'cnt', index: 0 },
+    { id: 'store', op: 'buffer_store', buffer: 'b_count', index: 0, value: 'load' }
+  ]);
+
+  backends.forEach(backend => {
+    it(`Compaction by flags keeps order and counts [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irCompact);
+      ctx.getResource('b_particles').data = [[1, 1, 1, 1], [2, 2, 2, 2], [3, 3, 3, 3], [4, 4, 4, 4]];
+      ctx.getResource('b_flags').data = [0, 1, 0, 1];
+      ctx.getResource('b_live').data = [[0, 0, 0, 0], [0, 0, 0, 0], [9, 9, 9, 9], [9, 9, 9, 9]];
+
+      await backend.run(ctx, 'main');
+
+      const live = ctx.getResource('b_live').data as number[][];
+      expect(live[0]).toEqual([2, 2, 2, 2]);
+      expect(live[1]).toEqual([4, 4, 4, 4]);
+      expect(live[2]).toEqual([9, 9, 9, 9]);
+      expect(ctx.getResource('b_count').data![0]).toBe(2);
+      ctx.destroy();
+    });
+  });
+});
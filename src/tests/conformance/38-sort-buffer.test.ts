@@ -0,0 +1,73 @@
+import { describe, it, expect } from 'vitest';
+import { cpuBackends, fixedBuffer, opGraph } from './test-runner';
+import { CppGenerator } from '../../metal/cpp-generator';
+
+// cmd_sort_buffer: buffer-sort.h in the C++ runtime.
+const backends = cpuBackends;
+
+const inputs = [{ id: 'u_count', type: 'int', default: 3 }];
+
+describe('Conformance: Sort Buffer', () => {
+  it('C++ generator batches sorts with element and key strides', () => {
+    const ir = opGraph('Sort Emit', inputs, [
+      fixedBuffer('b_particles', 'float4', 8),
+      fixedBuffer('b_depth', 'float', 8),
+      fixedBuffer('b_sorted', 'float4', 8)
+    ], [
+      { id: 'by_z', op: 'cmd_sort_buffer', src: 'b_particles', dst: 'b_sorted', key_component: 2, descending: true },
+      { id: 'by_depth', op: 'cmd_sort_buffer', src: 'b_particles', dst: 'b_particles', keys: 'b_depth', count: 'u_count' }
+    ]);
+    const { code } = new CppGenerator().compile(ir, 'main');
+    expect(code).toContain('ctx.sortBuffer(0, 2, 4, 2, -1, 1, true, static_cast<int>(-1));');
+    expect(code).toMatch(/ctx\.sortBuffer\(0, 0, 4, 0, 1, 1, false, static_cast<int>\(.*u_count.*\)\);/);
+    expect(code).toContain('ctx.beginBatch();');
+  });
+
+  if (backends.length === 0) {
+    it.skip('Skipping sort buffer tests (no compatible backend)', () => { });
+    return;
+  }
+
+  // Back-to-front by z: particles move whole, ties keep their order.
+  const irByComponent = opGraph('Sort By Component', inputs, [
+    fixedBuffer('b_particles', 'float4', 4),
+    fixedBuffer('b_sorted', 'float4', 4)
+  ], [
+    { id: 'sort', op: 'cmd_sort_buffer', src: 'b_particles', dst: 'b_sorted', key_component: 2, descending: true }
+  ]);
+
+  backends.forEach(backend => {
+    it(`Sort by element component, descending [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irByComponent);
+      ctx.getResource('b_particles').data = [[1, 0, 5, 1], [2, 0, -3, 1], [3, 0, 5, 1], [4, 0, 9, 1]];
+      ctx.getResource('b_sorted').data = [[0, 0, 0, 0], [0, 0, 0, 0], [0, 0, 0, 0], [0, 0, 0, 0]];
+
+      await backend.run(ctx, 'main');
+
+      expect(ctx.getResource('b_sorted').data).toEqual([[4, 0, 9, 1], [1, 0, 5, 1], [3, 0, 5, 1], [2, 0, -3, 1]]);
+      ctx.destroy();
+    });
+  });
+
+  // Separate keys, in place: the keys come back sorted with the elements.
+  const irByKeys = opGraph('Sort By Keys', inputs, [
+    fixedBuffer('b_values', 'float', 5),
+    fixedBuffer('b_keys', 'float', 5)
+  ], [
+    { id: 'sort', op: 'cmd_sort_buffer', src: 'b_values', dst: 'b_values', keys: 'b_keys' }
+  ]);
+
+  backends.forEach(backend => {
+    it(`Sort by a keys buffer, in place [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irByKeys);
+      ctx.getResource('b_values').data = [10, 20, 30, 40, 50];
+      ctx.getResource('b_keys').data = [0.5, -2, 7, 0.25, -2];
+
+      await backend.run(ctx, 'main');
+
+      expect(ctx.getResource('b_values').data).toEqual([20, 50, 40, 10, 30]);
+      expect(ctx.getResource('b_keys').data).toEqual([-2, -2, 0.25, 0.5, 7]);
+      ctx.destroy();
+    });
+  });
+});
@@ -0,0 +1,86 @@
+import { describe, it, expect } from 'vitest';
+import { cpuBackends, fixedBuffer, fixedTexture, opGraph } from './test-runner';
+import { CppGenerator } from '../../metal/cpp-generator';
+
+// cmd_reduce_buffer: buffer-reduce.h in the C++ runtime.
+const backends = cpuBackends;
+
+const inputs = [{ id: 'u_max', type: 'float', default: 4 }];
+
+describe('Conformance: Reduce Buffer', () => {
+  it('C++ generator batches reductions with element strides and modes', () => {
+    const ir = opGraph('Reduce Emit', inputs, [
+      fixedTexture('t_frame', 4, 4),
+      fixedBuffer('b_bounds', 'float4', 1),
+      fixedBuffer('b_hist', 'float', 8),
+      fixedBuffer('cnt', 'int', 1, 'atomic_counter')
+    ], [
+      { id: 'max', op: 'cmd_reduce_buffer', src: 't_frame', dst: 'b_bounds', mode: 'max' },
+      { id: 'hist', op: 'cmd_reduce_buffer', src: 't_frame', dst: 'b_hist', mode: 'histogram', component: 1, range_max: 'u_max' },
+      { id: 'arg', op: 'cmd_reduce_buffer', src: 'b_hist', dst: 'cnt', mode: 'argmax' }
+    ]);
+    const { code } = new CppGenerator().compile(ir, 'main');
+    expect(code).toContain('ctx.reduceBuffer(0, 1, 4, 2, -1, static_cast<int>(-1), -1, 0.0f, 1.0f, false);');
+    expect(code).toMatch(/ctx\.reduceBuffer\(0, 2, 4, 6, 1, static_cast<int>\(-1\), -1, 0\.0f, .*u_max.*, false\);/);
+    expect(code).toContain('ctx.reduceBuffer(2, 3, 1, 5, -1, static_cast<int>(-1), -1, 0.0f, 1.0f, true);');
+    expect(code).toContain('ctx.beginBatch();');
+  });
+
+  if (backends.length === 0) {
+    it.skip('Skipping reduce buffer tests (no compatible backend)', () => { });
+    return;
+  }
+
+  const irStats = opGraph('Reduce Stats', inputs, [
+    fixedBuffer('b_src', 'float2', 4),
+    fixedBuffer('b_sum', 'float2', 1),
+    fixedBuffer('b_mean', 'float', 1),
+    fixedBuffer('b_min', 'float', 1),
+    fixedBuffer('b_arg', 'float', 1)
+  ], [
+    { id: 'sum', op: 'cmd_reduce_buffer', src: 'b_src', dst: 'b_sum' },
+    { id: 'mean', op: 'cmd_reduce_buffer', src: 'b_src', dst: 'b_mean', mode: 'mean', component: 1 },
+    { id: 'min', op: 'cmd_reduce_buffer', src: 'b_src', dst: 'b_min', mode: 'min', component: 0 },
+    { id: 'arg', op: 'cmd_reduce_buffer', src: 'b_src', dst: 'b_arg', mode: 'argmax', component: 1 }
+  ]);
+
+  backends.forEach(backend => {
+    it(`Sum, mean, min and argmax of a vector buffer [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irStats);
+      ctx.getResource('b_src').data = [[1, 10], [-2, 30], [5, 30], [4, 10]];
+
+      await backend.run(ctx, 'main');
+
+      expect(ctx.getResource('b_sum').data).toEqual([[8, 80]]);
+      expect(ctx.getResource('b_mean').data![0]).toBe(20);
+      expect(ctx.getResource('b_min').data![0]).toBe(-2);
+      // Ties resolve to the first index
+      expect(ctx.getResource('b_arg').data![0]).toBe(1);
+      ctx.destroy();
+    });
+  });
+
+  // Luminance-style histogram of one channel; out-of-range values land in
+  // the end bins.
+  const irHistogram = opGraph('Reduce Histogram', inputs, [
+    fixedTexture('t_src', 3, 2),
+    fixedBuffer('b_hist', 'float', 4)
+  ], [
+    { id: 'hist', op: 'cmd_reduce_buffer', src: 't_src', dst: 'b_hist', mode: 'histogram', component: 2 }
+  ]);
+
+  backends.forEach(backend => {
+    it(`Histogram of a texture channel [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irHistogram);
+      const src = ctx.getResource('t_src');
+      src.width = 3; src.height = 2;
+      src.data = [0.1, 0.3, 0.35, 0.9, -1, 2].map(b => [0, 0, b, 1]);
+      ctx.getResource('b_hist').data = [0, 0, 0, 0];
+
+      await backend.run(ctx, 'main');
+
+      expect(ctx.getResource('b_hist').data).toEqual([2, 2, 0, 2]);
+      ctx.destroy();
+    });
+  });
+});
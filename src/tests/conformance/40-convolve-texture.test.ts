@@ -0,0 +1,90 @@
+import { describe, it, expect } from 'vitest';
+import { cpuBackends, fixedTexture, opGraph } from './test-runner';
+import { IRDocument } from '../../ir/types';
+import { CppGenerator } from '../../metal/cpp-generator';
+
+// cmd_convolve_texture: texture-fft.h in the C++ runtime.
+const backends = cpuBackends;
+
+const convolveGraph = (name: string, width: number, height: number, kernel: [number, number], node: any): IRDocument => opGraph(
+  name,
+  [{ id: 'u_radius', type: 'float', default: 1 }],
+  [fixedTexture('t_src', width, height), fixedTexture('t_dst', width, height), fixedTexture('t_kernel', kernel[0], kernel[1])],
+  [{ id: 'convolve', op: 'cmd_convolve_texture', src: 't_src', dst: 't_dst', ...node }]
+);
+
+describe('Conformance: Convolve Texture', () => {
+  it('C++ generator batches cmd_convolve_texture with a Gaussian radius or a kernel texture', () => {
+    const gaussian = convolveGraph('Convolve Emit', 4, 4, [1, 1], { radius: 'u_radius' });
+    const { code } = new CppGenerator().compile(gaussian, 'main');
+    expect(code).toMatch(/ctx\.convolveTexture\(0, 1, -1, .*u_radius.*, 0\.0f, true\);/);
+    expect(code).toContain('ctx.beginBatch();');
+
+    const kernel = convolveGraph('Convolve Kernel Emit', 4, 4, [3, 3], { kernel: 't_kernel', normalize: false });
+    expect(new CppGenerator().compile(kernel, 'main').code)
+      .toContain('ctx.convolveTexture(0, 1, 2, 0.0f, 0.0f, false);');
+  });
+
+  if (backends.length === 0) {
+    it.skip('Skipping convolve texture tests (no compatible backend)', () => { });
+    return;
+  }
+
+  // A raw 3x1 kernel over an impulse: a true convolution, so the taps come
+  // out mirrored about the impulse.
+  const irKernel = convolveGraph('Kernel Convolve', 5, 1, [3, 1], { kernel: 't_kernel', normalize: false });
+
+  backends.forEach(backend => {
+    it(`Kernel texture convolves an impulse [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irKernel);
+      const src = ctx.getResource('t_src');
+      src.width = 5; src.height = 1;
+      src.data = [[0, 0, 0, 0], [0, 0, 0, 0], [1, 2, 3, 4], [0, 0, 0, 0], [0, 0, 0, 0]];
+      const dst = ctx.getResource('t_dst');
+      dst.width = 5; dst.height = 1;
+      dst.data = src.data.map(() => [0, 0, 0, 0]);
+      const kernel = ctx.getResource('t_kernel');
+      kernel.width = 3; kernel.height = 1;
+      kernel.data = [[1, 0, 0, 0], [2, 0, 0, 0], [3, 0, 0, 0]];
+
+      await backend.run(ctx, 'main');
+
+      const result = ctx.getResource('t_dst').data as number[][];
+      const taps = [0, 1, 2, 3, 0];
+      result.forEach((px, x) => {
+        for (let c = 0; c < 4; c++) expect(px[c]).toBeCloseTo(taps[x] * (c + 1), 4);
+      });
+      ctx.destroy();
+    });
+  });
+
+  // A normalized Gaussian preserves a constant image, and is symmetric
+  // about an impulse.
+  const irGaussian = convolveGraph('Gaussian Convolve', 9, 9, [1, 1], { radius: 4 });
+
+  backends.forEach(backend => {
+    it(`Gaussian convolution is normalized and symmetric [${backend.name}]`, async () => {
+      const ctx = await backend.createContext(irGaussian);
+      const src = ctx.getResource('t_src');
+      src.width = 9; src.height = 9;
+      src.data = Array.from({ length: 81 }, (_, i) => [0.5, 0.5, 0.5, i === 40 ? 1 : 0]);
+      const dst = ctx.getResource('t_dst');
+      dst.width = 9; dst.height = 9;
+      dst.data = Array.from({ length: 81 }, () => [0, 0, 0, 0]);
+
+      await backend.run(ctx, 'main');
+
+      const result = ctx.getResource('t_dst').data as number[][];
+      let alphaSum = 0;
+      for (const px of result) {
+        expect(px[0]).toBeCloseTo(0.5, 5);
+        alphaSum += px[3];
+      }
+      expect(alphaSum).toBeCloseTo(1, 4);
+      expect(result[40][3]).toBeGreaterThan(result[39][3]);
+      expect(result[39][3]).toBeCloseTo(result[41][3], 6);
+      expect(result[31][3]).toBeCloseTo(result[49][3], 6);
+      ctx.destroy();
+    });
+  });
+});
@@ -50,9 +50,12 @@ export const CppMetalBackend: TestBackend = {
     const ir = ctx.ir;
     const buildDir = getCppMetalBuildDir();
 
-    // 1. Generate C++ code for CPU functions
+    // 1. Generate C++ code for CPU functions (CPP_PROFILE=1 instruments every
+    // IR node and prints the per-node report)
+    const profile = process.env.CPP_PROFILE === '1';
     const generator = new CppGenerator();
-    const { code, resourceIds, shaderFunctions } = generator.compile(ir, entryPoint);
+    const { code, resourceIds, shaderFunctions, diagnostics } = generator.compile(ir, entryPoint, { profile });
+    diagnostics.forEach(d => console.warn(`[CppGenerator]: ${d}`));
 
     // 2. Write generated C++ code
     const generatedCodePath = path.join(buildDir, 'generated_code.cpp');
@@ -214,7 +217,12 @@ export const CppMetalBackend: TestBackend = {
 
     // Construct args array for spawnSync to avoid shell parsing issues if possible, but here we used large string
     // Let's stick to shell execution but use spawnSync to get stderr
-    const cmdStr = `"${executablePath}" ${metallibArg}${inputArgsStr}${dataFileArg}${resourceSpecs.join(' ')}`;
+    const foldedPath = path.join(buildDir, 'profile.folded');
+    const profileArg = profile ? `-p "${foldedPath}" ` : '';
+    // CPP_COUNTERS=1 samples hardware counters around CPU dispatches and copies
+    const counters = process.env.CPP_COUNTERS === '1';
+    const countersArg = counters ? '-c ' : '';
+    const cmdStr = `"${executablePath}" ${metallibArg}${inputArgsStr}${dataFileArg}${profileArg}${countersArg}${resourceSpecs.join(' ')}`;
 
     const res = spawnSync(cmdStr, {
       shell: true,
@@ -238,6 +246,27 @@ export const CppMetalBackend: TestBackend = {
 
     // 9. Parse JSON output
     const result = JSON.parse(output.trim());
+    if (profile && result.profile) {
+      console.log('--- Per-node profile ---');
+      console.table(result.profile);
+      console.log(`Folded stacks: ${foldedPath}`);
+    }
+    if (process.env.CPP_TIMINGS === '1' && result.timings) {
+      const { dispatches, ...phases } = result.timings;
+      console.log('--- Harness timings (ms) ---');
+      console.table([phases]);
+      if (dispatches.length > 0) {
+        console.table(dispatches);
+      }
+    }
+    if (counters && result.perfCounters) {
+      console.log('--- Hardware counters ---');
+      if (result.perfCounters.available) {
+        console.table(result.perfCounters.functions);
+      } else {
+        console.log(`Unavailable: ${result.perfCounters.reason}`);
+      }
+    }
 
     // 10. Update EvaluationContext with results
     result.resources.forEach((res: { type?: string; width?: number; height?: number; data: number[] }, i: number) => {
@@ -286,10 +315,11 @@ export const CppMetalBackend: TestBackend = {
       }
     }
 
-    // 12. Populate action log from harness output
+    // 12. Populate action log from harness output (records carry the
+    // resource index; -1 = none)
     if (result.log) {
       for (const entry of result.log) {
-        ctx.logAction(entry.type, entry.target || '', {
+        ctx.logAction(entry.type, resourceIds[entry.resource] || '', {
           width: entry.width,
           height: entry.height,
         });
@@ -83,6 +83,38 @@ export const buildSimpleIR = (name: string, nodes: any[], resources: any[] = [],
   };
 };
 
+// Fixtures for the native resource ops (cmd_blur_texture, cmd_scan_buffer,
+// ...). These run natively in the C++ runtime and on the CPU copies of
+// resources in the JIT executor, so their tests use cpuBackends.
+const cpuAccessible = () => ({ retain: false, clearEveryFrame: false, clearOnResize: false, cpuAccess: true });
+
+export const fixedBuffer = (id: string, dataType: string, size: number, type = 'buffer'): any => ({
+  id,
+  type,
+  dataType,
+  size: { mode: 'fixed', value: size },
+  persistence: cpuAccessible()
+});
+
+export const fixedTexture = (id: string, width: number, height: number): any => ({
+  id,
+  type: 'texture2d',
+  format: 'rgba32f',
+  size: { mode: 'fixed', value: [width, height] },
+  persistence: cpuAccessible()
+});
+
+// A graph whose cpu entry point `main` runs `nodes`.
+export const opGraph = (name: string, inputs: any[], resources: any[], nodes: any[]): IRDocument => ({
+  version: '1.0.0',
+  meta: { name },
+  entryPoint: 'main',
+  inputs,
+  resources,
+  structs: [],
+  functions: [{ id: 'main', type: 'cpu', inputs: [], outputs: [], localVars: [], nodes }]
+});
+
 export const runGraphTest = (
   name: string,
   nodes: any[],
@@ -0,0 +1,269 @@
+import { describe, it, expect, beforeAll } from 'vitest';
+import { execSync } from 'child_process';
+import * as path from 'path';
+import { compileCppHost, getMetalBuildDir } from '../metal/metal-compile';
+
+// Native tests for the backend-neutral runtime in intrinsics.incl.h
+// (CPU kernels, frame graph). Built as plain C++ without Metal.
+describe('CPU Runtime', () => {
+  let runnerPath: string;
+
+  const runCase = (name: string) => {
+    const output = execSync(`"${runnerPath}" ${name}`, {
+      encoding: 'utf-8',
+      stdio: ['pipe', 'pipe', 'pipe'],
+    });
+    return JSON.parse(output.trim());
+  };
+
+  beforeAll(() => {
+    const metalDir = path.resolve(__dirname, '../metal');
+    runnerPath = path.join(getMetalBuildDir(), 'cpu-runtime-runner');
+    compileCppHost({
+      sourcePaths: [path.join(metalDir, 'cpu-runtime-runner.cpp')],
+      outputPath: runnerPath,
+      objc: false,
+      extraFlags: ['-pthread'],
+    });
+  });
+
+  it('should run independent passes in one level and cache the schedule', () => {
+    const result = runCase('frame_graph');
+    expect(result.levels).toBe(2);
+    expect(result.cacheMisses).toBe(1);
+    expect(result.cacheHits).toBe(2);
+    expect(result.evicted).toBe(true);
+    expect(result.correct).toBe(true);
+    expect(result.head).toEqual([1, 4, 7, 10]);
+  });
+
+  it('should order dependent copies after the dispatch that produces them', () => {
+    const result = runCase('hazards');
+    expect(result.levels).toBe(3);
+    expect(result.result).toEqual([7, 7, 7, 7]);
+  });
+
+  it('should visit every cell of the dispatch grid exactly once', () => {
+    const result = runCase('tiles');
+    expect(result.correct).toBe(true);
+  });
+
+  it('should alias transient resources with disjoint lifetimes', () => {
+    const result = runCase('transient');
+    expect(result.correct).toBe(true);
+    expect(result.released).toBe(true);
+    expect(result.slots).toBe(2);
+    expect(result.pooledFloats).toBeLessThan(result.unaliasedFloats);
+  });
+
+  it('should wait only for the writer of the resource being read', () => {
+    const result = runCase('per_resource');
+    expect(result.a).toBe(10);
+    expect(result.aAgain).toBe(10);
+    expect(result.bBefore).toBe(0);
+    expect(result.pendingAfterRead).toBe(1);
+    expect(result.bAfter).toBe(15);
+    expect(result.waits).toBe(1);
+    expect(result.stale).toBe(0);
+  });
+
+  it('should transfer only dirty ranges between host and device', () => {
+    const result = runCase('residency');
+    expect(result.initial).toBe(4096);
+    expect(result.partialUpload).toBe(12);
+    expect(result.download).toBe(400);
+    expect(result.repeatDownload).toBe(0);
+    expect(result.resized).toBe(8192);
+    expect(result.allocations).toBe(2);
+    expect(result.correct).toBe(true);
+  });
+
+  it('should overlap host logic with the previous frame when pipelined', () => {
+    const pipelined = runCase('pipelined');
+    expect(pipelined.correct).toBe(true);
+    expect(pipelined.framesSubmitted).toBe(6);
+    expect(pipelined.overlapped).toBeGreaterThanOrEqual(5);
+    expect(pipelined.maxInFlight).toBeLessThanOrEqual(2);
+
+    const sequential = runCase('sequential');
+    expect(sequential.correct).toBe(true);
+    expect(sequential.overlapped).toBe(0);
+  });
+
+  it('should recycle argument arena blocks once their commands complete', () => {
+    const result = runCase('arg_arena');
+    expect(result.aligned).toBe(true);
+    expect(result.createdWhilePending).toBe(2);
+    expect(result.createdAfterRetire).toBe(2);
+    expect(result.correct).toBe(true);
+    expect(result.contextBlocks).toBe(1);
+  });
+
+  it('should compile no render pipelines in steady-state frames', () => {
+    const result = runCase('pipeline_cache');
+    expect(result.correct).toBe(true);
+    expect(result.firstFrame).toBe(4);
+    expect(result.steadyState).toBe(0);
+    expect(result.hits).toBe(16);
+    expect(result.cached).toBe(4);
+    expect(result.failedRetried).toBe(true);
+  });
+
+  it('should return from CPU commands at once on the async queue', () => {
+    const result = runCase('async_queue');
+    expect(result.returnedEarly).toBe(true);
+    expect(result.overlapped).toBe(true);
+    expect(result.correct).toBe(true);
+    expect(result.submitted).toBe(5);
+  });
+
+  it('should stop or cancel CPU dispatches against the frame budget', () => {
+    const result = runCase('budget');
+    expect(result.fullRows).toBe(64);
+    expect(result.limitedRows).toBeGreaterThan(0);
+    expect(result.limitedRows).toBeLessThan(64);
+    expect(result.limitedComplete).toBe(false);
+    expect(result.cancelled).toBe(true);
+    expect(result.cancelledRows).toBeLessThan(64);
+    expect(result.completedRows).toBe(64);
+    expect(result.missed).toBe(1);
+    expect(result.transientSkipped).toBe(0);
+    expect(result.transientMissed).toBe(1);
+    expect(result.consistent).toBe(true);
+  });
+
+  it('should aggregate per-node profile counters and folded stacks', () => {
+    const result = runCase('node_profiler');
+    expect(result.disabledIdle).toBe(true);
+    expect(result.balanced).toBe(true);
+    expect(result.counts).toBe(true);
+    expect(result.nested).toBe(true);
+    expect(result.foldedPath).toBe(true);
+    expect(result.reportHasNode).toBe(true);
+  });
+
+  it('should record a Chrome trace of commands into a bounded ring', () => {
+    const result = runCase('trace');
+    expect(result.recorded).toBe(true);
+    expect(result.details).toBe(true);
+    expect(result.threads).toBe(true);
+    expect(result.chromeJson).toBe(true);
+    expect(result.ring).toBe(true);
+    expect(result.correct).toBe(true);
+    expect(result.nsPerSpan).toBeLessThan(2000);
+  });
+
+  it('should account resource bytes and count steady-state allocations', () => {
+    const result = runCase('memory');
+    expect(result.grownReallocs).toBe(1);
+    expect(result.shrunkReallocs).toBe(1);
+    expect(result.grownBytes).toBeGreaterThanOrEqual(5 * 1024 * 4);
+    expect(result.grownPeak).toBe(result.grownBytes);
+    expect(result.releasedBytes).toBeLessThan(result.grownBytes);
+    expect(result.releasedPeak).toBe(result.grownPeak);
+    expect(result.storeVecCounted).toBe(true);
+    expect(result.counterInstalled).toBe(true);
+    expect(result.probeAllocations).toBeGreaterThanOrEqual(1);
+    expect(result.steadyAllocations).toBe(0);
+    expect(result.batchedAllocations).toBe(0);
+  });
+
+  it('should log resizes into a bounded ring with an optional drain', () => {
+    const result = runCase('action_log');
+    expect(result.recorded).toBe(true);
+    expect(result.flushed).toBe(true);
+    expect(result.overwrote).toBe(true);
+    expect(result.allocations).toBe(0);
+    expect(result.drainedBeforeFlush).toBe(2 * result.capacity);
+    expect(result.drained).toBe(2 * result.capacity + 5);
+    expect(result.inOrder).toBe(true);
+    expect(result.dropped).toBe(0);
+  });
+
+  it('should sample hardware counters per function or explain why not', () => {
+    const result = runCase('perf_counters');
+    expect(result.explained).toBe(true);
+    expect(result.recorded).toBe(true);
+    expect(result.traced).toBe(true);
+    expect(result.report).toBe(true);
+    expect(result.correct).toBe(true);
+  });
+
+  it('should apply the last autotune cache entry for this graph and machine', () => {
+    const result = runCase('tuning_cache');
+    expect(result.loaded).toBe(true);
+    expect(result.entries).toBe(4);
+    expect(result.frameMs).toBeCloseTo(2.0);
+    expect(result.applied).toBe(2);
+    expect(result.samples).toBe(12);
+    expect(result.tile).toBe(32);
+    expect(result.gain0).toBeCloseTo(0.5);
+    expect(result.unknownGraph).toBe(0);
+    expect(result.noPath).toBe(0);
+    expect(result.missingFile).toBe(0);
+    expect(result.keySafe).toBe(true);
+  });
+
+  it('should blur textures with separable Gaussian and box filters', () => {
+    const result = runCase('blur');
+    expect(result.gaussianErr).toBeLessThan(1e-5);
+    expect(result.boxErr).toBeLessThan(1e-5);
+    expect(result.wideErr).toBeLessThan(0.02);
+    expect(result.inPlaceErr).toBe(0);
+    expect(result.rejected).toBe(true);
+    expect(result.gaussianMs).toBeGreaterThan(0);
+    expect(result.steadyAllocations).toBe(0);
+  });
+
+  it('should scan and compact buffers in parallel blocks', () => {
+    const result = runCase('scan');
+    expect(result.exclusiveErr).toBe(0);
+    expect(result.inclusiveErr).toBe(0);
+    expect(result.totalOk).toBe(true);
+    expect(result.vec4Err).toBe(0);
+    expect(result.vec4TotalOk).toBe(true);
+    expect(result.inPlaceOk).toBe(true);
+    expect(result.countOk).toBe(true);
+    expect(result.compactOk).toBe(true);
+    expect(result.inPlaceCompactOk).toBe(true);
+    expect(result.clampedOk).toBe(true);
+    expect(result.scanMs).toBeGreaterThan(0);
+    expect(result.steadyAllocations).toBe(0);
+  });
+
+  it('should radix sort buffers by key with payloads', () => {
+    const result = runCase('sort');
+    expect(result.scalarOk).toBe(true);
+    expect(result.payloadOk).toBe(true);
+    expect(result.descendingOk).toBe(true);
+    expect(result.keysBufferOk).toBe(true);
+    expect(result.inPlaceOk).toBe(true);
+    expect(result.countOk).toBe(true);
+    expect(result.sortMs).toBeGreaterThan(0);
+    expect(result.steadyAllocations).toBe(0);
+  });
+
+  it('should reduce buffers deterministically across pool sizes', () => {
+    const result = runCase('reduce');
+    expect(result.scalarOk).toBe(true);
+    expect(result.deterministic).toBe(true);
+    expect(result.vectorOk).toBe(true);
+    expect(result.argOk).toBe(true);
+    expect(result.histogramOk).toBe(true);
+    expect(result.countOk).toBe(true);
+    expect(result.sumMs).toBeGreaterThan(0);
+    expect(result.steadyAllocations).toBe(0);
+  });
+
+  it('should convolve textures through FFTs with cached kernel spectra', () => {
+    const result = runCase('convolve');
+    expect(result.gaussianErr).toBeLessThan(1e-5);
+    expect(result.kernelErr).toBeLessThan(1e-4);
+    expect(result.normalizedErr).toBeLessThan(1e-5);
+    expect(result.inPlaceErr).toBe(0);
+    expect(result.spectrumMisses).toBe(9);
+    expect(result.spectrumHits).toBe(6);
+    expect(result.radius256Ms).toBeGreaterThan(0);
+    expect(result.steadyAllocations).toBe(0);
+  });
+});
@@ -0,0 +1,48 @@
+import { describe, it, expect, beforeAll } from 'vitest';
+import { execSync } from 'child_process';
+import * as path from 'path';
+import { compileCppHost, getMetalBuildDir } from '../metal/metal-compile';
+
+// Drives the FFGL plugin's per-frame lifecycle on the CPU backend
+// (src/metal/host-simulator.cpp) and checks that the evaluation context and
+// its bindings survive across frames.
+describe('Host Simulator', () => {
+  let simulatorPath: string;
+
+  const run = (mode: string, frames: number) => {
+    const output = execSync(`"${simulatorPath}" ${mode} ${frames}`, {
+      encoding: 'utf-8',
+      stdio: ['pipe', 'pipe', 'pipe'],
+    });
+    return JSON.parse(output.trim());
+  };
+
+  beforeAll(() => {
+    const metalDir = path.resolve(__dirname, '../metal');
+    simulatorPath = path.join(getMetalBuildDir(), 'host-simulator');
+    compileCppHost({
+      sourcePaths: [path.join(metalDir, 'host-simulator.cpp')],
+      outputPath: simulatorPath,
+      objc: false,
+      extraFlags: ['-pthread'],
+    });
+  });
+
+  it('should keep one context and patch bindings only on change', () => {
+    const result = run('persistent', 90);
+    expect(result.frames).toBe(90);
+    expect(result.contextsCreated).toBe(1);
+    // First frame and the input-count change
+    expect(result.rebinds).toBe(2);
+    // Output and first input recreated at the new viewport size
+    expect(result.patches).toBe(2);
+  });
+
+  it('should render the same frames as rebuilding the context every frame', () => {
+    const persistent = run('persistent', 90);
+    const fresh = run('fresh', 90);
+    expect(fresh.contextsCreated).toBe(90);
+    expect(fresh.rebinds).toBe(90);
+    expect(persistent.checksum).toBe(fresh.checksum);
+  });
+});
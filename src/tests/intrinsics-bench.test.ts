@@ -0,0 +1,75 @@
+import { describe, it, expect, beforeAll } from 'vitest';
+import { spawnSync } from 'child_process';
+import * as fs from 'fs';
+import * as path from 'path';
+import { compileCppHost, getMetalBuildDir } from '../metal/metal-compile';
+
+// Builds the intrinsics micro-benchmarks (src/metal/intrinsics-bench.cpp) and
+// checks their report and baseline comparison. Timings themselves are
+// machine-specific and are not asserted.
+describe('Intrinsics Benchmarks', () => {
+  let benchPath: string;
+  let baselinePath: string;
+
+  const run = (...args: string[]) => {
+    const proc = spawnSync(benchPath, ['--quick', ...args], { encoding: 'utf-8' });
+    return { status: proc.status, report: JSON.parse(proc.stdout.trim()) };
+  };
+
+  // The quick report with every nsPerOp replaced by `ns`.
+  const writeBaseline = (report: any, ns: number) => {
+    const results = report.results.map((r: any) => ({ name: r.name, nsPerOp: ns }));
+    fs.writeFileSync(baselinePath, JSON.stringify({ results, regressions: [] }));
+  };
+
+  beforeAll(() => {
+    const metalDir = path.resolve(__dirname, '../metal');
+    benchPath = path.join(getMetalBuildDir(), 'intrinsics-bench');
+    baselinePath = path.join(getMetalBuildDir(), 'intrinsics-bench-baseline.json');
+    compileCppHost({
+      sourcePaths: [path.join(metalDir, 'intrinsics-bench.cpp')],
+      outputPath: benchPath,
+      objc: false,
+      extraFlags: ['-pthread'],
+    });
+  });
+
+  it('should report ns/op for every intrinsic group and GB/s for memory ops', () => {
+    const { status, report } = run();
+    expect(status).toBe(0);
+    const byName = new Map<string, any>(report.results.map((r: any) => [r.name, r]));
+    for (const name of [
+      'elem::sin/float4', 'operator+/float4', 'mat_mul/4x4*4x4', 'mat_mul/3x3*vec3',
+      'quat_slerp', '_prng_hash', 'copyTexture/bilinear', 'resizeResource2DWithClear',
+      'copyBuffer/stride1',
+    ]) {
+      expect(byName.get(name)?.nsPerOp).toBeGreaterThan(0);
+    }
+    for (const wrap of ['repeat', 'clamp', 'mirror']) {
+      for (const filter of ['nearest', 'linear']) {
+        for (const stride of [1, 4]) {
+          const r = byName.get(`sampleTexture/${wrap}/${filter}/stride${stride}`);
+          expect(r?.gbPerSec).toBeGreaterThan(0);
+        }
+      }
+    }
+    expect(byName.get('elem::sin/float4').gbPerSec).toBeUndefined();
+    expect(report.regressions).toEqual([]);
+  });
+
+  it('should pass against a slower baseline and fail against a faster one', () => {
+    const { report } = run('--filter', 'quat_');
+    expect(report.results.length).toBe(4);
+
+    writeBaseline(report, 1e9);
+    const slower = run('--filter', 'quat_', '--baseline', baselinePath);
+    expect(slower.status).toBe(0);
+    expect(slower.report.regressions).toEqual([]);
+
+    writeBaseline(report, 1e-3);
+    const faster = run('--filter', 'quat_', '--baseline', baselinePath);
+    expect(faster.status).toBe(2);
+    expect(faster.report.regressions.map((r: any) => r.name).sort()).toEqual(
+      ['quat_mul', 'quat_rotate', 'quat_slerp', 'quat_to_float4x4']);
+  });
+});
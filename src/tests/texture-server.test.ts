@@ -6,7 +6,7 @@
  */
 
 import { describe, it, expect, beforeAll, afterAll } from 'vitest';
-import { startTextureServer, TextureServerProcess } from '../metal/texture-server-compile';
+import { runTextureServerLoad, startTextureServer, TextureServerProcess } from '../metal/texture-server-compile';
 
 // ---------------------------------------------------------------------------
 // Helper: request/response WebSocket client with id-correlation
@@ -350,4 +350,58 @@ describe('Texture Server WebSocket API', () => {
     expect(readBack[2]).toBe(50);
     expect(readBack[3]).toBe(255);
   });
+
+  it('get_stats reports per-method latencies, bytes and channel rates', async () => {
+    const rgba = makeRGBA(8, 8, [1, 2, 3, 255]);
+    for (let i = 0; i < 3; i++) {
+      await client.request('debug_push_texture', {
+        channel: 'test-stats',
+        width: 8,
+        height: 8,
+        data: rgba.toString('base64'),
+      });
+    }
+    await client.request('debug_read_texture', { channel: 'test-stats' });
+    await expect(client.request('nonexistent_stats_method')).rejects.toBeDefined();
+
+    const stats = await client.request('get_stats');
+    expect(stats.uptimeSeconds).toBeGreaterThan(0);
+    expect(stats.bytesIn).toBeGreaterThan(0);
+    expect(stats.bytesOut).toBeGreaterThan(0);
+    expect(stats.registry.channels).toBeGreaterThanOrEqual(1);
+    expect(stats.registry.bytes).toBeGreaterThanOrEqual(8 * 8 * 4);
+
+    const push = stats.methods['debug_push_texture'];
+    expect(push.calls).toBeGreaterThanOrEqual(3);
+    for (const phase of ['parse', 'handler', 'encode', 'send']) {
+      expect(push[phase].count).toBeGreaterThan(0);
+      expect(push[phase].p50Us).toBeLessThanOrEqual(push[phase].p99Us);
+      expect(push[phase].p99Us).toBeLessThanOrEqual(push[phase].maxUs);
+    }
+    // Unknown methods share one entry
+    expect(stats.methods['<unknown>'].errors).toBeGreaterThanOrEqual(1);
+    expect(stats.methods['nonexistent_stats_method']).toBeUndefined();
+
+    const channel = stats.channels['test-stats'];
+    expect(channel.pushes).toBe(3);
+    expect(channel.reads).toBe(1);
+    expect(channel.bytesPushed).toBe(3 * 8 * 8 * 4);
+    expect(channel.bytesRead).toBe(8 * 8 * 4);
+  });
+
+  it('load generator drives producers and readers', () => {
+    const report = runTextureServerLoad(server.port, {
+      producers: 2,
+      readers: 2,
+      width: 64,
+      height: 64,
+      seconds: 1,
+    });
+    expect(report.push.frames).toBeGreaterThan(0);
+    expect(report.read.frames).toBeGreaterThan(0);
+    expect(report.push.errors).toBe(0);
+    expect(report.read.errors).toBe(0);
+    expect(report.read.latencyMs.p50).toBeLessThanOrEqual(report.read.latencyMs.max);
+    expect(report.serverStats.channels['load-0'].pushes).toBeGreaterThan(0);
+  }, 60000);
 });
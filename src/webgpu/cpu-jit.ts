@@ -551,6 +551,50 @@ require('./intrinsics.js');
       const normalized = node['normalized'] === true ? 'true' : 'false';
       lines.push(`${indent}ctx.globals.copyTexture('${srcId}', '${dstId}', ${srcRect}, ${dstRect}, ${sample}, ${alpha}, ${normalized});`);
     }
+    else if (node.op === 'cmd_blur_texture') {
+      const srcId = node['src'];
+      const dstId = node['dst'];
+      const radius = this.resolveArg(node, 'radius', func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges);
+      const hasSigma = node['sigma'] !== undefined || edges.some(e => e.to === node.id && e.portIn === 'sigma' && e.type === 'data');
+      const sigma = hasSigma ? this.resolveArg(node, 'sigma', func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges) : '0';
+      const mode = JSON.stringify(node['mode'] ?? 'gaussian');
+      lines.push(`${indent}await ctx.globals.blurTexture('${srcId}', '${dstId}', ${radius}, ${sigma}, ${mode});`);
+    }
+    else if (node.op === 'cmd_scan_buffer') {
+      const hasCount = node['count'] !== undefined || edges.some(e => e.to === node.id && e.portIn === 'count' && e.type === 'data');
+      const count = hasCount ? this.resolveArg(node, 'count', func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges) : 'Infinity';
+      const inclusive = node['inclusive'] === true ? 'true' : 'false';
+      const total = node['total'] !== undefined ? `'${node['total']}'` : 'null';
+      lines.push(`${indent}await ctx.globals.scanBuffer('${node['src']}', '${node['dst']}', ${inclusive}, ${count}, ${total});`);
+    }
+    else if (node.op === 'cmd_compact_buffer') {
+      const flags = node['flags'] !== undefined ? `'${node['flags']}'` : 'null';
+      const counter = node['counter'] !== undefined ? `'${node['counter']}'` : 'null';
+      lines.push(`${indent}await ctx.globals.compactBuffer('${node['src']}', '${node['dst']}', ${flags}, ${counter});`);
+    }
+    else if (node.op === 'cmd_sort_buffer') {
+      const hasCount = node['count'] !== undefined || edges.some(e => e.to === node.id && e.portIn === 'count' && e.type === 'data');
+      const count = hasCount ? this.resolveArg(node, 'count', func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges) : 'Infinity';
+      const keyComponent = Number(node['key_component'] ?? 0);
+      const keys = node['keys'] !== undefined ? `'${node['keys']}'` : 'null';
+      const descending = node['descending'] === true ? 'true' : 'false';
+      lines.push(`${indent}await ctx.globals.sortBuffer('${node['src']}', '${node['dst']}', ${keyComponent}, ${keys}, ${descending}, ${count});`);
+    }
+    else if (node.op === 'cmd_reduce_buffer') {
+      const hasArg = (name: string) => node[name] !== undefined || edges.some(e => e.to === node.id && e.portIn === name && e.type === 'data');
+      const arg = (name: string, fallback: string) => hasArg(name) ? this.resolveArg(node, name, func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges) : fallback;
+      const mode = JSON.stringify(node['mode'] ?? 'sum');
+      const component = node['component'] !== undefined ? Number(node['component']) : -1;
+      const bins = node['bins'] !== undefined ? Number(node['bins']) : -1;
+      lines.push(`${indent}await ctx.globals.reduceBuffer('${node['src']}', '${node['dst']}', ${mode}, ${component}, ${arg('count', 'Infinity')}, ${bins}, ${arg('range_min', '0')}, ${arg('range_max', '1')});`);
+    }
+    else if (node.op === 'cmd_convolve_texture') {
+      const hasArg = (name: string) => node[name] !== undefined || edges.some(e => e.to === node.id && e.portIn === name && e.type === 'data');
+      const arg = (name: string, fallback: string) => hasArg(name) ? this.resolveArg(node, name, func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges) : fallback;
+      const kernel = node['kernel'] !== undefined ? `'${node['kernel']}'` : 'null';
+      const normalize = node['normalize'] === false ? 'false' : 'true';
+      lines.push(`${indent}await ctx.globals.convolveTexture('${node['src']}', '${node['dst']}', ${kernel}, ${arg('radius', '0')}, ${arg('sigma', '0')}, ${normalize});`);
+    }
     else if (node.op === 'buffer_store') {
       const bufferId = node['buffer'];
       const idx = this.resolveArg(node, 'index', func, sanitizeId, nodeResId, funcName, allFunctions, inferredTypes, emitPure, edges);
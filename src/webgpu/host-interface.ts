@@ -185,4 +185,34 @@ export interface RuntimeGlobals {
   copyTexture(srcId: string, dstId: string, srcRect: [number, number, number, number] | null,
               dstRect: [number, number, number, number] | null, sample: string | null,
               alpha: number, normalized: boolean): void;
+
+  /**
+   * Blur a whole texture into another of the same size with a separable Gaussian or box filter.
+   */
+  blurTexture(srcId: string, dstId: string, radius: number, sigma: number, mode: string): Promise<void>;
+
+  /**
+   * Prefix sum of a buffer's elements into another buffer (or in place); totalId receives the sum.
+   */
+  scanBuffer(srcId: string, dstId: string, inclusive: boolean, count: number, totalId: string | null): Promise<void>;
+
+  /**
+   * Copy the elements of a buffer whose flag is positive to the front of another; counterId receives how many.
+   */
+  compactBuffer(srcId: string, dstId: string, flagsId: string | null, counterId: string | null): Promise<void>;
+
+  /**
+   * Stable sort of a buffer's elements by a component of each (or by keysId, which is sorted with them).
+   */
+  sortBuffer(srcId: string, dstId: string, keyComponent: number, keysId: string | null, descending: boolean, count: number): Promise<void>;
+
+  /**
+   * Reduce a buffer or texture (sum/min/max/mean/argmin/argmax/histogram) into dstId from index 0.
+   */
+  reduceBuffer(srcId: string, dstId: string, mode: string, component: number, count: number, bins: number, rangeMin: number, rangeMax: number): Promise<void>;
+
+  /**
+   * Convolve a whole texture with a large kernel (kernelId's first channel, or a Gaussian of radius) through FFTs.
+   */
+  convolveTexture(srcId: string, dstId: string, kernelId: string | null, radius: number, sigma: number, normalize: boolean): Promise<void>;
 }
@@ -115,6 +115,226 @@ const _buffer_load = (resources, id, idx) => {
   return res.data[idx];
 };
 
+// Whole-resource commands on the CPU copies of resources (state.data). The
+// interpreter and mock executor share these algorithms from
+// runtime/resource-ops.ts; keep the two in step.
+
+// Texture edges follow the sampler's wrap mode (repeat without a sampler)
+const _wrap_index = (i, n, wrap) => {
+  if (wrap === 'clamp') return Math.max(0, Math.min(n - 1, i));
+  if (wrap === 'mirror') {
+    const m = ((i % (2 * n)) + 2 * n) % (2 * n);
+    return m >= n ? 2 * n - 1 - m : m;
+  }
+  return ((i % n) + n) % n;
+};
+
+const _texel = (v) => Array.isArray(v) ? v : [v, v, v, v];
+
+// Elements a buffer holds: its declared size, or its data if longer (data
+// the graph never wrote may still be empty)
+const _capacity = (res) => Math.max(res.data ? res.data.length : 0, res.width);
+
+// Components per element, from the data or else the declared vector type
+const _components = (res) => {
+  if (res.data && Array.isArray(res.data[0])) return res.data[0].length;
+  const m = /([234])$/.exec((res.def && res.def.dataType) || '');
+  return m ? Number(m[1]) : 1;
+};
+
+const _gaussian_weights = (r, sigma, normalize = true) => {
+  const w = [];
+  let sum = 0;
+  for (let k = -r; k <= r; k++) {
+    const v = Math.exp(-0.5 * k * k / (sigma * sigma));
+    w.push(v);
+    sum += v;
+  }
+  return normalize ? w.map(v => v / sum) : w;
+};
+
+// out(p) = sum_k weights[k] * in(p + k - r) along x (axis 0) or y (axis 1)
+const _filter_axis = (src, w, h, weights, axis, wrap) => {
+  const r = (weights.length - 1) / 2;
+  const out = new Array(w * h);
+  for (let y = 0; y < h; y++) {
+    for (let x = 0; x < w; x++) {
+      const acc = [0, 0, 0, 0];
+      for (let k = 0; k < weights.length; k++) {
+        const sx = axis === 0 ? _wrap_index(x + k - r, w, wrap) : x;
+        const sy = axis === 1 ? _wrap_index(y + k - r, h, wrap) : y;
+        const p = src[sy * w + sx];
+        for (let c = 0; c < 4; c++) acc[c] += weights[k] * p[c];
+      }
+      out[y * w + x] = acc;
+    }
+  }
+  return out;
+};
+
+const _blur_texture = (src, dst, radius, sigma, mode) => {
+  if (!src.data) return;
+  const w = src.width, h = src.height;
+  if (dst.width !== w || dst.height !== h || src.data.length < w * h) return;
+  const pixels = src.data.slice(0, w * h).map(v => _texel(v).slice());
+  const r = Math.round(Math.max(0, radius));
+  if (r <= 0) {
+    dst.data = pixels;
+    return;
+  }
+  const weights = mode === 'box'
+    ? new Array(2 * r + 1).fill(1 / (2 * r + 1))
+    : _gaussian_weights(r, sigma > 0 ? sigma : r / 3);
+  const wrap = (src.def && src.def.sampler && src.def.sampler.wrap) || 'repeat';
+  dst.data = _filter_axis(_filter_axis(pixels, w, h, weights, 0, wrap), w, h, weights, 1, wrap);
+};
+
+const _scan_buffer = (src, dst, inclusive, count, total) => {
+  if (!src.data || !dst.data) return;
+  let n = Math.min(src.data.length, _capacity(dst));
+  if (count !== Infinity && count >= 0) n = Math.min(n, count);
+  const add = (a, b) => Array.isArray(a) ? a.map((v, i) => v + b[i]) : a + b;
+  let sum = Array.isArray(src.data[0]) ? src.data[0].map(() => 0) : 0;
+  for (let i = 0; i < n; i++) {
+    const before = sum;
+    sum = add(sum, src.data[i]);
+    dst.data[i] = inclusive ? sum : before;
+  }
+  if (total && total.data && _capacity(total) > 0) total.data[0] = sum;
+};
+
+// Flags come from a separate buffer, or each element's first component
+const _compact_buffer = (src, dst, flags, counter) => {
+  if (!src.data || !dst.data) return;
+  const f = flags ? flags.data : src.data;
+  if (!f) return;
+  const n = Math.min(src.data.length, f.length);
+  let kept = 0;
+  const capacity = _capacity(dst);
+  for (let i = 0; i < n && kept < capacity; i++) {
+    const flag = Array.isArray(f[i]) ? f[i][0] : f[i];
+    if (flag > 0) dst.data[kept++] = src.data[i];
+  }
+  if (counter && counter.data && _capacity(counter) > 0) counter.data[0] = kept;
+};
+
+// Stable sort by a component of each element, or by a keys buffer that is
+// sorted along with the elements
+const _sort_buffer = (src, dst, keyComponent, keys, descending, count) => {
+  if (!src.data || !dst.data) return;
+  const k = keys ? keys.data : null;
+  if (keys && !k) return;
+  let n = Math.min(src.data.length, _capacity(dst), k ? k.length : Infinity);
+  if (count !== Infinity && count >= 0) n = Math.min(n, count);
+  const keyOf = (i) => {
+    if (k) return k[i];
+    const v = src.data[i];
+    return Array.isArray(v) ? v[keyComponent] : v;
+  };
+  const order = Array.from({ length: n }, (_, i) => i);
+  order.sort((a, b) => descending ? keyOf(b) - keyOf(a) : keyOf(a) - keyOf(b));
+  const sorted = order.map(i => src.data[i]);
+  const sortedKeys = k ? order.map(i => k[i]) : null;
+  for (let i = 0; i < n; i++) {
+    dst.data[i] = sorted[i];
+    if (sortedKeys) k[i] = sortedKeys[i];
+  }
+};
+
+// sum/min/max/mean per component (or of component), argmin/argmax, or a
+// histogram of component over [rangeMin, rangeMax), into dst from index 0
+const _reduce_buffer = (src, dst, mode, component, count, bins, rangeMin, rangeMax) => {
+  if (!src.data || !dst.data) return;
+  let n = src.data.length;
+  if (count !== Infinity && count >= 0) n = Math.min(n, count);
+  const width = Array.isArray(src.data[0]) ? src.data[0].length : 1;
+  const at = (i, c) => Array.isArray(src.data[i]) ? src.data[i][c] : src.data[i];
+  const key = Math.max(component, 0);
+  const capacity = _capacity(dst);
+  if (mode === 'histogram') {
+    const binCount = Math.min(bins >= 0 ? bins : capacity, capacity);
+    const counts = new Array(binCount).fill(0);
+    const scale = rangeMax > rangeMin ? binCount / (rangeMax - rangeMin) : 0;
+    for (let i = 0; i < n; i++) {
+      const v = at(i, key);
+      if (Number.isNaN(v)) continue;
+      counts[Math.min(binCount - 1, Math.max(0, Math.floor((v - rangeMin) * scale)))]++;
+    }
+    counts.forEach((c, k) => { dst.data[k] = c; });
+    return;
+  }
+  if (mode === 'argmin' || mode === 'argmax') {
+    let best = -1;
+    for (let i = 0; i < n; i++) {
+      const v = at(i, key);
+      if (Number.isNaN(v)) continue;
+      if (best < 0 || (mode === 'argmin' ? v < at(best, key) : v > at(best, key))) best = i;
+    }
+    dst.data[0] = best;
+    return;
+  }
+  const components = component >= 0 ? [component] : Array.from({ length: width }, (_, c) => c);
+  const results = components.map(c => {
+    let total = 0, min = Infinity, max = -Infinity, seen = false;
+    for (let i = 0; i < n; i++) {
+      const v = at(i, c);
+      total += v;
+      if (Number.isNaN(v)) continue;
+      min = Math.min(min, v);
+      max = Math.max(max, v);
+      seen = true;
+    }
+    if (mode === 'min') return seen ? min : 0;
+    if (mode === 'max') return seen ? max : 0;
+    if (mode === 'mean') return n > 0 ? total / n : 0;
+    return total;
+  });
+  // Vector results fill element 0 of a vector buffer
+  if (_components(dst) > 1 && results.length > 1) dst.data[0] = results;
+  else results.forEach((v, k) => { if (k < capacity) dst.data[k] = v; });
+};
+
+// Convolution with the first channel of a kernel texture, centred on its
+// middle texel, or a Gaussian of radius (as two separable passes). The C++
+// runtime does this through FFTs.
+const _convolve_texture = (src, dst, kernel, radius, sigma, normalize) => {
+  if (!src.data) return;
+  const w = src.width, h = src.height;
+  if (dst.width !== w || dst.height !== h || src.data.length < w * h) return;
+  const pixels = src.data.slice(0, w * h).map(_texel);
+  const wrap = (src.def && src.def.sampler && src.def.sampler.wrap) || 'repeat';
+  if (!kernel) {
+    const r = Math.round(Math.max(0, radius));
+    const weights = _gaussian_weights(r, sigma > 0 ? sigma : Math.max(r, 1) / 3, normalize);
+    dst.data = _filter_axis(_filter_axis(pixels, w, h, weights, 0, wrap), w, h, weights, 1, wrap);
+    return;
+  }
+  if (!kernel.data) return;
+  const kw = kernel.width, kh = kernel.height;
+  if (kw <= 0 || kh <= 0 || kernel.data.length < kw * kh) return;
+  const taps = kernel.data.slice(0, kw * kh).map(v => _texel(v)[0]);
+  const sum = taps.reduce((s, v) => s + v, 0);
+  const scale = normalize && sum !== 0 ? 1 / sum : 1;
+  const cx = Math.floor(kw / 2), cy = Math.floor(kh / 2);
+  const out = new Array(w * h);
+  for (let y = 0; y < h; y++) {
+    for (let x = 0; x < w; x++) {
+      const acc = [0, 0, 0, 0];
+      for (let ky = 0; ky < kh; ky++) {
+        const sy = _wrap_index(y - (ky - cy), h, wrap);
+        for (let kx = 0; kx < kw; kx++) {
+          const t = taps[ky * kw + kx] * scale;
+          if (t === 0) continue;
+          const p = pixels[sy * w + _wrap_index(x - (kx - cx), w, wrap)];
+          for (let c = 0; c < 4; c++) acc[c] += t * p[c];
+        }
+      }
+      out[y * w + x] = acc;
+    }
+  }
+  dst.data = out;
+};
+
 const _createExecutor = (device, pipelines, precomputedInfos, renderPipelines, resourceInfos = new Map()) => {
   const writeOp = (view, op, val, baseOffset = 0) => {
     if (val === undefined || val === null) return;
@@ -172,7 +392,28 @@ const _createExecutor = (device, pipelines, precomputedInfos, renderPipelines, r
   // Map<ResourceId, { buffer: GPUBuffer, bytesPerRow?: number, type: 'buffer'|'texture' }>
   const activeReadbacks = new Map();
 
-  return {
+  // CPU-side commands work on state.data: resources the GPU has written are
+  // read back first, and the ones written here upload with the next dispatch
+  // that binds them.
+  const syncForCpu = async (resources, ids) => {
+    for (const id of ids) {
+      const state = id ? resources.get(id) : undefined;
+      if (!state || !state.flags || !state.flags.gpuDirty) continue;
+      executor.executeSyncToCpu(id, resources);
+      await executor.executeWaitCpuSync(id, resources);
+    }
+  };
+  const markCpuWritten = (resources, ids) => {
+    for (const id of ids) {
+      const state = id ? resources.get(id) : undefined;
+      if (!state) continue;
+      if (!state.flags) state.flags = { cpuDirty: false, gpuDirty: false };
+      state.flags.cpuDirty = true;
+      state.flags.gpuDirty = false;
+    }
+  };
+
+  const executor = {
     async executeShader(funcId, dim, args, resources) {
       const info = precomputedInfos.get(funcId);
       if (!info) throw new Error("Precomputed info not found: " + funcId);
@@ -808,8 +1049,66 @@ fn main(@builtin(global_invocation_id) gid: vec3<u32>) {
           }
         }
       }
+    },
+
+    async executeBlurTexture(srcId, dstId, radius, sigma, mode, resources) {
+      const src = resources.get(srcId);
+      const dst = resources.get(dstId);
+      if (!src || !dst) return;
+      await syncForCpu(resources, [srcId, dstId]);
+      _blur_texture(src, dst, radius, sigma, mode);
+      markCpuWritten(resources, [dstId]);
+    },
+
+    async executeScanBuffer(srcId, dstId, inclusive, count, totalId, resources) {
+      const src = resources.get(srcId);
+      const dst = resources.get(dstId);
+      if (!src || !dst) return;
+      await syncForCpu(resources, [srcId, dstId, totalId]);
+      _scan_buffer(src, dst, inclusive, count, totalId ? resources.get(totalId) : null);
+      markCpuWritten(resources, [dstId, totalId]);
+    },
+
+    async executeCompactBuffer(srcId, dstId, flagsId, counterId, resources) {
+      const src = resources.get(srcId);
+      const dst = resources.get(dstId);
+      if (!src || !dst) return;
+      if (flagsId && !resources.get(flagsId)) return;
+      await syncForCpu(resources, [srcId, dstId, flagsId, counterId]);
+      _compact_buffer(src, dst, flagsId ? resources.get(flagsId) : null, counterId ? resources.get(counterId) : null);
+      markCpuWritten(resources, [dstId, counterId]);
+    },
+
+    async executeSortBuffer(srcId, dstId, keyComponent, keysId, descending, count, resources) {
+      const src = resources.get(srcId);
+      const dst = resources.get(dstId);
+      if (!src || !dst) return;
+      if (keysId && !resources.get(keysId)) return;
+      await syncForCpu(resources, [srcId, dstId, keysId]);
+      _sort_buffer(src, dst, keyComponent, keysId ? resources.get(keysId) : null, descending, count);
+      markCpuWritten(resources, [dstId, keysId]);
+    },
+
+    async executeReduceBuffer(srcId, dstId, mode, component, count, bins, rangeMin, rangeMax, resources) {
+      const src = resources.get(srcId);
+      const dst = resources.get(dstId);
+      if (!src || !dst) return;
+      await syncForCpu(resources, [srcId, dstId]);
+      _reduce_buffer(src, dst, mode, component, count, bins, rangeMin, rangeMax);
+      markCpuWritten(resources, [dstId]);
+    },
+
+    async executeConvolveTexture(srcId, dstId, kernelId, radius, sigma, normalize, resources) {
+      const src = resources.get(srcId);
+      const dst = resources.get(dstId);
+      if (!src || !dst) return;
+      if (kernelId && !resources.get(kernelId)) return;
+      await syncForCpu(resources, [srcId, dstId, kernelId]);
+      _convolve_texture(src, dst, kernelId ? resources.get(kernelId) : null, radius, sigma, normalize);
+      markCpuWritten(resources, [dstId]);
     }
   };
+  return executor;
 };
 
 const _ensureGpuResource = (device, state, info) => {
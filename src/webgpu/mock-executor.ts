@@ -2,6 +2,7 @@ import { IRDocument } from '../ir/types';
 import { CompiledJitResult } from './cpu-jit';
 import { ResourceState, RuntimeValue, RenderPipelineDef } from './host-interface';
 import { IGpuExecutor } from './webgpu-host';
+import { blurTexture, compactBuffer, convolveTexture, reduceBuffer, scanBuffer, sortBuffer } from '../runtime/resource-ops';
 
 /**
  * A mock executor that doesn't require a real GPUDevice.
@@ -43,6 +44,42 @@ export class MockGpuExecutor implements IGpuExecutor {
                      alpha: number, normalized: boolean, resources: Map<string, ResourceState>): void {
     console.log(`[MockGpuExecutor] executeCopyTexture: ${srcId} -> ${dstId}`);
   }
+
+  async executeBlurTexture(srcId: string, dstId: string, radius: number, sigma: number, mode: string,
+                           resources: Map<string, ResourceState>): Promise<void> {
+    // CPU-only fallback for mock
+    blurTexture(resources, srcId, dstId, radius, sigma, mode);
+  }
+
+  async executeScanBuffer(srcId: string, dstId: string, inclusive: boolean, count: number, totalId: string | null,
+                          resources: Map<string, ResourceState>): Promise<void> {
+    // CPU-only fallback for mock
+    scanBuffer(resources, srcId, dstId, inclusive, count, totalId);
+  }
+
+  async executeCompactBuffer(srcId: string, dstId: string, flagsId: string | null, counterId: string | null,
+                             resources: Map<string, ResourceState>): Promise<void> {
+    // CPU-only fallback for mock
+    compactBuffer(resources, srcId, dstId, flagsId, counterId);
+  }
+
+  async executeSortBuffer(srcId: string, dstId: string, keyComponent: number, keysId: string | null, descending: boolean,
+                          count: number, resources: Map<string, ResourceState>): Promise<void> {
+    // CPU-only fallback for mock
+    sortBuffer(resources, srcId, dstId, keyComponent, keysId, descending, count);
+  }
+
+  async executeReduceBuffer(srcId: string, dstId: string, mode: string, component: number, count: number, bins: number,
+                            rangeMin: number, rangeMax: number, resources: Map<string, ResourceState>): Promise<void> {
+    // CPU-only fallback for mock
+    reduceBuffer(resources, srcId, dstId, mode, component, count, bins, rangeMin, rangeMax);
+  }
+
+  async executeConvolveTexture(srcId: string, dstId: string, kernelId: string | null, radius: number, sigma: number,
+                               normalize: boolean, resources: Map<string, ResourceState>): Promise<void> {
+    // CPU-only fallback for mock
+    convolveTexture(resources, srcId, dstId, kernelId, radius, sigma, normalize);
+  }
 }
 
 /**
@@ -13,6 +13,18 @@ export interface IGpuExecutor {
   executeCopyTexture(srcId: string, dstId: string, srcRect: [number, number, number, number] | null,
                      dstRect: [number, number, number, number] | null, sample: string | null,
                      alpha: number, normalized: boolean, resources: Map<string, ResourceState>): void;
+  executeBlurTexture(srcId: string, dstId: string, radius: number, sigma: number, mode: string,
+                     resources: Map<string, ResourceState>): Promise<void>;
+  executeScanBuffer(srcId: string, dstId: string, inclusive: boolean, count: number, totalId: string | null,
+                    resources: Map<string, ResourceState>): Promise<void>;
+  executeCompactBuffer(srcId: string, dstId: string, flagsId: string | null, counterId: string | null,
+                       resources: Map<string, ResourceState>): Promise<void>;
+  executeSortBuffer(srcId: string, dstId: string, keyComponent: number, keysId: string | null, descending: boolean,
+                    count: number, resources: Map<string, ResourceState>): Promise<void>;
+  executeReduceBuffer(srcId: string, dstId: string, mode: string, component: number, count: number, bins: number,
+                      rangeMin: number, rangeMax: number, resources: Map<string, ResourceState>): Promise<void>;
+  executeConvolveTexture(srcId: string, dstId: string, kernelId: string | null, radius: number, sigma: number,
+                         normalize: boolean, resources: Map<string, ResourceState>): Promise<void>;
 }
 
 /**
@@ -124,6 +136,30 @@ export class WebGpuHost implements RuntimeGlobals {
     this.executor.executeCopyTexture(srcId, dstId, srcRect, dstRect, sample, alpha, normalized, this.resources);
   }
 
+  async blurTexture(srcId: string, dstId: string, radius: number, sigma: number, mode: string): Promise<void> {
+    await this.executor.executeBlurTexture(srcId, dstId, radius, sigma, mode, this.resources);
+  }
+
+  async scanBuffer(srcId: string, dstId: string, inclusive: boolean, count: number, totalId: string | null): Promise<void> {
+    await this.executor.executeScanBuffer(srcId, dstId, inclusive, count, totalId, this.resources);
+  }
+
+  async compactBuffer(srcId: string, dstId: string, flagsId: string | null, counterId: string | null): Promise<void> {
+    await this.executor.executeCompactBuffer(srcId, dstId, flagsId, counterId, this.resources);
+  }
+
+  async sortBuffer(srcId: string, dstId: string, keyComponent: number, keysId: string | null, descending: boolean, count: number): Promise<void> {
+    await this.executor.executeSortBuffer(srcId, dstId, keyComponent, keysId, descending, count, this.resources);
+  }
+
+  async reduceBuffer(srcId: string, dstId: string, mode: string, component: number, count: number, bins: number, rangeMin: number, rangeMax: number): Promise<void> {
+    await this.executor.executeReduceBuffer(srcId, dstId, mode, component, count, bins, rangeMin, rangeMax, this.resources);
+  }
+
+  async convolveTexture(srcId: string, dstId: string, kernelId: string | null, radius: number, sigma: number, normalize: boolean): Promise<void> {
+    await this.executor.executeConvolveTexture(srcId, dstId, kernelId, radius, sigma, normalize, this.resources);
+  }
+
   log(message: string, payload?: any): void {
     if (this.logHandler) {
       this.logHandler(message, payload);